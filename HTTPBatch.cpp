@@ -0,0 +1,354 @@
+/* HTTPBatch.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPBatch.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPBatch.h"
+#include "util/HTTPTime.h"
+
+#include <cstring>
+#include <cstdlib>
+
+#define STATE_ACTIVE 0x80000000u //Half being filled
+#define STATE_SEALED 0x40000000u //The other half waits to be posted
+#define STATE_LEN_BITS 15
+#define STATE_LEN_MASK 0x7FFFu
+
+static uint32_t getLen(uint32_t state, int half)
+{
+  return (state >> (half * STATE_LEN_BITS)) & STATE_LEN_MASK;
+}
+
+static uint32_t setLen(uint32_t state, int half, uint32_t len)
+{
+  return (state & ~(STATE_LEN_MASK << (half * STATE_LEN_BITS))) | (len << (half * STATE_LEN_BITS));
+}
+
+static int getActive(uint32_t state)
+{
+  return (state & STATE_ACTIVE) ? 1 : 0;
+}
+
+HTTPBatch::HTTPBatch(HTTPClient& client, HTTPEndpoint& endpoint, size_t size) : m_client(client), m_endpoint(endpoint), m_owned(true)
+{
+  size = MIN(size, (size_t)HTTP_BATCH_MAX_SIZE);
+  m_buf = (char*) malloc(size);
+  if(m_buf == NULL)
+  {
+    WARN("Could not allocate %d bytes", (int)size);
+    size = 0;
+  }
+  init(size);
+}
+
+HTTPBatch::HTTPBatch(HTTPClient& client, HTTPEndpoint& endpoint, char* arena, size_t size) : m_client(client), m_endpoint(endpoint), m_buf(arena), m_owned(false)
+{
+  init(MIN(size, (size_t)HTTP_BATCH_MAX_SIZE));
+}
+
+HTTPBatch::~HTTPBatch()
+{
+  if(m_owned)
+  {
+    free(m_buf);
+  }
+}
+
+void HTTPBatch::setThresholds(size_t maxLen, size_t maxCount, uint32_t window /*= HTTP_BATCH_DEFAULT_WINDOW*/)
+{
+  m_maxLen = MAX(MIN(maxLen, m_halfSize), (size_t)1);
+  m_maxCount = maxCount;
+  m_window = window;
+}
+
+void HTTPBatch::setFraming(const char* prefix, const char* separator, const char* suffix)
+{
+  m_prefix = prefix;
+  m_separator = separator;
+  m_suffix = suffix;
+}
+
+void HTTPBatch::setContentType(const char* type)
+{
+  m_type = type;
+}
+
+int HTTPBatch::add(const char* record, size_t len /*= 0*/)
+{
+  if(len == 0)
+  {
+    len = strlen(record);
+  }
+  size_t separatorLen = strlen(m_separator);
+  if(len + separatorLen > m_halfSize)
+  {
+    return NET_INVALID;
+  }
+  while(true)
+  {
+    uint32_t state = m_state;
+    int half = getActive(state);
+    uint32_t pos = getLen(state, half);
+    size_t recordLen = (pos == 0) ? len : (separatorLen + len);
+    if(pos + recordLen > m_halfSize)
+    {
+      //The half is full: it is sealed so that the record goes to the other half
+      if(state & STATE_SEALED)
+      {
+        __sync_fetch_and_add(&m_dropped, 1);
+        return NET_FULL;
+      }
+      swap(state); //Fails if another thread swapped the halves or reserved room meanwhile, either way the state is read again
+      continue;
+    }
+    if( !__sync_bool_compare_and_swap(&m_state, state, setLen(state, half, pos + recordLen)) )
+    {
+      continue;
+    }
+
+    //The room is reserved, the half cannot be posted before its length was written
+    char* buf = m_buf + half * m_halfSize + pos;
+    if(pos > 0)
+    {
+      memcpy(buf, m_separator, separatorLen);
+      buf += separatorLen;
+    }
+    memcpy(buf, record, len);
+    if(pos == 0)
+    {
+      m_firstTime[half] = HTTPTime::getMs();
+      __sync_synchronize(); //The time is set before the flag
+      m_firstSet[half] = true;
+    }
+    __sync_fetch_and_add(&m_count[half], 1);
+    __sync_fetch_and_add(&m_written[half], recordLen); //Full barrier, the record is visible to the flushing thread once counted
+    return OK;
+  }
+}
+
+int HTTPBatch::poll(uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  uint32_t state = m_state;
+  if(state & STATE_SEALED)
+  {
+    //Sealed by a producer as it was full, or kept after a failure, in which case it is posted again once the time window expired
+    if( m_failed && (HTTPTime::elapsed(m_failedTime) < m_window) )
+    {
+      return OK;
+    }
+    return post(timeout);
+  }
+
+  int half = getActive(state);
+  uint32_t len = getLen(state, half);
+  bool due = (len >= m_maxLen) || ( (m_maxCount != 0) && (m_count[half] >= m_maxCount) ) || ( m_firstSet[half] && (HTTPTime::elapsed(m_firstTime[half]) >= m_window) );
+  if(!due)
+  {
+    return OK;
+  }
+  while( !swap(state) )
+  {
+    state = m_state;
+    if(state & STATE_SEALED)
+    {
+      break; //Swapped by a producer meanwhile
+    }
+  }
+  return post(timeout);
+}
+
+int HTTPBatch::flush(uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  uint32_t state = m_state;
+  if(state & STATE_SEALED)
+  {
+    int ret = post(timeout);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    state = m_state;
+  }
+  if( getLen(state, getActive(state)) == 0 )
+  {
+    return OK;
+  }
+  while( !swap(state) )
+  {
+    state = m_state;
+    if(state & STATE_SEALED)
+    {
+      break;
+    }
+  }
+  return post(timeout);
+}
+
+uint32_t HTTPBatch::getDropped()
+{
+  return m_dropped;
+}
+
+uint32_t HTTPBatch::getPosted()
+{
+  return m_posted;
+}
+
+/*virtual*/ int HTTPBatch::read(char* buf, size_t len, size_t* pReadLen)
+{
+  //The prefix, the records and the suffix, one after the other
+  const char* parts[3] = { m_prefix, m_readBuf, m_suffix };
+  size_t lens[3] = { strlen(m_prefix), m_readLen, strlen(m_suffix) };
+  size_t pos = m_readPos;
+  *pReadLen = 0;
+  for(int i = 0; (i < 3) && (*pReadLen < len); i++)
+  {
+    if(pos >= lens[i])
+    {
+      pos -= lens[i];
+      continue;
+    }
+    size_t partLen = MIN(lens[i] - pos, len - *pReadLen);
+    memcpy(buf + *pReadLen, parts[i] + pos, partLen);
+    *pReadLen += partLen;
+    pos = 0;
+  }
+  m_readPos += *pReadLen;
+  return OK;
+}
+
+/*virtual*/ int HTTPBatch::getDataType(char* type, size_t maxTypeLen) //Internet media type for Content-Type header
+{
+  strncpy(type, m_type, maxTypeLen-1);
+  type[maxTypeLen-1] = '\0';
+  return OK;
+}
+
+/*virtual*/ bool HTTPBatch::getIsChunked() //For Transfer-Encoding header
+{
+  return false; //The batch is complete once sealed
+}
+
+/*virtual*/ size_t HTTPBatch::getDataLen() //For Content-Length header
+{
+  return strlen(m_prefix) + m_readLen + strlen(m_suffix);
+}
+
+/*virtual*/ bool HTTPBatch::rewind()
+{
+  m_readPos = 0;
+  return true;
+}
+
+void HTTPBatch::init(size_t size)
+{
+  m_halfSize = MIN(size / 2, (size_t)STATE_LEN_MASK);
+  m_maxLen = MAX(m_halfSize, (size_t)1);
+  m_maxCount = 0;
+  m_window = HTTP_BATCH_DEFAULT_WINDOW;
+  m_prefix = "";
+  m_separator = "\n";
+  m_suffix = "";
+  m_type = "text/plain";
+  m_state = 0;
+  for(int i = 0; i < 2; i++)
+  {
+    m_written[i] = 0;
+    m_count[i] = 0;
+    m_firstTime[i] = 0;
+    m_firstSet[i] = false;
+  }
+  m_dropped = 0;
+  m_posted = 0;
+  m_failedTime = 0;
+  m_failed = false;
+  m_readBuf = NULL;
+  m_readLen = 0;
+  m_readPos = 0;
+}
+
+bool HTTPBatch::swap(uint32_t state) //Seal the half being filled and start filling the other one, false if the other one is in use
+{
+  if(state & STATE_SEALED)
+  {
+    return false;
+  }
+  //The length of the other half was cleared when it was posted
+  return __sync_bool_compare_and_swap(&m_state, state, (state ^ STATE_ACTIVE) | STATE_SEALED);
+}
+
+int HTTPBatch::post(uint32_t timeout) //Post the sealed half
+{
+  uint32_t state = m_state;
+  int half = 1 - getActive(state);
+  uint32_t len = getLen(state, half);
+
+  //Producers that reserved room before the halves were swapped may still be copying their records
+  while(__sync_fetch_and_add(&m_written[half], 0) != len) //Full barrier, the records are read after their length
+  {
+    HTTPTime::sleep(1);
+  }
+
+  m_readBuf = m_buf + half * m_halfSize;
+  m_readLen = len;
+  m_readPos = 0;
+  DBG("Posting %d records (%d bytes)", m_count[half], len);
+  int ret = m_client.post(m_endpoint, *this, NULL, timeout);
+  int code = m_client.getHTTPResponseCode();
+  if( (ret != OK) && ( (code < 400) || (code >= 500) || (code == 408) || (code == 429) ) )
+  {
+    WARN("Could not post %d records (%d), keeping them", m_count[half], ret);
+    m_failed = true;
+    m_failedTime = HTTPTime::getMs();
+    return ret;
+  }
+  if(ret != OK)
+  {
+    //Sending the same data again would not help
+    ERR("Batch of %d records rejected with code %d, dropping it", m_count[half], code);
+    __sync_fetch_and_add(&m_dropped, m_count[half]);
+  }
+  else
+  {
+    m_posted++;
+  }
+  m_failed = false;
+
+  //The half can be filled again
+  m_count[half] = 0;
+  m_written[half] = 0;
+  m_firstSet[half] = false;
+  do
+  {
+    state = m_state;
+  } while( !__sync_bool_compare_and_swap(&m_state, state, setLen(state, half, 0) & ~STATE_SEALED) );
+  return ret;
+}
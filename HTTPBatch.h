@@ -0,0 +1,181 @@
+/* HTTPBatch.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPBATCH_H_
+#define HTTPBATCH_H_
+
+#include "HTTPClient.h"
+
+#define HTTP_BATCH_MAX_SIZE 65534 //Largest storage, as each half is tracked on 15 bits
+#define HTTP_BATCH_DEFAULT_WINDOW 10000
+
+/** Aggregator posting many small records (e.g. sensor readings) as one request
+ * Records are appended to one half of a double buffer, while the other half is being posted: producers never wait for the network.
+ * The buffer is posted when it reaches a length or a number of records, or when its first record is older than a time window.
+ * Records are separated by a separator (a new line by default), and the whole batch can be wrapped, e.g. into a JSON array:
+ * @code
+ * HTTPClient client;
+ * HTTPEndpoint endpoint;
+ * endpoint.setUrl("http://example.com/telemetry");
+ * HTTPBatch batch(client, endpoint, 4096);
+ * batch.setFraming("[", ",", "]");
+ * batch.setContentType("application/json");
+ *
+ * //Any thread, or an interrupt handler
+ * batch.add("{\"t\":21.5}");
+ *
+ * //Flushing thread
+ * while(true)
+ * {
+ *   batch.poll();
+ *   Thread::wait(100);
+ * }
+ * @endcode
+ * Adding a record is lock-free, with the GCC __sync atomic builtins (ARMv7-M and above on the mbed target).
+ * A batch that could not be posted is kept and posted again at the next poll() once the time window expired;
+ * meanwhile the records that do not fit in the other half are dropped. A batch rejected with a 4xx code (other than 408 and 429) is dropped as well.
+ */
+class HTTPBatch : public IHTTPDataOut
+{
+public:
+  /** Instantiate an aggregator that allocates its storage once
+   * @param client Client posting the batches, used by the flushing thread only
+   * @param endpoint Endpoint to post the batches to, must remain valid as long as the aggregator is in use
+   * @param size Size of the storage, split into two halves (at most HTTP_BATCH_MAX_SIZE)
+   */
+  HTTPBatch(HTTPClient& client, HTTPEndpoint& endpoint, size_t size);
+
+  /** Instantiate an aggregator that uses a caller-provided arena
+   * @param client Client posting the batches, used by the flushing thread only
+   * @param endpoint Endpoint to post the batches to, must remain valid as long as the aggregator is in use
+   * @param arena Storage, must remain valid as long as the aggregator is in use
+   * @param size Size of the arena, split into two halves (at most HTTP_BATCH_MAX_SIZE)
+   */
+  HTTPBatch(HTTPClient& client, HTTPEndpoint& endpoint, char* arena, size_t size);
+
+  ~HTTPBatch();
+
+  /** Set when a batch is posted, whichever comes first
+   * Must be called before records are added
+   * @param maxLen Length of the records, the batch is also posted when the next record does not fit (default: half the storage)
+   * @param maxCount Number of records, 0 for no limit (default)
+   * @param window Age of the first record in ms (HTTP_BATCH_DEFAULT_WINDOW by default)
+   */
+  void setThresholds(size_t maxLen, size_t maxCount, uint32_t window = HTTP_BATCH_DEFAULT_WINDOW);
+
+  /** Set how records are put together
+   * Must be called before records are added
+   * @param prefix Sent before the first record, must remain valid as long as the aggregator is in use
+   * @param separator Stored between two records ("\n" by default), must remain valid as long as the aggregator is in use
+   * @param suffix Sent after the last record, must remain valid as long as the aggregator is in use
+   */
+  void setFraming(const char* prefix, const char* separator, const char* suffix);
+
+  /** Set the Content-Type of the batches ("text/plain" by default)
+   * @param type Internet media type, must remain valid as long as the aggregator is in use
+   */
+  void setContentType(const char* type);
+
+  /** Add a record, from any thread or interrupt handler
+   * Never blocks
+   * @param record Record to add
+   * @param len Length of the record, 0 to use strlen(record)
+   * @return 0 on success, NET_FULL if the record was dropped as both halves are in use, NET_INVALID if it cannot fit in a half
+   */
+  int add(const char* record, size_t len = 0);
+
+  /** Post the batch being filled if it is due, or the batch that could not be posted
+   * To be called regularly by a single thread, blocks while posting
+   * @param timeout Timeout of the request in ms
+   * @return 0 if nothing was due or the batch was posted, NET error if it could not be posted (it is kept, unless the server rejected it with a 4xx code)
+   */
+  int poll(uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Post the records added so far, e.g. before going to sleep
+   * To be called by the thread that calls poll()
+   * @param timeout Timeout of the request in ms
+   * @return 0 on success (or if there was nothing to post), NET error if the records could not be posted (they are kept)
+   */
+  int flush(uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Get the number of records dropped so far
+   */
+  uint32_t getDropped();
+
+  /** Get the number of batches posted so far
+   */
+  uint32_t getPosted();
+
+protected:
+  //IHTTPDataOut
+  virtual int read(char* buf, size_t len, size_t* pReadLen);
+
+  virtual int getDataType(char* type, size_t maxTypeLen); //Internet media type for Content-Type header
+
+  virtual bool getIsChunked(); //For Transfer-Encoding header
+
+  virtual size_t getDataLen(); //For Content-Length header
+
+  virtual bool rewind(); //The batch is kept until it is posted
+
+private:
+  HTTPBatch(const HTTPBatch&); //Not copyable, producers keep using it
+  HTTPBatch& operator=(const HTTPBatch&);
+
+  void init(size_t size);
+  bool swap(uint32_t state); //Seal the half being filled and start filling the other one, false if the other one is in use
+  int post(uint32_t timeout); //Post the sealed half
+
+  HTTPClient& m_client;
+  HTTPEndpoint& m_endpoint;
+  char* m_buf;
+  size_t m_halfSize;
+  bool m_owned; //Allocated on the heap, as opposed to an arena
+
+  size_t m_maxLen;
+  size_t m_maxCount;
+  uint32_t m_window;
+  const char* m_prefix;
+  const char* m_separator;
+  const char* m_suffix;
+  const char* m_type;
+
+  //Half being filled in bit 31, whether the other half is sealed in bit 30, and the length reserved in each half on 15 bits (half 1 in the high bits),
+  //so that producers reserve room and the halves are swapped with a single compare-and-swap
+  volatile uint32_t m_state;
+  volatile uint32_t m_written[2]; //Length actually copied, which catches up with the reserved length once the producers are done
+  volatile uint32_t m_count[2];
+  volatile uint32_t m_firstTime[2]; //When the first record was added
+  volatile bool m_firstSet[2];
+  volatile uint32_t m_dropped;
+  uint32_t m_posted;
+  uint32_t m_failedTime; //When the sealed half could not be posted
+  bool m_failed;
+
+  //Sealed half being posted
+  const char* m_readBuf;
+  size_t m_readLen;
+  size_t m_readPos;
+};
+
+#endif /* HTTPBATCH_H_ */
@@ -21,7 +21,10 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
-#define __DEBUG__ 4 //Maximum verbosity
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
 #ifndef __MODULE__
 #define __MODULE__ "HTTPClient.cpp"
 #endif
@@ -29,24 +32,95 @@ SOFTWARE.
 #include "core/fwk.h"
 
 #include "HTTPClient.h"
+#include "util/HTTPTime.h"
+#include "util/HTTPScan.h"
+#include "util/HTTPSHA1.h"
+#include "util/HTTPBase64.h"
+#include "util/HTTPTrace.h"
+#include "HTTPWebSocket.h"
 
 #define HTTP_REQUEST_TIMEOUT 30000
-#define HTTP_PORT 80
 
 #define CHUNK_SIZE 256
 
+#ifndef HTTP_LOCATION_MAX_LEN
+#define HTTP_LOCATION_MAX_LEN (HTTP_ENDPOINT_SCHEME_MAX_LEN + 3 + HTTP_ENDPOINT_AUTHORITY_MAX_LEN + HTTP_ENDPOINT_PATH_MAX_LEN) //Absolute URL
+#endif
+
+#define LINE_MAX_LEN MAX(CHUNK_SIZE, HTTP_LOCATION_MAX_LEN + 16) //Status line, header or chunk header, the longest one needed being Location
+
 #include <cstring>
+#include <cctype>
+
+static bool equalsNoCase(const char* a, const char* b)
+{
+  while( (*a != '\0') && (tolower((unsigned char)*a) == tolower((unsigned char)*b)) )
+  {
+    a++;
+    b++;
+  }
+  return (*a == '\0') && (*b == '\0');
+}
+
+static bool isNeededHeader(const char* key, bool redirect, bool failed) //Headers read by recvResponse(), which cannot be skipped
+{
+  return equalsNoCase(key, "Content-Length") || equalsNoCase(key, "Transfer-Encoding") || equalsNoCase(key, "Content-Type") || equalsNoCase(key, "Connection")
+    || (redirect && equalsNoCase(key, "Location")) || (failed && equalsNoCase(key, "Retry-After"));
+}
+
+static bool hasToken(const char* list, const char* token) //Case-insensitive search in a comma-separated header value
+{
+  size_t tokenLen = strlen(token);
+  while(*list != '\0')
+  {
+    while( (*list == ' ') || (*list == '\t') || (*list == ',') )
+    {
+      list++;
+    }
+    size_t len = strcspn(list, ", \t");
+    size_t i = 0;
+    while( (i < len) && (i < tokenLen) && (tolower((unsigned char)list[i]) == tolower((unsigned char)token[i])) )
+    {
+      i++;
+    }
+    if( (len == tokenLen) && (i == len) )
+    {
+      return true;
+    }
+    list += len;
+  }
+  return false;
+}
 
 HTTPClient::HTTPClient() :
-m_basicAuthUser(NULL), m_basicAuthPassword(NULL), m_httpResponseCode(0)
+m_pTransport(&m_defaultTransport), m_pTLSTransport(NULL), m_pConnTransport(NULL), m_bodyTimeout(0), m_maxRedirects(HTTP_CLIENT_DEFAULT_MAX_REDIRECTS), m_pHeaderVisitor(NULL), m_headerNames(NULL), m_headerNamesCount(0),
+m_expectContinue(false), m_expectContinueMinLen(0), m_expectContinueTimeout(HTTP_CLIENT_DEFAULT_CONTINUE_TIMEOUT), m_keepAlive(false), m_maxRetries(0),
+m_retryBaseDelay(HTTP_CLIENT_DEFAULT_RETRY_DELAY), m_retryMaxDelay(HTTP_CLIENT_DEFAULT_RETRY_MAX_DELAY), m_retryPost(false), m_random(0), m_connected(false), m_connTime(0),
+m_basicAuthUser(NULL), m_basicAuthPassword(NULL), m_httpResponseCode(0), m_sent(false), m_received(false), m_recvResult(OK), m_retryAfterSet(false), m_retryAfter(0)
+{
+
+}
+
+HTTPClient::HTTPClient(IHTTPTransport* pTransport) :
+m_pTransport(pTransport), m_pTLSTransport(NULL), m_pConnTransport(NULL), m_bodyTimeout(0), m_maxRedirects(HTTP_CLIENT_DEFAULT_MAX_REDIRECTS), m_pHeaderVisitor(NULL), m_headerNames(NULL), m_headerNamesCount(0),
+m_expectContinue(false), m_expectContinueMinLen(0), m_expectContinueTimeout(HTTP_CLIENT_DEFAULT_CONTINUE_TIMEOUT), m_keepAlive(false), m_maxRetries(0),
+m_retryBaseDelay(HTTP_CLIENT_DEFAULT_RETRY_DELAY), m_retryMaxDelay(HTTP_CLIENT_DEFAULT_RETRY_MAX_DELAY), m_retryPost(false), m_random(0), m_connected(false), m_connTime(0),
+m_basicAuthUser(NULL), m_basicAuthPassword(NULL), m_httpResponseCode(0), m_sent(false), m_received(false), m_recvResult(OK), m_retryAfterSet(false), m_retryAfter(0)
 {
 
 }
 
 HTTPClient::~HTTPClient()
 {
+  closeConnection();
+}
 
+#ifdef HTTP_CLIENT_TLS
+void HTTPClient::setTLSTransport(HTTPTLSTransport* pTLSTransport)
+{
+  m_pTLSTransport = pTLSTransport;
 }
+#endif
 
 #if 0
 void HTTPClient::basicAuth(const char* user, const char* password) //Basic Authentification
@@ -58,7 +132,19 @@ void HTTPClient::basicAuth(const char* user, const char* password) //Basic Authe
 
 int HTTPClient::get(const char* url, IHTTPDataIn* pDataIn, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
 {
-  return connect(url, HTTP_GET, NULL, pDataIn, timeout);
+  HTTPEndpoint endpoint;
+  int ret = endpoint.setUrl(url);
+  if(ret != OK)
+  {
+    ERR("Invalid URL %s (%d)", url, ret);
+    return ret;
+  }
+  return connect(endpoint, HTTP_GET, NULL, pDataIn, timeout);
+}
+
+int HTTPClient::get(HTTPEndpoint& endpoint, IHTTPDataIn* pDataIn, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  return connect(endpoint, HTTP_GET, NULL, pDataIn, timeout);
 }
 
 int HTTPClient::get(const char* url, char* result, size_t maxResultLen, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
@@ -69,7 +155,162 @@ int HTTPClient::get(const char* url, char* result, size_t maxResultLen, uint32_t
 
 int HTTPClient::post(const char* url, const IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
 {
-  return connect(url, HTTP_POST, (IHTTPDataOut*)&dataOut, pDataIn, timeout);
+  HTTPEndpoint endpoint;
+  int ret = endpoint.setUrl(url);
+  if(ret != OK)
+  {
+    ERR("Invalid URL %s (%d)", url, ret);
+    return ret;
+  }
+  return connect(endpoint, HTTP_POST, (IHTTPDataOut*)&dataOut, pDataIn, timeout);
+}
+
+int HTTPClient::post(HTTPEndpoint& endpoint, const IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  return connect(endpoint, HTTP_POST, (IHTTPDataOut*)&dataOut, pDataIn, timeout);
+}
+
+int HTTPClient::resolve(HTTPEndpoint& endpoint)
+{
+  return endpoint.resolve(m_pTransport);
+}
+
+int HTTPClient::preconnect(HTTPEndpoint& endpoint, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  if( !m_keepAlive || !endpoint.isValid() )
+  {
+    return NET_INVALID;
+  }
+
+  const HTTPEndpoint* pOrigin = getConnection();
+  if( (pOrigin != NULL) && endpoint.isSameOrigin(*pOrigin) )
+  {
+    return OK;
+  }
+  closeConnection();
+
+  m_timeout = timeout;
+  int ret = open(endpoint);
+  if(ret != OK)
+  {
+    return ret;
+  }
+  DBG("Connected to %s ahead of the first request", endpoint.getHost());
+  m_connected = true;
+  m_connOrigin = endpoint;
+  m_connTime = HTTPTime::getMs();
+  return OK;
+}
+
+const HTTPEndpoint* HTTPClient::getConnection(uint32_t* pIdleTime /*= NULL*/)
+{
+  if(!m_connected)
+  {
+    return NULL;
+  }
+  //An idle connection has nothing to read, unless the server closed it
+  if( m_pConnTransport->wait(HTTP_READABLE, 0) != NET_TIMEOUT )
+  {
+    closeConnection();
+    return NULL;
+  }
+  if(pIdleTime != NULL)
+  {
+    *pIdleTime = HTTPTime::elapsed(m_connTime);
+  }
+  return &m_connOrigin;
+}
+
+int HTTPClient::execute(HTTPRequestTemplate& request, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  if( !request.isFrozen() )
+  {
+    ERR("Request template is not frozen");
+    return NET_INVALID;
+  }
+  //The framing of the data must match the headers of the template
+  if(pDataOut != NULL)
+  {
+    if( pDataOut->getIsChunked() == request.hasContentLength() )
+    {
+      ERR("Content-Length header of the template does not match the data");
+      return NET_INVALID;
+    }
+    if( !pDataOut->getIsChunked() )
+    {
+      request.setContentLength(pDataOut->getDataLen());
+    }
+  }
+  else if( request.hasContentLength() )
+  {
+    request.setContentLength(0);
+  }
+  //Requests with data are handled as POST requests (e.g. for redirections)
+  return connect(request.getEndpoint(), (pDataOut != NULL) ? HTTP_POST : HTTP_GET, pDataOut, pDataIn, timeout, &request);
+}
+
+int HTTPClient::openWebSocket(const char* url, HTTPWebSocket* pWebSocket, const char* protocol /*= NULL*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  HTTPEndpoint endpoint;
+  int ret = endpoint.setUrl(url);
+  if(ret != OK)
+  {
+    ERR("Invalid URL %s (%d)", url, ret);
+    return ret;
+  }
+  return openWebSocket(endpoint, pWebSocket, protocol, timeout);
+}
+
+int HTTPClient::openWebSocket(HTTPEndpoint& endpoint, HTTPWebSocket* pWebSocket, const char* protocol /*= NULL*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  m_httpResponseCode = 0;
+  m_timeout = timeout;
+  if( !endpoint.isValid() )
+  {
+    return NET_INVALID;
+  }
+  pWebSocket->drop();
+  closeConnection(); //The connection is handed over to the WebSocket, so a new one is opened
+
+  int ret = open(endpoint);
+  if(ret != OK)
+  {
+    return ret;
+  }
+
+  char key[HTTP_WEBSOCKET_KEY_LEN + 1];
+  pWebSocket->makeKey(key);
+  char head[HTTP_ENDPOINT_PATH_MAX_LEN + HTTP_ENDPOINT_AUTHORITY_MAX_LEN + 192];
+  int len = snprintf(head, sizeof(head), "GET %s HTTP/1.1\r\nHost: %s\r\n", endpoint.getPath(), endpoint.getAuthority());
+  len += snprintf(head + len, sizeof(head) - len, "Upgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n", key);
+  if(protocol != NULL)
+  {
+    len += snprintf(head + len, sizeof(head) - len, "Sec-WebSocket-Protocol: %s\r\n", protocol);
+  }
+  len += snprintf(head + len, sizeof(head) - len, "\r\n");
+  if(len >= (int)sizeof(head))
+  {
+    ERR("Handshake request too long");
+    m_pConnTransport->close();
+    return NET_TOOSMALL;
+  }
+  DBG("Sending WebSocket handshake");
+  ret = send(head, len);
+  if(ret != OK)
+  {
+    m_pConnTransport->close();
+    return NET_CONN;
+  }
+
+  char buf[CHUNK_SIZE + 1]; //Including space for the NULL-terminating char
+  size_t trfLen = 0;
+  ret = recvUpgrade(buf, &trfLen, key, protocol);
+  if(ret != OK)
+  {
+    m_pConnTransport->close();
+    return ret;
+  }
+  return pWebSocket->attach(m_pConnTransport, buf, trfLen); //The frames the server sent right away are in buf
 }
 
 int HTTPClient::getHTTPResponseCode()
@@ -77,81 +318,387 @@ int HTTPClient::getHTTPResponseCode()
   return m_httpResponseCode;
 }
 
+void HTTPClient::setMaxRedirects(int maxRedirects)
+{
+  m_maxRedirects = maxRedirects;
+}
 
-int HTTPClient::connect(const char* url, HTTP_METH method, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout) //Execute request
+void HTTPClient::setHeaderVisitor(IHTTPHeaderVisitor* pVisitor, const char* const* names /*= NULL*/, size_t namesCount /*= 0*/)
+{
+  m_pHeaderVisitor = pVisitor;
+  m_headerNames = names;
+  m_headerNamesCount = namesCount;
+}
+
+void HTTPClient::setExpectContinue(bool enable, size_t minDataLen /*= 0*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_CONTINUE_TIMEOUT*/)
+{
+  m_expectContinue = enable;
+  m_expectContinueMinLen = minDataLen;
+  m_expectContinueTimeout = timeout;
+}
+
+
+void HTTPClient::setKeepAlive(bool enable)
+{
+  m_keepAlive = enable;
+  if(!enable)
+  {
+    closeConnection();
+  }
+}
+
+void HTTPClient::closeConnection()
+{
+  if(m_connected)
+  {
+    m_pConnTransport->close();
+    m_connected = false;
+  }
+}
+
+void HTTPClient::setRetry(int maxRetries, uint32_t baseDelay /*= HTTP_CLIENT_DEFAULT_RETRY_DELAY*/, uint32_t maxDelay /*= HTTP_CLIENT_DEFAULT_RETRY_MAX_DELAY*/, bool retryPost /*= false*/)
+{
+  m_maxRetries = maxRetries;
+  m_retryBaseDelay = baseDelay;
+  m_retryMaxDelay = maxDelay;
+  m_retryPost = retryPost;
+}
+
+void HTTPClient::setBodyTimeout(uint32_t timeout)
+{
+  m_bodyTimeout = timeout;
+}
+
+int HTTPClient::connect(HTTPEndpoint& endpoint, HTTP_METH method, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout, const HTTPRequestTemplate* pTemplate /*= NULL*/) //Execute request, retrying on transient errors
+{
+  bool idempotent = (pTemplate != NULL) ? isIdempotent(pTemplate->getMethod()) : (method != HTTP_POST);
+  uint32_t delayBound = m_retryBaseDelay;
+  for(int retry = 0; ; retry++)
+  {
+    HTTP_TRACE(REQUEST, method, retry);
+    int ret = attempt(endpoint, method, pDataOut, pDataIn, timeout, pTemplate);
+    HTTP_TRACE(DONE, ret, m_httpResponseCode);
+    if( (ret == OK) || (retry >= m_maxRetries) || !isTransient(ret) )
+    {
+      return ret;
+    }
+    if( m_sent && !idempotent && !m_retryPost )
+    {
+      WARN("Request may have been processed, not retrying");
+      return ret;
+    }
+    if( m_sent && (pDataOut != NULL) && !pDataOut->rewind() )
+    {
+      WARN("Cannot send data again, not retrying");
+      return ret;
+    }
+
+    uint32_t delay;
+    if(m_retryAfterSet)
+    {
+      if(m_retryAfter > m_retryMaxDelay)
+      {
+        WARN("Server asked to retry in %u ms, not retrying", (unsigned int)m_retryAfter);
+        return ret;
+      }
+      delay = m_retryAfter;
+    }
+    else
+    {
+      //Full jitter: anywhere between 0 and the bound, mixed with the clock so that devices started together drift apart
+      m_random = (m_random ^ HTTPTime::getMs()) * 1103515245 + 12345; //Same LCG as the C standard's example rand()
+      delay = (m_random >> 8) % (delayBound + 1);
+      delayBound = (delayBound > m_retryMaxDelay / 2) ? m_retryMaxDelay : (delayBound * 2);
+    }
+    WARN("Request failed (%d), retrying in %u ms", ret, (unsigned int)delay);
+    HTTPTime::sleep(delay);
+  }
+}
+
+int HTTPClient::attempt(HTTPEndpoint& endpoint, HTTP_METH method, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout, const HTTPRequestTemplate* pTemplate) //Execute request once
 {
   m_httpResponseCode = 0; //Invalidate code
+  m_sent = false;
+  m_retryAfterSet = false;
   m_timeout = timeout;
 
-  char scheme[8];
-  uint16_t port;
-  char host[32];
-  char path[64];
-  //First we need to parse the url (http[s]://host[:port][/[path]]) -- HTTPS not supported (yet?)
-  int ret = parseURL(url, scheme, sizeof(scheme), host, sizeof(host), &port, path, sizeof(path));
-  if(ret != OK)
+  if( !endpoint.isValid() )
   {
-    ERR("parseURL returned %d", ret);
-    return ret;
+    return NET_INVALID;
   }
 
-  if(port == 0) //TODO do handle HTTPS->443
+  HTTPEndpoint* pEndpoint = &endpoint;
+  HTTPEndpoint redirected; //Target of redirections, so that the caller's endpoint is left untouched
+  int ret;
+  char location[HTTP_LOCATION_MAX_LEN];
+  bool keepAlive = false; //Whether the connection can carry the next request
+  bool skipExpect = false;
+  bool replayed = false;
+
+  if(m_connected)
   {
-    port = 80;
+    m_connected = false; //Until the request completes
+    //An idle connection has nothing to read, unless the server closed it
+    if( endpoint.isSameOrigin(m_connOrigin) && (m_pConnTransport->wait(HTTP_READABLE, 0) == NET_TIMEOUT) )
+    {
+      DBG("Reusing connection to %s", endpoint.getHost());
+      keepAlive = true;
+    }
+    else
+    {
+      m_pConnTransport->close();
+    }
   }
 
-  DBG("Scheme: %s", scheme);
-  DBG("Host: %s", host);
-  DBG("Port: %d", port);
-  DBG("Path: %s", path);
+  for(int hop = 0; ; hop++)
+  {
+    bool reused = keepAlive; //Whether the server may have closed the connection while it was idle
+    if(!keepAlive)
+    {
+      ret = open(*pEndpoint);
+      if(ret != OK)
+      {
+        return ret;
+      }
+    }
 
-  //Now populate structure
-  std::memset(&m_serverAddr, 0, sizeof(struct sockaddr_in));
+    //Hold the data back until the server accepts the request, unless it is small enough to just send it
+    bool expectContinue = (method == HTTP_POST) && (pDataOut != NULL) && (pTemplate == NULL) && m_expectContinue && !skipExpect &&
+        (pDataOut->getIsChunked() || (pDataOut->getDataLen() >= m_expectContinueMinLen));
+    bool dataSent = false;
+
+    DBG("Sending request");
+    m_sent = true;
+    m_received = false;
+    m_recvResult = OK;
+    ret = sendRequest(method, *pEndpoint, pDataOut, expectContinue, pTemplate);
+    if( (ret == OK) && (method == HTTP_POST) && (pDataOut != NULL) && !expectContinue )
+    {
+      ret = sendData(pDataOut);
+      dataSent = true;
+    }
+    if(ret != OK)
+    {
+      m_pConnTransport->close();
+      if( reused && !replayed && (!dataSent || pDataOut->rewind()) )
+      {
+        WARN("Connection closed by server, sending again on a new connection");
+        replayed = true;
+        keepAlive = false;
+        hop--;
+        continue;
+      }
+      ERR("Could not write request");
+      return NET_CONN;
+    }
 
-  //Resolve DNS if needed
+    if(expectContinue)
+    {
+      DBG("Waiting for 100 Continue");
+      bool proceed = false;
+      ret = m_pConnTransport->wait(HTTP_READABLE, m_expectContinueTimeout);
+      if(ret == OK) //The server answered before the timeout
+      {
+        ret = recvResponse(pDataIn, (hop < m_maxRedirects) ? location : NULL, sizeof(location), &keepAlive, true);
+        proceed = (ret == OK) && (m_httpResponseCode == 100);
+      }
+      else if(ret == NET_TIMEOUT) //Servers are not required to send 100 Continue, send the data anyway
+      {
+        ret = OK;
+        proceed = true;
+      }
+      if(proceed)
+      {
+        ret = sendData(pDataOut);
+        dataSent = true;
+      }
+      if(ret != OK)
+      {
+        m_pConnTransport->close();
+        if( !dataSent && (m_httpResponseCode == 417) ) //Expectation Failed, try again without it
+        {
+          WARN("Server does not support Expect: 100-continue");
+          skipExpect = true;
+          keepAlive = false;
+          hop--;
+          continue;
+        }
+        if( !dataSent && (m_httpResponseCode != 0) )
+        {
+          WARN("Request rejected with code %d, data not sent", m_httpResponseCode);
+        }
+        return ((ret == NET_PROTOCOL) || (ret == NET_ABORT) || (ret == NET_TIMEOUT)) ? ret : NET_CONN;
+      }
+    }
+
+    if( !expectContinue || dataSent )
+    {
+      DBG("Receiving response");
+      ret = recvResponse(pDataIn, (hop < m_maxRedirects) ? location : NULL, sizeof(location), &keepAlive, false);
+      if(ret != OK)
+      {
+        m_pConnTransport->close();
+        //Closed before answering: the server dropped the idle connection just as the request was sent
+        if( reused && !replayed && !m_received && (m_recvResult != NET_TIMEOUT) && ((pDataOut == NULL) || pDataOut->rewind()) )
+        {
+          WARN("Connection closed by server, sending again on a new connection");
+          replayed = true;
+          keepAlive = false;
+          hop--;
+          continue;
+        }
+        return ret;
+      }
+    }
+    else
+    {
+      keepAlive = false; //Final status received early, the server may still be waiting for the data
+    }
+
+    if( !isRedirect(m_httpResponseCode) )
+    {
+      break;
+    }
+
+    //Follow redirection
+    if( (m_httpResponseCode == 303) || (((m_httpResponseCode == 301) || (m_httpResponseCode == 302)) && (method == HTTP_POST)) )
+    {
+      //Rewritten into a GET without body, as all user agents do for 301 and 302
+      if(method != HTTP_HEAD)
+      {
+        method = HTTP_GET;
+      }
+      pDataOut = NULL;
+      pTemplate = NULL; //Its headers describe the original request
+    }
+    else if( (pDataOut != NULL) && !pDataOut->rewind() ) //307 and 308 replay the same request
+    {
+      WARN("Cannot send data again, not following redirection to %s", location);
+      m_pConnTransport->close();
+      return NET_PROTOCOL;
+    }
+
+    if(pEndpoint != &redirected)
+    {
+      redirected = *pEndpoint;
+      pEndpoint = &redirected;
+    }
+    bool sameOrigin;
+    ret = redirected.resolveReference(location, &sameOrigin);
+    if(ret != OK)
+    {
+      ERR("Invalid redirection to %s", location);
+      m_pConnTransport->close();
+      return NET_PROTOCOL;
+    }
+
+    //Only a connection to the same origin can be reused, and credentials are not sent to another origin
+    if(!sameOrigin)
+    {
+      keepAlive = false;
+      pTemplate = NULL;
+    }
+    if(!keepAlive)
+    {
+      m_pConnTransport->close();
+    }
+    DBG("Redirected (%d) to %s://%s:%d%s%s", m_httpResponseCode, redirected.getScheme(), redirected.getHost(), redirected.getPort(),
+        redirected.getPath(), keepAlive ? " on the same connection" : "");
+  }
 
-  DBG("Resolving DNS address or populate hard-coded IP address");
-  struct hostent *server = socket::gethostbyname(host);
-  if(server == NULL)
+  if(m_keepAlive && keepAlive)
   {
-    return NET_NOTFOUND; //Fail
+    m_connected = true;
+    m_connOrigin = *pEndpoint;
+    m_connTime = HTTPTime::getMs();
   }
-  memcpy((char*)&m_serverAddr.sin_addr.s_addr, (char*)server->h_addr_list[0], server->h_length);
+  else
+  {
+    m_pConnTransport->close();
+  }
+  DBG("Completed HTTP transaction");
 
-  m_serverAddr.sin_family = AF_INET;
-  m_serverAddr.sin_port = htons(port);
+  return OK;
+}
 
-  //Create socket
-  DBG("Creating socket");
-  m_sock = socket::socket(AF_INET, SOCK_STREAM, 0); //UDP socket
-  if (m_sock < 0)
+int HTTPClient::open(HTTPEndpoint& endpoint) //Connect to endpoint, 0 on success, err code on failure
+{
+  m_pConnTransport = m_pTransport;
+  if( endpoint.isSecure() )
   {
-    ERR("Could not create socket");
-    return NET_OOM;
+#ifdef HTTP_CLIENT_TLS
+    if(m_pTLSTransport == NULL)
+    {
+      ERR("No TLS transport set, cannot connect to %s", endpoint.getHost());
+      return NET_INVALID;
+    }
+    m_pTLSTransport->setHostName(endpoint.getHost()); //For SNI, certificate verification and session resumption
+    m_pConnTransport = m_pTLSTransport;
+#else
+    ERR("HTTPS support is not enabled (build with HTTP_CLIENT_TLS)");
+    return NET_INVALID;
+#endif
   }
-  DBG("Handle is %d", m_sock);
 
-  //Connect it
-  DBG("Connecting socket to %s:%d", inet_ntoa(m_serverAddr.sin_addr), ntohs(m_serverAddr.sin_port));
-  ret = socket::connect(m_sock, (const struct sockaddr *)&m_serverAddr, sizeof(m_serverAddr));
-  if (ret < 0)
+  DBG("Scheme: %s", endpoint.getScheme());
+  DBG("Host: %s", endpoint.getHost());
+  DBG("Port: %d", endpoint.getPort());
+
+  //Resolve DNS if needed
+  bool cached = endpoint.isResolved();
+  if( !cached && (endpoint.resolve(m_pConnTransport) != OK) )
+  {
+    return NET_NOTFOUND; //Fail
+  }
+
+  //Connect to any of the addresses of the host
+  size_t index;
+  int ret = m_pConnTransport->connectAny(endpoint.getAddresses(), endpoint.getAddressCount(), m_timeout, &index);
+  if( (ret != OK) && cached )
+  {
+    //The addresses of the host may have changed since it was resolved
+    WARN("Could not connect to cached address, resolving %s again", endpoint.getHost());
+    if(endpoint.resolve(m_pConnTransport) != OK)
+    {
+      return NET_NOTFOUND;
+    }
+    ret = m_pConnTransport->connectAny(endpoint.getAddresses(), endpoint.getAddressCount(), m_timeout, &index);
+  }
+  HTTP_TRACE(CONNECT, ret, endpoint.getPort());
+  if(ret != OK)
   {
-    socket::close(m_sock);
     ERR("Could not connect");
     return NET_CONN;
   }
+  endpoint.setPreferredAddress(index); //Tried first next time
 
-  //Send request
-  DBG("Sending request");
-  char line[128];
-  const char* meth = (method==HTTP_GET)?"GET":(method==HTTP_POST)?"POST":"";
-  snprintf(line, sizeof(line), "%s %s HTTP/1.1\r\nHost: %s\r\n", meth, path, host); //Write request
-  ret = send(line);
-  if(ret)
+  return OK;
+}
+
+int HTTPClient::sendRequest(HTTP_METH method, const HTTPEndpoint& endpoint, IHTTPDataOut* pDataOut, bool expectContinue, const HTTPRequestTemplate* pTemplate) //Send request line and headers, 0 on success, err code on failure
+{
+  DBG("Path: %s", endpoint.getPath());
+  char line[HTTP_ENDPOINT_PATH_MAX_LEN + HTTP_ENDPOINT_AUTHORITY_MAX_LEN + 32];
+  const char* meth = (method==HTTP_GET)?"GET":(method==HTTP_POST)?"POST":(method==HTTP_HEAD)?"HEAD":"";
+  if(pTemplate != NULL)
   {
-    socket::close(m_sock);
-    ERR("Could not write request");
-    return NET_CONN;
+    if( &endpoint == &pTemplate->getEndpoint() )
+    {
+      DBG("Sending request template");
+      return send(pTemplate->getData(), pTemplate->getLength()); //Already formatted
+    }
+    meth = pTemplate->getMethod(); //Redirected, only the request line and the Host header change
+  }
+  snprintf(line, sizeof(line), "%s %s HTTP/1.1\r\nHost: %s\r\n", meth, endpoint.getPath(), endpoint.getAuthority()); //Write request
+  int ret = send(line);
+  if(ret != OK)
+  {
+    return ret;
+  }
+
+  if(pTemplate != NULL)
+  {
+    return send(pTemplate->getHeaders(), pTemplate->getHeadersLength());
   }
 
   //Send all headers
@@ -163,139 +710,194 @@ int HTTPClient::connect(const char* url, HTTP_METH method, IHTTPDataOut* pDataOu
     if( pDataOut->getIsChunked() )
     {
       ret = send("Transfer-Encoding: chunked\r\n");
-      if(ret != OK) goto connerr;
+      if(ret != OK) return ret;
     }
     else
     {
-      snprintf(line, sizeof(line), "Content-Length: %d\r\n", pDataOut->getDataLen());
+      snprintf(line, sizeof(line), "Content-Length: %u\r\n", (unsigned int)pDataOut->getDataLen());
       ret = send(line);
-      if(ret != OK) goto connerr;
+      if(ret != OK) return ret;
     }
-    char type[48];
-    if( pDataOut->getDataType(type, 48) == OK )
+    char type[64];
+    if( pDataOut->getDataType(type, sizeof(type)) == OK )
     {
       snprintf(line, sizeof(line), "Content-Type: %s\r\n", type);
       ret = send(line);
-      if(ret != OK) goto connerr;
+      if(ret != OK) return ret;
+    }
+    if(expectContinue)
+    {
+      ret = send("Expect: 100-continue\r\n");
+      if(ret != OK) return ret;
     }
   }
 
   //Close headers
   DBG("Headers sent");
-  ret = send("\r\n");
-  if(ret != OK) goto connerr;
+  return send("\r\n");
+}
 
+int HTTPClient::sendData(IHTTPDataOut* pDataOut) //Send request data, 0 on success, err code on failure
+{
   char buf[CHUNK_SIZE];
+  char line[16];
   size_t trfLen;
+  int ret;
 
-  //Send data (if POST)
-  if( (method == HTTP_POST) && (pDataOut != NULL) )
-  {
-    DBG("Sending data");
-    while(true)
-    {
-      size_t writtenLen = 0;
-      pDataOut->read(buf, CHUNK_SIZE, &trfLen);
-      if( pDataOut->getIsChunked() )
-      {
-        //Write chunk header
-        snprintf(line, sizeof(line), "%X\r\n", trfLen); //In hex encoding
-        ret = send(line);
-        if(ret != OK) goto connerr;
-      }
-      else if( trfLen == 0 )
-      {
-        break;
-      }
-      if( trfLen != 0 )
-      {
-        ret = send(buf, trfLen);
-        if(ret != OK) goto connerr;
-      }
-
-      if( pDataOut->getIsChunked()  )
-      {
-        ret = send("\r\n"); //Chunk-terminating CRLF
-        if(ret != OK) goto connerr;
-      }
-      else
-      {
-        writtenLen += trfLen;
-        if( writtenLen >= pDataOut->getDataLen() )
-        {
-          break;
-        }
-      }
+  DBG("Sending data");
+  size_t writtenLen = 0;
+  while(true)
+  {
+    ret = pDataOut->read(buf, CHUNK_SIZE, &trfLen);
+    if(ret != OK)
+    {
+      ERR("Could not read data to send (%d)", ret);
+      return ret;
+    }
+    if( pDataOut->getIsChunked() )
+    {
+      //Write chunk header
+      snprintf(line, sizeof(line), "%X\r\n", (unsigned int)trfLen); //In hex encoding
+      ret = send(line);
+      if(ret != OK) return ret;
+    }
+    else if( trfLen == 0 )
+    {
+      break;
+    }
+    if( trfLen != 0 )
+    {
+      ret = send(buf, trfLen);
+      if(ret != OK) return ret;
+    }
 
-      if( trfLen == 0 )
+    if( pDataOut->getIsChunked()  )
+    {
+      ret = send("\r\n"); //Chunk-terminating CRLF
+      if(ret != OK) return ret;
+    }
+    else
+    {
+      writtenLen += trfLen;
+      if( writtenLen >= pDataOut->getDataLen() )
       {
         break;
       }
     }
 
+    if( trfLen == 0 )
+    {
+      break;
+    }
   }
 
-  //Receive response
-  DBG("Receiving response");
-  ret = recv(buf, CHUNK_SIZE, CHUNK_SIZE, &trfLen); //Read n bytes
-  if(ret != OK) goto connerr;
+  return OK;
+}
 
-  buf[trfLen] = '\0';
+int HTTPClient::recvResponse(IHTTPDataIn* pDataIn, char* location, size_t maxLocationLen, bool* pKeepAlive, bool stopOnContinue) //Receive status, headers and data, 0 on success, err code on failure
+{
+  char buf[LINE_MAX_LEN + 1]; //Including space for the NULL-terminating char
+  size_t trfLen;
+  size_t crlfPos;
+  size_t recvContentLength = 0;
+  bool recvContentLengthSet = false;
+  bool recvChunked = false;
+  bool redirect;
+  bool failed;
+  int minorVersion;
+  int ret;
 
-  char* crlfPtr = strstr(buf, "\r\n");
-  if(crlfPtr == NULL)
+  *pKeepAlive = false;
+  if(location != NULL)
   {
-    goto prtclerr;
+    location[0] = '\0';
   }
+  m_httpResponseCode = 0;
 
-  int crlfPos = crlfPtr - buf;
-  buf[crlfPos] = '\0';
-
-  //Parse HTTP response
-  if( sscanf(buf, "HTTP/%*d.%*d %d %*[^\r\n]", &m_httpResponseCode) != 1 )
+  //recv() may split the stream anywhere (within the status line, a header, a CRLF or a chunk header) so every line is
+  //assembled with recvLine() until its CRLF is in the buffer, and nothing is assumed about what the buffer holds beyond trfLen
+  trfLen = 0;
+  while(true)
   {
-    //Cannot match string, error
-    ERR("Not a correct HTTP answer : %s\n", buf);
-    goto prtclerr;
+    ret = recvLine(buf, LINE_MAX_LEN, &trfLen, &crlfPos);
+    if(ret == NET_TOOSMALL) goto prtclerr;
+    if(ret != OK) goto connerr;
+
+    buf[crlfPos] = '\0';
+
+    //Parse HTTP response
+    if( sscanf(buf, "HTTP/%*d.%d %d %*[^\r\n]", &minorVersion, &m_httpResponseCode) != 2 )
+    {
+      //Cannot match string, error
+      ERR("Not a correct HTTP answer : %s\n", buf);
+      goto prtclerr;
+    }
+    HTTP_TRACE(STATUS, m_httpResponseCode, minorVersion);
+
+    memmove(buf, &buf[crlfPos+2], trfLen - (crlfPos + 2));
+    trfLen -= (crlfPos + 2);
+
+    if( (m_httpResponseCode < 100) || (m_httpResponseCode >= 200) )
+    {
+      break;
+    }
+
+    //Interim response (100 Continue, 103 Early Hints...), skip its headers
+    DBG("Interim response %d", m_httpResponseCode);
+    do
+    {
+      ret = recvLine(buf, LINE_MAX_LEN, &trfLen, &crlfPos);
+      if(ret == NET_TOOSMALL) //None of them is needed
+      {
+        ret = skipLine(buf, LINE_MAX_LEN, &trfLen);
+        if(ret != OK) goto connerr;
+        crlfPos = 1; //Not the end of the headers
+        continue;
+      }
+      if(ret != OK) goto connerr;
+      memmove(buf, &buf[crlfPos+2], trfLen - (crlfPos + 2));
+      trfLen -= (crlfPos + 2);
+    } while(crlfPos != 0);
+
+    if( stopOnContinue && (m_httpResponseCode == 100) && (trfLen == 0) )
+    {
+      return OK; //The caller can now send the data
+    }
   }
 
-  if(m_httpResponseCode != 200)
+  redirect = (location != NULL) && isRedirect(m_httpResponseCode);
+  failed = ((m_httpResponseCode < 200) || (m_httpResponseCode >= 300)) && !redirect; //Any 2xx code is a success
+  if(redirect || failed)
   {
-    //Cannot match string, error
-    WARN("Response code %d", m_httpResponseCode);
-    goto prtclerr;
+    pDataIn = NULL; //The body of a redirection is discarded, and so is an error response
   }
+  *pKeepAlive = (minorVersion >= 1); //Persistent by default from HTTP/1.1
 
   DBG("Reading headers");
 
-  memmove(buf, &buf[crlfPos+2], trfLen - (crlfPos + 2));
-  trfLen -= (crlfPos + 2);
-
-  size_t recvContentLength = 0;
-  bool recvChunked = false;
   //Now get headers
   while( true )
   {
-    crlfPtr = strstr(buf, "\r\n");
-    if(crlfPtr == NULL)
+    ret = recvLine(buf, LINE_MAX_LEN, &trfLen, &crlfPos);
+    if(ret == NET_TOOSMALL) //A header that does not fit in the buffer (a large cookie...) is skipped, unless it is one read below
     {
-      if( trfLen < CHUNK_SIZE )
-      {
-        size_t newTrfLen;
-        ret = recv(buf + trfLen, 1, CHUNK_SIZE - trfLen - 1, &newTrfLen);
-        trfLen += newTrfLen;
-        buf[trfLen] = '\0';
-        DBG("In buf: [%s]", buf);
-        if(ret != OK) goto connerr;
-        continue;
-      }
-      else
+      buf[trfLen] = '\0';
+      char* colon = strchr(buf, ':');
+      if(colon != NULL)
       {
-        goto prtclerr;
+        *colon = '\0';
+        if( isNeededHeader(buf, redirect, failed) )
+        {
+          ERR("Header %s too long", buf);
+          goto prtclerr;
+        }
       }
+      WARN("Skipping header longer than %d bytes", (int)LINE_MAX_LEN);
+      ret = skipLine(buf, LINE_MAX_LEN, &trfLen);
+      if(ret != OK) goto connerr;
+      continue;
     }
-
-    crlfPos = crlfPtr - buf;
+    if(ret != OK) goto connerr;
 
     if(crlfPos == 0) //End of headers
     {
@@ -307,29 +909,84 @@ int HTTPClient::connect(const char* url, HTTP_METH method, IHTTPDataOut* pDataOu
 
     buf[crlfPos] = '\0';
 
-    char key[16];
-    char value[16];
-
-    int n = sscanf(buf, "%16[^:]: %16[^\r\n]", key, value);
-    if ( n == 2 )
+    //Split the line in place, as header names can be longer than any fixed-size array
+    char* key = buf;
+    char* value = strchr(buf, ':');
+    if ( value != NULL )
     {
+      *value = '\0';
+      value++;
+      while( (*value == ' ') || (*value == '\t') )
+      {
+        value++;
+      }
       DBG("Read header : %s: %s\n", key, value);
-      if( !strcmp(key, "Content-Length") )
+      if( (m_pHeaderVisitor != NULL) && !redirect )
+      {
+        visitHeader(key, value);
+      }
+
+      if( equalsNoCase(key, "Content-Length") )
       {
-        sscanf(value, "%d", &recvContentLength);
-        pDataIn->setDataLen(recvContentLength);
+        unsigned int contentLength;
+        if( sscanf(value, "%u", &contentLength) != 1 )
+        {
+          ERR("Invalid Content-Length");
+          goto prtclerr;
+        }
+        recvContentLength = contentLength;
+        recvContentLengthSet = true;
+        if(pDataIn != NULL)
+        {
+          pDataIn->setDataLen(recvContentLength);
+        }
       }
-      else if( !strcmp(key, "Transfer-Encoding") )
+      else if( equalsNoCase(key, "Transfer-Encoding") )
       {
-        if( !strcmp(value, "Chunked") || !strcmp(value, "chunked") )
+        if( equalsNoCase(value, "chunked") )
         {
           recvChunked = true;
-          pDataIn->setIsChunked(true);
+          if(pDataIn != NULL)
+          {
+            pDataIn->setIsChunked(true);
+          }
+        }
+      }
+      else if( equalsNoCase(key, "Content-Type") )
+      {
+        if(pDataIn != NULL)
+        {
+          pDataIn->setDataType(value);
+        }
+      }
+      else if( equalsNoCase(key, "Connection") )
+      {
+        if( equalsNoCase(value, "close") )
+        {
+          *pKeepAlive = false;
+        }
+        else if( equalsNoCase(value, "keep-alive") )
+        {
+          *pKeepAlive = true;
+        }
+      }
+      else if( failed && equalsNoCase(key, "Retry-After") )
+      {
+        unsigned int seconds;
+        if( sscanf(value, "%u", &seconds) == 1 ) //HTTP dates are ignored, as they would need a synchronised clock
+        {
+          m_retryAfter = (seconds < 0xFFFFFFFF / 1000) ? (seconds * 1000) : 0xFFFFFFFF;
+          m_retryAfterSet = true;
         }
       }
-      else if( !strcmp(key, "Content-Type") )
+      else if( redirect && equalsNoCase(key, "Location") )
       {
-        pDataIn->setDataType(value);
+        if( strlen(value) >= maxLocationLen )
+        {
+          ERR("Location too long");
+          goto prtclerr;
+        }
+        strcpy(location, value);
       }
 
       memmove(buf, &buf[crlfPos+2], trfLen - (crlfPos + 2));
@@ -344,6 +1001,40 @@ int HTTPClient::connect(const char* url, HTTP_METH method, IHTTPDataOut* pDataOu
 
   }
 
+  if(failed)
+  {
+    WARN("Response code %d", m_httpResponseCode);
+    goto prtclerr;
+  }
+
+  if( redirect && (location[0] == '\0') )
+  {
+    ERR("Redirection without Location");
+    goto prtclerr;
+  }
+
+  if(m_httpResponseCode == 204) //No content, whatever the headers say, and the connection stays usable
+  {
+    recvChunked = false;
+    recvContentLength = 0;
+    recvContentLengthSet = true;
+    if(pDataIn != NULL)
+    {
+      pDataIn->setIsChunked(false);
+      pDataIn->setDataLen(0);
+    }
+  }
+
+  if( !recvChunked && !recvContentLengthSet )
+  {
+    *pKeepAlive = false; //Data is delimited by the server closing the connection
+  }
+
+  if( (pDataIn != NULL) && (m_bodyTimeout != 0) )
+  {
+    m_timeout = m_bodyTimeout; //Until the next request
+  }
+
   //Receive data
   DBG("Receiving data");
   while(true)
@@ -353,32 +1044,12 @@ int HTTPClient::connect(const char* url, HTTP_METH method, IHTTPDataOut* pDataOu
     if( recvChunked )
     {
       //Read chunk header
-      crlfPos=0;
-      for(crlfPos++; crlfPos < trfLen - 2; crlfPos++)
-      {
-        if( buf[crlfPos] == '\r' && buf[crlfPos + 1] == '\n' )
-        {
-          break;
-        }
-      }
-      if(crlfPos >= trfLen - 2) //Try to read more
-      {
-        if( trfLen < CHUNK_SIZE )
-        {
-          size_t newTrfLen;
-          ret = recv(buf + trfLen, 0, CHUNK_SIZE - trfLen - 1, &newTrfLen);
-          trfLen += newTrfLen;
-          if(ret != OK) goto connerr;
-          continue;
-        }
-        else
-        {
-          goto prtclerr;
-        }
-      }
+      ret = recvLine(buf, LINE_MAX_LEN, &trfLen, &crlfPos);
+      if(ret == NET_TOOSMALL) goto prtclerr;
+      if(ret != OK) goto connerr;
+
       buf[crlfPos] = '\0';
-      int n = sscanf(buf, "%x", &readLen);
-      if(n!=1)
+      if( HTTPScan::parseHex(buf, &readLen) == 0 ) //Chunk extensions are ignored
       {
         ERR("Could not read chunk length");
         goto prtclerr;
@@ -389,50 +1060,82 @@ int HTTPClient::connect(const char* url, HTTP_METH method, IHTTPDataOut* pDataOu
 
       if( readLen == 0 )
       {
-        //Last chunk
+        //Last chunk, skip trailers until the empty line
+        while(true)
+        {
+          ret = recvLine(buf, LINE_MAX_LEN, &trfLen, &crlfPos);
+          if(ret == NET_TOOSMALL) //Trailers are not read
+          {
+            ret = skipLine(buf, LINE_MAX_LEN, &trfLen);
+            if(ret != OK) goto connerr;
+            continue;
+          }
+          if(ret != OK) goto connerr;
+          memmove(buf, &buf[crlfPos+2], trfLen - (crlfPos + 2));
+          trfLen -= (crlfPos + 2);
+          if(crlfPos == 0)
+          {
+            break;
+          }
+        }
         break;
       }
     }
-    else
+    else if( recvContentLengthSet )
     {
       readLen = recvContentLength;
     }
+    else
+    {
+      readLen = (size_t)-1; //No framing, data is delimited by the server closing the connection
+    }
 
     DBG("Retrieving %d bytes", readLen);
 
-    do
+    while(readLen > 0)
     {
-      pDataIn->write(buf, MIN(trfLen, readLen));
-      if( trfLen > readLen )
-      {
-        memmove(buf, &buf[readLen], trfLen - readLen);
-        trfLen -= readLen;
-        readLen = 0;
-      }
-      else
+      if(trfLen == 0)
       {
-        readLen -= trfLen;
+        ret = recv(buf, 1, CHUNK_SIZE, &trfLen);
+        if( (ret == NET_CLOSED) && !recvChunked && !recvContentLengthSet )
+        {
+          break; //End of data
+        }
+        if(ret != OK) goto connerr;
       }
 
-      if(readLen)
+      size_t writeLen = MIN(trfLen, readLen);
+      if(pDataIn != NULL)
       {
-        ret = recv(buf, 1, CHUNK_SIZE - trfLen - 1, &trfLen);
-        if(ret != OK) goto connerr;
-
+        ret = writeData(pDataIn, buf, writeLen);
+        if(ret != OK)
+        {
+          *pKeepAlive = false; //The rest of the response is not read
+          if(ret == HTTP_DATA_ENOUGH)
+          {
+            DBG("Data sink does not need more data");
+            return OK;
+          }
+          if(ret == HTTP_DATA_ABORT)
+          {
+            WARN("Transfer aborted by data sink");
+            return NET_ABORT;
+          }
+          return ret;
+        }
       }
-    } while(readLen);
+      memmove(buf, &buf[writeLen], trfLen - writeLen);
+      trfLen -= writeLen;
+      readLen -= writeLen;
+    }
 
     if( recvChunked )
     {
-      if(trfLen < 2)
-      {
-        size_t newTrfLen;
-        //Read missing chars to find end of chunk
-        ret = recv(buf, 2 - trfLen, CHUNK_SIZE, &newTrfLen);
-        if(ret != OK) goto connerr;
-        trfLen += newTrfLen;
-      }
-      if( (buf[0] != '\r') || (buf[1] != '\n') )
+      //Chunk-terminating CRLF
+      ret = recvLine(buf, LINE_MAX_LEN, &trfLen, &crlfPos);
+      if(ret == NET_TOOSMALL) goto prtclerr;
+      if(ret != OK) goto connerr;
+      if( crlfPos != 0 )
       {
         ERR("Format error");
         goto prtclerr;
@@ -447,182 +1150,279 @@ int HTTPClient::connect(const char* url, HTTP_METH method, IHTTPDataOut* pDataOu
 
   }
 
-  socket::close(m_sock);
-  DBG("Completed HTTP transaction");
+  if(trfLen > 0)
+  {
+    WARN("Unexpected data after response");
+    *pKeepAlive = false;
+  }
 
   return OK;
 
   connerr:
-    socket::close(m_sock);
     ERR("Connection error (%d)", ret);
   return NET_CONN;
 
   prtclerr:
-    socket::close(m_sock);
     ERR("Protocol error");
   return NET_PROTOCOL;
 
 }
 
-int HTTPClient::recv(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen) //0 on success, err code on failure
+int HTTPClient::recvLine(char* buf, size_t maxLen, size_t* pTrfLen, size_t* pCrlfPos) //0 on success, err code on failure
 {
-  DBG("Trying to read between %d and %d bytes", minLen, maxLen);
-  size_t readLen = 0;
-  while(readLen < minLen)
+  size_t pos = 0;
+  while(true)
   {
-    //Wait for socket to be readable
-    //Creating FS set
-    fd_set socksSet;
-    FD_ZERO(&socksSet);
-    FD_SET(m_sock, &socksSet);
-    struct timeval t_val;
-    t_val.tv_sec = m_timeout / 1000;
-    t_val.tv_usec = (m_timeout - (t_val.tv_sec * 1000)) * 1000;
-    int ret = socket::select(FD_SETSIZE, &socksSet, NULL, NULL, &t_val);
-    if(ret <= 0 || !FD_ISSET(m_sock, &socksSet))
+    size_t crlfPos = pos + HTTPScan::findCRLF(buf + pos, *pTrfLen - pos);
+    if(crlfPos < *pTrfLen)
     {
-      WARN("Timeout");
-      return NET_TIMEOUT; //Timeout
+      *pCrlfPos = crlfPos;
+      return OK;
     }
+    //Resume from the last byte, which could be the first half of a CRLF split across two reads
+    pos = (*pTrfLen > 0) ? (*pTrfLen - 1) : 0;
 
-    ret = socket::recv(m_sock, buf + readLen, maxLen - readLen, 0);
-    if( ret > 0)
+    if( *pTrfLen >= maxLen )
     {
-      readLen += ret;
-      continue;
+      WARN("Line does not fit in buffer");
+      return NET_TOOSMALL;
     }
-    else if( ret == 0 )
+
+    size_t newTrfLen;
+    int ret = recv(buf + *pTrfLen, 1, maxLen - *pTrfLen, &newTrfLen);
+    *pTrfLen += newTrfLen;
+    if(ret != OK)
     {
-      WARN("Connection was closed by server");
-      return NET_CLOSED; //Connection was closed by server
+      return ret;
     }
-    else
+  }
+}
+
+int HTTPClient::skipLine(char* buf, size_t maxLen, size_t* pTrfLen) //0 on success, err code on failure
+{
+  while(true)
+  {
+    size_t crlfPos = HTTPScan::findCRLF(buf, *pTrfLen);
+    if(crlfPos < *pTrfLen)
     {
-      ERR("Connection error (recv returned %d)", ret);
-      return NET_CONN;
+      memmove(buf, &buf[crlfPos+2], *pTrfLen - (crlfPos + 2));
+      *pTrfLen -= (crlfPos + 2);
+      return OK;
+    }
+    //Only keep the last byte, which could be the first half of a CRLF split across two reads
+    if(*pTrfLen > 1)
+    {
+      buf[0] = buf[*pTrfLen - 1];
+      *pTrfLen = 1;
+    }
+
+    size_t newTrfLen;
+    int ret = recv(buf + *pTrfLen, 1, maxLen - *pTrfLen, &newTrfLen);
+    *pTrfLen += newTrfLen;
+    if(ret != OK)
+    {
+      return ret;
     }
   }
-  *pReadLen = readLen;
-  DBG("Read %d bytes", readLen);
-  return OK;
 }
 
-int HTTPClient::send(char* buf, size_t len) //0 on success, err code on failure
+int HTTPClient::recvUpgrade(char* buf, size_t* pTrfLen, const char* key, const char* protocol) //Receive and check the WebSocket handshake response, buf keeps the bytes that follow it
 {
-  if(len == 0)
+  //The server proves it understood the handshake by hashing the key with the GUID of the protocol
+  char accept[((HTTP_SHA1_DIGEST_LEN + 2) / 3) * 4 + 1];
+  uint8_t digest[HTTP_SHA1_DIGEST_LEN];
+  HTTPSHA1 sha1;
+  sha1.update(key, strlen(key));
+  sha1.update("258EAFA5-E914-47DA-95CA-C5AB0DC85B11", 36);
+  sha1.finish(digest);
+  HTTPBase64::encode((const char*)digest, sizeof(digest), accept, sizeof(accept));
+
+  size_t crlfPos;
+  int ret = recvLine(buf, CHUNK_SIZE, pTrfLen, &crlfPos);
+  if(ret != OK)
   {
-    len = strlen(buf);
+    return (ret == NET_TOOSMALL) ? NET_PROTOCOL : NET_CONN;
   }
-  DBG("Trying to write %d bytes", len);
-  size_t writtenLen = 0;
-  while(writtenLen < len)
+  buf[crlfPos] = '\0';
+  if( sscanf(buf, "HTTP/%*d.%*d %d", &m_httpResponseCode) != 1 )
+  {
+    ERR("Not a correct HTTP answer : %s", buf);
+    return NET_PROTOCOL;
+  }
+  if(m_httpResponseCode != 101)
   {
-    //Wait for socket to be writeable
-    //Creating FS set
-    fd_set socksSet;
-    FD_ZERO(&socksSet);
-    FD_SET(m_sock, &socksSet);
-    struct timeval t_val;
-    t_val.tv_sec = m_timeout / 1000;
-    t_val.tv_usec = (m_timeout - (t_val.tv_sec * 1000)) * 1000;
-    int ret = socket::select(FD_SETSIZE, NULL, &socksSet, NULL, &t_val);
-    if(ret <= 0 || !FD_ISSET(m_sock, &socksSet))
+    WARN("Upgrade refused with code %d", m_httpResponseCode);
+    return NET_PROTOCOL;
+  }
+  memmove(buf, &buf[crlfPos + 2], *pTrfLen - (crlfPos + 2));
+  *pTrfLen -= (crlfPos + 2);
+
+  bool upgrade = false;
+  bool connection = false;
+  bool accepted = false;
+  bool protocolAccepted = (protocol == NULL);
+  while(true)
+  {
+    ret = recvLine(buf, CHUNK_SIZE, pTrfLen, &crlfPos);
+    if(ret != OK)
     {
-      WARN("Timeout");
-      return NET_TIMEOUT; //Timeout
+      return (ret == NET_TOOSMALL) ? NET_PROTOCOL : NET_CONN;
     }
-
-    ret = socket::send(m_sock, buf + writtenLen, len - writtenLen, 0);
-    if( ret > 0)
+    if(crlfPos == 0) //End of headers
     {
-      writtenLen += ret;
-      continue;
+      memmove(buf, &buf[2], *pTrfLen - 2);
+      *pTrfLen -= 2;
+      break;
     }
-    else if( ret == 0 )
+    buf[crlfPos] = '\0';
+    char* value = strchr(buf, ':');
+    if(value == NULL)
     {
-      WARN("Connection was closed by server");
-      return NET_CLOSED; //Connection was closed by server
+      ERR("Could not parse header");
+      return NET_PROTOCOL;
     }
-    else
+    *value = '\0';
+    value++;
+    while( (*value == ' ') || (*value == '\t') )
     {
-      ERR("Connection error (recv returned %d)", ret);
-      return NET_CONN;
+      value++;
+    }
+    DBG("Read header : %s: %s", buf, value);
+    if(m_pHeaderVisitor != NULL)
+    {
+      visitHeader(buf, value);
+    }
+    if( equalsNoCase(buf, "Upgrade") )
+    {
+      upgrade = equalsNoCase(value, "websocket");
+    }
+    else if( equalsNoCase(buf, "Connection") )
+    {
+      connection = hasToken(value, "upgrade");
+    }
+    else if( equalsNoCase(buf, "Sec-WebSocket-Accept") )
+    {
+      accepted = !strcmp(value, accept);
+    }
+    else if( equalsNoCase(buf, "Sec-WebSocket-Protocol") )
+    {
+      protocolAccepted = (protocol != NULL) && !strcmp(value, protocol);
+    }
+    else if( equalsNoCase(buf, "Sec-WebSocket-Extensions") )
+    {
+      ERR("Extension not requested: %s", value);
+      return NET_PROTOCOL;
     }
+    memmove(buf, &buf[crlfPos + 2], *pTrfLen - (crlfPos + 2));
+    *pTrfLen -= (crlfPos + 2);
   }
-  DBG("Written %d bytes", writtenLen);
+
+  if( !upgrade || !connection || !accepted || !protocolAccepted )
+  {
+    ERR("Invalid handshake response (upgrade %d, connection %d, accept %d, protocol %d)", upgrade, connection, accepted, protocolAccepted);
+    return NET_PROTOCOL;
+  }
+  DBG("WebSocket handshake completed");
   return OK;
 }
 
-int HTTPClient::parseURL(const char* url, char* scheme, size_t maxSchemeLen, char* host, size_t maxHostLen, uint16_t* port, char* path, size_t maxPathLen) //Parse URL
+int HTTPClient::recv(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen) //0 on success, err code on failure
 {
-  char* schemePtr = (char*) url;
-  char* hostPtr = (char*) strstr(url, "://");
-  if(hostPtr == NULL)
+  m_recvResult = m_pConnTransport->read(buf, minLen, maxLen, pReadLen, m_timeout);
+  HTTP_TRACE(RECV, *pReadLen, m_recvResult);
+  if(*pReadLen > 0)
   {
-    WARN("Could not find host");
-    return NET_INVALID; //URL is invalid
+    m_received = true;
   }
+  return m_recvResult;
+}
 
-  if( maxSchemeLen < hostPtr - schemePtr + 1 ) //including NULL-terminating char
+int HTTPClient::writeData(IHTTPDataIn* pDataIn, const char* buf, size_t len) //Pass data to the sink, waiting while it is paused, 0 or HTTP_DATA_ABORT/HTTP_DATA_ENOUGH on success, err code on failure
+{
+  //Nothing is read from the connection while the sink is paused, so that TCP flow control holds the server back
+  uint32_t start = HTTPTime::getMs();
+  while(true)
   {
-    WARN("Scheme str is too small (%d >= %d)", maxSchemeLen, hostPtr - schemePtr + 1);
-    return NET_TOOSMALL;
+    int ret = pDataIn->write(buf, len);
+    if( (ret == HTTP_DATA_ABORT) || (ret == HTTP_DATA_ENOUGH) )
+    {
+      return ret;
+    }
+    if(ret != HTTP_DATA_PAUSE)
+    {
+      return OK; //Errors reported by the sink itself do not stop the transfer
+    }
+    if( HTTPTime::elapsed(start) >= m_timeout )
+    {
+      WARN("Data sink paused for too long");
+      return NET_TIMEOUT;
+    }
+    HTTPTime::sleep(HTTP_CLIENT_PAUSE_POLL_INTERVAL);
   }
-  memcpy(scheme, schemePtr, hostPtr - schemePtr);
-  scheme[hostPtr - schemePtr] = '\0';
+}
 
-  hostPtr+=3;
+int HTTPClient::send(const char* buf, size_t len) //0 on success, err code on failure
+{
+  if(len == 0)
+  {
+    len = strlen(buf);
+  }
+  int ret = m_pConnTransport->write(buf, len, m_timeout);
+  HTTP_TRACE(SEND, len, ret);
+  return ret;
+}
 
-  size_t hostLen = 0;
+void HTTPClient::visitHeader(const char* key, const char* value) //Pass header to the visitor if it was registered for it
+{
+  HTTPStringView name;
+  name.ptr = key;
+  name.len = strlen(key);
 
-  char* portPtr = strchr(hostPtr, ':');
-  if( portPtr != NULL )
+  if(m_headerNames != NULL)
   {
-    hostLen = portPtr - hostPtr;
-    portPtr++;
-    if( sscanf(portPtr, "%d", &port) != 1)
+    size_t i;
+    for(i = 0; i < m_headerNamesCount; i++)
     {
-      WARN("Could not find port");
-      return NET_INVALID;
+      if( name.equalsNoCase(m_headerNames[i]) )
+      {
+        break;
+      }
+    }
+    if(i == m_headerNamesCount)
+    {
+      return; //Not requested
     }
-  }
-  else
-  {
-    *port=0;
-  }
-  char* pathPtr = strchr(hostPtr, '/');
-  if( hostLen == 0 )
-  {
-    hostLen = pathPtr - hostPtr;
   }
 
-  if( maxHostLen < hostLen + 1 ) //including NULL-terminating char
+  HTTPStringView val;
+  val.ptr = value;
+  val.len = strlen(value);
+  while( (val.len > 0) && ((value[val.len - 1] == ' ') || (value[val.len - 1] == '\t')) )
   {
-    WARN("Host str is too small (%d >= %d)", maxHostLen, hostLen + 1);
-    return NET_TOOSMALL;
+    val.len--;
   }
-  memcpy(host, hostPtr, hostLen);
-  host[hostLen] = '\0';
+  m_pHeaderVisitor->onHeader(name, val);
+}
 
-  size_t pathLen;
-  char* fragmentPtr = strchr(hostPtr, '#');
-  if(fragmentPtr != NULL)
-  {
-    pathLen = fragmentPtr - pathPtr;
-  }
-  else
+bool HTTPClient::isRedirect(int responseCode)
+{
+  return (responseCode == 301) || (responseCode == 302) || (responseCode == 303) || (responseCode == 307) || (responseCode == 308);
+}
+
+bool HTTPClient::isTransient(int ret) //Whether a failed request can be retried
+{
+  if( (ret == NET_CONN) || (ret == NET_TIMEOUT) || (ret == NET_CLOSED) )
   {
-    pathLen = strlen(pathPtr);
+    return (m_httpResponseCode < 200) || (m_httpResponseCode >= 300); //Otherwise part of the data may already have been passed on
   }
-
-  if( maxPathLen < pathLen + 1 ) //including NULL-terminating char
+  if(ret == NET_PROTOCOL)
   {
-    WARN("Path str is too small (%d >= %d)", maxPathLen, pathLen + 1);
-    return NET_TOOSMALL;
+    return (m_httpResponseCode == 408) || (m_httpResponseCode == 429) || (m_httpResponseCode == 502) || (m_httpResponseCode == 503) || (m_httpResponseCode == 504);
   }
-  memcpy(path, pathPtr, pathLen);
-  path[pathLen] = '\0';
-
-  return OK;
+  return false;
 }
 
+bool HTTPClient::isIdempotent(const char* method)
+{
+  return equalsNoCase(method, "GET") || equalsNoCase(method, "HEAD") || equalsNoCase(method, "PUT") || equalsNoCase(method, "DELETE") || equalsNoCase(method, "OPTIONS");
+}
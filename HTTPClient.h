@@ -28,14 +28,35 @@ HTTP Client header file
 #ifndef HTTP_CLIENT_H
 #define HTTP_CLIENT_H
 
-#include "api/socket.h"
-
 #define HTTP_CLIENT_DEFAULT_TIMEOUT 4000
+#define HTTP_CLIENT_DEFAULT_MAX_REDIRECTS 5
+#define HTTP_CLIENT_DEFAULT_CONTINUE_TIMEOUT 1000
+#define HTTP_CLIENT_DEFAULT_RETRY_DELAY 500
+#define HTTP_CLIENT_DEFAULT_RETRY_MAX_DELAY 30000
+#define HTTP_CLIENT_PAUSE_POLL_INTERVAL 10 //Time in ms between two writes to a paused IHTTPDataIn
 
 class HTTPData;
+class HTTPWebSocket;
 
 #include "IHTTPData.h"
+#include "IHTTPTransport.h"
+#include "IHTTPHeaderVisitor.h"
+#include "HTTPEndpoint.h"
+#include "HTTPRequestTemplate.h"
+
+#ifdef __linux__
+#include "transport/HTTPEpollTransport.h"
+typedef HTTPEpollTransport HTTPDefaultTransport;
+#else
+#include "transport/HTTPSocketTransport.h"
+typedef HTTPSocketTransport HTTPDefaultTransport;
 #include "mbed.h"
+#endif
+
+class HTTPTLSTransport;
+#ifdef HTTP_CLIENT_TLS
+#include "transport/HTTPTLSTransport.h"
+#endif
 
 ///HTTP client results
 enum HTTPResult
@@ -56,13 +77,29 @@ enum HTTPResult
 The HTTPClient is composed of:
 - The actual client (HTTPClient)
 - Classes that act as a data repository, each of which deriving from the HTTPData class (HTTPText for short text content, HTTPFile for file I/O, HTTPMap for key/value pairs, and HTTPStream for streaming purposes)
+A data repository can pause the download, or end it early, from its write() method (see HTTPDataInControl)
+Any 2xx response is a success (a 204 has no body), and its code is given by getHTTPResponseCode(); other codes fail with NET_PROTOCOL
+Messages are logged up to HTTP_CLIENT_LOG_LEVEL, set at compile time (0: none, 1: errors, 2: warnings, the default, 3: information, 4: debug); the calls above it compile to nothing
+Built with HTTP_CLIENT_TRACE, the client also records requests, connections, sends and receives in a binary ring that costs no formatting (see HTTPTrace)
 */
 class HTTPClient
 {
 public:
-  ///Instantiate the HTTP client
+  ///Instantiate the HTTP client, using the platform's default transport (mbed sockets, or native sockets on Linux)
   HTTPClient();
+
+  /** Instantiate the HTTP client on top of a specific transport
+  @param pTransport : transport to use for all connections, must remain valid as long as the client is in use
+  */
+  HTTPClient(IHTTPTransport* pTransport);
   ~HTTPClient();
+
+#ifdef HTTP_CLIENT_TLS
+  /** Set the transport to use for https URLs (requires building with HTTP_CLIENT_TLS)
+  @param pTLSTransport : TLS transport, typically running on top of the plain transport; must remain valid as long as the client is in use
+  */
+  void setTLSTransport(HTTPTLSTransport* pTLSTransport);
+#endif
   
 #if 0 //TODO add header handlers
   /**
@@ -83,6 +120,16 @@ public:
   @return 0 on success, NET error (<0) on failure
   */
   int get(const char* url, IHTTPDataIn* pDataIn, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Execute a GET request on an endpoint
+  Blocks until completion
+  The endpoint keeps the resolved address of the host for the next requests
+  @param endpoint : endpoint on which to execute the request
+  @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+  @param timeout waiting timeout in ms (osWaitForever for blocking function, not recommended)
+  @return 0 on success, NET error (<0) on failure
+  */
+  int get(HTTPEndpoint& endpoint, IHTTPDataIn* pDataIn, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
   
   /** Execute a GET request on the url
   Blocks until completion
@@ -104,11 +151,133 @@ public:
   @return 0 on success, NET error on failure
   */
   int post(const char* url, const IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Execute a POST request on an endpoint
+  Blocks until completion
+  The endpoint keeps the resolved address of the host for the next requests
+  @param endpoint : endpoint on which to execute the request
+  @param dataOut : a IHTTPDataOut instance that contains the data that will be posted
+  @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+  @param timeout waiting timeout in ms (osWaitForever for blocking function, not recommended)
+  @return 0 on success, NET error on failure
+  */
+  int post(HTTPEndpoint& endpoint, const IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Resolve the host of an endpoint ahead of the first request
+  @param endpoint : endpoint to resolve
+  @return 0 on success, NET error on failure
+  */
+  int resolve(HTTPEndpoint& endpoint);
+
+  /** Open a connection to an endpoint ahead of the first request, so that the request starts sending at once
+  Requires keep-alive (see setKeepAlive()). Another connection kept open is closed; nothing is done if an idle connection to the same scheme, host and port is already open.
+  @param endpoint : endpoint to connect to, resolved first if needed
+  @param timeout : connection timeout in ms
+  @return 0 on success, NET_INVALID if keep-alive is disabled or the endpoint is invalid, NET error on failure
+  */
+  int preconnect(HTTPEndpoint& endpoint, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Get the idle connection kept open, if any
+  A connection that the server closed in the meantime is closed and not reported.
+  @param pIdleTime : pointer to a uint32_t that will receive the time in ms since the connection was opened or last used, can be NULL
+  @return the scheme, host and port of the connection, NULL if none is open
+  */
+  const HTTPEndpoint* getConnection(uint32_t* pIdleTime = NULL);
+
+  /** Execute a frozen request template
+  Blocks until completion
+  The request line and headers are sent as-is in a single write, only the Content-Length value is updated with the length of the data.
+  Expect: 100-continue is not used. A redirection keeps the headers of the template only if it stays on the same origin and the request is replayed as is.
+  @param request : frozen template to send, which also keeps the resolved address of the host
+  @param pDataOut : pointer to an IHTTPDataOut instance that contains the data to send, can be NULL
+  @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+  @param timeout waiting timeout in ms (osWaitForever for blocking function, not recommended)
+  @return 0 on success, NET error on failure
+  */
+  int execute(HTTPRequestTemplate& request, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Open a WebSocket connection (RFC 6455) with the HTTP/1.1 Upgrade handshake
+  Blocks until completion
+  The connection is handed over to the WebSocket: the client must not be used for other requests until the WebSocket is closed, and must outlive it.
+  Redirections are not followed and failures are not retried.
+  @param url : ws:// or wss:// url (http:// and https:// are accepted as well)
+  @param pWebSocket : WebSocket taking over the connection
+  @param protocol : subprotocol to request with Sec-WebSocket-Protocol, which the server must accept, or NULL
+  @param timeout waiting timeout in ms
+  @return 0 on success, NET error on failure (NET_PROTOCOL if the server refused the upgrade, see getHTTPResponseCode())
+  */
+  int openWebSocket(const char* url, HTTPWebSocket* pWebSocket, const char* protocol = NULL, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Open a WebSocket connection (RFC 6455) on an endpoint with the HTTP/1.1 Upgrade handshake
+  Blocks until completion
+  The endpoint keeps the resolved address of the host for the next connections
+  @param endpoint : endpoint to connect to
+  @param pWebSocket : WebSocket taking over the connection
+  @param protocol : subprotocol to request with Sec-WebSocket-Protocol, which the server must accept, or NULL
+  @param timeout waiting timeout in ms
+  @return 0 on success, NET error on failure (NET_PROTOCOL if the server refused the upgrade, see getHTTPResponseCode())
+  */
+  int openWebSocket(HTTPEndpoint& endpoint, HTTPWebSocket* pWebSocket, const char* protocol = NULL, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
   
   /** Get last request's HTTP response code
   @return The HTTP response code of the last request
   */
   int getHTTPResponseCode();
+
+  /** Set the maximum number of redirections (301, 302, 303, 307 and 308) followed by a request
+  301 and 302 responses to a POST, and all 303 responses, are followed with a GET; 307 and 308 replay the request, which requires the posted data to support IHTTPDataOut::rewind().
+  A redirection to the same scheme, host and port is sent on the same connection when the server keeps it alive.
+  @param maxRedirects : maximum number of hops, 0 to return redirections as errors (default HTTP_CLIENT_DEFAULT_MAX_REDIRECTS)
+  */
+  void setMaxRedirects(int maxRedirects);
+
+  /** Set a visitor for the response headers
+  The visitor receives each matching header as a name/value view into the receive buffer, without any copy. Headers that are not requested only cost the name comparison.
+  Content-Length, Transfer-Encoding and Content-Type are still passed to the IHTTPDataIn instance as well.
+  Headers that do not fit in the receive buffer (such as large cookies) are skipped without being visited.
+  @param pVisitor : visitor to call, or NULL to disable
+  @param names : names of the headers to visit (case-insensitive), or NULL to visit all headers; the array must remain valid as long as the visitor is set
+  @param namesCount : number of names in the array
+  */
+  void setHeaderVisitor(IHTTPHeaderVisitor* pVisitor, const char* const* names = NULL, size_t namesCount = 0);
+
+  /** Hold back the data of POST requests until the server accepts them (Expect: 100-continue)
+  When the server answers with a final status (e.g. 401, 413 or 503) instead of 100 Continue, the request ends without sending the data.
+  Servers that do not support it are given timeout ms to answer before the data is sent anyway.
+  @param enable : true to send Expect: 100-continue (disabled by default)
+  @param minDataLen : only for data at least that long (chunked data always qualifies, as its length is unknown)
+  @param timeout : time to wait for the answer of the server in ms
+  */
+  void setExpectContinue(bool enable, size_t minDataLen = 0, uint32_t timeout = HTTP_CLIENT_DEFAULT_CONTINUE_TIMEOUT);
+
+  /** Keep the connection open after a request, so that the next request to the same scheme, host and port skips the connection setup
+  The connection is only kept when the server allows it. An idle connection that the server closed in the meantime is detected and replaced before sending.
+  If the server closes it while the request is being sent, before any byte of the response, the request is sent again at once on a new connection.
+  @param enable : true to keep connections open (disabled by default)
+  */
+  void setKeepAlive(bool enable);
+
+  /** Close the connection kept open after the last request, if any
+  */
+  void closeConnection();
+
+  /** Retry requests that failed on a transient error: connection failures and timeouts, and 408, 429, 502, 503 and 504 responses
+  The delay before each retry is drawn at random between 0 and a bound that doubles on each retry from baseDelay up to maxDelay, so that clients failing together do not retry together.
+  A delay requested by the server with Retry-After (in seconds) is used instead, and the request fails right away when it exceeds maxDelay.
+  POST requests are only retried if the request was not sent at all, unless retryPost is set; their data must then support IHTTPDataOut::rewind().
+  Requests are never retried once data of the response was passed to the IHTTPDataIn instance.
+  @param maxRetries : maximum number of retries, 0 to disable (default)
+  @param baseDelay : bound of the delay before the first retry in ms
+  @param maxDelay : maximum delay before a retry in ms
+  @param retryPost : true to also retry POST requests that may have been processed by the server
+  */
+  void setRetry(int maxRetries, uint32_t baseDelay = HTTP_CLIENT_DEFAULT_RETRY_DELAY, uint32_t maxDelay = HTTP_CLIENT_DEFAULT_RETRY_MAX_DELAY, bool retryPost = false);
+
+  /** Set the time to wait for each piece of the response body, once the headers are received
+  Long-lived responses (event streams, long polling) may stay silent for much longer than the server takes to answer a request.
+  @param timeout : timeout in ms, HTTP_WAIT_FOREVER to wait as long as the connection is open, or 0 to use the timeout of the request (default)
+  */
+  void setBodyTimeout(uint32_t timeout);
   
 private:
   enum HTTP_METH
@@ -118,20 +287,59 @@ private:
     HTTP_HEAD
   };
 
-  int connect(const char* url, HTTP_METH method, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout); //Execute request
+  int connect(HTTPEndpoint& endpoint, HTTP_METH method, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout, const HTTPRequestTemplate* pTemplate = NULL); //Execute request, retrying on transient errors
+  int attempt(HTTPEndpoint& endpoint, HTTP_METH method, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout, const HTTPRequestTemplate* pTemplate); //Execute request once
+  int open(HTTPEndpoint& endpoint); //Connect to endpoint, 0 on success, err code on failure
+  int sendRequest(HTTP_METH method, const HTTPEndpoint& endpoint, IHTTPDataOut* pDataOut, bool expectContinue, const HTTPRequestTemplate* pTemplate); //Send request line and headers, 0 on success, err code on failure
+  int sendData(IHTTPDataOut* pDataOut); //Send request data, 0 on success, err code on failure
+  int recvResponse(IHTTPDataIn* pDataIn, char* location, size_t maxLocationLen, bool* pKeepAlive, bool stopOnContinue); //Receive status, headers and data (location is NULL when redirections are not followed), 0 on success, err code on failure
+  int recvUpgrade(char* buf, size_t* pTrfLen, const char* key, const char* protocol); //Receive and check the WebSocket handshake response, buf keeps the bytes that follow it
   int recv(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen); //0 on success, err code on failure
-  int send(char* buf, size_t len = 0); //0 on success, err code on failure
-  int parseURL(const char* url, char* scheme, size_t maxSchemeLen, char* host, size_t maxHostLen, uint16_t* port, char* path, size_t maxPathLen); //Parse URL
+  int writeData(IHTTPDataIn* pDataIn, const char* buf, size_t len); //Pass data to the sink, waiting while it is paused, 0 or HTTP_DATA_ABORT/HTTP_DATA_ENOUGH on success, err code on failure
+  int recvLine(char* buf, size_t maxLen, size_t* pTrfLen, size_t* pCrlfPos); //Read until buf holds a CRLF, within maxLen bytes, 0 on success, err code on failure
+  int skipLine(char* buf, size_t maxLen, size_t* pTrfLen); //Discard the line buf starts with up to its CRLF, buf keeps the bytes that follow it, 0 on success, err code on failure
+  int send(const char* buf, size_t len = 0); //0 on success, err code on failure
+  void visitHeader(const char* key, const char* value); //Pass header to the visitor if it was registered for it
+  static bool isRedirect(int responseCode);
+  bool isTransient(int ret); //Whether a failed request can be retried
+  static bool isIdempotent(const char* method);
 
   //Parameters
-  int m_sock;
+  HTTPDefaultTransport m_defaultTransport;
+  IHTTPTransport* m_pTransport;
+  HTTPTLSTransport* m_pTLSTransport;
+  IHTTPTransport* m_pConnTransport; //Transport carrying the current request, plain or TLS
   uint32_t m_timeout;
+  uint32_t m_bodyTimeout; //0 to keep m_timeout
+  int m_maxRedirects;
+  IHTTPHeaderVisitor* m_pHeaderVisitor;
+  const char* const* m_headerNames;
+  size_t m_headerNamesCount;
+  bool m_expectContinue;
+  size_t m_expectContinueMinLen;
+  uint32_t m_expectContinueTimeout;
+  bool m_keepAlive;
+  int m_maxRetries;
+  uint32_t m_retryBaseDelay;
+  uint32_t m_retryMaxDelay;
+  bool m_retryPost;
+  uint32_t m_random; //Jitter of the retry delays
+
+  //Connection kept open after the last request
+  bool m_connected;
+  HTTPEndpoint m_connOrigin;
+  uint32_t m_connTime; //When the connection was opened or last used
 
   const char* m_basicAuthUser;
   const char* m_basicAuthPassword;
   int m_httpResponseCode;
 
-  struct sockaddr_in m_serverAddr;
+  //Progress of the last attempt
+  bool m_sent; //Part of the request was written
+  bool m_received; //Part of the response was read
+  int m_recvResult; //Result of the last read
+  bool m_retryAfterSet;
+  uint32_t m_retryAfter; //Delay requested by the server in ms
 
 };
 
@@ -0,0 +1,453 @@
+/* HTTPEndpoint.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPEndpoint.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPEndpoint.h"
+
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+
+HTTPEndpoint::HTTPEndpoint() : m_port(0), m_secure(false), m_valid(false), m_resolved(false), m_addrCount(0),
+m_familyPreferred(false), m_preferredFamily(HTTP_ADDR_IPV4)
+{
+  m_scheme[0] = '\0';
+  m_host[0] = '\0';
+  m_authority[0] = '\0';
+  m_path[0] = '\0';
+}
+
+HTTPEndpoint::HTTPEndpoint(const char* url) : m_port(0), m_secure(false), m_valid(false), m_resolved(false), m_addrCount(0),
+m_familyPreferred(false), m_preferredFamily(HTTP_ADDR_IPV4)
+{
+  setUrl(url);
+}
+
+#if __cplusplus >= 201402L
+HTTPEndpoint::HTTPEndpoint(const HTTPUrl& url) : m_port(0), m_secure(false), m_valid(false), m_resolved(false), m_addrCount(0),
+m_familyPreferred(false), m_preferredFamily(HTTP_ADDR_IPV4)
+{
+  if( url.isValid() )
+  {
+    set(url.getScheme(), url.getSchemeLen(), url.getHost(), url.getHostLen(), url.getPort(), url.getPath(), url.getPathLen());
+  }
+}
+#endif
+
+static bool isIPv6Literal(const char* str, size_t len) //Between the brackets, e.g. "::1" or "::ffff:192.0.2.1"
+{
+  if( (len == 0) || (memchr(str, ':', len) == NULL) )
+  {
+    return false;
+  }
+  for(size_t i = 0; i < len; i++)
+  {
+    if( !isxdigit((unsigned char)str[i]) && (str[i] != ':') && (str[i] != '.') )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+int HTTPEndpoint::setUrl(const char* url)
+{
+  m_valid = false;
+  m_resolved = false;
+
+  const char* hostPtr = strstr(url, "://");
+  if(hostPtr == NULL)
+  {
+    WARN("Could not find host");
+    return NET_INVALID; //URL is invalid
+  }
+  size_t schemeLen = hostPtr - url;
+  hostPtr += 3;
+
+  //The authority ends with the path, the query or the fragment
+  const char* pathPtr = hostPtr + strcspn(hostPtr, "/?#");
+  size_t hostLen = pathPtr - hostPtr;
+
+  uint16_t port = 0;
+  const char* portPtr;
+  if( (hostLen > 0) && (hostPtr[0] == '[') ) //IPv6 address (RFC 3986 section 3.2.2), whose colons are not the port separator
+  {
+    const char* endPtr = (const char*) memchr(hostPtr, ']', hostLen);
+    if( (endPtr == NULL) || !isIPv6Literal(hostPtr + 1, endPtr - (hostPtr + 1)) || ((endPtr + 1 != pathPtr) && (endPtr[1] != ':')) )
+    {
+      WARN("Invalid IPv6 address");
+      return NET_INVALID;
+    }
+    portPtr = (endPtr + 1 != pathPtr) ? (endPtr + 1) : NULL;
+    hostPtr++; //The brackets are not part of the address passed to the resolver
+    hostLen = endPtr - hostPtr;
+  }
+  else
+  {
+    portPtr = (const char*) memchr(hostPtr, ':', hostLen);
+    if( portPtr != NULL )
+    {
+      hostLen = portPtr - hostPtr;
+    }
+  }
+  if( portPtr != NULL )
+  {
+    unsigned int portVal = 0;
+    const char* p;
+    for(p = portPtr + 1; (p < pathPtr) && isdigit((unsigned char)*p); p++)
+    {
+      portVal = portVal * 10 + (*p - '0');
+      if(portVal > 0xFFFF)
+      {
+        break;
+      }
+    }
+    if( (p != pathPtr) || (p == portPtr + 1) || (portVal == 0) )
+    {
+      WARN("Could not find port");
+      return NET_INVALID;
+    }
+    port = (uint16_t)portVal;
+  }
+
+  return set(url, schemeLen, hostPtr, hostLen, port, pathPtr, strcspn(pathPtr, "#"));
+}
+
+static bool hasScheme(const char* ref) //scheme = ALPHA *( ALPHA / DIGIT / "+" / "-" / "." ), followed by "://"
+{
+  if( !isalpha((unsigned char)ref[0]) )
+  {
+    return false;
+  }
+  const char* p = ref + 1;
+  while( isalnum((unsigned char)*p) || (*p == '+') || (*p == '-') || (*p == '.') )
+  {
+    p++;
+  }
+  return !strncmp(p, "://", 3);
+}
+
+int HTTPEndpoint::resolveReference(const char* ref, bool* pSameOrigin)
+{
+  *pSameOrigin = true;
+  if( hasScheme(ref) ) //Absolute URL; a "://" further on, e.g. in the query, does not make one
+  {
+    HTTPEndpoint target;
+    int ret = target.setUrl(ref);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    *pSameOrigin = isSameOrigin(target);
+    if(*pSameOrigin)
+    {
+      target.m_resolved = m_resolved;
+      memcpy(target.m_addrs, m_addrs, sizeof(m_addrs));
+      target.m_addrCount = m_addrCount;
+      target.m_familyPreferred = m_familyPreferred;
+      target.m_preferredFamily = m_preferredFamily;
+    }
+    *this = target;
+    return OK;
+  }
+
+  if( (ref[0] == '/') && (ref[1] == '/') ) //Scheme-relative URL
+  {
+    char url[HTTP_ENDPOINT_SCHEME_MAX_LEN + HTTP_ENDPOINT_HOST_MAX_LEN + HTTP_ENDPOINT_PATH_MAX_LEN];
+    if( snprintf(url, sizeof(url), "%s:%s", m_scheme, ref) >= (int)sizeof(url) )
+    {
+      return NET_TOOSMALL;
+    }
+    return resolveReference(url, pSameOrigin);
+  }
+
+  size_t refLen = strcspn(ref, "#");
+  if(refLen == 0) //Empty or fragment only: same document
+  {
+    return OK;
+  }
+
+  //Path, relative to the current one unless it starts with '/', or query only (RFC 3986 section 5.2.2)
+  size_t dirLen = 0;
+  if( ref[0] == '?' )
+  {
+    dirLen = strcspn(m_path, "?"); //Same path, the query is replaced
+  }
+  else if( ref[0] != '/' )
+  {
+    size_t queryPos = strcspn(m_path, "?");
+    for(size_t i = 0; i < queryPos; i++)
+    {
+      if(m_path[i] == '/')
+      {
+        dirLen = i + 1;
+      }
+    }
+  }
+  if( HTTP_ENDPOINT_PATH_MAX_LEN < dirLen + refLen + 1 ) //including NULL-terminating char
+  {
+    WARN("Path str is too small (%d >= %d)", HTTP_ENDPOINT_PATH_MAX_LEN, (int)(dirLen + refLen + 1));
+    return NET_TOOSMALL;
+  }
+  memcpy(m_path + dirLen, ref, refLen);
+  m_path[dirLen + refLen] = '\0';
+
+  //Remove "." and ".." segments (RFC 3986 section 5.2.4)
+  char* query = m_path + strcspn(m_path, "?");
+  char* in = m_path;
+  char* out = m_path;
+  while(in < query) //in points to a '/'
+  {
+    char* next = in + 1;
+    while( (next < query) && (*next != '/') )
+    {
+      next++;
+    }
+    size_t segmentLen = next - (in + 1);
+    bool dot = (segmentLen == 1) && (in[1] == '.');
+    bool dotDot = (segmentLen == 2) && (in[1] == '.') && (in[2] == '.');
+    if(dotDot)
+    {
+      while( (out > m_path) && (*(--out) != '/') ); //Remove last output segment
+    }
+    else if(!dot)
+    {
+      memmove(out, in, next - in);
+      out += next - in;
+    }
+    if( (dot || dotDot) && (next == query) )
+    {
+      *out++ = '/'; //A path ending with a dot segment refers to a directory
+    }
+    in = next;
+  }
+  memmove(out, query, strlen(query) + 1);
+  return OK;
+}
+
+int HTTPEndpoint::resolve(IHTTPTransport* pTransport)
+{
+  if(!m_valid)
+  {
+    return NET_INVALID;
+  }
+  int ret = pTransport->resolveAll(m_host, m_port, m_addrs, HTTP_ENDPOINT_MAX_ADDRESSES, &m_addrCount);
+  if( (ret != OK) || (m_addrCount == 0) )
+  {
+    m_resolved = false;
+    return NET_NOTFOUND;
+  }
+  if(m_familyPreferred)
+  {
+    //Start with the family that worked last time
+    for(size_t i = 0; i < m_addrCount; i++)
+    {
+      if(m_addrs[i].family == m_preferredFamily)
+      {
+        moveFirst(i);
+        break;
+      }
+    }
+  }
+  m_resolved = true;
+  return OK;
+}
+
+void HTTPEndpoint::clearAddress()
+{
+  m_resolved = false;
+}
+
+void HTTPEndpoint::setPreferredAddress(size_t index)
+{
+  if(index >= m_addrCount)
+  {
+    return;
+  }
+  m_familyPreferred = true;
+  m_preferredFamily = m_addrs[index].family;
+  moveFirst(index);
+}
+
+bool HTTPEndpoint::isValid() const
+{
+  return m_valid;
+}
+
+bool HTTPEndpoint::isSecure() const
+{
+  return m_secure;
+}
+
+bool HTTPEndpoint::isDefaultPort() const
+{
+  return m_port == (m_secure ? HTTPS_PORT : HTTP_PORT);
+}
+
+bool HTTPEndpoint::isResolved() const
+{
+  return m_resolved;
+}
+
+const char* HTTPEndpoint::getScheme() const
+{
+  return m_scheme;
+}
+
+const char* HTTPEndpoint::getHost() const
+{
+  return m_host;
+}
+
+const char* HTTPEndpoint::getAuthority() const
+{
+  return m_authority;
+}
+
+uint16_t HTTPEndpoint::getPort() const
+{
+  return m_port;
+}
+
+const char* HTTPEndpoint::getPath() const
+{
+  return m_path;
+}
+
+const HTTPAddress& HTTPEndpoint::getAddress() const
+{
+  return m_addrs[0];
+}
+
+const HTTPAddress* HTTPEndpoint::getAddresses() const
+{
+  return m_addrs;
+}
+
+size_t HTTPEndpoint::getAddressCount() const
+{
+  return m_resolved ? m_addrCount : 0;
+}
+
+int HTTPEndpoint::set(const char* scheme, size_t schemeLen, const char* host, size_t hostLen, uint16_t port, const char* path, size_t pathLen)
+{
+  m_valid = false;
+  m_resolved = false;
+
+  if( schemeLen + 1 > HTTP_ENDPOINT_SCHEME_MAX_LEN ) //including NULL-terminating char
+  {
+    WARN("Scheme str is too small (%d >= %d)", HTTP_ENDPOINT_SCHEME_MAX_LEN, (int)(schemeLen + 1));
+    return NET_TOOSMALL;
+  }
+  for(size_t i = 0; i < schemeLen; i++)
+  {
+    m_scheme[i] = tolower((unsigned char)scheme[i]); //Schemes are case-insensitive
+  }
+  m_scheme[schemeLen] = '\0';
+  if( !strcmp(m_scheme, "https") || !strcmp(m_scheme, "wss") )
+  {
+    m_secure = true;
+  }
+  else if( !strcmp(m_scheme, "http") || !strcmp(m_scheme, "ws") ) //WebSocket URLs, see HTTPClient::openWebSocket()
+  {
+    m_secure = false;
+  }
+  else
+  {
+    WARN("Unsupported scheme %s", m_scheme);
+    return NET_INVALID;
+  }
+
+  if( hostLen == 0 )
+  {
+    WARN("Could not find host");
+    return NET_INVALID;
+  }
+  if( hostLen + 1 > HTTP_ENDPOINT_HOST_MAX_LEN ) //including NULL-terminating char
+  {
+    WARN("Host str is too small (%d >= %d)", HTTP_ENDPOINT_HOST_MAX_LEN, (int)(hostLen + 1));
+    return NET_TOOSMALL;
+  }
+  memcpy(m_host, host, hostLen);
+  m_host[hostLen] = '\0';
+
+  m_port = (port != 0) ? port : (m_secure ? HTTPS_PORT : HTTP_PORT);
+
+  //An IPv6 address is the only host with a colon, it gets its brackets back
+  const char* format = (strchr(m_host, ':') != NULL) ? "[%s]" : "%s";
+  int len = snprintf(m_authority, sizeof(m_authority), format, m_host);
+  if( !isDefaultPort() )
+  {
+    snprintf(m_authority + len, sizeof(m_authority) - len, ":%d", m_port);
+  }
+
+  size_t offset = 0;
+  if( (pathLen == 0) || (path[0] != '/') ) //e.g. "http://host" or "http://host?query"
+  {
+    m_path[0] = '/';
+    offset = 1;
+  }
+  if( HTTP_ENDPOINT_PATH_MAX_LEN < offset + pathLen + 1 ) //including NULL-terminating char
+  {
+    WARN("Path str is too small (%d >= %d)", HTTP_ENDPOINT_PATH_MAX_LEN, (int)(offset + pathLen + 1));
+    return NET_TOOSMALL;
+  }
+  memcpy(m_path + offset, path, pathLen);
+  m_path[offset + pathLen] = '\0';
+
+  m_valid = true;
+  return OK;
+}
+
+void HTTPEndpoint::moveFirst(size_t index) //Move an address to the front, keeping the order of the others
+{
+  HTTPAddress addr = m_addrs[index];
+  memmove(&m_addrs[1], &m_addrs[0], index * sizeof(HTTPAddress));
+  m_addrs[0] = addr;
+}
+
+bool HTTPEndpoint::isSameOrigin(const HTTPEndpoint& endpoint) const
+{
+  if( (m_secure != endpoint.m_secure) || (m_port != endpoint.m_port) )
+  {
+    return false;
+  }
+  //Host names are case-insensitive
+  const char* a = m_host;
+  const char* b = endpoint.m_host;
+  while( (*a != '\0') && (tolower((unsigned char)*a) == tolower((unsigned char)*b)) )
+  {
+    a++;
+    b++;
+  }
+  return (*a == '\0') && (*b == '\0');
+}
@@ -0,0 +1,264 @@
+/* HTTPEndpoint.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPENDPOINT_H_
+#define HTTPENDPOINT_H_
+
+#include "IHTTPTransport.h"
+
+#define HTTP_ENDPOINT_SCHEME_MAX_LEN 8 //Including the NULL-terminating char
+#define HTTP_ENDPOINT_HOST_MAX_LEN 64 //Including the NULL-terminating char
+#define HTTP_ENDPOINT_AUTHORITY_MAX_LEN (HTTP_ENDPOINT_HOST_MAX_LEN + 8) //Host, brackets of an IPv6 address and port
+#ifndef HTTP_ENDPOINT_PATH_MAX_LEN
+#define HTTP_ENDPOINT_PATH_MAX_LEN 512 //Including the NULL-terminating char; signed URLs of CDNs often exceed 256 chars
+#endif
+#ifndef HTTP_ENDPOINT_MAX_ADDRESSES
+#define HTTP_ENDPOINT_MAX_ADDRESSES 4 //Addresses of the host kept for connecting (IPv4 and IPv6)
+#endif
+
+#define HTTP_PORT 80
+#define HTTPS_PORT 443
+
+#if __cplusplus >= 201402L
+/** URL that can be validated at compile time (C++14 and later)
+ * Declaring it constexpr turns an invalid URL into a build error, e.g.:
+ * @code
+ * constexpr HTTPUrl kReportUrl("http://example.com/report"); //A typo in the scheme or port does not compile
+ * HTTPEndpoint report(kReportUrl); //No parsing at run time
+ * @endcode
+ * Only the offsets of each component are computed, the string itself must remain valid while the HTTPUrl is in use.
+ */
+class HTTPUrl
+{
+public:
+  /** Parse and validate a URL (http[s]://host[:port][/[path]])
+   * @param url URL, usually a string literal; an IPv6 address is enclosed in brackets, which are not part of the host
+   */
+  constexpr HTTPUrl(const char* url) : m_url(url), m_schemeLen(0), m_hostPos(0), m_hostLen(0), m_port(0), m_pathPos(0), m_pathLen(0), m_valid(false)
+  {
+    m_valid = parse();
+    if(!m_valid)
+    {
+      invalidUrl(); //Not constexpr: a constexpr HTTPUrl that gets here fails to compile
+    }
+  }
+
+  constexpr bool isValid() const { return m_valid; }
+  constexpr const char* getUrl() const { return m_url; }
+  constexpr const char* getScheme() const { return m_url; }
+  constexpr size_t getSchemeLen() const { return m_schemeLen; }
+  constexpr const char* getHost() const { return m_url + m_hostPos; } ///<Without the brackets of an IPv6 address
+  constexpr size_t getHostLen() const { return m_hostLen; }
+  constexpr uint16_t getPort() const { return m_port; } ///<0 if the URL uses the default port
+  constexpr const char* getPath() const { return m_url + m_pathPos; }
+  constexpr size_t getPathLen() const { return m_pathLen; } ///<0 if the URL has no path
+
+private:
+  constexpr bool parse()
+  {
+    size_t i = 0;
+    while( ((m_url[i] >= 'a') && (m_url[i] <= 'z')) || ((m_url[i] >= 'A') && (m_url[i] <= 'Z')) )
+    {
+      i++;
+    }
+    if( (m_url[i] != ':') || (m_url[i + 1] != '/') || (m_url[i + 2] != '/') )
+    {
+      return false;
+    }
+    m_schemeLen = i;
+    bool http = (i >= 4) && ((m_url[0] | 0x20) == 'h') && ((m_url[1] | 0x20) == 't') && ((m_url[2] | 0x20) == 't') && ((m_url[3] | 0x20) == 'p');
+    if( !http || ((i != 4) && ((i != 5) || ((m_url[4] | 0x20) != 's'))) )
+    {
+      return false; //Only http and https
+    }
+
+    i += 3;
+    if(m_url[i] == '[') //IPv6 address, whose colons are not the port separator
+    {
+      i++;
+      m_hostPos = i;
+      bool colon = false;
+      while( ((m_url[i] >= '0') && (m_url[i] <= '9')) || (((m_url[i] | 0x20) >= 'a') && ((m_url[i] | 0x20) <= 'f')) || (m_url[i] == ':') || (m_url[i] == '.') )
+      {
+        colon = colon || (m_url[i] == ':');
+        i++;
+      }
+      if( (m_url[i] != ']') || !colon )
+      {
+        return false;
+      }
+      m_hostLen = i - m_hostPos;
+      i++;
+    }
+    else
+    {
+      m_hostPos = i;
+      while( (m_url[i] != '\0') && (m_url[i] != ':') && (m_url[i] != '/') && (m_url[i] != '?') && (m_url[i] != '#') )
+      {
+        i++;
+      }
+      m_hostLen = i - m_hostPos;
+    }
+    if( (m_hostLen == 0) || (m_hostLen >= HTTP_ENDPOINT_HOST_MAX_LEN) )
+    {
+      return false;
+    }
+
+    if(m_url[i] == ':')
+    {
+      i++;
+      size_t start = i;
+      uint32_t port = 0;
+      while( (m_url[i] >= '0') && (m_url[i] <= '9') )
+      {
+        port = port * 10 + (m_url[i] - '0');
+        if(port > 0xFFFF)
+        {
+          return false;
+        }
+        i++;
+      }
+      if( (i == start) || (port == 0) )
+      {
+        return false;
+      }
+      m_port = port;
+    }
+
+    if( (m_url[i] != '\0') && (m_url[i] != '/') && (m_url[i] != '?') && (m_url[i] != '#') )
+    {
+      return false;
+    }
+    m_pathPos = i;
+    while( (m_url[i] != '\0') && (m_url[i] != '#') )
+    {
+      i++;
+    }
+    m_pathLen = i - m_pathPos;
+    return m_pathLen + 1 < HTTP_ENDPOINT_PATH_MAX_LEN; //Leave room for a leading '/'
+  }
+
+  static void invalidUrl() {}
+
+  const char* m_url;
+  size_t m_schemeLen;
+  size_t m_hostPos;
+  size_t m_hostLen;
+  uint16_t m_port;
+  size_t m_pathPos;
+  size_t m_pathLen;
+  bool m_valid;
+};
+#endif
+
+/** Target of requests, parsed once and resolved once
+ * Keeping an endpoint for URLs that are requested over and over avoids parsing the URL and resolving the host on every request:
+ * @code
+ * HTTPEndpoint status("http://example.com/status");
+ * client.resolve(status); //Optional, otherwise done by the first request
+ * while(true)
+ * {
+ *   client.get(status, &text);
+ * }
+ * @endcode
+ */
+class HTTPEndpoint
+{
+public:
+  ///Instantiate an invalid endpoint, to be set with setUrl()
+  HTTPEndpoint();
+
+  /** Instantiate an endpoint from a URL, use isValid() to check the result
+   * @param url URL (http[s]://host[:port][/[path]]), where an IPv6 address is enclosed in brackets (e.g. http://[::1]:8080/)
+   */
+  HTTPEndpoint(const char* url);
+
+#if __cplusplus >= 201402L
+  /** Instantiate an endpoint from a URL validated at compile time, without parsing it again
+   * @param url Validated URL
+   */
+  HTTPEndpoint(const HTTPUrl& url);
+#endif
+
+  /** Parse and validate a URL, discarding any resolved address
+   * @param url URL (http[s]://host[:port][/[path]]), where an IPv6 address is enclosed in brackets (e.g. http://[::1]:8080/)
+   * @return 0 on success, NET error on failure
+   */
+  int setUrl(const char* url);
+
+  /** Resolve a reference (e.g. a Location header) against this endpoint, which then points to the target
+   * @param ref Absolute URL, scheme-relative URL, absolute path, relative path or query
+   * @param pSameOrigin Set to true if the scheme, host and port did not change, in which case the resolved address is kept
+   * @return 0 on success, NET error on failure
+   */
+  int resolveReference(const char* ref, bool* pSameOrigin);
+
+  /** Resolve the host through a transport, and keep the address for the following requests
+   * @param pTransport Transport to resolve with
+   * @return 0 on success, NET error on failure
+   */
+  int resolve(IHTTPTransport* pTransport);
+
+  /** Forget the resolved address, so that the next request resolves the host again
+   */
+  void clearAddress();
+
+  /** Move an address first, once a connection to it succeeded, so that the next connections try it first
+   * Its family is also tried first when the host is resolved again
+   * @param index Index of the address in getAddresses()
+   */
+  void setPreferredAddress(size_t index);
+
+  bool isValid() const;
+  bool isSecure() const; ///<Whether the scheme is https (or wss)
+  bool isDefaultPort() const; ///<Whether the port is the default one of the scheme
+  bool isResolved() const;
+  const char* getScheme() const;
+  const char* getHost() const; ///<Host name or address, without the brackets of an IPv6 address
+  const char* getAuthority() const; ///<Value of the Host header: host, in brackets if it is an IPv6 address, and port unless it is the default one
+  uint16_t getPort() const;
+  const char* getPath() const; ///<Path and query, always starting with '/'
+  const HTTPAddress& getAddress() const; ///<Preferred address, only meaningful if isResolved()
+  const HTTPAddress* getAddresses() const; ///<All the addresses of the host, in the order in which they should be tried
+  size_t getAddressCount() const; ///<Number of addresses, 0 if not resolved
+  bool isSameOrigin(const HTTPEndpoint& endpoint) const; ///<Whether the scheme, host and port are the same
+
+private:
+  int set(const char* scheme, size_t schemeLen, const char* host, size_t hostLen, uint16_t port, const char* path, size_t pathLen);
+  void moveFirst(size_t index); //Move an address to the front, keeping the order of the others
+
+  char m_scheme[HTTP_ENDPOINT_SCHEME_MAX_LEN];
+  char m_host[HTTP_ENDPOINT_HOST_MAX_LEN];
+  char m_authority[HTTP_ENDPOINT_AUTHORITY_MAX_LEN];
+  char m_path[HTTP_ENDPOINT_PATH_MAX_LEN];
+  uint16_t m_port;
+  bool m_secure;
+  bool m_valid;
+  bool m_resolved;
+  HTTPAddress m_addrs[HTTP_ENDPOINT_MAX_ADDRESSES];
+  size_t m_addrCount;
+  bool m_familyPreferred; //Whether a connection succeeded, in which case m_preferredFamily is tried first
+  HTTPAddressFamily m_preferredFamily;
+};
+
+#endif /* HTTPENDPOINT_H_ */
@@ -0,0 +1,428 @@
+/* HTTPEventStream.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPEventStream.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPEventStream.h"
+#include "util/HTTPTime.h"
+
+#include <string.h>
+#include <ctype.h>
+
+static const char s_bom[] = "\xEF\xBB\xBF"; //UTF-8 byte order mark, skipped at the start of the stream
+
+HTTPEventStream::HTTPEventStream() :
+m_pListener(NULL), m_retry(HTTP_EVENT_STREAM_DEFAULT_RETRY)
+{
+  m_lastId[0] = '\0';
+  m_id[0] = '\0';
+  reset();
+}
+
+int HTTPEventStream::run(HTTPClient& client, const char* url, IHTTPEventListener* pListener, uint32_t idleTimeout /*= HTTP_EVENT_STREAM_DEFAULT_IDLE_TIMEOUT*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  HTTPEndpoint endpoint;
+  int ret = endpoint.setUrl(url);
+  if(ret != OK)
+  {
+    ERR("Invalid URL %s (%d)", url, ret);
+    return ret;
+  }
+  return run(client, endpoint, pListener, idleTimeout, timeout);
+}
+
+int HTTPEventStream::run(HTTPClient& client, HTTPEndpoint& endpoint, IHTTPEventListener* pListener, uint32_t idleTimeout /*= HTTP_EVENT_STREAM_DEFAULT_IDLE_TIMEOUT*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  HTTPRequestTemplate request;
+  int ret;
+  m_pListener = pListener;
+  client.setBodyTimeout(idleTimeout);
+  while(true)
+  {
+    //Built again for each connection, as the last event ID changes
+    ret = request.setRequest("GET", endpoint);
+    if(ret == OK) ret = request.addHeader("Accept", "text/event-stream");
+    if(ret == OK) ret = request.addHeader("Cache-Control", "no-cache");
+    if( (ret == OK) && (m_lastId[0] != '\0') ) ret = request.addHeader("Last-Event-ID", m_lastId);
+    if(ret == OK) ret = request.freeze();
+    if(ret != OK)
+    {
+      ERR("Could not build the request (%d)", ret);
+      break;
+    }
+
+    reset();
+    DBG("Connecting to the event stream (last event ID '%s')", m_lastId);
+    ret = client.execute(request, NULL, this, timeout);
+    endpoint = request.getEndpoint(); //Keeps the resolved address for the next connection
+    if(m_stopped) //Ended by the listener
+    {
+      ret = OK;
+      break;
+    }
+    if( (client.getHTTPResponseCode() == 204) && (ret == OK) ) //Ended by the server
+    {
+      DBG("No more events");
+      ret = OK;
+      break;
+    }
+    if( (client.getHTTPResponseCode() == 200) && !m_eventStream )
+    {
+      ERR("Not an event stream");
+      ret = NET_PROTOCOL;
+      break;
+    }
+    if( (ret == NET_PROTOCOL) || (ret == NET_ABORT) || (ret == NET_INVALID) )
+    {
+      break;
+    }
+
+    //The response ended or the connection failed: reconnect, unless the listener is done
+    if( !m_pListener->onDisconnected(ret) )
+    {
+      break;
+    }
+    WARN("Event stream interrupted (%d), reconnecting in %u ms", ret, (unsigned int)m_retry);
+    HTTPTime::sleep(m_retry);
+  }
+  client.setBodyTimeout(0);
+  m_pListener = NULL;
+  return ret;
+}
+
+void HTTPEventStream::setLastEventId(const char* id)
+{
+  m_lastId[0] = '\0';
+  if(id != NULL)
+  {
+    strncat(m_lastId, id, sizeof(m_lastId) - 1);
+  }
+  strcpy(m_id, m_lastId);
+}
+
+const char* HTTPEventStream::getLastEventId() const
+{
+  return m_lastId;
+}
+
+uint32_t HTTPEventStream::getRetry() const
+{
+  return m_retry;
+}
+
+/*virtual*/ int HTTPEventStream::write(const char* buf, size_t len)
+{
+  if(!m_eventStream)
+  {
+    return HTTP_DATA_ABORT; //run() fails with NET_PROTOCOL
+  }
+
+  size_t pos = 0;
+  if(m_dispatching) //The same data again, after a pause
+  {
+    int ret = dispatch();
+    if(ret != OK)
+    {
+      return ret;
+    }
+    pos = m_resumePos;
+  }
+
+  while(pos < len)
+  {
+    char c = buf[pos];
+    if(m_bomPos < sizeof(s_bom) - 1)
+    {
+      if(c == s_bom[m_bomPos])
+      {
+        m_bomPos++;
+        pos++;
+        continue;
+      }
+      m_bomPos = sizeof(s_bom) - 1;
+    }
+    if(m_skipLF)
+    {
+      m_skipLF = false;
+      if(c == '\n') //Second half of a CRLF
+      {
+        pos++;
+        continue;
+      }
+    }
+
+    if( (c == '\r') || (c == '\n') )
+    {
+      pos++;
+      m_skipLF = (c == '\r');
+      if(m_lineStart) //Blank line, the event is complete
+      {
+        m_resumePos = pos;
+        int ret = dispatch();
+        if(ret != OK)
+        {
+          return ret;
+        }
+      }
+      else
+      {
+        endField();
+      }
+      continue;
+    }
+    m_lineStart = false;
+
+    if(m_field == FIELD_NAME)
+    {
+      pos++;
+      if(c == ':')
+      {
+        beginValue();
+      }
+      else if(m_nameLen < sizeof(m_name))
+      {
+        m_name[m_nameLen++] = c; //Too long for any known field once full
+      }
+      continue;
+    }
+
+    //Value: copy the run of chars up to the end of the line where it belongs
+    if(m_valueStart)
+    {
+      m_valueStart = false;
+      if(c == ' ') //One space after the colon is skipped
+      {
+        pos++;
+        continue;
+      }
+    }
+    size_t end = pos;
+    while( (end < len) && (buf[end] != '\r') && (buf[end] != '\n') )
+    {
+      end++;
+    }
+    appendValue(buf + pos, end - pos);
+    pos = end;
+  }
+  return OK;
+}
+
+/*virtual*/ void HTTPEventStream::setDataType(const char* type)
+{
+  static const char eventStream[] = "text/event-stream";
+  size_t len = sizeof(eventStream) - 1;
+  size_t i = 0;
+  while( (i < len) && (tolower((unsigned char)type[i]) == eventStream[i]) )
+  {
+    i++;
+  }
+  m_eventStream = (i == len) && ( (type[len] == '\0') || (type[len] == ';') || (type[len] == ' ') || (type[len] == '\t') ); //Parameters (e.g. charset) are ignored
+  if(!m_eventStream)
+  {
+    WARN("Unexpected content type %s", type);
+  }
+}
+
+/*virtual*/ void HTTPEventStream::setIsChunked(bool /*chunked*/)
+{
+
+}
+
+/*virtual*/ void HTTPEventStream::setDataLen(size_t /*len*/)
+{
+
+}
+
+void HTTPEventStream::reset() //New connection, the last event ID and the retry delay are kept
+{
+  m_eventStream = false;
+  m_stopped = false;
+  m_bomPos = 0;
+  m_skipLF = false;
+  m_lineStart = true;
+  m_field = FIELD_NAME;
+  m_nameLen = 0;
+  m_valueStart = false;
+  m_valueLen = 0;
+  m_dispatching = false;
+  m_resumePos = 0;
+  m_dataLen = 0;
+  m_hasData = false;
+  m_dataOverflow = false;
+  m_typeLen = 0;
+  strcpy(m_id, m_lastId); //An incomplete event does not count
+}
+
+void HTTPEventStream::beginValue() //Field name complete
+{
+  m_field = FIELD_IGNORED;
+  if( (m_nameLen == 4) && !memcmp(m_name, "data", 4) )
+  {
+    m_field = FIELD_DATA;
+    if(m_hasData) //Data lines are joined with LF
+    {
+      appendValue("\n", 1);
+    }
+    m_hasData = true;
+  }
+  else if( (m_nameLen == 5) && !memcmp(m_name, "event", 5) )
+  {
+    m_field = FIELD_EVENT;
+    m_typeLen = 0;
+  }
+  else if( (m_nameLen == 2) && !memcmp(m_name, "id", 2) )
+  {
+    m_field = FIELD_ID;
+    m_lineIdLen = 0;
+    m_lineIdValid = true;
+  }
+  else if( (m_nameLen == 5) && !memcmp(m_name, "retry", 5) )
+  {
+    m_field = FIELD_RETRY;
+    m_lineRetry = 0;
+    m_lineRetryValid = true;
+  }
+  //Anything else, including comments (lines starting with a colon), is ignored
+  m_valueStart = true;
+  m_valueLen = 0;
+}
+
+void HTTPEventStream::appendValue(const char* value, size_t len)
+{
+  m_valueLen += len;
+  switch(m_field)
+  {
+  case FIELD_DATA:
+    if(m_dataLen + len <= HTTP_EVENT_STREAM_DATA_MAX_LEN)
+    {
+      memcpy(m_data + m_dataLen, value, len);
+      m_dataLen += len;
+    }
+    else
+    {
+      m_dataOverflow = true;
+    }
+    break;
+  case FIELD_EVENT:
+    len = MIN(len, sizeof(m_type) - 1 - m_typeLen); //Truncated
+    memcpy(m_type + m_typeLen, value, len);
+    m_typeLen += len;
+    break;
+  case FIELD_ID:
+    if( (m_lineIdLen + len < sizeof(m_lineId)) && (memchr(value, '\0', len) == NULL) )
+    {
+      memcpy(m_lineId + m_lineIdLen, value, len);
+      m_lineIdLen += len;
+    }
+    else
+    {
+      m_lineIdValid = false; //IDs with NULL chars are ignored, and so are IDs too long to be sent back in full
+    }
+    break;
+  case FIELD_RETRY:
+    for(size_t i = 0; i < len; i++)
+    {
+      if( (value[i] < '0') || (value[i] > '9') || (m_lineRetry > (0xFFFFFFFF - 9) / 10) )
+      {
+        m_lineRetryValid = false;
+        break;
+      }
+      m_lineRetry = m_lineRetry * 10 + (value[i] - '0');
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void HTTPEventStream::endField() //End of a non-blank line
+{
+  if(m_field == FIELD_NAME) //No colon: the whole line is the name, and the value is empty
+  {
+    beginValue();
+  }
+  if( (m_field == FIELD_ID) && m_lineIdValid )
+  {
+    memcpy(m_id, m_lineId, m_lineIdLen);
+    m_id[m_lineIdLen] = '\0';
+  }
+  else if( (m_field == FIELD_ID) && !m_lineIdValid )
+  {
+    WARN("Invalid event ID ignored");
+  }
+  else if( (m_field == FIELD_RETRY) && m_lineRetryValid && (m_valueLen > 0) )
+  {
+    DBG("Reconnection delay set to %u ms", (unsigned int)m_lineRetry);
+    m_retry = m_lineRetry;
+  }
+  m_field = FIELD_NAME;
+  m_nameLen = 0;
+  m_lineStart = true;
+}
+
+int HTTPEventStream::dispatch() //Blank line, 0 or the result of the listener
+{
+  if(!m_dispatching)
+  {
+    strcpy(m_lastId, m_id);
+    if( !m_hasData || m_dataOverflow )
+    {
+      if(m_dataOverflow)
+      {
+        WARN("Event larger than %d bytes dropped", HTTP_EVENT_STREAM_DATA_MAX_LEN);
+      }
+      m_dataLen = 0;
+      m_hasData = false;
+      m_dataOverflow = false;
+      m_typeLen = 0;
+      return OK;
+    }
+    m_data[m_dataLen] = '\0';
+    m_type[m_typeLen] = '\0';
+  }
+
+  int ret = m_pListener->onEvent((m_typeLen > 0) ? m_type : "message", m_data, m_dataLen, m_lastId);
+  if(ret == HTTP_DATA_PAUSE)
+  {
+    m_dispatching = true; //Passed again when the data is written again
+    return ret;
+  }
+  m_dispatching = false;
+  m_dataLen = 0;
+  m_hasData = false;
+  m_typeLen = 0;
+  if(ret == HTTP_DATA_ENOUGH)
+  {
+    m_stopped = true;
+    return ret;
+  }
+  return (ret == HTTP_DATA_ABORT) ? ret : OK; //NET errors would make the client skip the rest of the data
+}
@@ -0,0 +1,166 @@
+/* HTTPEventStream.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPEVENTSTREAM_H_
+#define HTTPEVENTSTREAM_H_
+
+#include "HTTPClient.h"
+
+#ifndef HTTP_EVENT_STREAM_DATA_MAX_LEN
+#define HTTP_EVENT_STREAM_DATA_MAX_LEN 512 //Data of an event, larger events are dropped
+#endif
+#define HTTP_EVENT_STREAM_TYPE_MAX_LEN 32 //Including the NULL-terminating char
+#define HTTP_EVENT_STREAM_ID_MAX_LEN 64 //Including the NULL-terminating char
+#define HTTP_EVENT_STREAM_DEFAULT_RETRY 3000 //Reconnection delay until the server sets one
+#define HTTP_EVENT_STREAM_DEFAULT_IDLE_TIMEOUT HTTP_WAIT_FOREVER
+
+///This is a simple interface for receiving the events of an HTTPEventStream
+class IHTTPEventListener
+{
+protected:
+  friend class HTTPEventStream;
+
+  /** Called for each event, as soon as its terminating blank line is received
+   * @param type Event type, "message" if the server did not set one
+   * @param data Data of the event (its data lines joined with LF), NULL-terminated
+   * @param len Length of the data
+   * @param id Last event ID, empty if the server did not set any
+   * @return 0 to go on, or a HTTPDataInControl value: HTTP_DATA_PAUSE to be called again later with the same event, HTTP_DATA_ENOUGH to end the stream, HTTP_DATA_ABORT to fail it
+   */
+  virtual int onEvent(const char* type, const char* data, size_t len, const char* id) = 0;
+
+  /** Called when the connection could not be made, or was lost
+   * @param result NET error, or 0 if the server ended the response
+   * @return true to reconnect after the retry delay, false to stop the stream
+   */
+  virtual bool onDisconnected(int /*result*/) { return true; }
+
+public:
+  virtual ~IHTTPEventListener() {}
+};
+
+/** Server-Sent Events consumer (text/event-stream)
+ * The response is kept open for as long as the server sends it, and parsed as it arrives: each event reaches the listener as soon as its
+ * last line is received, instead of waiting for the next poll. Lines are not buffered, the fields are copied straight to where they belong.
+ * When the connection ends, it is opened again after the delay set by the server (retry field), with the ID of the last event received
+ * in a Last-Event-ID header so that the server can resume the stream. A 204 response ends the stream.
+ * @code
+ * HTTPClient client;
+ * HTTPEventStream stream;
+ * stream.run(client, "http://example.com/events", &listener, 60000); //The server sends a comment every 20 s
+ * @endcode
+ */
+class HTTPEventStream : public IHTTPDataIn
+{
+public:
+  HTTPEventStream();
+
+  /** Receive the events of a url until the listener ends the stream
+   * Blocks until completion
+   * @param client Client carrying the requests, whose settings (transport, retries, redirections) apply; its body timeout is set to idleTimeout during the call, then reset
+   * @param url Url of the stream
+   * @param pListener Listener receiving the events
+   * @param idleTimeout Time in ms without any data (events or comments) after which the connection is considered lost, HTTP_WAIT_FOREVER to never give up on it
+   * @param timeout Timeout in ms of the connection and of the response headers
+   * @return 0 if the listener or the server ended the stream, NET error on failure (NET_PROTOCOL if the response is not an event stream)
+   */
+  int run(HTTPClient& client, const char* url, IHTTPEventListener* pListener, uint32_t idleTimeout = HTTP_EVENT_STREAM_DEFAULT_IDLE_TIMEOUT, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Receive the events of an endpoint until the listener ends the stream
+   * Blocks until completion
+   * The endpoint keeps the resolved address of the host for the next connections
+   * @param client Client carrying the requests, whose settings (transport, retries, redirections) apply; its body timeout is set to idleTimeout during the call, then reset
+   * @param endpoint Endpoint of the stream
+   * @param pListener Listener receiving the events
+   * @param idleTimeout Time in ms without any data (events or comments) after which the connection is considered lost, HTTP_WAIT_FOREVER to never give up on it
+   * @param timeout Timeout in ms of the connection and of the response headers
+   * @return 0 if the listener or the server ended the stream, NET error on failure (NET_PROTOCOL if the response is not an event stream)
+   */
+  int run(HTTPClient& client, HTTPEndpoint& endpoint, IHTTPEventListener* pListener, uint32_t idleTimeout = HTTP_EVENT_STREAM_DEFAULT_IDLE_TIMEOUT, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Set the ID sent in the Last-Event-ID header of the next connection, e.g. to resume a stream after a restart
+   * @param id Event ID, or NULL to clear it
+   */
+  void setLastEventId(const char* id);
+
+  const char* getLastEventId() const; ///<ID of the last event received, empty if none
+  uint32_t getRetry() const; ///<Reconnection delay in ms, as last set by the server
+
+protected:
+  //IHTTPDataIn
+  virtual int write(const char* buf, size_t len);
+  virtual void setDataType(const char* type);
+  virtual void setIsChunked(bool chunked);
+  virtual void setDataLen(size_t len);
+
+private:
+  HTTPEventStream(const HTTPEventStream&); //Not copyable, the listener may keep pointers to the buffers
+  HTTPEventStream& operator=(const HTTPEventStream&);
+
+  enum Field
+  {
+    FIELD_NAME, //Reading the field name
+    FIELD_DATA,
+    FIELD_EVENT,
+    FIELD_ID,
+    FIELD_RETRY,
+    FIELD_IGNORED //Comment or unknown field
+  };
+
+  void reset(); //New connection, the last event ID and the retry delay are kept
+  void beginValue(); //Field name complete
+  void appendValue(const char* value, size_t len);
+  void endField(); //End of a non-blank line
+  int dispatch(); //Blank line, 0 or the result of the listener
+
+  IHTTPEventListener* m_pListener;
+  bool m_eventStream; //Whether the response is text/event-stream
+  bool m_stopped; //Ended by the listener
+  size_t m_bomPos; //Bytes of the UTF-8 BOM matched at the start of the stream
+  bool m_skipLF; //Last line ended with CR, LF may follow
+  bool m_lineStart;
+  Field m_field;
+  char m_name[8]; //Field names that matter are shorter
+  size_t m_nameLen;
+  bool m_valueStart; //Before the first char of the value, where a space is skipped
+  size_t m_valueLen;
+  bool m_dispatching; //Paused by the listener, its event is passed again before any more data
+  size_t m_resumePos; //Where to go on in the data written again after a pause
+
+  char m_data[HTTP_EVENT_STREAM_DATA_MAX_LEN + 1];
+  size_t m_dataLen;
+  bool m_hasData; //A data field was received, possibly empty
+  bool m_dataOverflow;
+  char m_type[HTTP_EVENT_STREAM_TYPE_MAX_LEN];
+  size_t m_typeLen;
+  char m_lineId[HTTP_EVENT_STREAM_ID_MAX_LEN]; //Value of the id field being read
+  size_t m_lineIdLen;
+  bool m_lineIdValid;
+  char m_id[HTTP_EVENT_STREAM_ID_MAX_LEN]; //ID of the event being received
+  char m_lastId[HTTP_EVENT_STREAM_ID_MAX_LEN]; //ID of the last event, sent when reconnecting
+  uint32_t m_lineRetry; //Value of the retry field being read
+  bool m_lineRetryValid;
+  uint32_t m_retry;
+};
+
+#endif /* HTTPEVENTSTREAM_H_ */
@@ -0,0 +1,231 @@
+/* HTTPRequestTemplate.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPRequestTemplate.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPRequestTemplate.h"
+#include "util/HTTPBase64.h"
+
+#include <cstring>
+#include <cstdio>
+
+#define CONTENT_LENGTH_DIGITS 10 //Enough for any 32-bit length
+
+#define BASIC_AUTH_MAX_LEN 96 //Credentials, before encoding
+
+HTTPRequestTemplate::HTTPRequestTemplate() : m_len(0), m_headersPos(0), m_contentLengthPos(0), m_frozen(false)
+{
+  m_buf[0] = '\0';
+  m_method[0] = '\0';
+}
+
+int HTTPRequestTemplate::setRequest(const char* method, const char* url)
+{
+  m_len = 0;
+  m_frozen = false;
+  int ret = m_endpoint.setUrl(url);
+  if(ret != OK)
+  {
+    ERR("Invalid URL %s (%d)", url, ret);
+    return ret;
+  }
+  return init(method);
+}
+
+int HTTPRequestTemplate::setRequest(const char* method, const HTTPEndpoint& endpoint)
+{
+  m_len = 0;
+  m_frozen = false;
+  if( !endpoint.isValid() )
+  {
+    return NET_INVALID;
+  }
+  m_endpoint = endpoint;
+  return init(method);
+}
+
+int HTTPRequestTemplate::addHeader(const char* name, const char* value)
+{
+  if( (m_len == 0) || m_frozen )
+  {
+    return NET_INVALID;
+  }
+  //Reject anything that would end the header early
+  if( (name[0] == '\0') || (strpbrk(name, ":\r\n") != NULL) || (strpbrk(value, "\r\n") != NULL) )
+  {
+    return NET_INVALID;
+  }
+  size_t len = m_len;
+  int ret = append(name, strlen(name));
+  if(ret == OK) ret = append(": ", 2);
+  if(ret == OK) ret = append(value, strlen(value));
+  if(ret == OK) ret = append("\r\n", 2);
+  if(ret != OK)
+  {
+    m_len = len; //Leave the template as it was
+  }
+  return ret;
+}
+
+int HTTPRequestTemplate::addBasicAuth(const char* user, const char* password)
+{
+  char credentials[BASIC_AUTH_MAX_LEN];
+  int len = snprintf(credentials, sizeof(credentials), "%s:%s", user, password);
+  if( (len < 0) || (len >= (int)sizeof(credentials)) )
+  {
+    return NET_TOOSMALL;
+  }
+  char value[6 + ((BASIC_AUTH_MAX_LEN + 2) / 3) * 4 + 1] = "Basic ";
+  HTTPBase64::encode(credentials, len, value + 6, sizeof(value) - 6);
+  return addHeader("Authorization", value);
+}
+
+int HTTPRequestTemplate::addContentLength()
+{
+  if(m_contentLengthPos != 0)
+  {
+    return NET_INVALID;
+  }
+  int ret = addHeader("Content-Length", "0000000000");
+  if(ret != OK)
+  {
+    return ret;
+  }
+  m_contentLengthPos = m_len - 2 - CONTENT_LENGTH_DIGITS;
+  return setContentLength(0);
+}
+
+int HTTPRequestTemplate::freeze()
+{
+  if( (m_len == 0) || m_frozen )
+  {
+    return NET_INVALID;
+  }
+  int ret = append("\r\n", 2);
+  if(ret != OK)
+  {
+    return ret;
+  }
+  m_frozen = true;
+  DBG("Request template frozen (%d bytes)", (int)m_len);
+  return OK;
+}
+
+int HTTPRequestTemplate::setContentLength(size_t len)
+{
+  if(m_contentLengthPos == 0)
+  {
+    return NET_INVALID;
+  }
+  //Right-aligned in a fixed-width field, the leading spaces are optional whitespace before the value
+  char digits[CONTENT_LENGTH_DIGITS + 1];
+  snprintf(digits, sizeof(digits), "%*u", CONTENT_LENGTH_DIGITS, (unsigned int)len);
+  memcpy(m_buf + m_contentLengthPos, digits, CONTENT_LENGTH_DIGITS);
+  return OK;
+}
+
+bool HTTPRequestTemplate::isFrozen() const
+{
+  return m_frozen;
+}
+
+bool HTTPRequestTemplate::hasContentLength() const
+{
+  return m_contentLengthPos != 0;
+}
+
+const char* HTTPRequestTemplate::getMethod() const
+{
+  return m_method;
+}
+
+HTTPEndpoint& HTTPRequestTemplate::getEndpoint()
+{
+  return m_endpoint;
+}
+
+const HTTPEndpoint& HTTPRequestTemplate::getEndpoint() const
+{
+  return m_endpoint;
+}
+
+const char* HTTPRequestTemplate::getData() const
+{
+  return m_buf;
+}
+
+size_t HTTPRequestTemplate::getLength() const
+{
+  return m_len;
+}
+
+const char* HTTPRequestTemplate::getHeaders() const
+{
+  return m_buf + m_headersPos;
+}
+
+size_t HTTPRequestTemplate::getHeadersLength() const
+{
+  return m_len - m_headersPos;
+}
+
+int HTTPRequestTemplate::init(const char* method)
+{
+  m_contentLengthPos = 0;
+  size_t methodLen = strlen(method);
+  if( (methodLen == 0) || (methodLen >= sizeof(m_method)) || (strpbrk(method, " \r\n") != NULL) )
+  {
+    return NET_INVALID;
+  }
+  memcpy(m_method, method, methodLen + 1);
+
+  int len = snprintf(m_buf, sizeof(m_buf), "%s %s HTTP/1.1\r\nHost: %s\r\n", method, m_endpoint.getPath(), m_endpoint.getAuthority());
+  if( (len < 0) || (len >= (int)sizeof(m_buf)) )
+  {
+    return NET_TOOSMALL;
+  }
+  m_len = len;
+  m_headersPos = len;
+  return OK;
+}
+
+int HTTPRequestTemplate::append(const char* str, size_t len)
+{
+  if(m_len + len >= sizeof(m_buf))
+  {
+    WARN("Request template is full");
+    return NET_TOOSMALL;
+  }
+  memcpy(m_buf + m_len, str, len);
+  m_len += len;
+  m_buf[m_len] = '\0';
+  return OK;
+}
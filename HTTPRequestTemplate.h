@@ -0,0 +1,124 @@
+/* HTTPRequestTemplate.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPREQUESTTEMPLATE_H_
+#define HTTPREQUESTTEMPLATE_H_
+
+#include "HTTPEndpoint.h"
+
+#ifndef HTTP_REQUEST_TEMPLATE_MAX_LEN
+#define HTTP_REQUEST_TEMPLATE_MAX_LEN 384 //Request line and headers
+#endif
+#define HTTP_REQUEST_TEMPLATE_METHOD_MAX_LEN 8 //Including the NULL-terminating char
+
+/** Request serialized once and sent as-is by HTTPClient::execute()
+ * Polling and heartbeat requests are identical every time: the request line, the Host header and the fixed headers are formatted once into a frozen block of bytes, so that each request costs a single write.
+ * The only per-request part is the Content-Length value, which is patched in place.
+ * @code
+ * HTTPRequestTemplate beat;
+ * beat.setRequest("POST", "http://example.com/heartbeat");
+ * beat.addBasicAuth("device", "secret");
+ * beat.addHeader("Content-Type", "application/json");
+ * beat.addContentLength();
+ * beat.freeze();
+ * while(true)
+ * {
+ *   client.execute(beat, &status, NULL);
+ * }
+ * @endcode
+ */
+class HTTPRequestTemplate
+{
+public:
+  ///Instantiate an empty template, to be set with setRequest()
+  HTTPRequestTemplate();
+
+  /** Start the request, discarding any previous content
+   * @param method Request method (e.g. "GET", "POST" or "PUT")
+   * @param url URL (http[s]://host[:port][/[path]])
+   * @return 0 on success, NET error on failure
+   */
+  int setRequest(const char* method, const char* url);
+
+  /** Start the request, discarding any previous content
+   * @param method Request method (e.g. "GET", "POST" or "PUT")
+   * @param endpoint Endpoint to send the request to, copied along with its resolved address
+   * @return 0 on success, NET error on failure
+   */
+  int setRequest(const char* method, const HTTPEndpoint& endpoint);
+
+  /** Append a fixed header
+   * @param name Header name
+   * @param value Header value
+   * @return 0 on success, NET error on failure
+   */
+  int addHeader(const char* name, const char* value);
+
+  /** Append an Authorization header with basic credentials
+   * @param user User name
+   * @param password Password
+   * @return 0 on success, NET error on failure
+   */
+  int addBasicAuth(const char* user, const char* password);
+
+  /** Append a Content-Length header whose value is set for each request with the length of the data
+   * Requests with data of known length need it; for chunked data, add a "Transfer-Encoding: chunked" header instead.
+   * @return 0 on success, NET error on failure
+   */
+  int addContentLength();
+
+  /** Terminate the headers, after which the template can be executed but not modified
+   * @return 0 on success, NET error on failure
+   */
+  int freeze();
+
+  /** Patch the value of the Content-Length header
+   * @param len Length of the data
+   * @return 0 on success, NET error if the template has no Content-Length header
+   */
+  int setContentLength(size_t len);
+
+  bool isFrozen() const;
+  bool hasContentLength() const;
+  const char* getMethod() const;
+  HTTPEndpoint& getEndpoint(); ///<Keeps the resolved address between requests
+  const HTTPEndpoint& getEndpoint() const;
+  const char* getData() const; ///<Frozen request line and headers
+  size_t getLength() const;
+  const char* getHeaders() const; ///<Headers following the Host header, for redirections
+  size_t getHeadersLength() const;
+
+private:
+  int init(const char* method);
+  int append(const char* str, size_t len);
+
+  char m_buf[HTTP_REQUEST_TEMPLATE_MAX_LEN];
+  size_t m_len;
+  size_t m_headersPos;
+  size_t m_contentLengthPos; //0 if there is no Content-Length header
+  char m_method[HTTP_REQUEST_TEMPLATE_METHOD_MAX_LEN];
+  bool m_frozen;
+  HTTPEndpoint m_endpoint;
+};
+
+#endif /* HTTPREQUESTTEMPLATE_H_ */
@@ -0,0 +1,409 @@
+/* HTTPSharedClient.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPSharedClient.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPSharedClient.h"
+#include "util/HTTPTime.h"
+
+#define FREE_LIST_END 0xFFFF
+#define FREE_LIST_INDEX_MASK 0xFFFFu
+#define FREE_LIST_TAG_INC 0x10000u
+
+HTTPSharedClient::HTTPSharedClient() : m_head(FREE_LIST_END), m_warmLock(0), m_refresh(HTTP_SHARED_CLIENT_DEFAULT_REFRESH)
+{
+  for(int i = HTTP_SHARED_CLIENT_MAX_CONNECTIONS - 1; i >= 0; i--)
+  {
+    m_clients[i].setKeepAlive(true);
+    push(i);
+  }
+  for(int i = 0; i < HTTP_SHARED_CLIENT_MAX_WARM_HOSTS; i++)
+  {
+    m_warmCounts[i] = 0;
+  }
+}
+
+HTTPSharedClient::~HTTPSharedClient()
+{
+
+}
+
+void HTTPSharedClient::setMaxRedirects(int maxRedirects)
+{
+  for(int i = 0; i < HTTP_SHARED_CLIENT_MAX_CONNECTIONS; i++)
+  {
+    m_clients[i].setMaxRedirects(maxRedirects);
+  }
+}
+
+void HTTPSharedClient::setExpectContinue(bool enable, size_t minDataLen /*= 0*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_CONTINUE_TIMEOUT*/)
+{
+  for(int i = 0; i < HTTP_SHARED_CLIENT_MAX_CONNECTIONS; i++)
+  {
+    m_clients[i].setExpectContinue(enable, minDataLen, timeout);
+  }
+}
+
+void HTTPSharedClient::setRetry(int maxRetries, uint32_t baseDelay /*= HTTP_CLIENT_DEFAULT_RETRY_DELAY*/, uint32_t maxDelay /*= HTTP_CLIENT_DEFAULT_RETRY_MAX_DELAY*/, bool retryPost /*= false*/)
+{
+  for(int i = 0; i < HTTP_SHARED_CLIENT_MAX_CONNECTIONS; i++)
+  {
+    m_clients[i].setRetry(maxRetries, baseDelay, maxDelay, retryPost);
+  }
+}
+
+void HTTPSharedClient::setRefresh(uint32_t refresh)
+{
+  m_refresh = refresh;
+}
+
+int HTTPSharedClient::preconnect(const char* url, int count /*= 1*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  HTTPEndpoint endpoint;
+  if( endpoint.setUrl(url) != OK )
+  {
+    return NET_INVALID;
+  }
+
+  //Register the host, or update its count
+  lock();
+  int host = -1;
+  for(int i = 0; i < HTTP_SHARED_CLIENT_MAX_WARM_HOSTS; i++)
+  {
+    if( (m_warmCounts[i] > 0) && m_warmHosts[i].isSameOrigin(endpoint) )
+    {
+      host = i;
+      break;
+    }
+  }
+  for(int i = 0; (i < HTTP_SHARED_CLIENT_MAX_WARM_HOSTS) && (host < 0) && (count > 0); i++)
+  {
+    if(m_warmCounts[i] == 0)
+    {
+      host = i;
+      m_warmHosts[i] = endpoint;
+    }
+  }
+  if(host >= 0)
+  {
+    m_warmCounts[host] = count;
+  }
+  unlock();
+
+  if(count == 0)
+  {
+    return OK; //The connections are left open until used or closed by the server
+  }
+  if(host < 0)
+  {
+    WARN("Cannot keep connections to %s warm, too many hosts", endpoint.getHost());
+    return NET_FULL;
+  }
+  return warm(host, timeout);
+}
+
+int HTTPSharedClient::poll(uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  int ret = OK;
+  for(int i = 0; i < HTTP_SHARED_CLIENT_MAX_WARM_HOSTS; i++)
+  {
+    int hostRet = warm(i, timeout);
+    if(hostRet != OK)
+    {
+      ret = hostRet;
+    }
+  }
+  return ret;
+}
+
+int HTTPSharedClient::get(const char* url, IHTTPDataIn* pDataIn, int* pResponseCode /*= NULL*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  HTTPClient* pClient = checkout(timeout);
+  if(pClient == NULL)
+  {
+    return NET_FULL;
+  }
+  int ret = pClient->get(url, pDataIn, timeout);
+  release(pClient, pResponseCode);
+  return ret;
+}
+
+int HTTPSharedClient::get(HTTPEndpoint& endpoint, IHTTPDataIn* pDataIn, int* pResponseCode /*= NULL*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  HTTPClient* pClient = checkout(timeout);
+  if(pClient == NULL)
+  {
+    return NET_FULL;
+  }
+  int ret = pClient->get(endpoint, pDataIn, timeout);
+  release(pClient, pResponseCode);
+  return ret;
+}
+
+int HTTPSharedClient::post(const char* url, const IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, int* pResponseCode /*= NULL*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  HTTPClient* pClient = checkout(timeout);
+  if(pClient == NULL)
+  {
+    return NET_FULL;
+  }
+  int ret = pClient->post(url, dataOut, pDataIn, timeout);
+  release(pClient, pResponseCode);
+  return ret;
+}
+
+int HTTPSharedClient::post(HTTPEndpoint& endpoint, const IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, int* pResponseCode /*= NULL*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  HTTPClient* pClient = checkout(timeout);
+  if(pClient == NULL)
+  {
+    return NET_FULL;
+  }
+  int ret = pClient->post(endpoint, dataOut, pDataIn, timeout);
+  release(pClient, pResponseCode);
+  return ret;
+}
+
+int HTTPSharedClient::execute(HTTPRequestTemplate& request, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, int* pResponseCode /*= NULL*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  HTTPClient* pClient = checkout(timeout);
+  if(pClient == NULL)
+  {
+    return NET_FULL;
+  }
+  int ret = pClient->execute(request, pDataOut, pDataIn, timeout);
+  release(pClient, pResponseCode);
+  return ret;
+}
+
+void HTTPSharedClient::closeIdleConnections()
+{
+  //Take all the free connections, so that none is checked out while being closed
+  int indexes[HTTP_SHARED_CLIENT_MAX_CONNECTIONS];
+  int count = 0;
+  for(int index = pop(); index >= 0; index = pop())
+  {
+    m_clients[index].closeConnection();
+    indexes[count++] = index;
+  }
+  while(count > 0)
+  {
+    push(indexes[--count]);
+  }
+}
+
+HTTPClient* HTTPSharedClient::checkout(uint32_t timeout) //Wait for a free connection, NULL on timeout
+{
+  uint32_t start = HTTPTime::getMs();
+  int index = pop();
+  while(index < 0)
+  {
+    if(HTTPTime::elapsed(start) >= timeout)
+    {
+      WARN("No free connection");
+      return NULL;
+    }
+    HTTPTime::sleep(1);
+    index = pop();
+  }
+  return &m_clients[index];
+}
+
+void HTTPSharedClient::release(HTTPClient* pClient, int* pResponseCode)
+{
+  if(pResponseCode != NULL)
+  {
+    *pResponseCode = pClient->getHTTPResponseCode();
+  }
+  push(pClient - m_clients);
+}
+
+int HTTPSharedClient::pop() //Index of a free connection, -1 if none
+{
+  uint32_t head;
+  uint32_t newHead;
+  do
+  {
+    head = m_head;
+    uint32_t index = head & FREE_LIST_INDEX_MASK;
+    if(index == FREE_LIST_END)
+    {
+      return -1;
+    }
+    //m_next[index] may be outdated if another thread popped it meanwhile, in which case the tag changed and the swap fails
+    newHead = ((head + FREE_LIST_TAG_INC) & ~FREE_LIST_INDEX_MASK) | m_next[index];
+  } while( !__sync_bool_compare_and_swap(&m_head, head, newHead) );
+  return head & FREE_LIST_INDEX_MASK;
+}
+
+void HTTPSharedClient::push(int index)
+{
+  uint32_t head;
+  uint32_t newHead;
+  do
+  {
+    head = m_head;
+    m_next[index] = head & FREE_LIST_INDEX_MASK;
+    newHead = ((head + FREE_LIST_TAG_INC) & ~FREE_LIST_INDEX_MASK) | (uint32_t)index;
+  } while( !__sync_bool_compare_and_swap(&m_head, head, newHead) );
+}
+
+int HTTPSharedClient::warm(int host, uint32_t timeout) //Open the connections missing to a warm host
+{
+  lock();
+  int count = m_warmCounts[host];
+  HTTPEndpoint endpoint = m_warmHosts[host];
+  unlock();
+  if(count == 0)
+  {
+    return OK;
+  }
+
+  //Sort the free connections, most recently used first; each is held for a readability check, and the scan stops as soon as
+  //the connections to the host are enough, so in the steady state only those are taken
+  int stale[HTTP_SHARED_CLIENT_MAX_CONNECTIONS]; //Open to the host, but idle for too long
+  int closed[HTTP_SHARED_CLIENT_MAX_CONNECTIONS]; //Then open to hosts that are not kept warm
+  int others[HTTP_SHARED_CLIENT_MAX_CONNECTIONS]; //Warm, or open to other warm hosts
+  int spare[HTTP_SHARED_CLIENT_MAX_CONNECTIONS];
+  int staleCount = 0;
+  int closedCount = 0;
+  int otherCount = 0;
+  int spareCount = 0;
+  int warmCount = 0;
+  for(int index = pop(); index >= 0; index = pop())
+  {
+    uint32_t idleTime;
+    const HTTPEndpoint* pOrigin = m_clients[index].getConnection(&idleTime);
+    if(pOrigin == NULL)
+    {
+      closed[closedCount++] = index;
+    }
+    else if( !endpoint.isSameOrigin(*pOrigin) )
+    {
+      if( isWarm(*pOrigin) )
+      {
+        others[otherCount++] = index;
+      }
+      else
+      {
+        spare[spareCount++] = index;
+      }
+    }
+    else if(idleTime >= m_refresh)
+    {
+      stale[staleCount++] = index;
+    }
+    else
+    {
+      others[otherCount++] = index;
+      warmCount++;
+    }
+    if(warmCount + staleCount >= count)
+    {
+      break;
+    }
+  }
+  for(int i = 0; i < spareCount; i++)
+  {
+    closed[closedCount++] = spare[i];
+  }
+
+  //Stale connections are opened again first; the connections that are not needed are returned at once
+  int openCount = MIN(MAX(count - warmCount, 0), staleCount + closedCount);
+  int openStale = MIN(openCount, staleCount);
+  int openClosed = openCount - openStale;
+  for(int i = openClosed; i < closedCount; i++)
+  {
+    push(closed[i]);
+  }
+  for(int i = openStale; i < staleCount; i++)
+  {
+    push(stale[i]);
+  }
+  for(int i = 0; i < otherCount; i++)
+  {
+    push(others[i]);
+  }
+
+  //Held while connecting, and returned last so that they are checked out first
+  int ret = OK;
+  for(int i = 0; i < openCount; i++)
+  {
+    int index = (i < openStale) ? stale[i] : closed[i - openStale];
+    m_clients[index].closeConnection();
+    int connRet = m_clients[index].preconnect(endpoint, timeout);
+    if(connRet != OK)
+    {
+      WARN("Could not open a connection to %s ahead of the requests (%d)", endpoint.getHost(), connRet);
+      ret = connRet;
+    }
+    push(index);
+  }
+  if(openCount > 0)
+  {
+    DBG("%d connections to %s opened, %d were warm", openCount, endpoint.getHost(), warmCount);
+  }
+
+  //Keep the resolved addresses, so that the host is only resolved once
+  lock();
+  if( (m_warmCounts[host] > 0) && m_warmHosts[host].isSameOrigin(endpoint) && !m_warmHosts[host].isResolved() && endpoint.isResolved() )
+  {
+    m_warmHosts[host] = endpoint;
+  }
+  unlock();
+
+  return ret;
+}
+
+bool HTTPSharedClient::isWarm(const HTTPEndpoint& origin) //Whether connections to origin are kept warm
+{
+  bool warm = false;
+  lock();
+  for(int i = 0; (i < HTTP_SHARED_CLIENT_MAX_WARM_HOSTS) && !warm; i++)
+  {
+    warm = (m_warmCounts[i] > 0) && m_warmHosts[i].isSameOrigin(origin);
+  }
+  unlock();
+  return warm;
+}
+
+void HTTPSharedClient::lock() //Warm hosts
+{
+  while( __sync_lock_test_and_set(&m_warmLock, 1) )
+  {
+    HTTPTime::sleep(1);
+  }
+}
+
+void HTTPSharedClient::unlock()
+{
+  __sync_lock_release(&m_warmLock);
+}
@@ -0,0 +1,214 @@
+/* HTTPSharedClient.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPSHAREDCLIENT_H_
+#define HTTPSHAREDCLIENT_H_
+
+#include "HTTPClient.h"
+
+#ifndef HTTP_SHARED_CLIENT_MAX_CONNECTIONS
+#define HTTP_SHARED_CLIENT_MAX_CONNECTIONS 4 //Requests running at the same time, each with its own connection
+#endif
+
+#ifndef HTTP_SHARED_CLIENT_MAX_WARM_HOSTS
+#define HTTP_SHARED_CLIENT_MAX_WARM_HOSTS 2 //Hosts to which connections are kept open ahead of the requests, see preconnect()
+#endif
+
+#define HTTP_SHARED_CLIENT_DEFAULT_REFRESH 4000 //Common servers close idle connections after 5 s or more
+
+/** HTTP client shared by several threads
+ * Each request checks out one of HTTP_SHARED_CLIENT_MAX_CONNECTIONS connections, and returns it once completed, still open when the server allows it.
+ * The free connections are kept in a lock-free list, so threads never wait on each other unless all connections are in use.
+ * The most recently returned connection is checked out first, which keeps the connections to a single server warm.
+ * Connections can also be opened ahead of the requests with preconnect(), and kept open by calling poll() from a background thread:
+ * @code
+ * client.preconnect("http://example.com/", 2); //Resolves the host and opens 2 connections
+ *
+ * void housekeeping(void const* arg)
+ * {
+ *   while(true)
+ *   {
+ *     client.poll(); //Opens again the connections that were idle for too long
+ *     Thread::wait(500);
+ *   }
+ * }
+ * @endcode
+ * Threads waiting for a connection poll the list every ms and are not served in order, so size the pool for the number of concurrent requests.
+ * @code
+ * HTTPSharedClient client; //Shared by all worker threads
+ *
+ * void worker(void const* arg)
+ * {
+ *   char buf[128];
+ *   HTTPText text(buf, sizeof(buf));
+ *   int code;
+ *   int ret = client.get("http://example.com/status", &text, &code);
+ * }
+ * @endcode
+ * Data containers, endpoints and request templates are modified by the requests and must not be used by two threads at the same time.
+ * https is not supported, as each connection would need its own TLS transport.
+ * The free list relies on the GCC __sync atomic builtins (ARMv7-M and above on the mbed target).
+ */
+class HTTPSharedClient
+{
+public:
+  ///Instantiate the client, using the platform's default transport (mbed sockets, or native sockets on Linux)
+  HTTPSharedClient();
+  ~HTTPSharedClient();
+
+  /** Set the maximum number of redirections followed by a request, see HTTPClient::setMaxRedirects()
+   * Must be called before the client is shared
+   * @param maxRedirects : maximum number of hops, 0 to return redirections as errors
+   */
+  void setMaxRedirects(int maxRedirects);
+
+  /** Hold back the data of POST requests until the server accepts them, see HTTPClient::setExpectContinue()
+   * Must be called before the client is shared
+   * @param enable : true to send Expect: 100-continue (disabled by default)
+   * @param minDataLen : only for data at least that long
+   * @param timeout : time to wait for the answer of the server in ms
+   */
+  void setExpectContinue(bool enable, size_t minDataLen = 0, uint32_t timeout = HTTP_CLIENT_DEFAULT_CONTINUE_TIMEOUT);
+
+  /** Retry requests that failed on a transient error, see HTTPClient::setRetry()
+   * Must be called before the client is shared
+   * @param maxRetries : maximum number of retries, 0 to disable (default)
+   * @param baseDelay : bound of the delay before the first retry in ms
+   * @param maxDelay : maximum delay before a retry in ms
+   * @param retryPost : true to also retry POST requests that may have been processed by the server
+   */
+  void setRetry(int maxRetries, uint32_t baseDelay = HTTP_CLIENT_DEFAULT_RETRY_DELAY, uint32_t maxDelay = HTTP_CLIENT_DEFAULT_RETRY_MAX_DELAY, bool retryPost = false);
+
+  /** Set the idle time after which poll() opens again the connections kept warm, see preconnect()
+   * Must be called before the client is shared
+   * @param refresh : time in ms, shorter than the idle timeout of the servers by more than the interval between two calls to poll()
+   */
+  void setRefresh(uint32_t refresh);
+
+  /** Resolve the host of a url and open connections to it ahead of the requests, then keep them warm with poll()
+   * Blocks while connecting, so it can be called from a background thread.
+   * The free connections are taken one at a time to be sorted, with a readability check each, until enough are open to that host (all of them otherwise),
+   * and the ones being opened are held until connected: requests wait meanwhile if no other connection is free.
+   * Free connections that are not open, open to that host but idle for too long, or open to hosts that are not kept warm, are opened; connections kept warm for other hosts are left alone.
+   * The connections opened last are checked out first: with several hosts, a request may take a connection opened to another one.
+   * @param url : url of the host, only its scheme, host and port matter
+   * @param count : number of connections to keep open, 0 to stop keeping connections to that host open
+   * @param timeout : connection timeout in ms
+   * @return 0 on success, NET_INVALID if the url is invalid, NET_FULL if HTTP_SHARED_CLIENT_MAX_WARM_HOSTS hosts are already kept warm, NET error if a connection could not be opened (poll() tries again)
+   */
+  int preconnect(const char* url, int count = 1, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Keep the connections opened by preconnect() warm
+   * Opens again the connections that were idle for longer than the refresh time (see setRefresh()) or that the server closed,
+   * and opens new ones when fewer than requested are left, for instance after a request to another host took one.
+   * Call it periodically from a background thread; requests may wait for a free connection meanwhile, as with preconnect().
+   * @param timeout : connection timeout in ms
+   * @return 0 on success, NET error if a connection could not be opened
+   */
+  int poll(uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Execute a GET request on the url
+   * Blocks until completion
+   * @param url : url on which to execute the request
+   * @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param pResponseCode : pointer to an int that will receive the HTTP response code, can be NULL
+   * @param timeout : waiting timeout in ms, also applied to waiting for a free connection
+   * @return 0 on success, NET_FULL if no connection was free in time, NET error on failure
+   */
+  int get(const char* url, IHTTPDataIn* pDataIn, int* pResponseCode = NULL, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Execute a GET request on an endpoint
+   * Blocks until completion
+   * @param endpoint : endpoint on which to execute the request
+   * @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param pResponseCode : pointer to an int that will receive the HTTP response code, can be NULL
+   * @param timeout : waiting timeout in ms, also applied to waiting for a free connection
+   * @return 0 on success, NET_FULL if no connection was free in time, NET error on failure
+   */
+  int get(HTTPEndpoint& endpoint, IHTTPDataIn* pDataIn, int* pResponseCode = NULL, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Execute a POST request on the url
+   * Blocks until completion
+   * @param url : url on which to execute the request
+   * @param dataOut : a IHTTPDataOut instance that contains the data that will be posted
+   * @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param pResponseCode : pointer to an int that will receive the HTTP response code, can be NULL
+   * @param timeout : waiting timeout in ms, also applied to waiting for a free connection
+   * @return 0 on success, NET_FULL if no connection was free in time, NET error on failure
+   */
+  int post(const char* url, const IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, int* pResponseCode = NULL, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Execute a POST request on an endpoint
+   * Blocks until completion
+   * @param endpoint : endpoint on which to execute the request
+   * @param dataOut : a IHTTPDataOut instance that contains the data that will be posted
+   * @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param pResponseCode : pointer to an int that will receive the HTTP response code, can be NULL
+   * @param timeout : waiting timeout in ms, also applied to waiting for a free connection
+   * @return 0 on success, NET_FULL if no connection was free in time, NET error on failure
+   */
+  int post(HTTPEndpoint& endpoint, const IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, int* pResponseCode = NULL, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Execute a frozen request template, see HTTPClient::execute()
+   * Blocks until completion
+   * @param request : frozen template to send
+   * @param pDataOut : pointer to an IHTTPDataOut instance that contains the data to send, can be NULL
+   * @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param pResponseCode : pointer to an int that will receive the HTTP response code, can be NULL
+   * @param timeout : waiting timeout in ms, also applied to waiting for a free connection
+   * @return 0 on success, NET_FULL if no connection was free in time, NET error on failure
+   */
+  int execute(HTTPRequestTemplate& request, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, int* pResponseCode = NULL, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Close the connections that are not in use
+   */
+  void closeIdleConnections();
+
+private:
+  HTTPSharedClient(const HTTPSharedClient&); //Not copyable, the connections are shared
+  HTTPSharedClient& operator=(const HTTPSharedClient&);
+
+  HTTPClient* checkout(uint32_t timeout); //Wait for a free connection, NULL on timeout
+  void release(HTTPClient* pClient, int* pResponseCode);
+  int pop(); //Index of a free connection, -1 if none
+  void push(int index);
+  int warm(int host, uint32_t timeout); //Open the connections missing to a warm host
+  bool isWarm(const HTTPEndpoint& origin); //Whether connections to origin are kept warm
+  void lock(); //Warm hosts
+  void unlock();
+
+  HTTPClient m_clients[HTTP_SHARED_CLIENT_MAX_CONNECTIONS];
+
+  //Free list: index of the first free connection in the low 16 bits, and a tag in the high 16 bits that changes on each update,
+  //so that a thread holding an outdated head cannot swap it in after other threads popped and pushed the same connection (ABA)
+  volatile uint32_t m_head;
+  volatile uint16_t m_next[HTTP_SHARED_CLIENT_MAX_CONNECTIONS];
+
+  //Hosts kept warm, resolved by their first connection; a count of 0 marks a free slot
+  HTTPEndpoint m_warmHosts[HTTP_SHARED_CLIENT_MAX_WARM_HOSTS];
+  int m_warmCounts[HTTP_SHARED_CLIENT_MAX_WARM_HOSTS];
+  volatile uint32_t m_warmLock;
+  uint32_t m_refresh;
+};
+
+#endif /* HTTPSHAREDCLIENT_H_ */
@@ -0,0 +1,548 @@
+/* HTTPSpool.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifdef __linux__ //Linux host build only
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPSpool.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPSpool.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#define SPOOL_MAGIC 0x4C4F4F53u //"SOOL" in the file header
+#define SPOOL_VERSION 1
+#define SPOOL_HEADER_LEN 4096 //One page, the ring starts aligned
+#define SPOOL_RECORD_MAGIC 0x44525053u //Record
+#define SPOOL_PADDING_MAGIC 0x44415053u //Unused end of the ring, records are never split
+#define SPOOL_ALIGN 8
+
+struct HTTPSpoolHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  uint64_t head; //Only this field changes, an aligned store is never torn
+};
+
+struct HTTPSpoolFrame
+{
+  uint32_t magic;
+  uint32_t len;
+  uint64_t pos; //Tells a record apart from what was left there before the ring wrapped
+  uint32_t crc; //Of len, pos and the record
+  uint32_t reserved;
+};
+
+#define SPOOL_FRAME_LEN sizeof(HTTPSpoolFrame)
+
+static uint32_t s_crcTable[256];
+static bool s_crcInit = false;
+
+static uint32_t crc32(uint32_t crc, const void* data, size_t len) //CRC-32 (IEEE 802.3)
+{
+  if(!s_crcInit)
+  {
+    for(uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t c = i;
+      for(int j = 0; j < 8; j++)
+      {
+        c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+      }
+      s_crcTable[i] = c;
+    }
+    s_crcInit = true;
+  }
+
+  const uint8_t* p = (const uint8_t*) data;
+  crc = ~crc;
+  while(len--)
+  {
+    crc = s_crcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static uint32_t getFrameCrc(const HTTPSpoolFrame* frame, const char* data)
+{
+  uint32_t crc = crc32(0, &frame->len, sizeof(frame->len));
+  crc = crc32(crc, &frame->pos, sizeof(frame->pos));
+  return crc32(crc, data, (frame->magic == SPOOL_RECORD_MAGIC) ? frame->len : 0);
+}
+
+static size_t align(size_t len)
+{
+  return (len + SPOOL_ALIGN - 1) & ~(size_t)(SPOOL_ALIGN - 1);
+}
+
+HTTPSpool::HTTPSpool() : m_fd(-1), m_map(NULL), m_mapLen(0), m_ring(NULL), m_capacity(0), m_head(0), m_tail(0), m_count(0), m_durable(false), m_dropped(0),
+    m_prefix(""), m_separator("\n"), m_suffix(""), m_type("text/plain"),
+    m_batchStart(0), m_batchEnd(0), m_batchCount(0), m_batchLen(0), m_readState(READ_DONE), m_readRecord(0), m_readIndex(0), m_readPos(0)
+{
+
+}
+
+HTTPSpool::~HTTPSpool()
+{
+  close();
+}
+
+int HTTPSpool::open(const char* path, size_t capacity)
+{
+  close();
+
+  m_fd = ::open(path, O_RDWR | O_CREAT, 0644);
+  if(m_fd < 0)
+  {
+    WARN("Could not open %s", path);
+    return NET_NOTFOUND;
+  }
+
+  struct stat st;
+  if( fstat(m_fd, &st) != 0 )
+  {
+    close();
+    return NET_NOTFOUND;
+  }
+
+  bool created = (st.st_size == 0);
+  if(created)
+  {
+    capacity = align(capacity);
+    if( (capacity < 2 * SPOOL_FRAME_LEN) || ( ftruncate(m_fd, SPOOL_HEADER_LEN + capacity) != 0 ) )
+    {
+      WARN("Could not create a spool of %d bytes", (int)capacity);
+      close();
+      return NET_INVALID;
+    }
+    m_mapLen = SPOOL_HEADER_LEN + capacity;
+  }
+  else
+  {
+    if( (size_t)st.st_size < SPOOL_HEADER_LEN + 2 * SPOOL_FRAME_LEN )
+    {
+      WARN("%s is not a spool", path);
+      close();
+      return NET_INVALID;
+    }
+    m_mapLen = st.st_size;
+  }
+
+  void* map = mmap(NULL, m_mapLen, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if(map == MAP_FAILED)
+  {
+    WARN("Could not map %s", path);
+    m_mapLen = 0;
+    close();
+    return NET_OOM;
+  }
+  m_map = (char*) map;
+  m_ring = m_map + SPOOL_HEADER_LEN;
+
+  HTTPSpoolHeader* header = (HTTPSpoolHeader*) m_map;
+  if(created)
+  {
+    header->version = SPOOL_VERSION;
+    header->capacity = capacity;
+    header->head = 0;
+    header->magic = SPOOL_MAGIC; //Written last
+    sync(0, SPOOL_HEADER_LEN);
+  }
+  else if( (header->magic != SPOOL_MAGIC) || (header->version != SPOOL_VERSION) || (SPOOL_HEADER_LEN + header->capacity != m_mapLen) || (header->capacity % SPOOL_ALIGN) )
+  {
+    WARN("%s is not a spool", path);
+    close();
+    return NET_INVALID;
+  }
+  m_capacity = header->capacity;
+  m_head = header->head;
+
+  //Find the records that were not sent yet, up to the first one that is missing or torn
+  uint64_t pos = m_head;
+  uint64_t next;
+  m_count = 0;
+  while( (pos - m_head < m_capacity) && check(pos, &next) )
+  {
+    if( skip(pos) == pos )
+    {
+      m_count++;
+    }
+    pos = next;
+  }
+  m_tail = pos;
+  DBG("Spool %s: %d records (%d bytes) to send", path, m_count, (size_t)(m_tail - m_head));
+
+  return OK;
+}
+
+void HTTPSpool::close()
+{
+  if(m_map != NULL)
+  {
+    munmap(m_map, m_mapLen);
+    m_map = NULL;
+    m_ring = NULL;
+    m_mapLen = 0;
+  }
+  if(m_fd >= 0)
+  {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+  m_capacity = 0;
+  m_head = 0;
+  m_tail = 0;
+  m_count = 0;
+}
+
+void HTTPSpool::setDurable(bool durable)
+{
+  m_durable = durable;
+}
+
+void HTTPSpool::setFraming(const char* prefix, const char* separator, const char* suffix)
+{
+  m_prefix = prefix;
+  m_separator = separator;
+  m_suffix = suffix;
+}
+
+void HTTPSpool::setContentType(const char* type)
+{
+  m_type = type;
+}
+
+int HTTPSpool::append(const char* data, size_t len)
+{
+  if(m_map == NULL)
+  {
+    return NET_CLOSED;
+  }
+
+  size_t frameLen = align(SPOOL_FRAME_LEN + len);
+  if( (frameLen > m_capacity) || (len > 0xFFFFFFFFu) )
+  {
+    return NET_INVALID;
+  }
+
+  uint64_t pos = m_tail;
+  size_t offset = pos % m_capacity;
+  size_t rest = m_capacity - offset;
+  if( (rest < frameLen) && (m_count == 0) )
+  {
+    //Nothing to keep, start again at the beginning of the ring
+    setHead(pos + rest);
+    m_tail = m_head;
+    pos = m_tail;
+    offset = 0;
+    rest = m_capacity;
+  }
+  size_t used = frameLen;
+  if(rest < frameLen)
+  {
+    used += rest; //Start again at the beginning of the ring
+  }
+  if( (m_tail - m_head) + used > m_capacity )
+  {
+    return NET_FULL;
+  }
+
+  if(rest < frameLen)
+  {
+    if(rest >= SPOOL_FRAME_LEN) //Otherwise the gap is implied
+    {
+      HTTPSpoolFrame* padding = (HTTPSpoolFrame*) (m_ring + offset);
+      padding->len = rest - SPOOL_FRAME_LEN;
+      padding->pos = pos;
+      padding->reserved = 0;
+      padding->magic = SPOOL_PADDING_MAGIC;
+      padding->crc = getFrameCrc(padding, NULL);
+      sync(SPOOL_HEADER_LEN + offset, SPOOL_FRAME_LEN);
+    }
+    pos += rest;
+    offset = 0;
+  }
+
+  //A record torn by a crash does not match its CRC
+  HTTPSpoolFrame* frame = (HTTPSpoolFrame*) (m_ring + offset);
+  memcpy(m_ring + offset + SPOOL_FRAME_LEN, data, len);
+  frame->len = len;
+  frame->pos = pos;
+  frame->reserved = 0;
+  frame->magic = SPOOL_RECORD_MAGIC;
+  frame->crc = getFrameCrc(frame, m_ring + offset + SPOOL_FRAME_LEN);
+  sync(SPOOL_HEADER_LEN + offset, frameLen);
+
+  m_tail = pos + frameLen;
+  m_count++;
+  return OK;
+}
+
+int HTTPSpool::drain(HTTPClient& client, HTTPEndpoint& endpoint, size_t maxBatchLen /*= 0*/, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  if(m_map == NULL)
+  {
+    return NET_CLOSED;
+  }
+
+  size_t separatorLen = strlen(m_separator);
+  while(m_count > 0)
+  {
+    //Take as many consecutive records as fit in one request
+    m_batchStart = skip(m_head);
+    m_batchCount = 0;
+    m_batchLen = 0;
+    uint64_t pos = m_batchStart;
+    while( (m_batchCount < m_count) )
+    {
+      size_t len;
+      getRecord(pos, &len);
+      size_t batchLen = m_batchLen + ((m_batchCount > 0) ? separatorLen : 0) + len;
+      if( (m_batchCount > 0) && (batchLen > maxBatchLen) )
+      {
+        break;
+      }
+      m_batchLen = batchLen;
+      m_batchCount++;
+      pos += align(SPOOL_FRAME_LEN + len);
+      if(m_batchCount < m_count)
+      {
+        pos = skip(pos);
+      }
+    }
+    m_batchEnd = pos;
+
+    rewind();
+    DBG("Posting %d spooled records (%d bytes)", m_batchCount, m_batchLen);
+    int ret = client.post(endpoint, *this, NULL, timeout);
+    int code = client.getHTTPResponseCode();
+    if( (ret != OK) && ( (code < 400) || (code >= 500) || (code == 408) || (code == 429) ) )
+    {
+      WARN("Could not post %d spooled records (%d), keeping them", (int)m_batchCount, ret);
+      return ret;
+    }
+    if(ret != OK)
+    {
+      //Sending the same data again would not help
+      ERR("%d spooled records rejected with code %d, dropping them", (int)m_batchCount, code);
+      m_dropped += m_batchCount;
+    }
+
+    m_count -= m_batchCount;
+    setHead( (m_count > 0) ? m_batchEnd : m_tail );
+  }
+
+  return OK;
+}
+
+size_t HTTPSpool::getCount()
+{
+  return m_count;
+}
+
+size_t HTTPSpool::getLength()
+{
+  return m_tail - m_head;
+}
+
+uint32_t HTTPSpool::getDropped()
+{
+  return m_dropped;
+}
+
+/*virtual*/ int HTTPSpool::read(char* buf, size_t len, size_t* pReadLen)
+{
+  size_t readLen = 0;
+  while( (readLen < len) && (m_readState != READ_DONE) )
+  {
+    const char* part;
+    size_t partLen;
+    switch(m_readState)
+    {
+    case READ_PREFIX:
+      part = m_prefix;
+      partLen = strlen(m_prefix);
+      break;
+    case READ_RECORD:
+      part = getRecord(m_readRecord, &partLen); //Straight from the mapping
+      break;
+    case READ_SEPARATOR:
+      part = m_separator;
+      partLen = strlen(m_separator);
+      break;
+    case READ_SUFFIX:
+    default:
+      part = m_suffix;
+      partLen = strlen(m_suffix);
+      break;
+    }
+
+    size_t copyLen = MIN(partLen - m_readPos, len - readLen);
+    memcpy(buf + readLen, part + m_readPos, copyLen);
+    readLen += copyLen;
+    m_readPos += copyLen;
+    if(m_readPos < partLen)
+    {
+      continue;
+    }
+
+    //Next part
+    m_readPos = 0;
+    switch(m_readState)
+    {
+    case READ_PREFIX:
+    case READ_SEPARATOR:
+      m_readState = READ_RECORD;
+      break;
+    case READ_RECORD:
+      m_readIndex++;
+      if(m_readIndex < m_batchCount)
+      {
+        m_readRecord = skip(m_readRecord + align(SPOOL_FRAME_LEN + partLen));
+        m_readState = READ_SEPARATOR;
+      }
+      else
+      {
+        m_readState = READ_SUFFIX;
+      }
+      break;
+    case READ_SUFFIX:
+    default:
+      m_readState = READ_DONE;
+      break;
+    }
+  }
+  *pReadLen = readLen;
+  return OK;
+}
+
+/*virtual*/ int HTTPSpool::getDataType(char* type, size_t maxTypeLen) //Internet media type for Content-Type header
+{
+  strncpy(type, m_type, maxTypeLen-1);
+  type[maxTypeLen-1] = '\0';
+  return OK;
+}
+
+/*virtual*/ bool HTTPSpool::getIsChunked() //For Transfer-Encoding header
+{
+  return false; //The length of the records is known
+}
+
+/*virtual*/ size_t HTTPSpool::getDataLen() //For Content-Length header
+{
+  return strlen(m_prefix) + m_batchLen + strlen(m_suffix);
+}
+
+/*virtual*/ bool HTTPSpool::rewind()
+{
+  m_readState = READ_PREFIX;
+  m_readRecord = m_batchStart;
+  m_readIndex = 0;
+  m_readPos = 0;
+  return true;
+}
+
+bool HTTPSpool::check(uint64_t pos, uint64_t* pNext) //Whether a valid record or padding starts at pos, and the position after it
+{
+  size_t offset = pos % m_capacity;
+  size_t rest = m_capacity - offset;
+  if(rest < SPOOL_FRAME_LEN)
+  {
+    *pNext = pos + rest;
+    return true;
+  }
+
+  const HTTPSpoolFrame* frame = (const HTTPSpoolFrame*) (m_ring + offset);
+  if(frame->pos != pos)
+  {
+    return false; //Never written since the ring wrapped
+  }
+  if(frame->magic == SPOOL_PADDING_MAGIC)
+  {
+    if( (frame->len != rest - SPOOL_FRAME_LEN) || (frame->crc != getFrameCrc(frame, NULL)) )
+    {
+      return false;
+    }
+    *pNext = pos + rest;
+    return true;
+  }
+  if( (frame->magic != SPOOL_RECORD_MAGIC) || (align(SPOOL_FRAME_LEN + frame->len) > rest) || (frame->crc != getFrameCrc(frame, m_ring + offset + SPOOL_FRAME_LEN)) )
+  {
+    return false;
+  }
+  *pNext = pos + align(SPOOL_FRAME_LEN + frame->len);
+  return true;
+}
+
+uint64_t HTTPSpool::skip(uint64_t pos) //Position of the next record, skipping padding
+{
+  size_t offset = pos % m_capacity;
+  size_t rest = m_capacity - offset;
+  if( (rest < SPOOL_FRAME_LEN) || ( ((const HTTPSpoolFrame*) (m_ring + offset))->magic == SPOOL_PADDING_MAGIC ) )
+  {
+    return pos + rest;
+  }
+  return pos;
+}
+
+const char* HTTPSpool::getRecord(uint64_t pos, size_t* pLen)
+{
+  const HTTPSpoolFrame* frame = (const HTTPSpoolFrame*) (m_ring + pos % m_capacity);
+  *pLen = frame->len;
+  return (const char*) (frame + 1);
+}
+
+void HTTPSpool::setHead(uint64_t head)
+{
+  m_head = head;
+  ((HTTPSpoolHeader*) m_map)->head = head;
+  sync(0, SPOOL_HEADER_LEN);
+}
+
+void HTTPSpool::sync(size_t offset, size_t len)
+{
+  if(!m_durable)
+  {
+    return; //Written back by the kernel
+  }
+
+  //msync() needs an address aligned on a page
+  size_t pageLen = sysconf(_SC_PAGESIZE);
+  size_t start = offset - offset % pageLen;
+  msync(m_map + start, offset + len - start, MS_SYNC);
+}
+
+#endif
@@ -0,0 +1,173 @@
+/* HTTPSpool.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPSPOOL_H_
+#define HTTPSPOOL_H_
+
+#include "HTTPClient.h"
+
+/** Persistent outbound spool, for uploads made while the network is down (Linux host build only)
+ * Records are appended to a ring in a memory-mapped file, each framed with its position and a CRC-32.
+ * When the spool is opened again, e.g. after a reboot, the records that were not sent yet are found by checking the frames from the oldest one,
+ * so that a record torn by a crash, and what follows it, are discarded.
+ * drain() posts the records in order, streaming them from the mapping: a record is never copied, whatever the size of the spool.
+ * @code
+ * HTTPSpool spool;
+ * spool.open("/var/spool/telemetry", 1024 * 1024);
+ *
+ * if( client.post(endpoint, data, NULL) == NET_CONN )
+ * {
+ *   spool.append(reading, len); //Sent later
+ * }
+ *
+ * //Once connectivity returns
+ * client.setKeepAlive(true);
+ * spool.drain(client, endpoint, 64 * 1024); //Up to 64 kB of records per request
+ * @endcode
+ * A record is only removed once the server accepted it, so a crash during drain() may post it again (at-least-once delivery).
+ * A spool must only be used by one thread.
+ */
+class HTTPSpool : public IHTTPDataOut
+{
+public:
+  HTTPSpool();
+  ~HTTPSpool();
+
+  /** Open a spool, creating its file if needed
+   * @param path Path of the file
+   * @param capacity Size of the ring when the file is created (an existing file keeps its own)
+   * @return 0 on success, NET_NOTFOUND if the file cannot be opened, NET_INVALID if it is not a spool, NET_OOM if it cannot be mapped
+   */
+  int open(const char* path, size_t capacity);
+
+  /** Close the spool, the records are kept in the file
+   */
+  void close();
+
+  /** Write each change to the storage before returning, so that records survive a power loss (disabled by default)
+   * Otherwise the records survive a crash of the process, and are written back by the kernel in the background
+   * @param durable true to sync the file on each append and each drained batch
+   */
+  void setDurable(bool durable);
+
+  /** Set how records are put together when several are posted in one request
+   * @param prefix Sent before the first record, must remain valid as long as the spool is in use
+   * @param separator Sent between two records ("\n" by default), must remain valid as long as the spool is in use
+   * @param suffix Sent after the last record, must remain valid as long as the spool is in use
+   */
+  void setFraming(const char* prefix, const char* separator, const char* suffix);
+
+  /** Set the Content-Type of the requests ("text/plain" by default)
+   * @param type Internet media type, must remain valid as long as the spool is in use
+   */
+  void setContentType(const char* type);
+
+  /** Append a record
+   * @param data Record
+   * @param len Length of the record
+   * @return 0 on success, NET_FULL if the spool is full, NET_INVALID if the record can never fit, NET_CLOSED if the spool is not open
+   */
+  int append(const char* data, size_t len);
+
+  /** Post the records, oldest first, until the spool is empty
+   * Blocks until completion
+   * Records are removed as soon as the server accepted them (any 2xx code); records rejected with a 4xx code (other than 408 and 429) are removed as well, as sending them again would not help.
+   * @param client Client to post the records with, best with keep-alive enabled
+   * @param endpoint Endpoint to post the records to
+   * @param maxBatchLen Maximum length of the records posted in one request, 0 to post each record on its own (a record longer than that is posted on its own)
+   * @param timeout Timeout of each request in ms
+   * @return 0 once the spool is empty, NET error of the request that failed otherwise (the records that were not accepted are kept)
+   */
+  int drain(HTTPClient& client, HTTPEndpoint& endpoint, size_t maxBatchLen = 0, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Get the number of records in the spool
+   */
+  size_t getCount();
+
+  /** Get the space used in the ring, including the framing
+   */
+  size_t getLength();
+
+  /** Get the number of records rejected by the server
+   */
+  uint32_t getDropped();
+
+protected:
+  //IHTTPDataOut
+  virtual int read(char* buf, size_t len, size_t* pReadLen);
+
+  virtual int getDataType(char* type, size_t maxTypeLen); //Internet media type for Content-Type header
+
+  virtual bool getIsChunked(); //For Transfer-Encoding header
+
+  virtual size_t getDataLen(); //For Content-Length header
+
+  virtual bool rewind(); //The records are kept until they are accepted
+
+private:
+  HTTPSpool(const HTTPSpool&); //Not copyable, the mapping is owned
+  HTTPSpool& operator=(const HTTPSpool&);
+
+  enum READ_STATE
+  {
+    READ_PREFIX,
+    READ_RECORD,
+    READ_SEPARATOR,
+    READ_SUFFIX,
+    READ_DONE
+  };
+
+  bool check(uint64_t pos, uint64_t* pNext); //Whether a valid record or padding starts at pos, and the position after it
+  uint64_t skip(uint64_t pos); //Position of the next record, skipping padding
+  const char* getRecord(uint64_t pos, size_t* pLen);
+  void setHead(uint64_t head);
+  void sync(size_t offset, size_t len);
+
+  int m_fd;
+  char* m_map;
+  size_t m_mapLen;
+  char* m_ring;
+  size_t m_capacity;
+  uint64_t m_head; //Position of the oldest record, since the creation of the file
+  uint64_t m_tail; //Position of the next record
+  size_t m_count;
+  bool m_durable;
+  uint32_t m_dropped;
+
+  const char* m_prefix;
+  const char* m_separator;
+  const char* m_suffix;
+  const char* m_type;
+
+  //Records being posted
+  uint64_t m_batchStart;
+  uint64_t m_batchEnd;
+  size_t m_batchCount;
+  size_t m_batchLen;
+  READ_STATE m_readState;
+  uint64_t m_readRecord;
+  size_t m_readIndex;
+  size_t m_readPos;
+};
+
+#endif /* HTTPSPOOL_H_ */
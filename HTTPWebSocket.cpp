@@ -0,0 +1,518 @@
+/* HTTPWebSocket.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPWebSocket.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPWebSocket.h"
+#include "util/HTTPBase64.h"
+#include "util/HTTPTime.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/random.h>
+#include <errno.h>
+#endif
+
+#define HTTP_WS_FIN 0x80
+#define HTTP_WS_RSV 0x70 //No extension is negotiated, so these bits must be clear
+#define HTTP_WS_MASK 0x80
+
+HTTPWebSocket::HTTPWebSocket() : m_pTransport(NULL), m_pEntropySource(NULL), m_randomPos(HTTP_WEBSOCKET_RANDOM_POOL_LEN), m_random(0), m_txFragmented(false), m_rxPos(0), m_rxLen(0), m_frameRemaining(0), m_frameFinal(false),
+m_rxFragmented(false), m_rxOpcode(HTTP_WS_TEXT), m_closeSent(false), m_closeStatus(0)
+{
+
+}
+
+HTTPWebSocket::~HTTPWebSocket()
+{
+  drop();
+}
+
+bool HTTPWebSocket::isOpen()
+{
+  return m_pTransport != NULL;
+}
+
+void HTTPWebSocket::setEntropySource(IHTTPEntropySource* pSource)
+{
+  m_pEntropySource = pSource;
+  m_randomPos = HTTP_WEBSOCKET_RANDOM_POOL_LEN; //Bytes from the previous source are not used
+}
+
+char* HTTPWebSocket::getSendBuffer(size_t* pMaxLen)
+{
+  *pMaxLen = HTTP_WEBSOCKET_BUFFER_SIZE;
+  return m_txBuf + HTTP_WEBSOCKET_MAX_HEADER_LEN;
+}
+
+int HTTPWebSocket::sendBuffer(size_t len, HTTPWebSocketOpcode opcode /*= HTTP_WS_TEXT*/, bool final /*= true*/, uint32_t timeout /*= HTTP_WEBSOCKET_DEFAULT_TIMEOUT*/)
+{
+  if( !isOpen() )
+  {
+    return NET_INVALID;
+  }
+  bool continuation = (opcode == HTTP_WS_CONTINUATION);
+  if( (len > HTTP_WEBSOCKET_BUFFER_SIZE) || (continuation != m_txFragmented) || (!continuation && (opcode != HTTP_WS_TEXT) && (opcode != HTTP_WS_BINARY)) )
+  {
+    ERR("Invalid frame (opcode %d, length %d)", opcode, (int)len);
+    return NET_INVALID;
+  }
+  int ret = sendFrame(m_txBuf + HTTP_WEBSOCKET_MAX_HEADER_LEN, len, opcode, final, timeout);
+  if(ret == OK)
+  {
+    m_txFragmented = !final;
+  }
+  return ret;
+}
+
+int HTTPWebSocket::send(const char* data, size_t len, HTTPWebSocketOpcode opcode /*= HTTP_WS_TEXT*/, uint32_t timeout /*= HTTP_WEBSOCKET_DEFAULT_TIMEOUT*/)
+{
+  if(m_txFragmented)
+  {
+    return NET_INVALID; //Another message is being sent with sendBuffer()
+  }
+  size_t maxLen;
+  char* buf = getSendBuffer(&maxLen);
+  HTTPWebSocketOpcode frameOpcode = opcode;
+  do
+  {
+    size_t frameLen = MIN(len, maxLen);
+    memcpy(buf, data, frameLen);
+    data += frameLen;
+    len -= frameLen;
+    int ret = sendBuffer(frameLen, frameOpcode, len == 0, timeout);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    frameOpcode = HTTP_WS_CONTINUATION;
+  } while(len > 0);
+  return OK;
+}
+
+int HTTPWebSocket::ping(const char* data /*= NULL*/, size_t len /*= 0*/, uint32_t timeout /*= HTTP_WEBSOCKET_DEFAULT_TIMEOUT*/)
+{
+  if( !isOpen() || (len > HTTP_WEBSOCKET_MAX_CONTROL_LEN) )
+  {
+    return NET_INVALID;
+  }
+  return sendControl(HTTP_WS_PING, data, len, timeout);
+}
+
+int HTTPWebSocket::recv(const char** pData, size_t* pLen, HTTPWebSocketOpcode* pOpcode /*= NULL*/, bool* pFinal /*= NULL*/, uint32_t timeout /*= HTTP_WEBSOCKET_DEFAULT_TIMEOUT*/)
+{
+  int ret;
+  if( !isOpen() )
+  {
+    return (m_closeStatus != 0) ? NET_CLOSED : NET_INVALID;
+  }
+  while(true)
+  {
+    if(m_frameRemaining == 0)
+    {
+      //Nothing is consumed before the whole header (and the whole frame if it fits in the buffer) is there, so that a timeout leaves the state as it was
+      ret = fill(2, timeout);
+      if(ret != OK)
+      {
+        return ret;
+      }
+      const uint8_t* header = (const uint8_t*)(m_rxBuf + m_rxPos);
+      bool final = (header[0] & HTTP_WS_FIN) != 0;
+      int opcode = header[0] & 0x0F;
+      if( (header[0] & HTTP_WS_RSV) || (header[1] & HTTP_WS_MASK) ) //Frames from the server are not masked
+      {
+        ERR("Invalid frame header");
+        return fail(1002);
+      }
+      size_t headerLen = 2;
+      if( (header[1] & 0x7F) == 126 )
+      {
+        headerLen += 2;
+      }
+      else if( (header[1] & 0x7F) == 127 )
+      {
+        headerLen += 8;
+      }
+      ret = fill(headerLen, timeout);
+      if(ret != OK)
+      {
+        return ret;
+      }
+      header = (const uint8_t*)(m_rxBuf + m_rxPos); //The buffer may have been compacted
+      uint64_t len = header[1] & 0x7F;
+      if(headerLen > 2)
+      {
+        len = 0;
+        for(size_t i = 2; i < headerLen; i++)
+        {
+          len = (len << 8) | header[i];
+        }
+      }
+
+      if(opcode >= HTTP_WS_CLOSE) //Control frame, never fragmented, handled here
+      {
+        if( !final || (len > HTTP_WEBSOCKET_MAX_CONTROL_LEN) )
+        {
+          ERR("Invalid control frame");
+          return fail(1002);
+        }
+        ret = fill(headerLen + len, timeout);
+        if(ret != OK)
+        {
+          return ret;
+        }
+        const char* payload = m_rxBuf + m_rxPos + headerLen;
+        m_rxPos += headerLen + len;
+        if(opcode == HTTP_WS_PING)
+        {
+          DBG("Ping received");
+          ret = sendControl(HTTP_WS_PONG, payload, len, timeout);
+          if(ret != OK)
+          {
+            return ret;
+          }
+        }
+        else if(opcode == HTTP_WS_CLOSE)
+        {
+          m_closeStatus = (len >= 2) ? ((((uint8_t)payload[0]) << 8) | (uint8_t)payload[1]) : 1005;
+          DBG("Connection closed by server (%d)", m_closeStatus);
+          if(!m_closeSent)
+          {
+            sendControl(HTTP_WS_CLOSE, payload, MIN((size_t)len, (size_t)2), timeout); //Echo the status
+          }
+          drop();
+          return NET_CLOSED;
+        }
+        else if(opcode != HTTP_WS_PONG)
+        {
+          ERR("Unknown opcode %d", opcode);
+          return fail(1002);
+        }
+        continue;
+      }
+
+      bool continuation = (opcode == HTTP_WS_CONTINUATION);
+      if( (continuation != m_rxFragmented) || (!continuation && (opcode != HTTP_WS_TEXT) && (opcode != HTTP_WS_BINARY)) )
+      {
+        ERR("Unexpected frame (opcode %d)", opcode);
+        return fail(1002);
+      }
+      if(headerLen + len <= sizeof(m_rxBuf)) //Returned in one piece
+      {
+        ret = fill(headerLen + len, timeout);
+        if(ret != OK)
+        {
+          return ret;
+        }
+      }
+      m_rxPos += headerLen;
+      if(!continuation)
+      {
+        m_rxOpcode = (HTTPWebSocketOpcode) opcode;
+      }
+      m_rxFragmented = !final;
+      m_frameFinal = final;
+      m_frameRemaining = len;
+      if(len == 0)
+      {
+        *pData = m_rxBuf + m_rxPos;
+        *pLen = 0;
+        break;
+      }
+    }
+
+    if(m_rxPos == m_rxLen)
+    {
+      ret = fill(1, timeout);
+      if(ret != OK)
+      {
+        return ret;
+      }
+    }
+    size_t len = (size_t)MIN((uint64_t)(m_rxLen - m_rxPos), m_frameRemaining);
+    *pData = m_rxBuf + m_rxPos;
+    *pLen = len;
+    m_rxPos += len;
+    m_frameRemaining -= len;
+    break;
+  }
+  if(pOpcode != NULL)
+  {
+    *pOpcode = m_rxOpcode;
+  }
+  if(pFinal != NULL)
+  {
+    *pFinal = m_frameFinal && (m_frameRemaining == 0);
+  }
+  return OK;
+}
+
+int HTTPWebSocket::close(uint16_t status /*= 1000*/, uint32_t timeout /*= HTTP_WEBSOCKET_DEFAULT_TIMEOUT*/)
+{
+  if( !isOpen() )
+  {
+    return OK;
+  }
+  char payload[2] = { (char)(status >> 8), (char)status };
+  int ret = sendControl(HTTP_WS_CLOSE, payload, sizeof(payload), timeout);
+  if(ret != OK)
+  {
+    return ret;
+  }
+  m_closeSent = true;
+
+  //Wait for the server to answer, discarding the data still on the way
+  uint32_t start = HTTPTime::getMs();
+  while( isOpen() )
+  {
+    uint32_t elapsed = HTTPTime::elapsed(start);
+    if(elapsed >= timeout)
+    {
+      WARN("Server did not answer the closing handshake");
+      drop();
+      return NET_TIMEOUT;
+    }
+    const char* data;
+    size_t len;
+    ret = recv(&data, &len, NULL, NULL, timeout - elapsed);
+    if( (ret != OK) && (ret != NET_TIMEOUT) )
+    {
+      drop();
+      return (ret == NET_CLOSED) ? OK : ret;
+    }
+  }
+  return OK;
+}
+
+uint16_t HTTPWebSocket::getCloseStatus()
+{
+  return m_closeStatus;
+}
+
+void HTTPWebSocket::makeKey(char* key) //Random Sec-WebSocket-Key, NULL-terminated
+{
+  char nonce[16];
+  for(size_t i = 0; i < sizeof(nonce); i += 4)
+  {
+    uint32_t r = random();
+    memcpy(nonce + i, &r, 4);
+  }
+  HTTPBase64::encode(nonce, sizeof(nonce), key, HTTP_WEBSOCKET_KEY_LEN + 1);
+}
+
+int HTTPWebSocket::attach(IHTTPTransport* pTransport, const char* data, size_t len) //Take over the connection after the handshake, with the bytes received after it
+{
+  drop();
+  if(len > sizeof(m_rxBuf))
+  {
+    pTransport->close();
+    return NET_TOOSMALL;
+  }
+  memcpy(m_rxBuf, data, len);
+  m_rxLen = len;
+  m_pTransport = pTransport;
+  m_closeSent = false;
+  m_closeStatus = 0;
+  DBG("WebSocket open");
+  return OK;
+}
+
+int HTTPWebSocket::sendFrame(char* payload, size_t len, int opcode, bool final, uint32_t timeout) //Header written right before the payload
+{
+  uint8_t header[HTTP_WEBSOCKET_MAX_HEADER_LEN];
+  size_t headerLen = 2;
+  header[0] = (final ? HTTP_WS_FIN : 0) | opcode;
+  if(len < 126)
+  {
+    header[1] = HTTP_WS_MASK | len;
+  }
+  else if(len <= 0xFFFF)
+  {
+    header[1] = HTTP_WS_MASK | 126;
+    header[headerLen++] = (uint8_t)(len >> 8);
+    header[headerLen++] = (uint8_t)len;
+  }
+  else
+  {
+    header[1] = HTTP_WS_MASK | 127;
+    for(int i = 7; i >= 0; i--)
+    {
+      header[headerLen++] = (uint8_t)((uint64_t)len >> (8 * i));
+    }
+  }
+
+  //Frames from the client are masked with a new key each time
+  uint32_t r = random();
+  uint8_t* key = header + headerLen;
+  memcpy(key, &r, 4);
+  headerLen += 4;
+  for(size_t i = 0; i < len; i++)
+  {
+    payload[i] ^= key[i & 3];
+  }
+
+  char* frame = payload - headerLen;
+  memcpy(frame, header, headerLen);
+  int ret = m_pTransport->write(frame, headerLen + len, timeout);
+  if(ret != OK)
+  {
+    ERR("Could not send frame (%d)", ret);
+    drop(); //Part of the frame may have been sent
+    return (ret == NET_TIMEOUT) ? NET_TIMEOUT : NET_CONN;
+  }
+  return OK;
+}
+
+int HTTPWebSocket::sendControl(int opcode, const char* data, size_t len, uint32_t timeout)
+{
+  char* payload = m_ctrlBuf + HTTP_WEBSOCKET_MAX_HEADER_LEN; //Apart from the send buffer, which may hold a message being written
+  if(len > 0)
+  {
+    memcpy(payload, data, len);
+  }
+  return sendFrame(payload, len, opcode, true, timeout);
+}
+
+int HTTPWebSocket::fill(size_t len, uint32_t timeout) //Until len bytes are buffered
+{
+  size_t bufferedLen = m_rxLen - m_rxPos;
+  if(bufferedLen >= len)
+  {
+    return OK;
+  }
+  if(m_rxPos > 0)
+  {
+    memmove(m_rxBuf, m_rxBuf + m_rxPos, bufferedLen);
+    m_rxPos = 0;
+    m_rxLen = bufferedLen;
+  }
+  size_t readLen = 0;
+  int ret = m_pTransport->read(m_rxBuf + m_rxLen, len - bufferedLen, sizeof(m_rxBuf) - m_rxLen, &readLen, timeout);
+  m_rxLen += readLen;
+  if(ret == NET_TIMEOUT)
+  {
+    return NET_TIMEOUT;
+  }
+  if(ret != OK)
+  {
+    ERR("Connection error (%d)", ret);
+    m_closeStatus = 1006; //Closed without closing handshake
+    drop();
+    return (ret == NET_CLOSED) ? NET_CLOSED : NET_CONN;
+  }
+  return OK;
+}
+
+int HTTPWebSocket::fail(uint16_t status) //Protocol error: close with status
+{
+  char payload[2] = { (char)(status >> 8), (char)status };
+  sendControl(HTTP_WS_CLOSE, payload, sizeof(payload), HTTP_WEBSOCKET_DEFAULT_TIMEOUT);
+  m_closeStatus = status;
+  drop();
+  return NET_PROTOCOL;
+}
+
+void HTTPWebSocket::drop()
+{
+  if(m_pTransport != NULL)
+  {
+    m_pTransport->close();
+    m_pTransport = NULL;
+  }
+  m_rxPos = m_rxLen = 0;
+  m_frameRemaining = 0;
+  m_rxFragmented = false;
+  m_txFragmented = false;
+}
+
+uint32_t HTTPWebSocket::random()
+{
+  if(m_randomPos + 4 > HTTP_WEBSOCKET_RANDOM_POOL_LEN)
+  {
+    fillRandom();
+    m_randomPos = 0;
+  }
+  uint32_t r;
+  memcpy(&r, m_randomPool + m_randomPos, 4);
+  m_randomPos += 4;
+  return r;
+}
+
+void HTTPWebSocket::fillRandom() //Refill the pool of random bytes
+{
+  int ret = NET_NOTFOUND; //No entropy available
+  if(m_pEntropySource != NULL)
+  {
+    ret = m_pEntropySource->getEntropy(m_randomPool, sizeof(m_randomPool));
+  }
+#ifdef __linux__
+  else
+  {
+    size_t len = 0;
+    while(len < sizeof(m_randomPool))
+    {
+      ssize_t n = getrandom(m_randomPool + len, sizeof(m_randomPool) - len, 0);
+      if(n < 0)
+      {
+        if(errno == EINTR)
+        {
+          continue;
+        }
+        break;
+      }
+      len += n;
+    }
+    ret = (len == sizeof(m_randomPool)) ? OK : NET_UNKNOWN;
+  }
+#endif
+  if(ret == OK)
+  {
+    return;
+  }
+  if(ret != NET_NOTFOUND)
+  {
+    WARN("No entropy (%d), masking keys are predictable", ret);
+  }
+
+  //xorshift32, seeded with the clock and the address of the instance
+  if(m_random == 0)
+  {
+    m_random = (HTTPTime::getMs() ^ (uint32_t)(size_t)this) | 1;
+  }
+  for(size_t i = 0; i < sizeof(m_randomPool); i += 4)
+  {
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    memcpy(m_randomPool + i, &m_random, 4);
+  }
+}
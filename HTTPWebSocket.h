@@ -0,0 +1,188 @@
+/* HTTPWebSocket.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPWEBSOCKET_H_
+#define HTTPWEBSOCKET_H_
+
+#include "IHTTPTransport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef HTTP_WEBSOCKET_BUFFER_SIZE
+#define HTTP_WEBSOCKET_BUFFER_SIZE 512 //Payload of a frame sent at once, and frames received in one piece
+#endif
+#define HTTP_WEBSOCKET_MAX_HEADER_LEN 14 //Frame header with a 64-bit length and the masking key
+#define HTTP_WEBSOCKET_MAX_CONTROL_LEN 125 //Payload of ping, pong and close frames
+#define HTTP_WEBSOCKET_KEY_LEN 24 //Base64 of the 16 bytes of Sec-WebSocket-Key
+#define HTTP_WEBSOCKET_DEFAULT_TIMEOUT 4000
+#define HTTP_WEBSOCKET_RANDOM_POOL_LEN 64 //Random bytes drawn at once, enough for the masking keys of 16 frames
+
+///WebSocket frame types (RFC 6455)
+enum HTTPWebSocketOpcode
+{
+  HTTP_WS_CONTINUATION = 0x0, ///<Next fragment of a message
+  HTTP_WS_TEXT = 0x1, ///<UTF-8 text message
+  HTTP_WS_BINARY = 0x2, ///<Binary message
+  HTTP_WS_CLOSE = 0x8, ///<Closing handshake
+  HTTP_WS_PING = 0x9, ///<Ping, answered with a pong carrying the same data
+  HTTP_WS_PONG = 0xA ///<Answer to a ping
+};
+
+///This is a simple interface for a source of random bytes, such as the hardware RNG of the device
+class IHTTPEntropySource
+{
+protected:
+  friend class HTTPWebSocket;
+
+  /** Fill a buffer with random bytes
+   * @param buf Buffer to fill
+   * @param len Length of the buffer
+   * @return 0 on success, NET error on failure
+   */
+  virtual int getEntropy(uint8_t* buf, size_t len) = 0;
+
+};
+
+/** WebSocket connection (RFC 6455), opened by HTTPClient::openWebSocket()
+ * Messages are sent and received without intermediate copies: the payload of a frame is written directly into the send buffer, right after
+ * the room kept for its header, and received frames are read in place from the receive buffer.
+ * A frame costs 6 to 14 bytes of header on the way out (2 to 10 from the server), instead of a request line, headers and a response.
+ * Pings from the server are answered and pongs are consumed while receiving.
+ * The handshake key and the masking keys come from getrandom() on Linux, or from the source set with setEntropySource(), drawn
+ * HTTP_WEBSOCKET_RANDOM_POOL_LEN bytes at a time. Without either (e.g. on mbed with no source set), a generator seeded with the clock is used,
+ * whose keys an attacker can predict: RFC 6455 requires masking keys from a strong source of entropy.
+ * A WebSocket is used by one thread at a time.
+ */
+class HTTPWebSocket
+{
+public:
+  HTTPWebSocket();
+
+  ///Drop the connection if it is still open, without closing handshake
+  ~HTTPWebSocket();
+
+  /** Whether the connection is open
+   */
+  bool isOpen();
+
+  /** Set the source of the random bytes of the handshake key and of the masking keys, before opening the connection
+   * @param pSource Entropy source, e.g. wrapping the hardware RNG, or NULL for getrandom() on Linux; it must remain valid as long as the WebSocket is in use
+   */
+  void setEntropySource(IHTTPEntropySource* pSource);
+
+  /** Get the buffer in which to write the payload of the next frame sent with sendBuffer()
+   * @param pMaxLen Pointer to the variable on which the size of the buffer will be stored (HTTP_WEBSOCKET_BUFFER_SIZE)
+   * @return Buffer, which is masked in place by sendBuffer()
+   */
+  char* getSendBuffer(size_t* pMaxLen);
+
+  /** Send the payload written in the send buffer as a frame
+   * A message can be fragmented: its first frame has the message opcode and final set to false, the next ones HTTP_WS_CONTINUATION.
+   * @param len Length of the payload
+   * @param opcode HTTP_WS_TEXT, HTTP_WS_BINARY, or HTTP_WS_CONTINUATION for the next fragments of a message
+   * @param final false if more fragments of the message follow
+   * @param timeout Timeout in ms
+   * @return 0 on success, NET error on failure
+   */
+  int sendBuffer(size_t len, HTTPWebSocketOpcode opcode = HTTP_WS_TEXT, bool final = true, uint32_t timeout = HTTP_WEBSOCKET_DEFAULT_TIMEOUT);
+
+  /** Send a message, copied into the send buffer and fragmented if it does not fit in a single frame
+   * @param data Payload of the message
+   * @param len Length of the payload
+   * @param opcode HTTP_WS_TEXT or HTTP_WS_BINARY
+   * @param timeout Timeout in ms of each frame
+   * @return 0 on success, NET error on failure
+   */
+  int send(const char* data, size_t len, HTTPWebSocketOpcode opcode = HTTP_WS_TEXT, uint32_t timeout = HTTP_WEBSOCKET_DEFAULT_TIMEOUT);
+
+  /** Send a ping, whose pong is consumed by recv()
+   * @param data Payload of the ping, can be NULL
+   * @param len Length of the payload (at most HTTP_WEBSOCKET_MAX_CONTROL_LEN)
+   * @param timeout Timeout in ms
+   * @return 0 on success, NET error on failure
+   */
+  int ping(const char* data = NULL, size_t len = 0, uint32_t timeout = HTTP_WEBSOCKET_DEFAULT_TIMEOUT);
+
+  /** Receive the next piece of a message
+   * A frame that fits in the receive buffer is returned whole; a larger one in several pieces, as it arrives.
+   * @param pData Pointer to the variable on which the address of the data will be stored, valid until the next call
+   * @param pLen Pointer to the variable on which the length of the data will be stored
+   * @param pOpcode Pointer to the variable on which the opcode of the message (HTTP_WS_TEXT or HTTP_WS_BINARY) will be stored, can be NULL
+   * @param pFinal Pointer to the variable on which whether this piece ends the message will be stored, can be NULL
+   * @param timeout Timeout in ms
+   * @return 0 on success, NET_TIMEOUT if nothing arrived in time, NET_CLOSED if the server closed the connection, NET error on failure
+   */
+  int recv(const char** pData, size_t* pLen, HTTPWebSocketOpcode* pOpcode = NULL, bool* pFinal = NULL, uint32_t timeout = HTTP_WEBSOCKET_DEFAULT_TIMEOUT);
+
+  /** Close the connection with the closing handshake, discarding the data received in the meantime
+   * @param status Status code sent to the server (1000 for a normal closure)
+   * @param timeout Time in ms to wait for the server to answer
+   * @return 0 on success, NET error on failure (the connection is closed anyway)
+   */
+  int close(uint16_t status = 1000, uint32_t timeout = HTTP_WEBSOCKET_DEFAULT_TIMEOUT);
+
+  /** Get the status code of the closing handshake
+   * @return Status code sent by the server (1005 if it did not send any), the one sent on a protocol error, 1006 if the connection was lost, 0 if the connection was not closed
+   */
+  uint16_t getCloseStatus();
+
+private:
+  friend class HTTPClient;
+
+  HTTPWebSocket(const HTTPWebSocket&); //Not copyable, the buffers hold the state of the connection
+  HTTPWebSocket& operator=(const HTTPWebSocket&);
+
+  void makeKey(char* key); //Random Sec-WebSocket-Key, NULL-terminated
+  int attach(IHTTPTransport* pTransport, const char* data, size_t len); //Take over the connection after the handshake, with the bytes received after it
+  int sendFrame(char* payload, size_t len, int opcode, bool final, uint32_t timeout); //Header written right before the payload
+  int sendControl(int opcode, const char* data, size_t len, uint32_t timeout);
+  int fill(size_t len, uint32_t timeout); //Until len bytes are buffered
+  int fail(uint16_t status); //Protocol error: close with status
+  void drop();
+  uint32_t random();
+  void fillRandom(); //Refill the pool of random bytes
+
+  IHTTPTransport* m_pTransport; //NULL if not open
+  IHTTPEntropySource* m_pEntropySource;
+  uint8_t m_randomPool[HTTP_WEBSOCKET_RANDOM_POOL_LEN];
+  size_t m_randomPos; //First byte not used
+  uint32_t m_random; //State of the generator used when there is no entropy
+
+  char m_txBuf[HTTP_WEBSOCKET_MAX_HEADER_LEN + HTTP_WEBSOCKET_BUFFER_SIZE];
+  char m_ctrlBuf[HTTP_WEBSOCKET_MAX_HEADER_LEN + HTTP_WEBSOCKET_MAX_CONTROL_LEN];
+  bool m_txFragmented; //A fragmented message is being sent
+
+  char m_rxBuf[HTTP_WEBSOCKET_MAX_HEADER_LEN + HTTP_WEBSOCKET_BUFFER_SIZE];
+  size_t m_rxPos; //First byte not consumed
+  size_t m_rxLen;
+  uint64_t m_frameRemaining; //Payload of the current data frame not returned yet
+  bool m_frameFinal;
+  bool m_rxFragmented; //A fragmented message is being received
+  HTTPWebSocketOpcode m_rxOpcode; //Opcode of the message being received
+
+  bool m_closeSent;
+  uint16_t m_closeStatus;
+};
+
+#endif /* HTTPWEBSOCKET_H_ */
@@ -24,11 +24,24 @@ SOFTWARE.
 #ifndef IHTTPDATA_H
 #define IHTTPDATA_H
 
+#include <stddef.h>
+
+///Flow control requested by IHTTPDataIn::write() instead of returning 0, apart from the NET error codes (which do not stop the transfer)
+enum HTTPDataInControl
+{
+  HTTP_DATA_PAUSE = 0x100, ///<The sink cannot take the data yet: it is written again later, and no more is read from the server meanwhile
+  HTTP_DATA_ABORT, ///<Stop the transfer at once, the request fails with NET_ABORT
+  HTTP_DATA_ENOUGH ///<The data was taken and the sink needs no more: the transfer stops and the request succeeds
+};
+
 ///This is a simple interface for HTTP data storage (impl examples are Key/Value Pairs, File, etc...)
 class IHTTPDataOut
 {
 protected:
   friend class HTTPClient;
+  friend class HTTPAsyncRequest;
+  friend class HTTP2Connection;
+  friend class HTTPMultipart; //Parts can be read from other data sources
 
   /** Read a piece of data to be transmitted
    * @param buf Pointer to the buffer on which to copy the data
@@ -52,6 +65,11 @@ protected:
    */
   virtual size_t getDataLen() = 0;
 
+  /** Restart reading the data from the beginning, used to replay a request on a 307 or 308 redirection
+   * @return true on success, false if the data cannot be read again (default)
+   */
+  virtual bool rewind() { return false; }
+
 };
 
 ///This is a simple interface for HTTP data storage (impl examples are Key/Value Pairs, File, etc...)
@@ -59,10 +77,13 @@ class IHTTPDataIn
 {
 protected:
   friend class HTTPClient;
+  friend class HTTPAsyncRequest;
+  friend class HTTP2Connection;
 
   /** Write a piece of data transmitted by the server
    * @param buf Pointer to the buffer from which to copy the data
    * @param len Length of the buffer
+   * @return 0 on success, or a HTTPDataInControl value to pause or stop the transfer
    */
   virtual int write(const char* buf, size_t len) = 0;
 
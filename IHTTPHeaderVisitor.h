@@ -0,0 +1,75 @@
+/* IHTTPHeaderVisitor.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef IHTTPHEADERVISITOR_H
+#define IHTTPHEADERVISITOR_H
+
+#include <stddef.h>
+
+///Non-owning view of a string that is not NULL-terminated, e.g. a header name or value in the receive buffer
+struct HTTPStringView
+{
+  const char* ptr; ///<First char
+  size_t len; ///<Number of chars
+
+  /** Compare with a NULL-terminated string, ignoring case as for header names
+   * @param str String to compare with
+   * @return true if both strings are equal
+   */
+  bool equalsNoCase(const char* str) const
+  {
+    for(size_t i = 0; i < len; i++)
+    {
+      char a = ptr[i];
+      char b = str[i];
+      if( (a >= 'A') && (a <= 'Z') ) a += 'a' - 'A';
+      if( (b >= 'A') && (b <= 'Z') ) b += 'a' - 'A';
+      if( (b == '\0') || (a != b) )
+      {
+        return false;
+      }
+    }
+    return str[len] == '\0';
+  }
+};
+
+///This is a simple interface for reading response headers as they are parsed, without copying them
+class IHTTPHeaderVisitor
+{
+protected:
+  friend class HTTPClient;
+  friend class HTTPHpackDecoder;
+  friend class HTTP2Connection;
+
+  /** Called for each response header the visitor was registered for
+   * The views point straight into the receive buffer and are only valid during the call: copy what must be kept.
+   * Headers of the final response are visited, including error responses (e.g. Retry-After on 503), but not those of
+   * redirections that are followed.
+   * @param name Header name, as sent by the server
+   * @param value Header value, without surrounding whitespace
+   */
+  virtual void onHeader(const HTTPStringView& name, const HTTPStringView& value) = 0;
+
+};
+
+#endif
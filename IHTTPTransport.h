@@ -0,0 +1,157 @@
+/* IHTTPTransport.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef IHTTPTRANSPORT_H
+#define IHTTPTRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+///Timeout value for blocking calls that never time out (same value as osWaitForever)
+#define HTTP_WAIT_FOREVER 0xFFFFFFFF
+
+///Address families
+enum HTTPAddressFamily
+{
+  HTTP_ADDR_IPV4, ///<IPv4 address
+  HTTP_ADDR_IPV6 ///<IPv6 address
+};
+
+///Resolved address of a remote host
+struct HTTPAddress
+{
+  HTTPAddressFamily family; ///<Address family
+  uint8_t addr[16]; ///<Address in network byte order (only the first 4 bytes are used for IPv4)
+  uint16_t port; ///<Port in host byte order
+};
+
+///Events for IHTTPTransport::wait()
+enum HTTPTransportEvent
+{
+  HTTP_READABLE = 1, ///<Data can be read
+  HTTP_WRITABLE = 2 ///<Data can be written
+};
+
+///This is a simple interface for the stream the HTTP client talks over (impl examples are mbed sockets, Linux sockets, etc...)
+class IHTTPTransport
+{
+public:
+  virtual ~IHTTPTransport() {}
+
+  /** Resolve a host name (or parse a hard-coded IP address)
+   * @param host Host name
+   * @param port Port to connect to
+   * @param pAddr Pointer to the structure on which the resolved address will be stored
+   * @return 0 on success, NET error on failure
+   */
+  virtual int resolve(const char* host, uint16_t port, HTTPAddress* pAddr) = 0;
+
+  /** Resolve a host name into all its addresses
+   * The default implementation only returns the address found by resolve()
+   * @param host Host name
+   * @param port Port to connect to
+   * @param pAddrs Pointer to the array on which the resolved addresses will be stored, in the order in which they should be tried
+   * @param maxCount Size of the array
+   * @param pCount Pointer to the variable on which the number of addresses will be stored
+   * @return 0 on success, NET error on failure
+   */
+  virtual int resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount)
+  {
+    *pCount = 0;
+    if(maxCount == 0) //No room for the address
+    {
+      return 0;
+    }
+    int ret = resolve(host, port, &pAddrs[0]);
+    if(ret == 0)
+    {
+      *pCount = 1;
+    }
+    return ret;
+  }
+
+  /** Open a connection, closing the previous one if needed
+   * @param addr Address to connect to
+   * @param timeout Connection timeout in ms
+   * @return 0 on success, NET error on failure
+   */
+  virtual int connect(const HTTPAddress& addr, uint32_t timeout) = 0;
+
+  /** Open a connection to the first address that accepts it, closing the previous one if needed
+   * The default implementation tries the addresses one after the other
+   * @param pAddrs Addresses to connect to, in order of preference
+   * @param count Number of addresses (at least 1)
+   * @param timeout Connection timeout in ms
+   * @param pIndex Pointer to the variable on which the index of the connected address will be stored
+   * @return 0 on success, NET error on failure
+   */
+  virtual int connectAny(const HTTPAddress* pAddrs, size_t count, uint32_t timeout, size_t* pIndex)
+  {
+    size_t i = 0;
+    int ret = connect(pAddrs[0], timeout);
+    while( (ret != 0) && (i + 1 < count) )
+    {
+      i++;
+      ret = connect(pAddrs[i], timeout);
+    }
+    *pIndex = i;
+    return ret;
+  }
+
+  /** Read between minLen and maxLen bytes
+   * @param buf Pointer to the buffer on which to copy the data
+   * @param minLen Minimum number of bytes to read before returning
+   * @param maxLen Length of the buffer
+   * @param pReadLen Pointer to the variable on which the number of bytes read will be stored, even if an error occurs
+   * @param timeout Timeout in ms when waiting for data
+   * @return 0 on success, NET error on failure
+   */
+  virtual int read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout) = 0;
+
+  /** Write a buffer entirely
+   * @param buf Pointer to the data to write
+   * @param len Length of the data
+   * @param timeout Timeout in ms when waiting for the connection to be writable
+   * @return 0 on success, NET error on failure
+   */
+  virtual int write(const char* buf, size_t len, uint32_t timeout) = 0;
+
+  /** Wait for the connection to be readable and/or writable
+   * @param events Combination of HTTPTransportEvent flags
+   * @param timeout Timeout in ms
+   * @return 0 when one of the events is ready, NET_TIMEOUT on timeout, NET error on failure
+   */
+  virtual int wait(int events, uint32_t timeout) = 0;
+
+  /** Close the connection
+   * @return 0 on success, NET error on failure
+   */
+  virtual int close() = 0;
+
+  /** Check whether a connection is open
+   */
+  virtual bool isConnected() = 0;
+
+};
+
+#endif
@@ -0,0 +1,684 @@
+/* HTTPAsyncRequest.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifdef __linux__ //Linux host build only
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPAsyncRequest.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPAsyncRequest.h"
+#include "../transport/HTTPLinuxNet.h"
+#include "../util/HTTPScan.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+
+#define CHUNK_HEADER_MAX_LEN 8 //Hex length of a buffer-sized chunk and CRLF
+
+static bool equalsNoCase(const char* a, const char* b)
+{
+  while( (*a != '\0') && (tolower((unsigned char)*a) == tolower((unsigned char)*b)) )
+  {
+    a++;
+    b++;
+  }
+  return (*a == '\0') && (*b == '\0');
+}
+
+HTTPAsyncRequest::HTTPAsyncRequest(HTTPEventLoop* pLoop) : m_pLoop(pLoop), m_pListener(NULL), m_pEndpoint(NULL), m_meth(NULL), m_pDataOut(NULL), m_pDataIn(NULL),
+m_timeout(0), m_sock(-1), m_addrIndex(0), m_watchId(-1), m_events(0), m_state(STATE_IDLE), m_result(OK), m_httpResponseCode(0), m_pos(0), m_len(0),
+m_writtenLen(0), m_dataEnd(false), m_remaining(0), m_chunked(false), m_lengthSet(false), m_paused(false)
+{
+
+}
+
+/*virtual*/ HTTPAsyncRequest::~HTTPAsyncRequest()
+{
+  abort();
+}
+
+int HTTPAsyncRequest::get(HTTPEndpoint& endpoint, IHTTPDataIn* pDataIn, IHTTPAsyncListener* pListener, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/)
+{
+  return start("GET", endpoint, NULL, pDataIn, pListener, timeout);
+}
+
+int HTTPAsyncRequest::post(HTTPEndpoint& endpoint, IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, IHTTPAsyncListener* pListener, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/)
+{
+  return start("POST", endpoint, &dataOut, pDataIn, pListener, timeout);
+}
+
+void HTTPAsyncRequest::abort()
+{
+  if( isPending() )
+  {
+    DBG("Aborting request");
+    close();
+    m_state = STATE_DONE;
+    m_result = NET_ABORT;
+  }
+}
+
+int HTTPAsyncRequest::resume()
+{
+  if( !isPending() || !m_paused )
+  {
+    return NET_INVALID;
+  }
+  DBG("Resuming request");
+  m_paused = false;
+  process(); //The data already received is written first, it may complete the request
+  return OK;
+}
+
+bool HTTPAsyncRequest::isPaused()
+{
+  return isPending() && m_paused;
+}
+
+bool HTTPAsyncRequest::isPending()
+{
+  return (m_state != STATE_IDLE) && (m_state != STATE_DONE);
+}
+
+int HTTPAsyncRequest::getResult()
+{
+  return isPending() ? NET_PROCESSING : m_result;
+}
+
+int HTTPAsyncRequest::getHTTPResponseCode()
+{
+  return m_httpResponseCode;
+}
+
+//IHTTPEventHandler
+/*virtual*/ void HTTPAsyncRequest::onEvent(int /*events*/) //Errors and hang-ups surface in the next socket call
+{
+  process();
+}
+
+/*virtual*/ void HTTPAsyncRequest::onTimeout()
+{
+  if( (m_state == STATE_CONNECTING) && (m_addrIndex + 1 < m_pEndpoint->getAddressCount()) )
+  {
+    WARN("Timeout connecting, trying the next address");
+    close();
+    m_addrIndex++;
+    int ret = connectAddress();
+    if(ret == OK)
+    {
+      return;
+    }
+    complete(ret);
+    return;
+  }
+  WARN("Timeout");
+  complete(NET_TIMEOUT);
+}
+
+void HTTPAsyncRequest::process() //Step, then wait for the next events or complete
+{
+  int ret = step();
+  if(ret == NET_PROCESSING)
+  {
+    if(m_paused)
+    {
+      //Nothing is read while paused, so that TCP flow control holds the server back
+      DBG("Request paused by data sink");
+      if(m_watchId >= 0)
+      {
+        m_pLoop->unwatch(m_watchId);
+        m_watchId = -1;
+      }
+      return;
+    }
+    if(m_watchId >= 0)
+    {
+      ret = m_pLoop->modify(m_watchId, m_events, m_timeout);
+    }
+    else
+    {
+      m_watchId = m_pLoop->watch(m_sock, m_events, m_timeout, this);
+      ret = (m_watchId >= 0) ? OK : -m_watchId;
+    }
+    if(ret == OK)
+    {
+      return;
+    }
+  }
+  complete(ret);
+}
+
+int HTTPAsyncRequest::start(const char* meth, HTTPEndpoint& endpoint, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, IHTTPAsyncListener* pListener, uint32_t timeout)
+{
+  if( isPending() )
+  {
+    return NET_INVALID;
+  }
+  m_httpResponseCode = 0;
+  m_result = OK;
+  m_paused = false;
+  if( !endpoint.isValid() || endpoint.isSecure() )
+  {
+    ERR("Invalid or https endpoint");
+    return NET_INVALID;
+  }
+  if( !endpoint.isResolved() )
+  {
+    HTTPEpollTransport resolver; //Blocking resolution, resolve endpoints in advance to avoid it
+    if( endpoint.resolve(&resolver) != OK )
+    {
+      return NET_NOTFOUND;
+    }
+  }
+
+  m_pEndpoint = &endpoint;
+  m_meth = meth;
+  m_pDataOut = pDataOut;
+  m_pDataIn = pDataIn;
+  m_pListener = pListener;
+  m_timeout = timeout;
+
+  m_addrIndex = 0;
+  int ret = connectAddress();
+  if(ret != OK)
+  {
+    m_state = STATE_IDLE;
+    return ret;
+  }
+  return OK;
+}
+
+int HTTPAsyncRequest::connectAddress() //Start connecting to the first address that can be tried from m_addrIndex
+{
+  //The addresses are tried one after the other, the one that works is tried first next time
+  const HTTPAddress* pAddrs = m_pEndpoint->getAddresses();
+  for( ; m_addrIndex < m_pEndpoint->getAddressCount(); m_addrIndex++ )
+  {
+    struct sockaddr_storage serverAddr;
+    socklen_t serverAddrLen = HTTPLinuxNet::toSockAddr(pAddrs[m_addrIndex], &serverAddr);
+    m_sock = ::socket(HTTPLinuxNet::getDomain(pAddrs[m_addrIndex]), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(m_sock < 0)
+    {
+      ERR("Could not create socket (errno %d)", errno);
+      return NET_OOM;
+    }
+    int one = 1;
+    setsockopt(m_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    DBG("Connecting socket (handle %d) to %s:%d (address %d)", m_sock, m_pEndpoint->getHost(), m_pEndpoint->getPort(), (int)m_addrIndex);
+    if( (::connect(m_sock, (const struct sockaddr *)&serverAddr, serverAddrLen) < 0) && (errno != EINPROGRESS) )
+    {
+      WARN("Could not connect (errno %d)", errno);
+      close();
+      continue;
+    }
+    m_state = STATE_CONNECTING;
+    m_events = HTTP_WRITABLE;
+
+    m_watchId = m_pLoop->watch(m_sock, m_events, m_timeout, this);
+    if(m_watchId < 0)
+    {
+      int ret = -m_watchId;
+      close();
+      return ret;
+    }
+    return OK;
+  }
+  ERR("Could not connect to any address");
+  return NET_CONN;
+}
+
+int HTTPAsyncRequest::step() //Advance as far as possible, NET_PROCESSING when waiting for m_events
+{
+  int ret;
+  while(true)
+  {
+    switch(m_state)
+    {
+    case STATE_CONNECTING:
+      {
+        int err = 0;
+        socklen_t errLen = sizeof(err);
+        getsockopt(m_sock, SOL_SOCKET, SO_ERROR, &err, &errLen);
+        if(err != 0)
+        {
+          WARN("Could not connect (errno %d)", err);
+          close();
+          m_addrIndex++;
+          ret = connectAddress(); //Next address, if any
+          if(ret != OK)
+          {
+            return ret;
+          }
+          return NET_PROCESSING;
+        }
+        m_pEndpoint->setPreferredAddress(m_addrIndex);
+      }
+      ret = formatHead();
+      if(ret != OK)
+      {
+        return ret;
+      }
+      m_state = STATE_SENDING_HEAD;
+      break;
+    case STATE_SENDING_HEAD:
+      ret = flush();
+      if(ret != OK)
+      {
+        return ret;
+      }
+      m_pos = m_len = 0;
+      m_writtenLen = 0;
+      m_dataEnd = false;
+      m_state = (m_pDataOut != NULL) ? STATE_SENDING_DATA : STATE_STATUS;
+      break;
+    case STATE_SENDING_DATA:
+      ret = flush();
+      if(ret != OK)
+      {
+        return ret;
+      }
+      if(m_dataEnd)
+      {
+        m_pos = m_len = 0;
+        m_state = STATE_STATUS;
+        break;
+      }
+      ret = fillData();
+      if(ret != OK)
+      {
+        return ret;
+      }
+      break;
+    case STATE_DONE:
+    case STATE_IDLE:
+      return NET_INVALID;
+    default: //Receiving
+      ret = parse();
+      if( (ret != NET_PROCESSING) || m_paused )
+      {
+        return ret;
+      }
+      ret = fill();
+      if( (ret == NET_CLOSED) && (m_state == STATE_DATA) && !m_lengthSet ) //Data is delimited by the server closing the connection
+      {
+        return OK;
+      }
+      if(ret != OK)
+      {
+        return (ret == NET_CLOSED) ? NET_CONN : ret;
+      }
+      break;
+    }
+  }
+}
+
+int HTTPAsyncRequest::formatHead()
+{
+  int len = snprintf(m_buf, sizeof(m_buf), "%s %s HTTP/1.1\r\nHost: %s\r\n", m_meth, m_pEndpoint->getPath(), m_pEndpoint->getAuthority());
+  if(m_pDataOut != NULL)
+  {
+    if( m_pDataOut->getIsChunked() )
+    {
+      len += snprintf(m_buf + len, sizeof(m_buf) - len, "Transfer-Encoding: chunked\r\n");
+    }
+    else
+    {
+      len += snprintf(m_buf + len, sizeof(m_buf) - len, "Content-Length: %u\r\n", (unsigned int)m_pDataOut->getDataLen());
+    }
+    char type[64];
+    if( m_pDataOut->getDataType(type, sizeof(type)) == OK )
+    {
+      len += snprintf(m_buf + len, sizeof(m_buf) - len, "Content-Type: %s\r\n", type);
+    }
+  }
+  len += snprintf(m_buf + len, sizeof(m_buf) - len, "\r\n");
+  if(len >= (int)sizeof(m_buf))
+  {
+    ERR("Request too long");
+    return NET_TOOSMALL;
+  }
+  m_pos = 0;
+  m_len = len;
+  return OK;
+}
+
+int HTTPAsyncRequest::fillData() //Next piece of data, framed if chunked
+{
+  size_t trfLen;
+  int ret;
+  if( m_pDataOut->getIsChunked() )
+  {
+    ret = m_pDataOut->read(m_buf + CHUNK_HEADER_MAX_LEN, sizeof(m_buf) - CHUNK_HEADER_MAX_LEN - 2, &trfLen);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    //The chunk header is written right before the data
+    char header[CHUNK_HEADER_MAX_LEN + 1];
+    int headerLen = snprintf(header, sizeof(header), "%X\r\n", (unsigned int)trfLen);
+    m_pos = CHUNK_HEADER_MAX_LEN - headerLen;
+    memcpy(m_buf + m_pos, header, headerLen);
+    m_len = CHUNK_HEADER_MAX_LEN + trfLen;
+    if(trfLen == 0) //Last chunk
+    {
+      m_buf[m_len++] = '\r';
+      m_buf[m_len++] = '\n';
+      m_dataEnd = true;
+    }
+    m_buf[m_len++] = '\r';
+    m_buf[m_len++] = '\n';
+    return OK;
+  }
+
+  ret = m_pDataOut->read(m_buf, sizeof(m_buf), &trfLen);
+  if(ret != OK)
+  {
+    return ret;
+  }
+  m_pos = 0;
+  m_len = trfLen;
+  m_writtenLen += trfLen;
+  if( (trfLen == 0) || (m_writtenLen >= m_pDataOut->getDataLen()) )
+  {
+    m_dataEnd = true;
+  }
+  return OK;
+}
+
+int HTTPAsyncRequest::flush() //Send the buffer, NET_PROCESSING if the socket is full
+{
+  while(m_pos < m_len)
+  {
+    ssize_t ret = ::send(m_sock, m_buf + m_pos, m_len - m_pos, MSG_NOSIGNAL);
+    if( ret > 0 )
+    {
+      m_pos += ret;
+    }
+    else if( (ret < 0) && (errno == EINTR) )
+    {
+      continue;
+    }
+    else if( (ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)) )
+    {
+      m_events = HTTP_WRITABLE;
+      return NET_PROCESSING;
+    }
+    else
+    {
+      ERR("Connection error (send errno %d)", errno);
+      return NET_CONN;
+    }
+  }
+  return OK;
+}
+
+int HTTPAsyncRequest::fill() //Receive more data after the unparsed bytes, NET_PROCESSING if there is none yet
+{
+  if(m_pos > 0)
+  {
+    memmove(m_buf, m_buf + m_pos, m_len - m_pos);
+    m_len -= m_pos;
+    m_pos = 0;
+  }
+  if(m_len == sizeof(m_buf))
+  {
+    ERR("Line too long");
+    return NET_PROTOCOL;
+  }
+  while(true)
+  {
+    ssize_t ret = ::recv(m_sock, m_buf + m_len, sizeof(m_buf) - m_len, 0);
+    if( ret > 0 )
+    {
+      m_len += ret;
+      return OK;
+    }
+    else if( ret == 0 )
+    {
+      return NET_CLOSED;
+    }
+    else if( errno == EINTR )
+    {
+      continue;
+    }
+    else if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+    {
+      m_events = HTTP_READABLE;
+      return NET_PROCESSING;
+    }
+    else
+    {
+      ERR("Connection error (recv errno %d)", errno);
+      return NET_CONN;
+    }
+  }
+}
+
+int HTTPAsyncRequest::parse() //Consume the received bytes, OK once the response is complete, NET_PROCESSING if more are needed
+{
+  while(true)
+  {
+    if( (m_state == STATE_DATA) || (m_state == STATE_CHUNK_DATA) )
+    {
+      if( (m_state == STATE_DATA) && m_lengthSet && (m_remaining == 0) )
+      {
+        return OK;
+      }
+      if(m_state == STATE_CHUNK_DATA && (m_remaining == 0))
+      {
+        m_state = STATE_CHUNK_END;
+        continue;
+      }
+      if(m_pos == m_len)
+      {
+        return NET_PROCESSING;
+      }
+      size_t writeLen = m_len - m_pos;
+      if( (m_state == STATE_CHUNK_DATA) || m_lengthSet )
+      {
+        writeLen = MIN(writeLen, m_remaining);
+      }
+      int ret = (m_pDataIn != NULL) ? m_pDataIn->write(m_buf + m_pos, writeLen) : OK;
+      if(ret == HTTP_DATA_PAUSE)
+      {
+        m_paused = true; //Written again on resume()
+        return NET_PROCESSING;
+      }
+      if(ret == HTTP_DATA_ABORT)
+      {
+        WARN("Transfer aborted by data sink");
+        return NET_ABORT;
+      }
+      if( (m_state == STATE_CHUNK_DATA) || m_lengthSet )
+      {
+        m_remaining -= writeLen;
+      }
+      m_pos += writeLen;
+      if(ret == HTTP_DATA_ENOUGH)
+      {
+        DBG("Data sink does not need more data");
+        return OK;
+      }
+      continue;
+    }
+
+    //Line-based states
+    size_t crlfPos = m_pos + HTTPScan::findCRLF(m_buf + m_pos, m_len - m_pos);
+    if(crlfPos == m_len)
+    {
+      return NET_PROCESSING;
+    }
+    char* crlf = m_buf + crlfPos;
+    *crlf = '\0';
+    char* line = m_buf + m_pos;
+    m_pos = crlf + 2 - m_buf;
+    int ret = parseLine(line);
+    if(ret != NET_PROCESSING)
+    {
+      return ret;
+    }
+  }
+}
+
+int HTTPAsyncRequest::parseLine(char* line) //NET_PROCESSING to go on, OK once the response is complete
+{
+  switch(m_state)
+  {
+  case STATE_STATUS:
+    if( sscanf(line, "HTTP/%*d.%*d %d", &m_httpResponseCode) != 1 )
+    {
+      ERR("Not a correct HTTP answer : %s", line);
+      return NET_PROTOCOL;
+    }
+    DBG("Response code %d", m_httpResponseCode);
+    m_chunked = false;
+    m_lengthSet = false;
+    m_remaining = 0;
+    m_state = STATE_HEADERS;
+    return NET_PROCESSING;
+  case STATE_HEADERS:
+    if(line[0] == '\0') //End of headers
+    {
+      if( (m_httpResponseCode >= 100) && (m_httpResponseCode < 200) ) //Interim response, the final one follows
+      {
+        m_state = STATE_STATUS;
+        return NET_PROCESSING;
+      }
+      if(m_httpResponseCode != 200)
+      {
+        WARN("Response code %d", m_httpResponseCode);
+        return NET_PROTOCOL;
+      }
+      m_state = m_chunked ? STATE_CHUNK_HEADER : STATE_DATA;
+      return NET_PROCESSING;
+    }
+    {
+      char* value = strchr(line, ':');
+      if(value == NULL)
+      {
+        ERR("Could not parse header");
+        return NET_PROTOCOL;
+      }
+      *value = '\0';
+      value++;
+      while( (*value == ' ') || (*value == '\t') )
+      {
+        value++;
+      }
+      bool final = (m_httpResponseCode == 200); //Only the headers of the data are passed on
+      if( equalsNoCase(line, "Content-Length") )
+      {
+        unsigned int contentLength;
+        if( sscanf(value, "%u", &contentLength) != 1 )
+        {
+          ERR("Invalid Content-Length");
+          return NET_PROTOCOL;
+        }
+        m_remaining = contentLength;
+        m_lengthSet = true;
+        if( final && (m_pDataIn != NULL) )
+        {
+          m_pDataIn->setDataLen(contentLength);
+        }
+      }
+      else if( equalsNoCase(line, "Transfer-Encoding") && equalsNoCase(value, "chunked") )
+      {
+        m_chunked = true;
+        if( final && (m_pDataIn != NULL) )
+        {
+          m_pDataIn->setIsChunked(true);
+        }
+      }
+      else if( equalsNoCase(line, "Content-Type") && final && (m_pDataIn != NULL) )
+      {
+        m_pDataIn->setDataType(value);
+      }
+    }
+    return NET_PROCESSING;
+  case STATE_CHUNK_HEADER:
+    {
+      if( HTTPScan::parseHex(line, &m_remaining) == 0 ) //Chunk extensions are ignored
+      {
+        ERR("Could not read chunk length");
+        return NET_PROTOCOL;
+      }
+      m_state = (m_remaining == 0) ? STATE_TRAILERS : STATE_CHUNK_DATA;
+    }
+    return NET_PROCESSING;
+  case STATE_CHUNK_END:
+    if(line[0] != '\0')
+    {
+      ERR("Format error");
+      return NET_PROTOCOL;
+    }
+    m_state = STATE_CHUNK_HEADER;
+    return NET_PROCESSING;
+  case STATE_TRAILERS:
+    return (line[0] == '\0') ? OK : NET_PROCESSING;
+  default:
+    return NET_INVALID;
+  }
+}
+
+void HTTPAsyncRequest::complete(int result)
+{
+  DBG("Request completed (%d)", result);
+  close();
+  m_state = STATE_DONE;
+  m_result = result;
+  if(m_pListener != NULL)
+  {
+    m_pListener->onComplete(this, result); //Last, the request may be destroyed
+  }
+}
+
+void HTTPAsyncRequest::close()
+{
+  if(m_watchId >= 0)
+  {
+    m_pLoop->unwatch(m_watchId);
+    m_watchId = -1;
+  }
+  if(m_sock >= 0)
+  {
+    ::close(m_sock);
+    m_sock = -1;
+  }
+}
+
+#endif
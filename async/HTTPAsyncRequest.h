@@ -0,0 +1,181 @@
+/* HTTPAsyncRequest.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPASYNCREQUEST_H_
+#define HTTPASYNCREQUEST_H_
+
+#include "HTTPEventLoop.h"
+#include "../HTTPClient.h"
+
+#define HTTP_ASYNC_BUFFER_SIZE 512 //Request line and headers, and longest response line
+
+class HTTPAsyncRequest;
+
+///This is a simple interface for being notified of the completion of an HTTPAsyncRequest
+class IHTTPAsyncListener
+{
+protected:
+  friend class HTTPAsyncRequest;
+
+  /** Called once the request completed, successfully or not
+   * This is the last thing the request does: the request may be reused or destroyed during the call.
+   * @param pRequest Request that completed
+   * @param result 0 on success, NET error on failure (same as the HTTPClient results)
+   */
+  virtual void onComplete(HTTPAsyncRequest* pRequest, int result) = 0;
+
+public:
+  virtual ~IHTTPAsyncListener() {}
+};
+
+/** Non-blocking request, driven by an HTTPEventLoop (Linux host build only)
+ * The request goes through connection, sending and receiving as the socket gets ready, without ever blocking the thread,
+ * and notifies its listener when it completes. Each request uses its own connection.
+ * Redirections are not followed and https is not supported; the host is resolved with a blocking call unless the endpoint was already resolved.
+ */
+class HTTPAsyncRequest : public IHTTPEventHandler
+{
+public:
+  /** Instantiate a request
+   * @param pLoop Event loop driving the request
+   */
+  HTTPAsyncRequest(HTTPEventLoop* pLoop);
+
+  ///Abort the request if it is still pending, without notifying the listener
+  virtual ~HTTPAsyncRequest();
+
+  /** Start a GET request
+   * @param endpoint Endpoint on which to execute the request, must remain valid until completion
+   * @param pDataIn Pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param pListener Listener to notify on completion, only if the request was started
+   * @param timeout Timeout in ms of each step of the request (connecting, and waiting to send or receive)
+   * @return 0 if the request was started, NET error otherwise
+   */
+  int get(HTTPEndpoint& endpoint, IHTTPDataIn* pDataIn, IHTTPAsyncListener* pListener, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT);
+
+  /** Start a POST request
+   * @param endpoint Endpoint on which to execute the request, must remain valid until completion
+   * @param dataOut IHTTPDataOut instance that contains the data that will be posted, must remain valid until completion
+   * @param pDataIn Pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param pListener Listener to notify on completion, only if the request was started
+   * @param timeout Timeout in ms of each step of the request (connecting, and waiting to send or receive)
+   * @return 0 if the request was started, NET error otherwise
+   */
+  int post(HTTPEndpoint& endpoint, IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, IHTTPAsyncListener* pListener, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT);
+
+  /** Abort the request if it is still pending, without notifying the listener
+   */
+  void abort();
+
+  /** Resume a request whose IHTTPDataIn returned HTTP_DATA_PAUSE, writing the same data to it again
+   * The socket is not watched while the request is paused, so the loop's run() may return meanwhile.
+   * The listener may be notified of completion before this returns.
+   * @return 0 on success, NET_INVALID if the request is not paused
+   */
+  int resume();
+
+  /** Whether the request is waiting for resume()
+   */
+  bool isPaused();
+
+  /** Whether the request was started and did not complete yet
+   */
+  bool isPending();
+
+  /** Get the result of the request
+   * @return 0 on success, NET error on failure, NET_PROCESSING while the request is pending
+   */
+  int getResult();
+
+  /** Get the HTTP response code of the request
+   */
+  int getHTTPResponseCode();
+
+protected:
+  //IHTTPEventHandler
+  virtual void onEvent(int events);
+
+  virtual void onTimeout();
+
+private:
+  HTTPAsyncRequest(const HTTPAsyncRequest&); //Not copyable, the socket is watched by the loop
+  HTTPAsyncRequest& operator=(const HTTPAsyncRequest&);
+
+  enum STATE
+  {
+    STATE_IDLE,
+    STATE_CONNECTING,
+    STATE_SENDING_HEAD, //Request line and headers
+    STATE_SENDING_DATA,
+    STATE_STATUS, //Receiving the status line
+    STATE_HEADERS,
+    STATE_DATA, //Delimited by Content-Length or by the server closing the connection
+    STATE_CHUNK_HEADER,
+    STATE_CHUNK_DATA,
+    STATE_CHUNK_END, //CRLF ending a chunk
+    STATE_TRAILERS,
+    STATE_DONE
+  };
+
+  void process(); //Step, then wait for the next events or complete
+  int start(const char* meth, HTTPEndpoint& endpoint, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, IHTTPAsyncListener* pListener, uint32_t timeout);
+  int connectAddress(); //Start connecting to the first address that can be tried from m_addrIndex
+  int step(); //Advance as far as possible, NET_PROCESSING when waiting for m_events
+  int formatHead();
+  int fillData();
+  int flush();
+  int fill();
+  int parse();
+  int parseLine(char* line);
+  void complete(int result);
+  void close();
+
+  HTTPEventLoop* m_pLoop;
+  IHTTPAsyncListener* m_pListener;
+  HTTPEndpoint* m_pEndpoint;
+  const char* m_meth;
+  IHTTPDataOut* m_pDataOut;
+  IHTTPDataIn* m_pDataIn;
+  uint32_t m_timeout;
+
+  int m_sock;
+  size_t m_addrIndex; //Address of the endpoint being connected to
+  int m_watchId;
+  int m_events; //Events waited for
+  STATE m_state;
+  int m_result;
+  int m_httpResponseCode;
+
+  char m_buf[HTTP_ASYNC_BUFFER_SIZE];
+  size_t m_pos; //First byte left to send or to parse
+  size_t m_len;
+
+  size_t m_writtenLen; //Data sent
+  bool m_dataEnd; //Last piece of data in the buffer
+  size_t m_remaining; //Data left in the body or in the chunk
+  bool m_chunked;
+  bool m_lengthSet;
+  bool m_paused; //The sink cannot take the data yet
+};
+
+#endif /* HTTPASYNCREQUEST_H_ */
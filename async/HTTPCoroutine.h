@@ -0,0 +1,233 @@
+/* HTTPCoroutine.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPCOROUTINE_H_
+#define HTTPCOROUTINE_H_
+
+#include "HTTPAsyncRequest.h"
+
+#if (__cplusplus >= 202002L) && defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+
+/** Coroutine running a sequence of requests (C++20, Linux host build only)
+ * The coroutine starts right away and runs until its first co_await; the event loop resumes it as requests complete.
+ * @code
+ * HTTPTask update(HTTPAsyncClient& client)
+ * {
+ *   int ret = co_await client.get(configUrl, &config);
+ *   if(ret == 0)
+ *   {
+ *     ret = co_await client.post(ackUrl, ack, NULL);
+ *   }
+ *   co_return ret;
+ * }
+ *
+ * HTTPTask task = update(client); //Any number of tasks can run at the same time
+ * loop.run();
+ * @endcode
+ * Destroying the task aborts the request it is waiting for.
+ */
+class HTTPTask
+{
+public:
+  struct promise_type
+  {
+    int result;
+
+    promise_type() : result(0) { }
+    HTTPTask get_return_object() { return HTTPTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+    std::suspend_always final_suspend() noexcept { return std::suspend_always(); } //Kept until the task is destroyed, to read the result
+    void return_value(int ret) { result = ret; }
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  HTTPTask(HTTPTask&& task) noexcept : m_handle(task.m_handle)
+  {
+    task.m_handle = nullptr;
+  }
+
+  ~HTTPTask()
+  {
+    if(m_handle)
+    {
+      m_handle.destroy();
+    }
+  }
+
+  ///Whether the coroutine returned
+  bool isDone() const { return !m_handle || m_handle.done(); }
+
+  ///Value returned by the coroutine, once it is done
+  int getResult() const { return m_handle ? m_handle.promise().result : 0; }
+
+private:
+  explicit HTTPTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) { }
+  HTTPTask(const HTTPTask&) = delete;
+  HTTPTask& operator=(const HTTPTask&) = delete;
+
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+class HTTPAsyncClient;
+
+///Request awaited by a coroutine, returned by HTTPAsyncClient; co_await yields the result of the request (0 on success, NET error on failure)
+class HTTPRequestAwaiter : public IHTTPAsyncListener
+{
+public:
+  bool await_ready() { return false; }
+  bool await_suspend(std::coroutine_handle<> handle); //Suspend unless the request could not be started
+  int await_resume() { return m_result; }
+
+protected:
+  //IHTTPAsyncListener
+  virtual void onComplete(HTTPAsyncRequest* pRequest, int result);
+
+private:
+  friend class HTTPAsyncClient;
+
+  HTTPRequestAwaiter(HTTPAsyncClient* pClient, HTTPEndpoint* pEndpoint, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout);
+  HTTPRequestAwaiter(HTTPAsyncClient* pClient, const char* url, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout);
+  HTTPRequestAwaiter(const HTTPRequestAwaiter&) = delete;
+  HTTPRequestAwaiter& operator=(const HTTPRequestAwaiter&) = delete;
+
+  HTTPAsyncClient* m_pClient;
+  HTTPEndpoint m_endpoint; //For requests on a URL
+  HTTPEndpoint* m_pEndpoint;
+  IHTTPDataOut* m_pDataOut;
+  IHTTPDataIn* m_pDataIn;
+  uint32_t m_timeout;
+  HTTPAsyncRequest m_request;
+  int m_result;
+  std::coroutine_handle<> m_handle;
+};
+
+/** Awaitable requests for coroutines (C++20, Linux host build only)
+ * Same requests as HTTPClient, except that co_await suspends the calling coroutine until the request completes instead of blocking the thread.
+ * Use one client per coroutine to read the response code of its requests.
+ */
+class HTTPAsyncClient
+{
+public:
+  /** Instantiate the client
+   * @param pLoop Event loop driving the requests
+   */
+  explicit HTTPAsyncClient(HTTPEventLoop* pLoop) : m_pLoop(pLoop), m_httpResponseCode(0) { }
+
+  /** Execute a GET request on the url
+   * @param url : url on which to execute the request
+   * @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param timeout : timeout in ms of each step of the request
+   * @return awaitable yielding 0 on success, NET error on failure
+   */
+  HTTPRequestAwaiter get(const char* url, IHTTPDataIn* pDataIn, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT)
+  {
+    return HTTPRequestAwaiter(this, url, NULL, pDataIn, timeout);
+  }
+
+  /** Execute a GET request on an endpoint, which keeps the resolved address of the host
+   * @param endpoint : endpoint on which to execute the request
+   * @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param timeout : timeout in ms of each step of the request
+   * @return awaitable yielding 0 on success, NET error on failure
+   */
+  HTTPRequestAwaiter get(HTTPEndpoint& endpoint, IHTTPDataIn* pDataIn, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT)
+  {
+    return HTTPRequestAwaiter(this, &endpoint, NULL, pDataIn, timeout);
+  }
+
+  /** Execute a POST request on the url
+   * @param url : url on which to execute the request
+   * @param dataOut : a IHTTPDataOut instance that contains the data that will be posted
+   * @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param timeout : timeout in ms of each step of the request
+   * @return awaitable yielding 0 on success, NET error on failure
+   */
+  HTTPRequestAwaiter post(const char* url, IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT)
+  {
+    return HTTPRequestAwaiter(this, url, &dataOut, pDataIn, timeout);
+  }
+
+  /** Execute a POST request on an endpoint, which keeps the resolved address of the host
+   * @param endpoint : endpoint on which to execute the request
+   * @param dataOut : a IHTTPDataOut instance that contains the data that will be posted
+   * @param pDataIn : pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @param timeout : timeout in ms of each step of the request
+   * @return awaitable yielding 0 on success, NET error on failure
+   */
+  HTTPRequestAwaiter post(HTTPEndpoint& endpoint, IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT)
+  {
+    return HTTPRequestAwaiter(this, &endpoint, &dataOut, pDataIn, timeout);
+  }
+
+  /** Get last request's HTTP response code
+   * @return The HTTP response code of the last request
+   */
+  int getHTTPResponseCode() { return m_httpResponseCode; }
+
+private:
+  friend class HTTPRequestAwaiter;
+
+  HTTPEventLoop* m_pLoop;
+  int m_httpResponseCode;
+};
+
+inline HTTPRequestAwaiter::HTTPRequestAwaiter(HTTPAsyncClient* pClient, HTTPEndpoint* pEndpoint, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout) :
+m_pClient(pClient), m_pEndpoint(pEndpoint), m_pDataOut(pDataOut), m_pDataIn(pDataIn), m_timeout(timeout), m_request(pClient->m_pLoop), m_result(0)
+{
+
+}
+
+inline HTTPRequestAwaiter::HTTPRequestAwaiter(HTTPAsyncClient* pClient, const char* url, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn, uint32_t timeout) :
+m_pClient(pClient), m_endpoint(url), m_pEndpoint(&m_endpoint), m_pDataOut(pDataOut), m_pDataIn(pDataIn), m_timeout(timeout), m_request(pClient->m_pLoop), m_result(0)
+{
+
+}
+
+inline bool HTTPRequestAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+  m_handle = handle;
+  m_pClient->m_httpResponseCode = 0;
+  if(m_pDataOut != NULL)
+  {
+    m_result = m_request.post(*m_pEndpoint, *m_pDataOut, m_pDataIn, this, m_timeout);
+  }
+  else
+  {
+    m_result = m_request.get(*m_pEndpoint, m_pDataIn, this, m_timeout);
+  }
+  return m_result == 0; //If the request did not start, the coroutine goes on with the error
+}
+
+inline void HTTPRequestAwaiter::onComplete(HTTPAsyncRequest* pRequest, int result)
+{
+  m_result = result;
+  m_pClient->m_httpResponseCode = pRequest->getHTTPResponseCode();
+  m_handle.resume(); //Last, the coroutine destroys this awaiter once it goes on
+}
+
+#endif
+
+#endif /* HTTPCOROUTINE_H_ */
@@ -0,0 +1,241 @@
+/* HTTPEventLoop.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifdef __linux__ //Linux host build only
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPEventLoop.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPEventLoop.h"
+#include "../util/HTTPTime.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstring>
+
+static uint32_t toEpollEvents(int events)
+{
+  return ((events & HTTP_READABLE) ? (uint32_t)EPOLLIN : (uint32_t)0) | ((events & HTTP_WRITABLE) ? (uint32_t)EPOLLOUT : (uint32_t)0);
+}
+
+HTTPEventLoop::HTTPEventLoop() : m_epfd(-1), m_count(0)
+{
+  for(int i = 0; i < HTTP_EVENT_LOOP_MAX_HANDLERS; i++)
+  {
+    m_entries[i].pHandler = NULL;
+    m_entries[i].fd = -1;
+    m_entries[i].generation = 0;
+    m_entries[i].deadline = 0;
+    m_entries[i].hasDeadline = false;
+  }
+}
+
+HTTPEventLoop::~HTTPEventLoop()
+{
+  if(m_epfd >= 0)
+  {
+    ::close(m_epfd);
+  }
+}
+
+int HTTPEventLoop::watch(int fd, int events, uint32_t timeout, IHTTPEventHandler* pHandler)
+{
+  int ret = init();
+  if(ret != OK)
+  {
+    return -ret;
+  }
+
+  int id = 0;
+  while( (id < HTTP_EVENT_LOOP_MAX_HANDLERS) && (m_entries[id].pHandler != NULL) )
+  {
+    id++;
+  }
+  if(id == HTTP_EVENT_LOOP_MAX_HANDLERS)
+  {
+    WARN("Too many sockets watched");
+    return -NET_FULL;
+  }
+
+  Entry& entry = m_entries[id];
+  entry.generation++;
+  struct epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  ev.events = toEpollEvents(events);
+  ev.data.u64 = ((uint64_t)entry.generation << 32) | (uint32_t)id;
+  if( epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev) < 0 )
+  {
+    ERR("Could not register socket (errno %d)", errno);
+    return -NET_OOM;
+  }
+  entry.pHandler = pHandler;
+  entry.fd = fd;
+  entry.hasDeadline = (timeout != HTTP_WAIT_FOREVER);
+  entry.deadline = HTTPTime::getMs() + timeout;
+  m_count++;
+  return id;
+}
+
+int HTTPEventLoop::modify(int id, int events, uint32_t timeout)
+{
+  Entry& entry = m_entries[id];
+  struct epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  ev.events = toEpollEvents(events);
+  ev.data.u64 = ((uint64_t)entry.generation << 32) | (uint32_t)id;
+  if( epoll_ctl(m_epfd, EPOLL_CTL_MOD, entry.fd, &ev) < 0 )
+  {
+    ERR("Could not update socket registration (errno %d)", errno);
+    return NET_CONN;
+  }
+  entry.hasDeadline = (timeout != HTTP_WAIT_FOREVER);
+  entry.deadline = HTTPTime::getMs() + timeout;
+  return OK;
+}
+
+void HTTPEventLoop::unwatch(int id)
+{
+  Entry& entry = m_entries[id];
+  if(entry.pHandler == NULL)
+  {
+    return;
+  }
+  epoll_ctl(m_epfd, EPOLL_CTL_DEL, entry.fd, NULL);
+  entry.pHandler = NULL;
+  entry.fd = -1;
+  entry.generation++; //Events of this watch that are already fetched are dropped
+  m_count--;
+}
+
+int HTTPEventLoop::runOnce(uint32_t timeout)
+{
+  int ret = init();
+  if(ret != OK)
+  {
+    return ret;
+  }
+
+  uint32_t waitTime = getWaitTime(timeout);
+  struct epoll_event evs[HTTP_EVENT_LOOP_BATCH];
+  int n = epoll_wait(m_epfd, evs, HTTP_EVENT_LOOP_BATCH, (waitTime == HTTP_WAIT_FOREVER) ? -1 : (int)waitTime);
+  if( (n < 0) && (errno != EINTR) )
+  {
+    ERR("epoll_wait failed (errno %d)", errno);
+    return NET_CONN;
+  }
+
+  for(int i = 0; i < n; i++)
+  {
+    uint32_t id = (uint32_t)evs[i].data.u64;
+    uint32_t generation = (uint32_t)(evs[i].data.u64 >> 32);
+    Entry& entry = m_entries[id];
+    if( (entry.pHandler == NULL) || (entry.generation != generation) ) //Unwatched by an earlier handler of the batch
+    {
+      continue;
+    }
+    int events = 0;
+    if( evs[i].events & (EPOLLERR | EPOLLHUP) )
+    {
+      events = HTTP_READABLE | HTTP_WRITABLE;
+    }
+    if( evs[i].events & EPOLLIN ) events |= HTTP_READABLE;
+    if( evs[i].events & EPOLLOUT ) events |= HTTP_WRITABLE;
+    entry.pHandler->onEvent(events);
+  }
+
+  //Expired timeouts, the handlers may unwatch any entry
+  uint32_t now = HTTPTime::getMs();
+  for(int id = 0; id < HTTP_EVENT_LOOP_MAX_HANDLERS; id++)
+  {
+    Entry& entry = m_entries[id];
+    if( (entry.pHandler != NULL) && entry.hasDeadline && ((int32_t)(now - entry.deadline) >= 0) )
+    {
+      entry.hasDeadline = false;
+      entry.pHandler->onTimeout();
+    }
+  }
+  return OK;
+}
+
+int HTTPEventLoop::run()
+{
+  while(m_count > 0)
+  {
+    int ret = runOnce(HTTP_WAIT_FOREVER);
+    if(ret != OK)
+    {
+      return ret;
+    }
+  }
+  return OK;
+}
+
+size_t HTTPEventLoop::getCount()
+{
+  return m_count;
+}
+
+int HTTPEventLoop::init()
+{
+  if(m_epfd < 0) //Created on first use, so that an unused loop holds no file descriptor
+  {
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(m_epfd < 0)
+    {
+      ERR("Could not create epoll instance (errno %d)", errno);
+      return NET_OOM;
+    }
+  }
+  return OK;
+}
+
+uint32_t HTTPEventLoop::getWaitTime(uint32_t timeout) //Until the next deadline, at most timeout
+{
+  uint32_t now = HTTPTime::getMs();
+  uint32_t waitTime = timeout;
+  for(int id = 0; id < HTTP_EVENT_LOOP_MAX_HANDLERS; id++)
+  {
+    const Entry& entry = m_entries[id];
+    if( (entry.pHandler != NULL) && entry.hasDeadline )
+    {
+      int32_t remaining = (int32_t)(entry.deadline - now);
+      uint32_t entryWait = (remaining > 0) ? (uint32_t)remaining : 0;
+      if( (waitTime == HTTP_WAIT_FOREVER) || (entryWait < waitTime) )
+      {
+        waitTime = entryWait;
+      }
+    }
+  }
+  return waitTime;
+}
+
+#endif
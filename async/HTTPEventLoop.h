@@ -0,0 +1,119 @@
+/* HTTPEventLoop.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPEVENTLOOP_H_
+#define HTTPEVENTLOOP_H_
+
+#include "../IHTTPTransport.h"
+
+#ifndef HTTP_EVENT_LOOP_MAX_HANDLERS
+#define HTTP_EVENT_LOOP_MAX_HANDLERS 256 //Sockets watched at the same time
+#endif
+#define HTTP_EVENT_LOOP_BATCH 16 //Events handled per epoll_wait() call
+
+///This is a simple interface for objects driven by an HTTPEventLoop
+class IHTTPEventHandler
+{
+protected:
+  friend class HTTPEventLoop;
+
+  /** Called when the watched socket is ready
+   * Errors and hang-ups are reported as ready, so that the next read or write returns the actual condition.
+   * The handler may unwatch its socket or be destroyed during the call.
+   * @param events Combination of HTTPTransportEvent flags
+   */
+  virtual void onEvent(int events) = 0;
+
+  /** Called when the socket did not become ready in time, after which it is still watched but without timeout
+   */
+  virtual void onTimeout() = 0;
+
+public:
+  virtual ~IHTTPEventHandler() {}
+};
+
+/** Single-threaded event loop for non-blocking requests (Linux host build only)
+ * Sockets are watched with epoll, each with its own timeout. A single thread running the loop can drive hundreds of requests.
+ */
+class HTTPEventLoop
+{
+public:
+  HTTPEventLoop();
+  ~HTTPEventLoop();
+
+  /** Start watching a socket
+   * @param fd Socket
+   * @param events Combination of HTTPTransportEvent flags to wait for
+   * @param timeout Time in ms after which the handler's onTimeout() is called, or HTTP_WAIT_FOREVER
+   * @param pHandler Handler to call
+   * @return Id of the watch (>= 0) on success, NET error (< 0) on failure
+   */
+  int watch(int fd, int events, uint32_t timeout, IHTTPEventHandler* pHandler);
+
+  /** Change the events and restart the timeout of a watch
+   * @param id Id returned by watch()
+   * @param events Combination of HTTPTransportEvent flags to wait for
+   * @param timeout Time in ms after which the handler's onTimeout() is called, or HTTP_WAIT_FOREVER
+   * @return 0 on success, NET error on failure
+   */
+  int modify(int id, int events, uint32_t timeout);
+
+  /** Stop watching a socket, which must be done before it is closed
+   * @param id Id returned by watch()
+   */
+  void unwatch(int id);
+
+  /** Wait for events once and call the handlers
+   * @param timeout Maximum time to wait in ms, or HTTP_WAIT_FOREVER
+   * @return 0 on success, NET error on failure
+   */
+  int runOnce(uint32_t timeout);
+
+  /** Run until no socket is watched anymore
+   * @return 0 on success, NET error on failure
+   */
+  int run();
+
+  /** Get the number of watched sockets
+   */
+  size_t getCount();
+
+private:
+  struct Entry
+  {
+    IHTTPEventHandler* pHandler; //NULL if the entry is free
+    int fd;
+    uint32_t generation; //Tells events of a former watch apart
+    uint32_t deadline;
+    bool hasDeadline;
+  };
+
+  int init();
+  uint32_t getWaitTime(uint32_t timeout);
+
+  int m_epfd;
+  Entry m_entries[HTTP_EVENT_LOOP_MAX_HANDLERS];
+  size_t m_count;
+};
+
+#endif /* HTTPEVENTLOOP_H_ */
@@ -0,0 +1,158 @@
+/* HTTPBuffer.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPBuffer.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPBuffer.h"
+
+#include <cstring>
+#include <cstdlib>
+
+HTTPBuffer::HTTPBuffer(size_t maxSize /*= HTTPBUFFER_DEFAULT_MAX_SIZE*/) : m_buf(NULL), m_capacity(0), m_maxSize(maxSize), m_len(0), m_owned(true), m_truncated(false)
+{
+
+}
+
+HTTPBuffer::HTTPBuffer(char* arena, size_t size) : m_buf(arena), m_capacity(size), m_maxSize(size), m_len(0), m_owned(false), m_truncated(false)
+{
+  if(m_capacity > 0)
+  {
+    m_buf[0] = '\0';
+  }
+}
+
+HTTPBuffer::~HTTPBuffer()
+{
+  if(m_owned)
+  {
+    free(m_buf);
+  }
+}
+
+void HTTPBuffer::clear()
+{
+  m_len = 0;
+  m_truncated = false;
+  if(m_capacity > 0)
+  {
+    m_buf[0] = '\0';
+  }
+}
+
+const char* HTTPBuffer::getData()
+{
+  return (m_capacity > 0) ? m_buf : "";
+}
+
+size_t HTTPBuffer::getLength()
+{
+  return m_len;
+}
+
+size_t HTTPBuffer::getCapacity()
+{
+  return m_capacity;
+}
+
+bool HTTPBuffer::isTruncated()
+{
+  return m_truncated;
+}
+
+//IHTTPDataIn
+/*virtual*/ int HTTPBuffer::write(const char* buf, size_t len)
+{
+  if(m_len + len + 1 > m_capacity)
+  {
+    //Grow geometrically, so that a body of unknown length only costs a few reallocations
+    size_t capacity = MAX(m_capacity * 2, (size_t)HTTPBUFFER_MIN_CAPACITY);
+    capacity = MAX(capacity, m_len + len + 1);
+    reserve(MIN(capacity, m_maxSize));
+  }
+  size_t writeLen = len;
+  if(m_len + writeLen + 1 > m_capacity)
+  {
+    writeLen = (m_capacity > m_len) ? (m_capacity - m_len - 1) : 0;
+    if(!m_truncated)
+    {
+      WARN("Buffer full, dropping data");
+    }
+    m_truncated = true;
+  }
+  if(writeLen > 0)
+  {
+    memcpy(m_buf + m_len, buf, writeLen);
+    m_len += writeLen;
+    m_buf[m_len] = '\0';
+  }
+  return m_truncated ? NET_OVERFLOW : OK;
+}
+
+/*virtual*/ void HTTPBuffer::setDataType(const char* /*type*/) //Internet media type from Content-Type header
+{
+
+}
+
+/*virtual*/ void HTTPBuffer::setIsChunked(bool /*chunked*/) //From Transfer-Encoding header
+{
+
+}
+
+/*virtual*/ void HTTPBuffer::setDataLen(size_t len) //From Content-Length header, or if the transfer is chunked, next chunk length
+{
+  //Allocate the whole body at once
+  reserve(MIN(m_len + len + 1, m_maxSize));
+}
+
+bool HTTPBuffer::reserve(size_t capacity)
+{
+  if(capacity <= m_capacity)
+  {
+    return true;
+  }
+  if(!m_owned)
+  {
+    return false; //The arena cannot grow
+  }
+  char* buf = (char*) realloc(m_buf, capacity);
+  if(buf == NULL)
+  {
+    WARN("Could not allocate %d bytes", (int)capacity);
+    return false;
+  }
+  if(m_capacity == 0)
+  {
+    buf[0] = '\0';
+  }
+  m_buf = buf;
+  m_capacity = capacity;
+  return true;
+}
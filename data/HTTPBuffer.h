@@ -0,0 +1,99 @@
+/* HTTPBuffer.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef HTTPBUFFER_H_
+#define HTTPBUFFER_H_
+
+#include "../IHTTPData.h"
+
+#define HTTPBUFFER_DEFAULT_MAX_SIZE 16384 //Including the NULL-terminating char
+#define HTTPBUFFER_MIN_CAPACITY 64
+
+/** A data endpoint that stores a response of any size
+ * The buffer is allocated on the heap with the exact size announced by Content-Length,
+ * or grows geometrically for chunked or close-delimited responses.
+ * It can also use a caller-provided arena, in which case nothing is allocated.
+ * Data that does not fit is dropped and reported by isTruncated().
+ */
+class HTTPBuffer : public IHTTPDataIn
+{
+public:
+  /** Create an HTTPBuffer instance that allocates its storage
+   * @param maxSize Maximum size of the buffer, including the NULL-terminating char
+   */
+  HTTPBuffer(size_t maxSize = HTTPBUFFER_DEFAULT_MAX_SIZE);
+
+  /** Create an HTTPBuffer instance that uses a caller-provided arena
+   * @param arena Storage, must remain valid as long as the instance is in use
+   * @param size Size of the arena, including the NULL-terminating char
+   */
+  HTTPBuffer(char* arena, size_t size);
+
+  ~HTTPBuffer();
+
+  /** Discard the data, keeping the storage for the next response
+   */
+  void clear();
+
+  /** Get the data, NULL-terminated (an empty string if nothing was received)
+   */
+  const char* getData();
+
+  /** Get the length of the data
+   */
+  size_t getLength();
+
+  /** Get the size of the storage
+   */
+  size_t getCapacity();
+
+  /** Whether data was dropped because it did not fit in maxSize or in the arena
+   */
+  bool isTruncated();
+
+protected:
+  //IHTTPDataIn
+  virtual int write(const char* buf, size_t len);
+
+  virtual void setDataType(const char* type); //Internet media type from Content-Type header
+
+  virtual void setIsChunked(bool chunked); //From Transfer-Encoding header
+
+  virtual void setDataLen(size_t len); //From Content-Length header, or if the transfer is chunked, next chunk length
+
+private:
+  HTTPBuffer(const HTTPBuffer&); //Not copyable, the storage may be owned
+  HTTPBuffer& operator=(const HTTPBuffer&);
+
+  bool reserve(size_t capacity);
+
+  char* m_buf;
+  size_t m_capacity;
+  size_t m_maxSize;
+  size_t m_len;
+  bool m_owned; //Allocated on the heap, as opposed to an arena
+  bool m_truncated;
+};
+
+#endif /* HTTPBUFFER_H_ */
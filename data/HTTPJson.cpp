@@ -0,0 +1,557 @@
+/* HTTPJson.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPJson.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPJson.h"
+
+#include <cstring>
+#include <cstdio>
+
+static bool isSpace(char c)
+{
+  return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+HTTPJson::HTTPJson(IHTTPJsonHandler* pHandler, const char* const* paths /*= NULL*/, size_t pathsCount /*= 0*/) :
+m_pHandler(pHandler), m_paths(paths), m_pathsCount(pathsCount)
+{
+  reset();
+}
+
+void HTTPJson::reset()
+{
+  m_state = STATE_VALUE;
+  m_error = OK;
+  m_depth = 0;
+  m_path[0] = '\0';
+  m_pathLen = 0;
+  m_value[0] = '\0';
+  m_valueLen = 0;
+  m_truncated = false;
+  m_isKey = false;
+  m_code = 0;
+  m_highSurrogate = 0;
+  m_hexCount = 0;
+  m_dataLen = 0;
+  m_dataLenSet = false;
+  m_writtenLen = 0;
+}
+
+bool HTTPJson::isComplete()
+{
+  return m_state == STATE_DONE;
+}
+
+int HTTPJson::getError()
+{
+  return m_error;
+}
+
+int HTTPJson::finish()
+{
+  if( (m_state == STATE_LITERAL) && (m_depth == 0) && !endLiteral() )
+  {
+    if(m_error == OK)
+    {
+      m_error = NET_PROTOCOL;
+    }
+    WARN("Invalid JSON literal '%s' (%d)", m_value, m_error);
+    m_state = STATE_ERROR;
+  }
+  return m_error;
+}
+
+//IHTTPDataIn
+/*virtual*/ int HTTPJson::write(const char* buf, size_t len)
+{
+  for(size_t i = 0; (i < len) && (m_state != STATE_ERROR); i++)
+  {
+    if( !parse(buf[i]) )
+    {
+      if(m_error == OK)
+      {
+        m_error = NET_PROTOCOL;
+      }
+      WARN("Invalid JSON at '%c' (%d)", buf[i], m_error);
+      m_state = STATE_ERROR;
+    }
+  }
+  m_writtenLen += len;
+  if( m_dataLenSet && (m_writtenLen >= m_dataLen) )
+  {
+    return finish();
+  }
+  return m_error;
+}
+
+/*virtual*/ void HTTPJson::setDataType(const char* /*type*/) //Internet media type from Content-Type header
+{
+
+}
+
+/*virtual*/ void HTTPJson::setIsChunked(bool /*chunked*/) //From Transfer-Encoding header
+{
+
+}
+
+/*virtual*/ void HTTPJson::setDataLen(size_t len) //From Content-Length header, or if the transfer is chunked, next chunk length
+{
+  m_dataLen = len;
+  m_dataLenSet = true;
+}
+
+bool HTTPJson::parse(char c)
+{
+  switch(m_state)
+  {
+  case STATE_ARRAY_FIRST:
+    if( isSpace(c) )
+    {
+      return true;
+    }
+    if(c == ']')
+    {
+      return leave();
+    }
+    if( !beginElement() )
+    {
+      return false;
+    }
+    //Fall through
+  case STATE_VALUE:
+    if( isSpace(c) )
+    {
+      return true;
+    }
+    return beginValue(c);
+  case STATE_KEY_FIRST:
+    if(c == '}')
+    {
+      return leave();
+    }
+    //Fall through
+  case STATE_KEY:
+    if( isSpace(c) )
+    {
+      return true;
+    }
+    if(c != '"')
+    {
+      return false;
+    }
+    //The key is decoded straight into the path
+    m_pathLen = m_levels[m_depth - 1].pathLen;
+    m_path[m_pathLen] = '\0';
+    if( (m_pathLen > 0) && !appendPath(".") )
+    {
+      return false;
+    }
+    m_isKey = true;
+    m_state = STATE_STRING;
+    return true;
+  case STATE_COLON:
+    if( isSpace(c) )
+    {
+      return true;
+    }
+    if(c != ':')
+    {
+      return false;
+    }
+    m_state = STATE_VALUE;
+    return true;
+  case STATE_STRING:
+    if(c == '"')
+    {
+      if(m_highSurrogate != 0) //Unpaired
+      {
+        m_highSurrogate = 0;
+        if( !appendCodePoint(0xFFFD) ) return false;
+      }
+      if(m_isKey)
+      {
+        m_state = STATE_COLON;
+        return true;
+      }
+      return endValue();
+    }
+    if(c == '\\')
+    {
+      m_state = STATE_ESCAPE;
+      return true;
+    }
+    if( (unsigned char)c < 0x20 )
+    {
+      return false;
+    }
+    if(m_highSurrogate != 0)
+    {
+      m_highSurrogate = 0;
+      if( !appendCodePoint(0xFFFD) ) return false;
+    }
+    return append(c);
+  case STATE_ESCAPE:
+    m_state = STATE_STRING;
+    if(c == 'u')
+    {
+      m_code = 0;
+      m_hexCount = 0;
+      m_state = STATE_UNICODE;
+      return true;
+    }
+    if(m_highSurrogate != 0)
+    {
+      m_highSurrogate = 0;
+      if( !appendCodePoint(0xFFFD) ) return false;
+    }
+    switch(c)
+    {
+    case '"': case '\\': case '/':
+      return append(c);
+    case 'b':
+      return append('\b');
+    case 'f':
+      return append('\f');
+    case 'n':
+      return append('\n');
+    case 'r':
+      return append('\r');
+    case 't':
+      return append('\t');
+    default:
+      return false;
+    }
+  case STATE_UNICODE:
+    if( (c >= '0') && (c <= '9') ) m_code = (m_code << 4) | (c - '0');
+    else if( (c >= 'a') && (c <= 'f') ) m_code = (m_code << 4) | (c - 'a' + 10);
+    else if( (c >= 'A') && (c <= 'F') ) m_code = (m_code << 4) | (c - 'A' + 10);
+    else return false;
+    if(++m_hexCount < 4)
+    {
+      return true;
+    }
+    m_state = STATE_STRING;
+    if( (m_code >= 0xD800) && (m_code <= 0xDBFF) ) //High surrogate, wait for the low one
+    {
+      bool ret = (m_highSurrogate == 0) || appendCodePoint(0xFFFD);
+      m_highSurrogate = m_code;
+      return ret;
+    }
+    if( (m_code >= 0xDC00) && (m_code <= 0xDFFF) )
+    {
+      if(m_highSurrogate == 0)
+      {
+        return appendCodePoint(0xFFFD);
+      }
+      uint32_t code = 0x10000 + ((m_highSurrogate - 0xD800) << 10) + (m_code - 0xDC00);
+      m_highSurrogate = 0;
+      return appendCodePoint(code);
+    }
+    if(m_highSurrogate != 0)
+    {
+      m_highSurrogate = 0;
+      if( !appendCodePoint(0xFFFD) ) return false;
+    }
+    return appendCodePoint(m_code);
+  case STATE_LITERAL:
+    if( ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z')) || (c == '-') || (c == '+') || (c == '.') || (c == 'E') )
+    {
+      return append(c);
+    }
+    //The literal ends with the char that follows it, which must then be parsed
+    if( !endLiteral() )
+    {
+      return false;
+    }
+    return parse(c);
+  case STATE_AFTER:
+    if( isSpace(c) )
+    {
+      return true;
+    }
+    if(c == ',')
+    {
+      if(m_levels[m_depth - 1].isArray)
+      {
+        m_levels[m_depth - 1].index++;
+        if( !beginElement() )
+        {
+          return false;
+        }
+        m_state = STATE_VALUE;
+      }
+      else
+      {
+        m_state = STATE_KEY;
+      }
+      return true;
+    }
+    if( (c == (m_levels[m_depth - 1].isArray ? ']' : '}')) )
+    {
+      return leave();
+    }
+    return false;
+  case STATE_DONE:
+    return isSpace(c); //Only whitespace may follow the document
+  default:
+    return false;
+  }
+}
+
+bool HTTPJson::beginValue(char c)
+{
+  m_isKey = false;
+  m_valueLen = 0;
+  m_value[0] = '\0';
+  m_truncated = false;
+  if(c == '{')
+  {
+    return enter(false);
+  }
+  if(c == '[')
+  {
+    return enter(true);
+  }
+  if(c == '"')
+  {
+    m_state = STATE_STRING;
+    return true;
+  }
+  if( (c == '-') || ((c >= '0') && (c <= '9')) || (c == 't') || (c == 'f') || (c == 'n') )
+  {
+    m_state = STATE_LITERAL;
+    return append(c);
+  }
+  return false;
+}
+
+bool HTTPJson::beginElement()
+{
+  m_pathLen = m_levels[m_depth - 1].pathLen;
+  m_path[m_pathLen] = '\0';
+  char index[16];
+  snprintf(index, sizeof(index), "[%u]", (unsigned int)m_levels[m_depth - 1].index);
+  return appendPath(index);
+}
+
+bool HTTPJson::enter(bool isArray)
+{
+  if(m_depth >= HTTPJSON_MAX_DEPTH)
+  {
+    m_error = NET_OVERFLOW;
+    return false;
+  }
+  Level& level = m_levels[m_depth];
+  level.isArray = isArray;
+  level.pathLen = m_pathLen;
+  level.index = 0;
+  m_depth++;
+  if( isRequested() )
+  {
+    m_pHandler->onEnter(m_path, isArray ? HTTP_JSON_ARRAY : HTTP_JSON_OBJECT);
+  }
+  m_state = isArray ? STATE_ARRAY_FIRST : STATE_KEY_FIRST;
+  return true;
+}
+
+bool HTTPJson::leave()
+{
+  m_depth--;
+  m_pathLen = m_levels[m_depth].pathLen;
+  m_path[m_pathLen] = '\0';
+  if( isRequested() )
+  {
+    m_pHandler->onLeave(m_path, m_levels[m_depth].isArray ? HTTP_JSON_ARRAY : HTTP_JSON_OBJECT);
+  }
+  m_state = (m_depth == 0) ? STATE_DONE : STATE_AFTER;
+  return true;
+}
+
+bool HTTPJson::endValue()
+{
+  if( isRequested() )
+  {
+    m_pHandler->onValue(m_path, HTTP_JSON_STRING, m_value, m_valueLen, m_truncated);
+  }
+  m_state = (m_depth == 0) ? STATE_DONE : STATE_AFTER;
+  return true;
+}
+
+bool HTTPJson::endLiteral()
+{
+  HTTP_JSON_TYPE type;
+  if( !strcmp(m_value, "true") )
+  {
+    type = HTTP_JSON_TRUE;
+  }
+  else if( !strcmp(m_value, "false") )
+  {
+    type = HTTP_JSON_FALSE;
+  }
+  else if( !strcmp(m_value, "null") )
+  {
+    type = HTTP_JSON_NULL;
+  }
+  else if( m_truncated || isNumber(m_value) ) //A truncated literal can only be a long number
+  {
+    type = HTTP_JSON_NUMBER;
+  }
+  else
+  {
+    return false;
+  }
+  if( isRequested() )
+  {
+    m_pHandler->onValue(m_path, type, m_value, m_valueLen, m_truncated);
+  }
+  m_state = (m_depth == 0) ? STATE_DONE : STATE_AFTER;
+  return true;
+}
+
+bool HTTPJson::append(char c)
+{
+  if(m_isKey)
+  {
+    char str[2] = { c, '\0' };
+    return appendPath(str);
+  }
+  if(m_valueLen + 1 < HTTPJSON_VALUE_MAX_LEN)
+  {
+    m_value[m_valueLen++] = c;
+    m_value[m_valueLen] = '\0';
+  }
+  else
+  {
+    m_truncated = true;
+  }
+  return true;
+}
+
+bool HTTPJson::appendCodePoint(uint32_t code) //As UTF-8
+{
+  if(code < 0x80)
+  {
+    return append(code);
+  }
+  if(code < 0x800)
+  {
+    return append(0xC0 | (code >> 6)) && append(0x80 | (code & 0x3F));
+  }
+  if(code < 0x10000)
+  {
+    return append(0xE0 | (code >> 12)) && append(0x80 | ((code >> 6) & 0x3F)) && append(0x80 | (code & 0x3F));
+  }
+  return append(0xF0 | (code >> 18)) && append(0x80 | ((code >> 12) & 0x3F)) && append(0x80 | ((code >> 6) & 0x3F)) && append(0x80 | (code & 0x3F));
+}
+
+bool HTTPJson::appendPath(const char* str)
+{
+  size_t len = strlen(str);
+  if(m_pathLen + len >= HTTPJSON_PATH_MAX_LEN)
+  {
+    m_error = NET_OVERFLOW;
+    return false;
+  }
+  memcpy(m_path + m_pathLen, str, len + 1);
+  m_pathLen += len;
+  return true;
+}
+
+bool HTTPJson::isRequested()
+{
+  if(m_paths == NULL)
+  {
+    return true;
+  }
+  for(size_t i = 0; i < m_pathsCount; i++)
+  {
+    if( matchPath(m_paths[i], m_path) )
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*static*/ bool HTTPJson::matchPath(const char* pattern, const char* path)
+{
+  while( (*pattern != '\0') && (*path != '\0') )
+  {
+    if( (pattern[0] == '[') && (pattern[1] == ']') && (path[0] == '[') ) //Any index
+    {
+      pattern += 2;
+      path = strchr(path, ']') + 1;
+      continue;
+    }
+    if(*pattern != *path)
+    {
+      return false;
+    }
+    pattern++;
+    path++;
+  }
+  return (*pattern == '\0') && (*path == '\0');
+}
+
+/*static*/ bool HTTPJson::isNumber(const char* str) //-?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+{
+  if(*str == '-')
+  {
+    str++;
+  }
+  if(*str == '0')
+  {
+    str++;
+  }
+  else if( (*str >= '1') && (*str <= '9') )
+  {
+    while( (*str >= '0') && (*str <= '9') ) str++;
+  }
+  else
+  {
+    return false;
+  }
+  if(*str == '.')
+  {
+    str++;
+    if( (*str < '0') || (*str > '9') ) return false;
+    while( (*str >= '0') && (*str <= '9') ) str++;
+  }
+  if( (*str == 'e') || (*str == 'E') )
+  {
+    str++;
+    if( (*str == '+') || (*str == '-') ) str++;
+    if( (*str < '0') || (*str > '9') ) return false;
+    while( (*str >= '0') && (*str <= '9') ) str++;
+  }
+  return *str == '\0';
+}
@@ -0,0 +1,183 @@
+/* HTTPJson.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef HTTPJSON_H_
+#define HTTPJSON_H_
+
+#include "../IHTTPData.h"
+
+#include <stdint.h>
+
+#define HTTPJSON_MAX_DEPTH 16 //Nested objects and arrays
+#define HTTPJSON_PATH_MAX_LEN 128 //Including the NULL-terminating char
+#define HTTPJSON_VALUE_MAX_LEN 64 //Including the NULL-terminating char, longer values are truncated
+
+///Type of a JSON value
+enum HTTP_JSON_TYPE
+{
+  HTTP_JSON_STRING,
+  HTTP_JSON_NUMBER,
+  HTTP_JSON_TRUE,
+  HTTP_JSON_FALSE,
+  HTTP_JSON_NULL,
+  HTTP_JSON_OBJECT,
+  HTTP_JSON_ARRAY
+};
+
+///This is a simple interface for receiving the values of a JSON document as it is parsed
+class IHTTPJsonHandler
+{
+protected:
+  friend class HTTPJson;
+
+  /** Called for each scalar value whose path was requested
+   * Paths join object keys with '.' and array indexes with brackets, e.g. "items[2].id"; the path of the root value is empty.
+   * @param path Path of the value
+   * @param type Type of the value
+   * @param value Unescaped string, or text of the number or literal, NULL-terminated; only valid during the call
+   * @param len Length of the value
+   * @param truncated Whether the value was longer than HTTPJSON_VALUE_MAX_LEN - 1 and was cut
+   */
+  virtual void onValue(const char* path, HTTP_JSON_TYPE type, const char* value, size_t len, bool truncated) = 0;
+
+  /** Called when an object or an array whose path was requested starts
+   * @param path Path of the object or array
+   * @param type HTTP_JSON_OBJECT or HTTP_JSON_ARRAY
+   */
+  virtual void onEnter(const char* /*path*/, HTTP_JSON_TYPE /*type*/) { }
+
+  /** Called when an object or an array whose path was requested ends
+   * @param path Path of the object or array
+   * @param type HTTP_JSON_OBJECT or HTTP_JSON_ARRAY
+   */
+  virtual void onLeave(const char* /*path*/, HTTP_JSON_TYPE /*type*/) { }
+
+};
+
+/** A data endpoint that parses JSON as it is received
+ * Only the values that are requested are passed to the handler, the document itself is not stored:
+ * memory use depends on the nesting depth, not on the size of the document.
+ */
+class HTTPJson : public IHTTPDataIn
+{
+public:
+  /** Create an HTTPJson instance
+   * @param pHandler Handler to call for the requested values
+   * @param paths Paths of the values to pass to the handler, where "[]" matches any array index (e.g. "items[].id"),
+   *  or NULL to pass all values; the array must remain valid as long as the instance is in use
+   * @param pathsCount Number of paths in the array
+   */
+  HTTPJson(IHTTPJsonHandler* pHandler, const char* const* paths = NULL, size_t pathsCount = 0);
+
+  /** Get ready to parse a new document, must be called before reusing the instance for another request
+   */
+  void reset();
+
+  /** Whether a whole document was parsed
+   */
+  bool isComplete();
+
+  /** Get the parsing error, if any
+   * @return 0 if the document is valid so far, NET_PROTOCOL if it is malformed, NET_OVERFLOW if it is nested too deeply or a path is too long
+   */
+  int getError();
+
+  /** Signal the end of the document
+   * A root number or literal is only delimited by the end of the data: it is delivered here, which is done
+   * automatically once Content-Length bytes were received, but must be called for chunked or unframed responses.
+   * @return 0 on success, or the parsing error
+   */
+  int finish();
+
+protected:
+  //IHTTPDataIn
+  virtual int write(const char* buf, size_t len);
+
+  virtual void setDataType(const char* type); //Internet media type from Content-Type header
+
+  virtual void setIsChunked(bool chunked); //From Transfer-Encoding header
+
+  virtual void setDataLen(size_t len); //From Content-Length header, or if the transfer is chunked, next chunk length
+
+private:
+  enum STATE
+  {
+    STATE_VALUE, //Before a value
+    STATE_ARRAY_FIRST, //After '[', before a value or ']'
+    STATE_KEY_FIRST, //After '{', before a key or '}'
+    STATE_KEY, //After ',' in an object, before a key
+    STATE_COLON,
+    STATE_STRING,
+    STATE_ESCAPE,
+    STATE_UNICODE, //In a \uXXXX escape sequence
+    STATE_LITERAL, //Number, true, false or null
+    STATE_AFTER, //After a value in an object or an array
+    STATE_DONE,
+    STATE_ERROR
+  };
+
+  struct Level
+  {
+    bool isArray;
+    uint16_t pathLen; //Path of the object or array
+    uint32_t index; //Of the current element of an array
+  };
+
+  bool parse(char c);
+  bool beginValue(char c);
+  bool beginElement();
+  bool enter(bool isArray);
+  bool leave();
+  bool endValue();
+  bool endLiteral();
+  bool append(char c);
+  bool appendCodePoint(uint32_t code);
+  bool appendPath(const char* str);
+  bool isRequested();
+  static bool matchPath(const char* pattern, const char* path);
+  static bool isNumber(const char* str);
+
+  IHTTPJsonHandler* m_pHandler;
+  const char* const* m_paths;
+  size_t m_pathsCount;
+
+  STATE m_state;
+  int m_error;
+  Level m_levels[HTTPJSON_MAX_DEPTH];
+  size_t m_depth;
+  char m_path[HTTPJSON_PATH_MAX_LEN];
+  size_t m_pathLen;
+  char m_value[HTTPJSON_VALUE_MAX_LEN];
+  size_t m_valueLen;
+  bool m_truncated;
+  bool m_isKey;
+  uint32_t m_code; //Code point of a \uXXXX escape sequence
+  uint32_t m_highSurrogate;
+  int m_hexCount;
+  size_t m_dataLen; //From Content-Length header
+  bool m_dataLenSet;
+  size_t m_writtenLen;
+};
+
+#endif /* HTTPJSON_H_ */
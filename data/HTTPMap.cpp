@@ -21,6 +21,14 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPMap.cpp"
+#endif
+
 #include "core/fwk.h"
 
 #include "HTTPMap.h"
@@ -196,3 +204,9 @@ void HTTPMap::clear()
   }
   return count;
 }
+
+/*virtual*/ bool HTTPMap::rewind()
+{
+  m_pos = 0;
+  return true;
+}
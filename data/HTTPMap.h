@@ -62,6 +62,8 @@ protected:
 
   virtual size_t getDataLen(); //For Content-Length header
 
+  virtual bool rewind(); //To send the data again on a redirection
+
 private:
   const char* m_keys[HTTPMAP_TABLE_SIZE];
   const char* m_values[HTTPMAP_TABLE_SIZE];
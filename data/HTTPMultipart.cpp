@@ -0,0 +1,320 @@
+/* HTTPMultipart.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPMultipart.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPMultipart.h"
+#include "../util/HTTPTime.h"
+
+#include <cstring>
+
+#define CLOSE_LEN (2 + HTTPMULTIPART_BOUNDARY_LEN + 4) //"--" boundary "--" CRLF
+
+HTTPMultipart::HTTPMultipart() : m_count(0), m_part(0), m_stage(STAGE_HEADER), m_offset(0), m_fp(NULL)
+{
+  //A boundary that is unlikely to appear in the content
+  static uint32_t s_counter = 0;
+  uint32_t seed = HTTPTime::getMs() ^ ((uint32_t)(size_t)this) ^ (++s_counter * 2654435761U);
+  char* p = m_boundary + snprintf(m_boundary, sizeof(m_boundary), "HTTPClient");
+  while(p < m_boundary + HTTPMULTIPART_BOUNDARY_LEN)
+  {
+    seed = seed * 1103515245 + 12345;
+    *p++ = "0123456789abcdef"[(seed >> 16) & 0xf];
+  }
+  *p = '\0';
+}
+
+HTTPMultipart::~HTTPMultipart()
+{
+  closeFile();
+}
+
+int HTTPMultipart::addField(const char* name, const char* value)
+{
+  return add(PART_BUFFER, name, NULL, NULL, value, NULL, strlen(value));
+}
+
+int HTTPMultipart::addBuffer(const char* name, const char* fileName, const char* type, const char* data, size_t len)
+{
+  return add(PART_BUFFER, name, fileName, type, data, NULL, len);
+}
+
+int HTTPMultipart::addFile(const char* name, const char* path, const char* fileName, const char* type)
+{
+  FILE* fp = fopen(path, "rb");
+  if(fp == NULL)
+  {
+    return NET_NOTFOUND;
+  }
+  long len = -1;
+  if( fseek(fp, 0, SEEK_END) == 0 )
+  {
+    len = ftell(fp);
+  }
+  fclose(fp);
+  if(len < 0)
+  {
+    return NET_UNKNOWN;
+  }
+  return add(PART_FILE, name, fileName, type, path, NULL, len);
+}
+
+int HTTPMultipart::addStream(const char* name, const char* fileName, const char* type, IHTTPDataOut* pData)
+{
+  if( pData->getIsChunked() )
+  {
+    return NET_INVALID; //The length of each part is needed up front
+  }
+  return add(PART_STREAM, name, fileName, type, NULL, pData, pData->getDataLen());
+}
+
+void HTTPMultipart::clear()
+{
+  closeFile();
+  m_count = 0;
+  rewind();
+}
+
+
+/*virtual*/ int HTTPMultipart::read(char* buf, size_t len, size_t* pReadLen)
+{
+  size_t readLen = 0;
+  while( (readLen < len) && (m_stage != STAGE_DONE) )
+  {
+    size_t trfLen = 0;
+    switch(m_stage)
+    {
+    case STAGE_HEADER:
+      if(m_part >= m_count)
+      {
+        m_stage = STAGE_CLOSE;
+        continue;
+      }
+      if(m_offset == 0)
+      {
+        formatHeader(m_parts[m_part], m_header, sizeof(m_header));
+      }
+      trfLen = MIN(len - readLen, m_parts[m_part].headerLen - m_offset);
+      memcpy(buf + readLen, m_header + m_offset, trfLen);
+      m_offset += trfLen;
+      if(m_offset == m_parts[m_part].headerLen)
+      {
+        m_stage = STAGE_CONTENT;
+        m_offset = 0;
+      }
+      break;
+    case STAGE_CONTENT:
+      if(m_offset < m_parts[m_part].len)
+      {
+        int ret = readContent(m_parts[m_part], buf + readLen, MIN(len - readLen, m_parts[m_part].len - m_offset), &trfLen);
+        if(ret != OK)
+        {
+          closeFile();
+          return ret;
+        }
+        m_offset += trfLen;
+      }
+      if(m_offset == m_parts[m_part].len)
+      {
+        closeFile();
+        m_stage = STAGE_TRAILER;
+        m_offset = 0;
+      }
+      break;
+    case STAGE_TRAILER:
+      trfLen = MIN(len - readLen, 2 - m_offset);
+      memcpy(buf + readLen, "\r\n" + m_offset, trfLen);
+      m_offset += trfLen;
+      if(m_offset == 2)
+      {
+        m_part++;
+        m_stage = STAGE_HEADER;
+        m_offset = 0;
+      }
+      break;
+    case STAGE_CLOSE:
+      {
+        char close[CLOSE_LEN + 1];
+        snprintf(close, sizeof(close), "--%s--\r\n", m_boundary);
+        trfLen = MIN(len - readLen, CLOSE_LEN - m_offset);
+        memcpy(buf + readLen, close + m_offset, trfLen);
+        m_offset += trfLen;
+        if(m_offset == CLOSE_LEN)
+        {
+          m_stage = STAGE_DONE;
+        }
+      }
+      break;
+    default:
+      break;
+    }
+    readLen += trfLen;
+  }
+
+  *pReadLen = readLen;
+  if(readLen == 0) //Past the end, start over for the next request
+  {
+    rewind();
+  }
+  return OK;
+}
+
+/*virtual*/ int HTTPMultipart::getDataType(char* type, size_t maxTypeLen) //Internet media type for Content-Type header
+{
+  int len = snprintf(type, maxTypeLen, "multipart/form-data; boundary=%s", m_boundary);
+  if( (len < 0) || (len >= (int)maxTypeLen) )
+  {
+    return NET_TOOSMALL;
+  }
+  return OK;
+}
+
+/*virtual*/ bool HTTPMultipart::getIsChunked() //For Transfer-Encoding header
+{
+  return false; //The length of every part is known
+}
+
+/*virtual*/ size_t HTTPMultipart::getDataLen() //For Content-Length header
+{
+  size_t count = CLOSE_LEN;
+  for(size_t i = 0; i < m_count; i++)
+  {
+    count += m_parts[i].headerLen + m_parts[i].len + 2;
+  }
+  return count;
+}
+
+/*virtual*/ bool HTTPMultipart::rewind()
+{
+  closeFile();
+  bool ret = true;
+  for(size_t i = 0; i < m_count; i++)
+  {
+    if( (m_parts[i].kind == PART_STREAM) && !m_parts[i].pStream->rewind() )
+    {
+      ret = false;
+    }
+  }
+  m_part = 0;
+  m_stage = STAGE_HEADER;
+  m_offset = 0;
+  return ret;
+}
+
+int HTTPMultipart::add(PART_KIND kind, const char* name, const char* fileName, const char* type, const char* data, IHTTPDataOut* pStream, size_t len)
+{
+  if(m_count >= HTTPMULTIPART_TABLE_SIZE)
+  {
+    return NET_FULL;
+  }
+  Part& part = m_parts[m_count];
+  part.kind = kind;
+  part.name = name;
+  part.fileName = fileName;
+  part.type = type;
+  part.data = data;
+  part.pStream = pStream;
+  part.len = len;
+  int ret = formatHeader(part, m_header, sizeof(m_header));
+  if(ret < 0)
+  {
+    return -ret;
+  }
+  part.headerLen = ret;
+  m_count++;
+  return OK;
+}
+
+int HTTPMultipart::formatHeader(const Part& part, char* buf, size_t maxLen) //Length of the header, or -(NET error)
+{
+  //Quotes and line breaks cannot be escaped in a way that all servers understand
+  if( (strpbrk(part.name, "\"\r\n") != NULL) || ((part.fileName != NULL) && (strpbrk(part.fileName, "\"\r\n") != NULL))
+      || ((part.type != NULL) && (strpbrk(part.type, "\r\n") != NULL)) )
+  {
+    return -NET_INVALID;
+  }
+  int len = snprintf(buf, maxLen, "--%s\r\nContent-Disposition: form-data; name=\"%s\"%s%s%s\r\n%s%s%s\r\n", m_boundary, part.name,
+      (part.fileName != NULL) ? "; filename=\"" : "", (part.fileName != NULL) ? part.fileName : "", (part.fileName != NULL) ? "\"" : "",
+      (part.type != NULL) ? "Content-Type: " : "", (part.type != NULL) ? part.type : "", (part.type != NULL) ? "\r\n" : "");
+  if( (len < 0) || (len >= (int)maxLen) )
+  {
+    return -NET_TOOSMALL;
+  }
+  return len;
+}
+
+int HTTPMultipart::readContent(Part& part, char* buf, size_t len, size_t* pReadLen)
+{
+  switch(part.kind)
+  {
+  case PART_BUFFER:
+    memcpy(buf, part.data + m_offset, len);
+    *pReadLen = len;
+    return OK;
+  case PART_FILE:
+    if(m_fp == NULL)
+    {
+      m_fp = fopen(part.data, "rb");
+      if( (m_fp == NULL) || ((m_offset > 0) && (fseek(m_fp, m_offset, SEEK_SET) != 0)) )
+      {
+        WARN("Could not open %s", part.data);
+        return NET_NOTFOUND;
+      }
+    }
+    *pReadLen = fread(buf, 1, len, m_fp);
+    break;
+  case PART_STREAM:
+    {
+      int ret = part.pStream->read(buf, len, pReadLen);
+      if(ret != OK)
+      {
+        return ret;
+      }
+      *pReadLen = MIN(*pReadLen, len);
+    }
+    break;
+  }
+  if(*pReadLen == 0) //Shorter than announced, the Content-Length would be wrong
+  {
+    WARN("Part %s ended early", part.name);
+    return NET_EMPTY;
+  }
+  return OK;
+}
+
+void HTTPMultipart::closeFile()
+{
+  if(m_fp != NULL)
+  {
+    fclose(m_fp);
+    m_fp = NULL;
+  }
+}
@@ -0,0 +1,153 @@
+/* HTTPMultipart.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef HTTPMULTIPART_H_
+#define HTTPMULTIPART_H_
+
+#include "../IHTTPData.h"
+
+#include <cstdio>
+
+#define HTTPMULTIPART_TABLE_SIZE 8
+#define HTTPMULTIPART_BOUNDARY_LEN 26
+#define HTTPMULTIPART_HEADER_MAX_LEN 192 //Boundary line and headers of a part
+
+/** multipart/form-data encoder
+ * Used to upload files along with other fields in a POST request
+ * The body is generated piece by piece as it is sent, and its length is known in advance so that it is not chunked:
+ * the content of each part is read straight from memory, from a file or from another data source.
+ */
+class HTTPMultipart: public IHTTPDataOut
+{
+public:
+  /**
+   Instantiates HTTPMultipart with a new random boundary
+   It supports at most 8 parts
+   */
+  HTTPMultipart();
+  ~HTTPMultipart();
+
+  /** Add a text field
+   The references to the parameters must remain valid as long as the clear() function is not called
+   @param name Name of the field
+   @param value Value of the field
+   @return 0 on success, NET error on failure
+   */
+  int addField(const char* name, const char* value);
+
+  /** Add a file whose content is in memory
+   The references to the parameters must remain valid as long as the clear() function is not called
+   @param name Name of the field
+   @param fileName File name reported to the server, can be NULL
+   @param type Internet media type of the content, can be NULL
+   @param data Content
+   @param len Length of the content
+   @return 0 on success, NET error on failure
+   */
+  int addBuffer(const char* name, const char* fileName, const char* type, const char* data, size_t len);
+
+  /** Add a file, which is read as the request is sent
+   The references to the parameters must remain valid as long as the clear() function is not called
+   The file must not change until the request completes, as its length is determined here
+   @param name Name of the field
+   @param path Path of the file to open
+   @param fileName File name reported to the server, can be NULL
+   @param type Internet media type of the content, can be NULL
+   @return 0 on success, NET error on failure
+   */
+  int addFile(const char* name, const char* path, const char* fileName, const char* type);
+
+  /** Add a part read from another data source, which must not be chunked
+   The references to the parameters must remain valid as long as the clear() function is not called
+   @param name Name of the field
+   @param fileName File name reported to the server, can be NULL
+   @param type Internet media type of the content, can be NULL (the type of the data source is not used)
+   @param pData Data source
+   @return 0 on success, NET error on failure
+   */
+  int addStream(const char* name, const char* fileName, const char* type, IHTTPDataOut* pData);
+
+  /** Clear parts
+   */
+  void clear();
+
+protected:
+  //IHTTPDataOut
+  virtual int read(char* buf, size_t len, size_t* pReadLen);
+
+  virtual int getDataType(char* type, size_t maxTypeLen); //Internet media type for Content-Type header
+
+  virtual bool getIsChunked(); //For Transfer-Encoding header
+
+  virtual size_t getDataLen(); //For Content-Length header
+
+  virtual bool rewind(); //To send the data again on a redirection
+
+private:
+  enum PART_KIND
+  {
+    PART_BUFFER,
+    PART_FILE,
+    PART_STREAM
+  };
+
+  struct Part
+  {
+    PART_KIND kind;
+    const char* name;
+    const char* fileName;
+    const char* type;
+    const char* data; //Content or path of the file
+    IHTTPDataOut* pStream;
+    size_t len;
+    size_t headerLen;
+  };
+
+  enum STAGE
+  {
+    STAGE_HEADER,
+    STAGE_CONTENT,
+    STAGE_TRAILER, //CRLF ending the content
+    STAGE_CLOSE, //Closing boundary
+    STAGE_DONE
+  };
+
+  int add(PART_KIND kind, const char* name, const char* fileName, const char* type, const char* data, IHTTPDataOut* pStream, size_t len);
+  int formatHeader(const Part& part, char* buf, size_t maxLen);
+  int readContent(Part& part, char* buf, size_t len, size_t* pReadLen);
+  void closeFile();
+
+  Part m_parts[HTTPMULTIPART_TABLE_SIZE];
+  size_t m_count;
+  char m_boundary[HTTPMULTIPART_BOUNDARY_LEN + 1];
+
+  //Position in the body
+  size_t m_part;
+  STAGE m_stage;
+  size_t m_offset; //In the current stage
+  char m_header[HTTPMULTIPART_HEADER_MAX_LEN];
+  FILE* m_fp;
+};
+
+#endif /* HTTPMULTIPART_H_ */
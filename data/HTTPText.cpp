@@ -21,6 +21,14 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPText.cpp"
+#endif
+
 #include "core/fwk.h"
 
 #include "HTTPText.h"
@@ -63,6 +71,12 @@ HTTPText::HTTPText(char* str, size_t size) : m_str(str), m_size(size), m_pos(0)
   return m_size - 1;
 }
 
+/*virtual*/ bool HTTPText::rewind()
+{
+  m_pos = 0;
+  return true;
+}
+
 //IHTTPDataOut
 /*virtual*/ int HTTPText::write(const char* buf, size_t len)
 {
@@ -53,6 +53,8 @@ protected:
 
   virtual size_t getDataLen(); //For Content-Length header
 
+  virtual bool rewind(); //To send the data again on a redirection
+
   //IHTTPDataOut
   virtual int write(const char* buf, size_t len);
 
@@ -0,0 +1,1203 @@
+/* HTTP2Connection.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTP2Connection.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTP2Connection.h"
+#include "../util/HTTPTime.h"
+
+#include <cstring>
+#include <cstdio>
+
+//Frame types
+#define H2_DATA 0x0
+#define H2_HEADERS 0x1
+#define H2_PRIORITY 0x2
+#define H2_RST_STREAM 0x3
+#define H2_SETTINGS 0x4
+#define H2_PUSH_PROMISE 0x5
+#define H2_PING 0x6
+#define H2_GOAWAY 0x7
+#define H2_WINDOW_UPDATE 0x8
+#define H2_CONTINUATION 0x9
+
+//Frame flags
+#define H2_FLAG_END_STREAM 0x1
+#define H2_FLAG_ACK 0x1
+#define H2_FLAG_END_HEADERS 0x4
+#define H2_FLAG_PADDED 0x8
+#define H2_FLAG_PRIORITY 0x20
+
+//Settings
+#define H2_SETTINGS_HEADER_TABLE_SIZE 0x1
+#define H2_SETTINGS_ENABLE_PUSH 0x2
+#define H2_SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define H2_SETTINGS_INITIAL_WINDOW_SIZE 0x4
+#define H2_SETTINGS_MAX_FRAME_SIZE 0x5
+
+//Error codes
+#define H2_NO_ERROR 0x0
+#define H2_PROTOCOL_ERROR 0x1
+#define H2_INTERNAL_ERROR 0x2
+#define H2_FLOW_CONTROL_ERROR 0x3
+#define H2_FRAME_SIZE_ERROR 0x6
+#define H2_REFUSED_STREAM 0x7
+#define H2_CANCEL 0x8
+#define H2_COMPRESSION_ERROR 0x9
+
+#define H2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define H2_DEFAULT_WINDOW_SIZE 65535
+#define H2_DEFAULT_MAX_FRAME_SIZE 16384 //Also the largest frame the server may send, as no other size is advertised
+#define H2_MAX_WINDOW_SIZE 0x7FFFFFFF
+#define H2_HPACK_FIELD_OVERHEAD 12 //Upper bound of the prefixes of a literal header, for lengths below 2^21
+
+static uint32_t get32(const char* buf)
+{
+  const uint8_t* p = (const uint8_t*)buf;
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void put32(char* buf, uint32_t value)
+{
+  buf[0] = (char)(value >> 24);
+  buf[1] = (char)(value >> 16);
+  buf[2] = (char)(value >> 8);
+  buf[3] = (char)value;
+}
+
+HTTP2Connection::HTTP2Connection() : m_pTransport(&m_defaultTransport), m_timeout(HTTP_CLIENT_DEFAULT_TIMEOUT), m_open(false), m_pFirst(NULL)
+{
+  m_authority[0] = '\0';
+  reset();
+}
+
+HTTP2Connection::HTTP2Connection(IHTTPTransport* pTransport) : m_pTransport(pTransport), m_timeout(HTTP_CLIENT_DEFAULT_TIMEOUT), m_open(false), m_pFirst(NULL)
+{
+  m_authority[0] = '\0';
+  reset();
+}
+
+HTTP2Connection::~HTTP2Connection()
+{
+  close();
+}
+
+int HTTP2Connection::open(const char* url, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/)
+{
+  HTTPEndpoint endpoint;
+  int ret = endpoint.setUrl(url);
+  if(ret != OK)
+  {
+    ERR("Invalid URL %s (%d)", url, ret);
+    return ret;
+  }
+  return open(endpoint, timeout);
+}
+
+int HTTP2Connection::open(HTTPEndpoint& endpoint, uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/)
+{
+  close();
+  if( endpoint.isSecure() )
+  {
+    ERR("HTTP/2 is only supported over cleartext connections (https needs ALPN)");
+    return NET_INVALID;
+  }
+  m_timeout = timeout;
+
+  //Resolve DNS if needed
+  bool cached = endpoint.isResolved();
+  if( !cached && (endpoint.resolve(m_pTransport) != OK) )
+  {
+    return NET_NOTFOUND;
+  }
+
+  //Connect to any of the addresses of the host
+  size_t index;
+  int ret = m_pTransport->connectAny(endpoint.getAddresses(), endpoint.getAddressCount(), m_timeout, &index);
+  if( (ret != OK) && cached )
+  {
+    //The addresses of the host may have changed since it was resolved
+    WARN("Could not connect to cached address, resolving %s again", endpoint.getHost());
+    if(endpoint.resolve(m_pTransport) != OK)
+    {
+      return NET_NOTFOUND;
+    }
+    ret = m_pTransport->connectAny(endpoint.getAddresses(), endpoint.getAddressCount(), m_timeout, &index);
+  }
+  if(ret != OK)
+  {
+    ERR("Could not connect");
+    return NET_CONN;
+  }
+  endpoint.setPreferredAddress(index); //Tried first next time
+
+  snprintf(m_authority, sizeof(m_authority), "%s", endpoint.getAuthority());
+
+  //The preface and settings are sent at once, requests do not need to wait for the settings of the server
+  reset();
+  memcpy(m_txBuf, H2_PREFACE, strlen(H2_PREFACE));
+  m_txLen = strlen(H2_PREFACE);
+  char settings[3 * 6];
+  const uint32_t values[3][2] = { { H2_SETTINGS_HEADER_TABLE_SIZE, HTTP_HPACK_TABLE_SIZE }, { H2_SETTINGS_ENABLE_PUSH, 0 }, { H2_SETTINGS_INITIAL_WINDOW_SIZE, HTTP2_WINDOW_SIZE } };
+  for(int i = 0; i < 3; i++)
+  {
+    settings[i * 6] = (char)(values[i][0] >> 8);
+    settings[i * 6 + 1] = (char)values[i][0];
+    put32(&settings[i * 6 + 2], values[i][1]);
+  }
+  m_open = true;
+  ret = sendControl(H2_SETTINGS, 0, 0, settings, sizeof(settings));
+  if( (ret == OK) && (HTTP2_WINDOW_SIZE > H2_DEFAULT_WINDOW_SIZE) ) //The window of the connection can only be changed this way
+  {
+    ret = sendWindowUpdate(0, HTTP2_WINDOW_SIZE - H2_DEFAULT_WINDOW_SIZE);
+  }
+  if(ret == OK) ret = flush();
+  if(ret != OK)
+  {
+    ERR("Could not send the connection preface");
+    m_pTransport->close();
+    m_open = false;
+    return NET_CONN;
+  }
+  DBG("Connected to %s", m_authority);
+  return OK;
+}
+
+int HTTP2Connection::run(uint32_t timeout /*= HTTP_CLIENT_DEFAULT_TIMEOUT*/) //Blocking
+{
+  if(!m_open)
+  {
+    close(); //Fail the requests started before
+    return NET_CLOSED;
+  }
+  m_timeout = timeout;
+  while(m_pFirst != NULL)
+  {
+    int ret = send();
+    if(ret != OK)
+    {
+      return fail(ret, H2_INTERNAL_ERROR);
+    }
+    if(m_pFirst == NULL)
+    {
+      break;
+    }
+    //Everything that could be sent was sent, wait for the server
+    ret = recv(timeout);
+    if(ret == NET_TIMEOUT)
+    {
+      WARN("Server did not answer in time");
+      while(m_pFirst != NULL)
+      {
+        cancel(m_pFirst, NET_TIMEOUT);
+      }
+      flush();
+      return NET_TIMEOUT;
+    }
+    if(ret != OK)
+    {
+      return ret; //The connection was closed
+    }
+  }
+  if(m_goAway)
+  {
+    DBG("Closing the connection as the server is going away");
+    close();
+    return OK;
+  }
+  int ret = flush(); //Acknowledgements
+  if(ret != OK)
+  {
+    return fail(ret, H2_INTERNAL_ERROR);
+  }
+  return OK;
+}
+
+void HTTP2Connection::close()
+{
+  if(m_open)
+  {
+    char payload[8];
+    put32(&payload[0], 0); //No stream was initiated by the server
+    put32(&payload[4], H2_NO_ERROR);
+    if( sendControl(H2_GOAWAY, 0, 0, payload, sizeof(payload)) == OK )
+    {
+      flush();
+    }
+    m_pTransport->close();
+    m_open = false;
+  }
+  while(m_pFirst != NULL)
+  {
+    complete(m_pFirst, NET_CLOSED);
+  }
+}
+
+bool HTTP2Connection::isOpen()
+{
+  return m_open && !m_goAway;
+}
+
+/*virtual*/ void HTTP2Connection::onHeader(const HTTPStringView& name, const HTTPStringView& value)
+{
+  HTTP2Request* pRequest = m_pHeaderRequest;
+  if( (pRequest == NULL) || pRequest->m_responseStarted ) //Trailers are ignored
+  {
+    return;
+  }
+  if( name.equalsNoCase(":status") )
+  {
+    int code = 0;
+    if(value.len == 3)
+    {
+      for(size_t i = 0; i < 3; i++)
+      {
+        code = ((value.ptr[i] >= '0') && (value.ptr[i] <= '9') && (code >= 0)) ? (code * 10 + (value.ptr[i] - '0')) : -1;
+      }
+    }
+    pRequest->m_httpResponseCode = (code > 0) ? code : 0;
+  }
+  else if( (pRequest->m_httpResponseCode == 200) && (pRequest->m_pDataIn != NULL) ) //The body of an error response is discarded
+  {
+    if( name.equalsNoCase("content-length") )
+    {
+      size_t len = 0;
+      size_t i;
+      for(i = 0; (i < value.len) && (value.ptr[i] >= '0') && (value.ptr[i] <= '9'); i++)
+      {
+        len = len * 10 + (value.ptr[i] - '0');
+      }
+      if( (i == value.len) && (i > 0) )
+      {
+        pRequest->m_pDataIn->setDataLen(len);
+        pRequest->m_lengthSet = true;
+      }
+    }
+    else if( name.equalsNoCase("content-type") )
+    {
+      char type[64];
+      size_t len = MIN(value.len, sizeof(type) - 1);
+      memcpy(type, value.ptr, len);
+      type[len] = '\0';
+      pRequest->m_pDataIn->setDataType(type);
+    }
+  }
+}
+
+void HTTP2Connection::reset()
+{
+  m_goAway = false;
+  m_nextStreamId = 1;
+  m_activeStreams = 0;
+  m_maxStreams = 0xFFFFFFFF; //Unlimited until the server tells otherwise
+  m_maxFrameSize = H2_DEFAULT_MAX_FRAME_SIZE;
+  m_initialWindow = H2_DEFAULT_WINDOW_SIZE;
+  m_sendWindow = H2_DEFAULT_WINDOW_SIZE;
+  m_recvWindow = HTTP2_WINDOW_SIZE;
+  m_recvConsumed = 0;
+  m_inFrame = false;
+  m_frameLen = 0;
+  m_frameType = 0;
+  m_frameFlags = 0;
+  m_frameStreamId = 0;
+  m_padLen = 0;
+  m_skipLen = 0;
+  m_blockStreamId = 0;
+  m_blockLen = 0;
+  m_blockEndStream = false;
+  m_pHeaderRequest = NULL;
+  m_encoder = HTTPHpackEncoder();
+  m_decoder = HTTPHpackDecoder();
+  m_txLen = 0;
+  m_rxPos = 0;
+  m_rxLen = 0;
+}
+
+int HTTP2Connection::start(HTTP2Request* pRequest)
+{
+  if( !isOpen() )
+  {
+    ERR("Connection is not open");
+    return NET_CLOSED;
+  }
+  pRequest->m_state = HTTP2Request::STATE_QUEUED;
+  pRequest->m_pNext = NULL;
+  HTTP2Request** ppLast = &m_pFirst;
+  while(*ppLast != NULL)
+  {
+    ppLast = &(*ppLast)->m_pNext;
+  }
+  *ppLast = pRequest;
+  return OK;
+}
+
+void HTTP2Connection::cancel(HTTP2Request* pRequest, int result)
+{
+  if( m_open && (pRequest->m_state == HTTP2Request::STATE_OPEN) )
+  {
+    char payload[4];
+    put32(payload, H2_CANCEL);
+    sendControl(H2_RST_STREAM, 0, pRequest->m_streamId, payload, sizeof(payload)); //Sent with the next frames
+  }
+  complete(pRequest, result);
+}
+
+void HTTP2Connection::complete(HTTP2Request* pRequest, int result)
+{
+  HTTP2Request** ppRequest = &m_pFirst;
+  while( (*ppRequest != NULL) && (*ppRequest != pRequest) )
+  {
+    ppRequest = &(*ppRequest)->m_pNext;
+  }
+  if(*ppRequest != NULL)
+  {
+    *ppRequest = pRequest->m_pNext;
+  }
+  if(pRequest->m_state == HTTP2Request::STATE_OPEN)
+  {
+    m_activeStreams--;
+  }
+  if(m_pHeaderRequest == pRequest)
+  {
+    m_pHeaderRequest = NULL;
+  }
+  pRequest->m_pNext = NULL;
+  pRequest->m_state = HTTP2Request::STATE_DONE;
+  pRequest->m_result = result;
+  DBG("Stream %d completed (%d)", pRequest->m_streamId, result);
+}
+
+HTTP2Request* HTTP2Connection::find(uint32_t streamId)
+{
+  for(HTTP2Request* pRequest = m_pFirst; pRequest != NULL; pRequest = pRequest->m_pNext)
+  {
+    if( (pRequest->m_state == HTTP2Request::STATE_OPEN) && (pRequest->m_streamId == streamId) )
+    {
+      return pRequest;
+    }
+  }
+  return NULL; //Completed or reset
+}
+
+int HTTP2Connection::send() //Start queued requests and send data as the windows allow
+{
+  HTTP2Request* pNext;
+  int ret;
+  for(HTTP2Request* pRequest = m_pFirst; pRequest != NULL; pRequest = pNext)
+  {
+    pNext = pRequest->m_pNext;
+    if( (pRequest->m_state == HTTP2Request::STATE_QUEUED) && (m_activeStreams < m_maxStreams) )
+    {
+      ret = sendHeaders(pRequest);
+      if(ret != OK)
+      {
+        return ret;
+      }
+    }
+  }
+
+  //The requests take turns, one frame each
+  bool sent = true;
+  while(sent)
+  {
+    sent = false;
+    for(HTTP2Request* pRequest = m_pFirst; pRequest != NULL; pRequest = pNext)
+    {
+      pNext = pRequest->m_pNext;
+      if( (pRequest->m_state == HTTP2Request::STATE_OPEN) && !pRequest->m_endSent )
+      {
+        bool requestSent;
+        ret = sendData(pRequest, &requestSent);
+        if(ret != OK)
+        {
+          return ret;
+        }
+        sent = sent || requestSent;
+      }
+    }
+  }
+  return flush();
+}
+
+int HTTP2Connection::sendHeaders(HTTP2Request* pRequest)
+{
+  const char* fields[2 * 6];
+  size_t count = 0;
+  fields[count++] = ":method";
+  fields[count++] = pRequest->m_meth;
+  fields[count++] = ":scheme";
+  fields[count++] = "http";
+  fields[count++] = ":authority";
+  fields[count++] = m_authority;
+  fields[count++] = ":path";
+  fields[count++] = pRequest->m_path;
+  char type[64];
+  char length[12];
+  size_t lengthIndex = 0;
+  IHTTPDataOut* pDataOut = pRequest->m_pDataOut;
+  if(pDataOut != NULL)
+  {
+    if( pDataOut->getDataType(type, sizeof(type)) == OK )
+    {
+      fields[count++] = "content-type";
+      fields[count++] = type;
+    }
+    if( !pDataOut->getIsChunked() )
+    {
+      snprintf(length, sizeof(length), "%u", (unsigned int)pDataOut->getDataLen());
+      lengthIndex = count;
+      fields[count++] = "content-length";
+      fields[count++] = length;
+    }
+  }
+
+  //The block must fit before it is encoded, as the encoder tables cannot go back
+  size_t maxLen = 2 * H2_HPACK_FIELD_OVERHEAD; //Table size updates
+  for(size_t i = 0; i < count; i += 2)
+  {
+    maxLen += strlen(fields[i]) + strlen(fields[i + 1]) + H2_HPACK_FIELD_OVERHEAD;
+  }
+  for(size_t i = 0; i < 2 * pRequest->m_headersCount; i += 2)
+  {
+    maxLen += strlen(pRequest->m_headers[i]) + strlen(pRequest->m_headers[i + 1]) + H2_HPACK_FIELD_OVERHEAD;
+  }
+  if(maxLen > HTTP2_BUFFER_SIZE - HTTP2_FRAME_HEADER_LEN)
+  {
+    ERR("Headers too long");
+    complete(pRequest, NET_TOOSMALL);
+    return OK;
+  }
+
+  char* payload = beginFrame(maxLen);
+  if(payload == NULL)
+  {
+    return NET_CONN;
+  }
+  int ret = m_encoder.begin(payload, maxLen);
+  for(size_t i = 0; (i < count) && (ret == OK); i += 2)
+  {
+    //The length changes with each request, it would only fill the tables
+    ret = m_encoder.add(fields[i], strlen(fields[i]), fields[i + 1], strlen(fields[i + 1]), ((lengthIndex != 0) && (i == lengthIndex)) ? HTTP_HPACK_NO_INDEX : HTTP_HPACK_INDEX);
+  }
+  for(size_t i = 0; (i < 2 * pRequest->m_headersCount) && (ret == OK); i += 2)
+  {
+    ret = m_encoder.add(pRequest->m_headers[i], strlen(pRequest->m_headers[i]), pRequest->m_headers[i + 1], strlen(pRequest->m_headers[i + 1]));
+  }
+  if(ret != OK)
+  {
+    ERR("Could not encode headers (%d)", ret);
+    return ret; //The tables of the server are out of sync
+  }
+
+  pRequest->m_streamId = m_nextStreamId;
+  m_nextStreamId += 2;
+  uint8_t flags = H2_FLAG_END_HEADERS;
+  if(pDataOut == NULL)
+  {
+    flags |= H2_FLAG_END_STREAM;
+    pRequest->m_endSent = true;
+  }
+  endFrame(H2_HEADERS, flags, pRequest->m_streamId, (int)m_encoder.getLength());
+  DBG("%s %s on stream %d (%d bytes of headers)", pRequest->m_meth, pRequest->m_path, pRequest->m_streamId, (int)m_encoder.getLength());
+
+  pRequest->m_state = HTTP2Request::STATE_OPEN;
+  pRequest->m_sendWindow = m_initialWindow;
+  pRequest->m_recvWindow = HTTP2_WINDOW_SIZE;
+  pRequest->m_recvConsumed = 0;
+  m_activeStreams++;
+  if(m_nextStreamId > H2_MAX_WINDOW_SIZE)
+  {
+    WARN("No stream identifier left");
+    m_goAway = true;
+  }
+  return OK;
+}
+
+int HTTP2Connection::sendData(HTTP2Request* pRequest, bool* pSent)
+{
+  *pSent = false;
+  IHTTPDataOut* pDataOut = pRequest->m_pDataOut;
+  bool chunked = pDataOut->getIsChunked();
+  size_t left = 0;
+  if(!chunked)
+  {
+    left = (pDataOut->getDataLen() > pRequest->m_writtenLen) ? (pDataOut->getDataLen() - pRequest->m_writtenLen) : 0;
+  }
+  bool end = !chunked && (left == 0);
+  size_t len = 0;
+  char* payload;
+  if(end)
+  {
+    payload = beginFrame(0);
+    if(payload == NULL)
+    {
+      return NET_CONN;
+    }
+  }
+  else
+  {
+    int32_t window = MIN(m_sendWindow, pRequest->m_sendWindow);
+    if(window <= 0)
+    {
+      return OK; //Wait for a WINDOW_UPDATE
+    }
+    len = MIN((size_t)window, (size_t)m_maxFrameSize);
+    len = MIN(len, (size_t)(HTTP2_BUFFER_SIZE - HTTP2_FRAME_HEADER_LEN));
+    if(!chunked)
+    {
+      len = MIN(len, left);
+    }
+    //Fill the room left in the buffer, unless it is too small to be worth a frame
+    size_t room = (m_txLen + HTTP2_FRAME_HEADER_LEN < HTTP2_BUFFER_SIZE) ? (HTTP2_BUFFER_SIZE - HTTP2_FRAME_HEADER_LEN - m_txLen) : 0;
+    if( (room < len) && (room < HTTP2_BUFFER_SIZE / 4) )
+    {
+      int ret = flush();
+      if(ret != OK)
+      {
+        return ret;
+      }
+      room = HTTP2_BUFFER_SIZE - HTTP2_FRAME_HEADER_LEN;
+    }
+    len = MIN(len, room);
+    payload = m_txBuf + m_txLen + HTTP2_FRAME_HEADER_LEN;
+
+    size_t readLen;
+    int ret = pDataOut->read(payload, len, &readLen);
+    if(ret != OK)
+    {
+      ERR("Could not read data to send (%d)", ret);
+      cancel(pRequest, ret);
+      return OK;
+    }
+    if(readLen == 0)
+    {
+      if(!chunked)
+      {
+        ERR("Data shorter than its length");
+        cancel(pRequest, NET_INVALID);
+        return OK;
+      }
+      end = true; //Last chunk
+    }
+    len = MIN(readLen, len);
+    end = end || (!chunked && (len == left));
+  }
+
+  endFrame(H2_DATA, end ? H2_FLAG_END_STREAM : 0, pRequest->m_streamId, len);
+  m_sendWindow -= len;
+  pRequest->m_sendWindow -= len;
+  pRequest->m_writtenLen += len;
+  pRequest->m_endSent = end;
+  *pSent = true;
+  return OK;
+}
+
+char* HTTP2Connection::beginFrame(size_t len) //Room for a frame of len bytes in the send buffer, flushing it if needed
+{
+  if( m_txLen + HTTP2_FRAME_HEADER_LEN + len > HTTP2_BUFFER_SIZE )
+  {
+    if(flush() != OK)
+    {
+      return NULL;
+    }
+  }
+  return m_txBuf + m_txLen + HTTP2_FRAME_HEADER_LEN;
+}
+
+void HTTP2Connection::endFrame(uint8_t type, uint8_t flags, uint32_t streamId, size_t len)
+{
+  char* header = m_txBuf + m_txLen;
+  header[0] = (char)(len >> 16);
+  header[1] = (char)(len >> 8);
+  header[2] = (char)len;
+  header[3] = (char)type;
+  header[4] = (char)flags;
+  put32(&header[5], streamId);
+  m_txLen += HTTP2_FRAME_HEADER_LEN + len;
+}
+
+int HTTP2Connection::sendControl(uint8_t type, uint8_t flags, uint32_t streamId, const char* payload, size_t len)
+{
+  char* buf = beginFrame(len);
+  if(buf == NULL)
+  {
+    return NET_CONN;
+  }
+  if(len > 0)
+  {
+    memcpy(buf, payload, len);
+  }
+  endFrame(type, flags, streamId, len);
+  return OK;
+}
+
+int HTTP2Connection::sendWindowUpdate(uint32_t streamId, uint32_t increment)
+{
+  char payload[4];
+  put32(payload, increment);
+  return sendControl(H2_WINDOW_UPDATE, 0, streamId, payload, sizeof(payload));
+}
+
+int HTTP2Connection::flush()
+{
+  if(m_txLen == 0)
+  {
+    return OK;
+  }
+  size_t len = m_txLen;
+  m_txLen = 0;
+  if( m_pTransport->write(m_txBuf, len, m_timeout) != OK )
+  {
+    ERR("Could not send %d bytes", (int)len);
+    return NET_CONN;
+  }
+  return OK;
+}
+
+int HTTP2Connection::recv(uint32_t timeout) //Read what the server sent and process all the frames read
+{
+  size_t readLen;
+  int ret = m_pTransport->read(m_rxBuf + m_rxLen, 1, HTTP2_BUFFER_SIZE - m_rxLen, &readLen, timeout);
+  m_rxLen += readLen;
+  if( (ret == NET_TIMEOUT) && (readLen == 0) )
+  {
+    return NET_TIMEOUT;
+  }
+  if(ret != OK)
+  {
+    ERR("Connection lost (%d)", ret);
+    return fail(NET_CONN, H2_NO_ERROR);
+  }
+  return parse();
+}
+
+int HTTP2Connection::parse() //Process the frames in the receive buffer
+{
+  int ret = OK;
+  while( (ret == OK) && m_open )
+  {
+    const char* buf = m_rxBuf + m_rxPos;
+    size_t avail = m_rxLen - m_rxPos;
+    if(m_skipLen > 0)
+    {
+      size_t len = MIN(avail, (size_t)m_skipLen);
+      m_rxPos += len;
+      m_skipLen -= len;
+      if(m_skipLen > 0)
+      {
+        break;
+      }
+    }
+    else if(!m_inFrame)
+    {
+      if(avail < HTTP2_FRAME_HEADER_LEN)
+      {
+        break;
+      }
+      size_t prefixLen = 0; //Padding length and priority, taken with the header
+      uint8_t flags = buf[4];
+      if( (buf[3] == H2_DATA) || (buf[3] == H2_HEADERS) )
+      {
+        prefixLen = ((flags & H2_FLAG_PADDED) ? 1 : 0) + (((buf[3] == H2_HEADERS) && (flags & H2_FLAG_PRIORITY)) ? 5 : 0);
+      }
+      size_t frameLen = ((uint8_t)buf[0] << 16) | ((uint8_t)buf[1] << 8) | (uint8_t)buf[2];
+      if( avail < HTTP2_FRAME_HEADER_LEN + MIN(prefixLen, frameLen) )
+      {
+        break;
+      }
+      ret = processFrameHeader(buf);
+      m_rxPos += HTTP2_FRAME_HEADER_LEN + MIN(prefixLen, frameLen);
+    }
+    else if( (m_frameType == H2_DATA) || (m_frameType == H2_HEADERS) || (m_frameType == H2_CONTINUATION) )
+    {
+      size_t len = MIN(avail, (size_t)m_frameLen);
+      if( (len == 0) && (m_frameLen > 0) )
+      {
+        break;
+      }
+      if(m_frameType == H2_DATA)
+      {
+        ret = processData(buf, len);
+      }
+      else if(m_blockLen + len <= sizeof(m_block))
+      {
+        memcpy(m_block + m_blockLen, buf, len);
+        m_blockLen += len;
+      }
+      else
+      {
+        ERR("Header block too long");
+        ret = fail(NET_TOOSMALL, H2_INTERNAL_ERROR); //The decoder cannot follow the tables of the server any more
+        break;
+      }
+      m_rxPos += len;
+      m_frameLen -= len;
+      if( (ret == OK) && (m_frameLen == 0) )
+      {
+        m_inFrame = false;
+        m_skipLen = m_padLen;
+        if(m_frameType == H2_DATA)
+        {
+          if(m_frameFlags & H2_FLAG_END_STREAM)
+          {
+            HTTP2Request* pRequest = find(m_frameStreamId);
+            if(pRequest != NULL)
+            {
+              finish(pRequest);
+            }
+          }
+        }
+        else if(m_frameFlags & H2_FLAG_END_HEADERS)
+        {
+          ret = processHeaders();
+        }
+      }
+    }
+    else
+    {
+      //The beginning of frames too long for the buffer is enough (e.g. GOAWAY with debug data)
+      size_t len = MIN((size_t)m_frameLen, (size_t)HTTP2_BUFFER_SIZE);
+      if(avail < len)
+      {
+        break;
+      }
+      ret = processFrame(buf, len);
+      m_rxPos += len;
+      m_skipLen = m_frameLen - len;
+      m_inFrame = false;
+    }
+  }
+  memmove(m_rxBuf, m_rxBuf + m_rxPos, m_rxLen - m_rxPos);
+  m_rxLen -= m_rxPos;
+  m_rxPos = 0;
+  return ret;
+}
+
+int HTTP2Connection::processFrameHeader(const char* buf) //Frame header, followed by the padding length and priority if any
+{
+  m_frameLen = ((uint8_t)buf[0] << 16) | ((uint8_t)buf[1] << 8) | (uint8_t)buf[2];
+  m_frameType = buf[3];
+  m_frameFlags = buf[4];
+  m_frameStreamId = get32(&buf[5]) & 0x7FFFFFFF;
+  m_padLen = 0;
+  m_inFrame = true;
+  if(m_frameLen > H2_DEFAULT_MAX_FRAME_SIZE)
+  {
+    ERR("Frame too long (%d bytes)", m_frameLen);
+    return fail(NET_PROTOCOL, H2_FRAME_SIZE_ERROR);
+  }
+  if( (m_blockStreamId != 0) != ((m_frameType == H2_CONTINUATION) && (m_frameStreamId == m_blockStreamId)) )
+  {
+    ERR("Header block interrupted");
+    return fail(NET_PROTOCOL, H2_PROTOCOL_ERROR);
+  }
+  if( (m_frameType != H2_DATA) && (m_frameType != H2_HEADERS) )
+  {
+    return OK;
+  }
+  if(m_frameStreamId == 0)
+  {
+    ERR("Frame without stream");
+    return fail(NET_PROTOCOL, H2_PROTOCOL_ERROR);
+  }
+
+  //Padding and priority
+  uint32_t totalLen = m_frameLen;
+  uint32_t prefixLen = (m_frameFlags & H2_FLAG_PADDED) ? 1 : 0;
+  if(m_frameFlags & H2_FLAG_PADDED)
+  {
+    m_padLen = (uint8_t)buf[HTTP2_FRAME_HEADER_LEN];
+  }
+  if( (m_frameType == H2_HEADERS) && (m_frameFlags & H2_FLAG_PRIORITY) )
+  {
+    prefixLen += 5;
+  }
+  if(prefixLen + m_padLen > m_frameLen)
+  {
+    ERR("Invalid padding");
+    return fail(NET_PROTOCOL, H2_PROTOCOL_ERROR);
+  }
+  m_frameLen -= prefixLen + m_padLen;
+
+  if(m_frameType == H2_HEADERS)
+  {
+    m_blockStreamId = m_frameStreamId;
+    m_blockLen = 0;
+    m_blockEndStream = (m_frameFlags & H2_FLAG_END_STREAM) != 0;
+    return OK;
+  }
+
+  //The whole DATA frame counts against the windows, including the padding
+  if( (int32_t)totalLen > m_recvWindow )
+  {
+    ERR("Flow control window exceeded");
+    return fail(NET_PROTOCOL, H2_FLOW_CONTROL_ERROR);
+  }
+  m_recvWindow -= totalLen;
+  HTTP2Request* pRequest = find(m_frameStreamId);
+  if(pRequest != NULL)
+  {
+    if( (int32_t)totalLen > pRequest->m_recvWindow )
+    {
+      ERR("Flow control window of stream %d exceeded", m_frameStreamId);
+      cancel(pRequest, NET_PROTOCOL);
+      pRequest = NULL;
+    }
+    else if(!pRequest->m_responseStarted)
+    {
+      ERR("Data before the response headers on stream %d", m_frameStreamId);
+      cancel(pRequest, NET_PROTOCOL);
+      pRequest = NULL;
+    }
+    else
+    {
+      pRequest->m_recvWindow -= totalLen;
+    }
+  }
+  return consume(pRequest, prefixLen + m_padLen);
+}
+
+int HTTP2Connection::processData(const char* buf, size_t len)
+{
+  HTTP2Request* pRequest = find(m_frameStreamId);
+  if( (pRequest != NULL) && (pRequest->m_httpResponseCode == 200) && (pRequest->m_pDataIn != NULL) && (len > 0) )
+  {
+    int ret = writeData(pRequest, buf, len);
+    if(ret != OK)
+    {
+      cancel(pRequest, (ret == HTTP_DATA_ENOUGH) ? OK : (ret == HTTP_DATA_ABORT) ? NET_ABORT : ret);
+      pRequest = NULL;
+    }
+  }
+  return consume(pRequest, len);
+}
+
+int HTTP2Connection::processHeaders() //Complete header block
+{
+  HTTP2Request* pRequest = find(m_blockStreamId);
+  m_blockStreamId = 0;
+  //Blocks of reset streams are decoded all the same, to keep the tables in sync
+  m_pHeaderRequest = pRequest;
+  int ret = m_decoder.decode(m_block, m_blockLen, this);
+  m_pHeaderRequest = NULL;
+  if(ret != OK)
+  {
+    ERR("Could not decode header block (%d)", ret);
+    return fail(NET_PROTOCOL, H2_COMPRESSION_ERROR);
+  }
+  if(pRequest == NULL)
+  {
+    return OK;
+  }
+
+  if(!pRequest->m_responseStarted)
+  {
+    int code = pRequest->m_httpResponseCode;
+    if( (code >= 100) && (code < 200) )
+    {
+      DBG("Interim response %d", code);
+      return OK;
+    }
+    if( (code < 200) || (code > 999) )
+    {
+      ERR("Invalid response status on stream %d", pRequest->m_streamId);
+      cancel(pRequest, NET_PROTOCOL);
+      return OK;
+    }
+    pRequest->m_responseStarted = true;
+    if(code != 200)
+    {
+      WARN("Response code %d", code);
+    }
+    else if( (pRequest->m_pDataIn != NULL) && !pRequest->m_lengthSet )
+    {
+      pRequest->m_pDataIn->setIsChunked(true); //Length unknown, the data comes in frames
+    }
+  }
+  if(m_blockEndStream)
+  {
+    finish(pRequest);
+  }
+  return OK;
+}
+
+void HTTP2Connection::finish(HTTP2Request* pRequest) //END_STREAM received
+{
+  int result = (pRequest->m_responseStarted && (pRequest->m_httpResponseCode == 200)) ? OK : NET_PROTOCOL;
+  if(!pRequest->m_endSent)
+  {
+    cancel(pRequest, result); //The server does not need the rest of the data
+  }
+  else
+  {
+    complete(pRequest, result);
+  }
+}
+
+int HTTP2Connection::processFrame(const char* payload, size_t len) //Frame other than DATA, HEADERS and CONTINUATION, complete
+{
+  HTTP2Request* pRequest;
+  HTTP2Request* pNext;
+  switch(m_frameType)
+  {
+  case H2_SETTINGS:
+    return processSettings(payload, len);
+  case H2_PING:
+    if( (m_frameLen != 8) || (m_frameStreamId != 0) )
+    {
+      ERR("Invalid PING frame");
+      return fail(NET_PROTOCOL, H2_FRAME_SIZE_ERROR);
+    }
+    if( !(m_frameFlags & H2_FLAG_ACK) )
+    {
+      return sendControl(H2_PING, H2_FLAG_ACK, 0, payload, len);
+    }
+    return OK;
+  case H2_WINDOW_UPDATE:
+    if(m_frameLen != 4)
+    {
+      ERR("Invalid WINDOW_UPDATE frame");
+      return fail(NET_PROTOCOL, H2_FRAME_SIZE_ERROR);
+    }
+    if(m_frameStreamId == 0)
+    {
+      uint32_t increment = get32(payload) & 0x7FFFFFFF;
+      if( (increment == 0) || ((int64_t)m_sendWindow + increment > H2_MAX_WINDOW_SIZE) )
+      {
+        ERR("Invalid window update");
+        return fail(NET_PROTOCOL, (increment == 0) ? H2_PROTOCOL_ERROR : H2_FLOW_CONTROL_ERROR);
+      }
+      m_sendWindow += increment;
+    }
+    else if( (pRequest = find(m_frameStreamId)) != NULL )
+    {
+      uint32_t increment = get32(payload) & 0x7FFFFFFF;
+      if( (increment == 0) || ((int64_t)pRequest->m_sendWindow + increment > H2_MAX_WINDOW_SIZE) )
+      {
+        ERR("Invalid window update on stream %d", m_frameStreamId);
+        cancel(pRequest, NET_PROTOCOL);
+        return OK;
+      }
+      pRequest->m_sendWindow += increment;
+    }
+    return OK;
+  case H2_RST_STREAM:
+    if( (m_frameLen != 4) || (m_frameStreamId == 0) )
+    {
+      ERR("Invalid RST_STREAM frame");
+      return fail(NET_PROTOCOL, H2_PROTOCOL_ERROR);
+    }
+    pRequest = find(m_frameStreamId);
+    if(pRequest != NULL)
+    {
+      uint32_t error = get32(payload);
+      //A refused stream was not processed at all, it can be sent again
+      if( (error == H2_REFUSED_STREAM) && !pRequest->m_responseStarted && ( (pRequest->m_pDataOut == NULL) || (pRequest->m_writtenLen == 0) || pRequest->m_pDataOut->rewind() ) )
+      {
+        DBG("Stream %d refused, queuing it again", m_frameStreamId);
+        m_activeStreams--;
+        pRequest->m_state = HTTP2Request::STATE_QUEUED;
+        pRequest->m_streamId = 0;
+        pRequest->m_endSent = false;
+        pRequest->m_writtenLen = 0;
+        pRequest->m_httpResponseCode = 0;
+        return OK;
+      }
+      WARN("Stream %d reset by the server (error %d)", m_frameStreamId, error);
+      complete(pRequest, NET_CONN);
+    }
+    return OK;
+  case H2_GOAWAY:
+    if( (m_frameLen < 8) || (m_frameStreamId != 0) )
+    {
+      ERR("Invalid GOAWAY frame");
+      return fail(NET_PROTOCOL, H2_PROTOCOL_ERROR);
+    }
+    else
+    {
+      uint32_t lastStreamId = get32(payload) & 0x7FFFFFFF;
+      WARN("Server going away (error %d, last stream %d)", get32(&payload[4]), lastStreamId);
+      m_goAway = true;
+      //The streams the server did not process, and those not started yet, will not complete
+      for(pRequest = m_pFirst; pRequest != NULL; pRequest = pNext)
+      {
+        pNext = pRequest->m_pNext;
+        if( (pRequest->m_state == HTTP2Request::STATE_QUEUED) || (pRequest->m_streamId > lastStreamId) )
+        {
+          complete(pRequest, NET_CONN);
+        }
+      }
+    }
+    return OK;
+  case H2_PUSH_PROMISE:
+    ERR("Push was disabled");
+    return fail(NET_PROTOCOL, H2_PROTOCOL_ERROR);
+  default: //PRIORITY and unknown frames
+    return OK;
+  }
+}
+
+int HTTP2Connection::processSettings(const char* payload, size_t len)
+{
+  if(m_frameStreamId != 0)
+  {
+    ERR("Invalid SETTINGS frame");
+    return fail(NET_PROTOCOL, H2_PROTOCOL_ERROR);
+  }
+  if(m_frameFlags & H2_FLAG_ACK)
+  {
+    return (m_frameLen == 0) ? OK : fail(NET_PROTOCOL, H2_FRAME_SIZE_ERROR);
+  }
+  if( (m_frameLen % 6) != 0 )
+  {
+    ERR("Invalid SETTINGS frame");
+    return fail(NET_PROTOCOL, H2_FRAME_SIZE_ERROR);
+  }
+  if(len != m_frameLen)
+  {
+    ERR("SETTINGS frame too long");
+    return fail(NET_TOOSMALL, H2_INTERNAL_ERROR);
+  }
+  for(size_t i = 0; i < len; i += 6)
+  {
+    uint16_t id = ((uint8_t)payload[i] << 8) | (uint8_t)payload[i + 1];
+    uint32_t value = get32(&payload[i + 2]);
+    switch(id)
+    {
+    case H2_SETTINGS_HEADER_TABLE_SIZE:
+      m_encoder.setMaxSize(value);
+      break;
+    case H2_SETTINGS_MAX_CONCURRENT_STREAMS:
+      m_maxStreams = value;
+      break;
+    case H2_SETTINGS_INITIAL_WINDOW_SIZE:
+      if(value > H2_MAX_WINDOW_SIZE)
+      {
+        ERR("Invalid initial window size");
+        return fail(NET_PROTOCOL, H2_FLOW_CONTROL_ERROR);
+      }
+      //The change applies to the open streams as well
+      for(HTTP2Request* pRequest = m_pFirst; pRequest != NULL; pRequest = pRequest->m_pNext)
+      {
+        if(pRequest->m_state == HTTP2Request::STATE_OPEN)
+        {
+          pRequest->m_sendWindow += (int32_t)value - m_initialWindow;
+        }
+      }
+      m_initialWindow = value;
+      break;
+    case H2_SETTINGS_MAX_FRAME_SIZE:
+      if( (value < H2_DEFAULT_MAX_FRAME_SIZE) || (value > 0xFFFFFF) )
+      {
+        ERR("Invalid maximum frame size");
+        return fail(NET_PROTOCOL, H2_PROTOCOL_ERROR);
+      }
+      m_maxFrameSize = value;
+      break;
+    default: //Push is disabled on our side, other settings do not apply
+      break;
+    }
+  }
+  DBG("Settings applied: %d concurrent streams, window %d", m_maxStreams, m_initialWindow);
+  return sendControl(H2_SETTINGS, H2_FLAG_ACK, 0, NULL, 0);
+}
+
+int HTTP2Connection::writeData(HTTP2Request* pRequest, const char* buf, size_t len) //Pass data to the sink, waiting while it is paused, 0 or HTTP_DATA_ABORT/HTTP_DATA_ENOUGH on success, err code on failure
+{
+  //Nothing is read from the connection while the sink is paused, which holds the other streams back as well
+  uint32_t start = HTTPTime::getMs();
+  while(true)
+  {
+    int ret = pRequest->m_pDataIn->write(buf, len);
+    if( (ret == HTTP_DATA_ABORT) || (ret == HTTP_DATA_ENOUGH) )
+    {
+      return ret;
+    }
+    if(ret != HTTP_DATA_PAUSE)
+    {
+      return OK; //Errors reported by the sink itself do not stop the transfer
+    }
+    if( HTTPTime::elapsed(start) >= m_timeout )
+    {
+      WARN("Data sink paused for too long");
+      return NET_TIMEOUT;
+    }
+    HTTPTime::sleep(HTTP_CLIENT_PAUSE_POLL_INTERVAL);
+  }
+}
+
+int HTTP2Connection::consume(HTTP2Request* pRequest, size_t len) //Open the windows again once data was processed
+{
+  int ret = OK;
+  m_recvConsumed += len;
+  if(m_recvConsumed >= HTTP2_WINDOW_SIZE / 2)
+  {
+    ret = sendWindowUpdate(0, m_recvConsumed);
+    m_recvWindow += m_recvConsumed;
+    m_recvConsumed = 0;
+  }
+  if( (ret == OK) && (pRequest != NULL) && (pRequest->m_state == HTTP2Request::STATE_OPEN) )
+  {
+    pRequest->m_recvConsumed += len;
+    if(pRequest->m_recvConsumed >= HTTP2_WINDOW_SIZE / 2)
+    {
+      ret = sendWindowUpdate(pRequest->m_streamId, pRequest->m_recvConsumed);
+      pRequest->m_recvWindow += pRequest->m_recvConsumed;
+      pRequest->m_recvConsumed = 0;
+    }
+  }
+  if(ret != OK)
+  {
+    return fail(ret, H2_INTERNAL_ERROR);
+  }
+  return OK;
+}
+
+int HTTP2Connection::fail(int result, uint32_t error) //Connection error: GOAWAY and close
+{
+  if(m_open)
+  {
+    char payload[8];
+    put32(&payload[0], 0); //No stream was initiated by the server
+    put32(&payload[4], error);
+    if( sendControl(H2_GOAWAY, 0, 0, payload, sizeof(payload)) == OK )
+    {
+      flush();
+    }
+    m_pTransport->close();
+    m_open = false;
+  }
+  while(m_pFirst != NULL)
+  {
+    complete(m_pFirst, result);
+  }
+  return result;
+}
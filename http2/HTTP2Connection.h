@@ -0,0 +1,178 @@
+/* HTTP2Connection.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP2CONNECTION_H_
+#define HTTP2CONNECTION_H_
+
+#include "../HTTPClient.h"
+#include "HTTP2Request.h"
+#include "HTTPHpack.h"
+
+#ifndef HTTP2_BUFFER_SIZE
+#define HTTP2_BUFFER_SIZE 1024 //Frames sent in one write, and pieces of frames received in one read
+#endif
+#ifndef HTTP2_HEADER_BLOCK_MAX_LEN
+#define HTTP2_HEADER_BLOCK_MAX_LEN 1024 //Compressed response headers
+#endif
+#ifndef HTTP2_WINDOW_SIZE
+#define HTTP2_WINDOW_SIZE 65535 //Data the server may send on each stream, and on the connection, before it is told that it was processed
+#endif
+#define HTTP2_FRAME_HEADER_LEN 9
+
+/** HTTP/2 connection (RFC 9113), carrying concurrent requests as multiplexed streams
+ * Only cleartext connections with prior knowledge (h2c) are supported: the server must be known to speak HTTP/2 on that port.
+ * Headers are compressed with HPACK, so that the headers repeated on each request cost a byte each once sent.
+ * Each stream has its own flow control window, which is only opened again as its IHTTPDataIn takes the data.
+ * @code
+ * HTTP2Connection conn;
+ * conn.open("http://example.com:8080/");
+ * HTTP2Request req1(&conn), req2(&conn);
+ * req1.get("/status", &status);
+ * req2.post("/telemetry", data, NULL);
+ * conn.run(); //Both requests at the same time, over one connection
+ * @endcode
+ * A connection is used by one thread at a time.
+ */
+class HTTP2Connection : protected IHTTPHeaderVisitor
+{
+public:
+  ///Instantiate a connection, using the platform's default transport
+  HTTP2Connection();
+
+  /** Instantiate a connection on top of a specific transport
+   * @param pTransport Transport to use, must remain valid as long as the connection is in use
+   */
+  HTTP2Connection(IHTTPTransport* pTransport);
+
+  ///Close the connection, failing the pending requests
+  ~HTTP2Connection();
+
+  /** Open the connection to the host of a url, closing the previous one if needed
+   * @param url http:// url, of which only the host and port are used
+   * @param timeout Connection timeout in ms
+   * @return 0 on success, NET error on failure
+   */
+  int open(const char* url, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT);
+
+  /** Open the connection to the host of an endpoint, closing the previous one if needed
+   * The endpoint keeps the resolved address of the host for the next connections
+   * @param endpoint Endpoint to connect to, of which only the host and port are used
+   * @param timeout Connection timeout in ms
+   * @return 0 on success, NET error on failure
+   */
+  int open(HTTPEndpoint& endpoint, uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT);
+
+  /** Run the started requests until they all complete
+   * Blocks until completion
+   * Requests started from an IHTTPDataIn during the call are run as well.
+   * @param timeout Time in ms to wait for the server when nothing can be sent
+   * @return 0 on success (the result of each request is in the request), NET_TIMEOUT if the server did not answer in time, in which case the pending requests were reset with NET_TIMEOUT but the connection can still be used, NET error if the connection failed, in which case the pending requests failed with the same error
+   */
+  int run(uint32_t timeout = HTTP_CLIENT_DEFAULT_TIMEOUT); //Blocking
+
+  /** Close the connection, failing the pending requests with NET_CLOSED
+   */
+  void close();
+
+  /** Whether the connection is open and accepts new requests
+   */
+  bool isOpen();
+
+protected:
+  //IHTTPHeaderVisitor
+  virtual void onHeader(const HTTPStringView& name, const HTTPStringView& value);
+
+private:
+  friend class HTTP2Request;
+
+  HTTP2Connection(const HTTP2Connection&); //Not copyable, requests keep a pointer to it
+  HTTP2Connection& operator=(const HTTP2Connection&);
+
+  void reset(); //State of a new connection
+  int start(HTTP2Request* pRequest); //Queue
+  void cancel(HTTP2Request* pRequest, int result); //Reset the stream and complete the request
+  void complete(HTTP2Request* pRequest, int result);
+  HTTP2Request* find(uint32_t streamId);
+
+  int send(); //Start queued requests and send data as the windows allow
+  int sendHeaders(HTTP2Request* pRequest);
+  int sendData(HTTP2Request* pRequest, bool* pSent);
+  char* beginFrame(size_t len); //Room for a frame of len bytes in the send buffer, flushing it if needed
+  void endFrame(uint8_t type, uint8_t flags, uint32_t streamId, size_t len);
+  int sendControl(uint8_t type, uint8_t flags, uint32_t streamId, const char* payload, size_t len);
+  int sendWindowUpdate(uint32_t streamId, uint32_t increment);
+  int flush();
+
+  int recv(uint32_t timeout); //Read what the server sent and process all the frames read
+  int parse(); //Process the frames in the receive buffer, NET_PROCESSING when more bytes are needed
+  int processFrameHeader(const char* buf); //Frame header, followed by the padding length and priority if any
+  int processData(const char* buf, size_t len);
+  int processHeaders(); //Complete header block
+  void finish(HTTP2Request* pRequest); //END_STREAM received
+  int processFrame(const char* payload, size_t len); //Frame other than DATA, HEADERS and CONTINUATION, complete
+  int processSettings(const char* payload, size_t len);
+  int writeData(HTTP2Request* pRequest, const char* buf, size_t len);
+  int consume(HTTP2Request* pRequest, size_t len); //Open the windows again once data was processed
+  int fail(int result, uint32_t error); //Connection error: GOAWAY and close
+
+  HTTPDefaultTransport m_defaultTransport;
+  IHTTPTransport* m_pTransport;
+  uint32_t m_timeout;
+  char m_authority[HTTP_ENDPOINT_AUTHORITY_MAX_LEN]; //Host and port
+  bool m_open;
+  bool m_goAway; //Received or sent, no new streams
+
+  HTTP2Request* m_pFirst; //Pending requests, in the order in which they were started
+  uint32_t m_nextStreamId;
+  uint32_t m_activeStreams;
+  uint32_t m_maxStreams; //SETTINGS_MAX_CONCURRENT_STREAMS of the server
+  uint32_t m_maxFrameSize; //SETTINGS_MAX_FRAME_SIZE of the server
+  int32_t m_initialWindow; //SETTINGS_INITIAL_WINDOW_SIZE of the server
+  int32_t m_sendWindow; //Flow control window of the server for the connection
+  int32_t m_recvWindow;
+  uint32_t m_recvConsumed;
+
+  //Frame being received
+  bool m_inFrame;
+  uint32_t m_frameLen; //Left to receive
+  uint8_t m_frameType;
+  uint8_t m_frameFlags;
+  uint32_t m_frameStreamId;
+  uint32_t m_padLen; //Padding at the end of the DATA or HEADERS frame
+  uint32_t m_skipLen; //Rest of a frame that is not processed
+  uint32_t m_blockStreamId; //Stream of the header block being received, 0 if none
+  size_t m_blockLen;
+  bool m_blockEndStream;
+  HTTP2Request* m_pHeaderRequest; //Request whose headers are being decoded
+
+  HTTPHpackEncoder m_encoder;
+  HTTPHpackDecoder m_decoder;
+  char m_txBuf[HTTP2_BUFFER_SIZE];
+  size_t m_txLen;
+  char m_rxBuf[HTTP2_BUFFER_SIZE];
+  size_t m_rxPos;
+  size_t m_rxLen;
+  char m_block[HTTP2_HEADER_BLOCK_MAX_LEN];
+};
+
+#endif /* HTTP2CONNECTION_H_ */
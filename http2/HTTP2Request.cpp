@@ -0,0 +1,108 @@
+/* HTTP2Request.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTP2Request.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTP2Request.h"
+#include "HTTP2Connection.h"
+
+HTTP2Request::HTTP2Request(HTTP2Connection* pConnection) :
+m_pConnection(pConnection), m_pNext(NULL), m_meth(NULL), m_path(NULL), m_headers(NULL), m_headersCount(0), m_pDataOut(NULL), m_pDataIn(NULL),
+m_state(STATE_IDLE), m_streamId(0), m_result(OK), m_httpResponseCode(0), m_endSent(false), m_responseStarted(false), m_lengthSet(false),
+m_writtenLen(0), m_sendWindow(0), m_recvWindow(0), m_recvConsumed(0)
+{
+
+}
+
+HTTP2Request::~HTTP2Request()
+{
+  abort();
+}
+
+int HTTP2Request::get(const char* path, IHTTPDataIn* pDataIn)
+{
+  return start("GET", path, NULL, pDataIn);
+}
+
+int HTTP2Request::post(const char* path, IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn)
+{
+  return start("POST", path, &dataOut, pDataIn);
+}
+
+void HTTP2Request::setHeaders(const char* const* headers, size_t count)
+{
+  m_headers = headers;
+  m_headersCount = count;
+}
+
+void HTTP2Request::abort()
+{
+  if( isPending() )
+  {
+    m_pConnection->cancel(this, NET_ABORT);
+  }
+}
+
+bool HTTP2Request::isPending()
+{
+  return (m_state == STATE_QUEUED) || (m_state == STATE_OPEN);
+}
+
+int HTTP2Request::getResult()
+{
+  return isPending() ? NET_PROCESSING : m_result;
+}
+
+int HTTP2Request::getHTTPResponseCode()
+{
+  return m_httpResponseCode;
+}
+
+int HTTP2Request::start(const char* meth, const char* path, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn)
+{
+  if( isPending() )
+  {
+    ERR("Request already pending");
+    return NET_PROCESSING;
+  }
+  m_meth = meth;
+  m_path = path;
+  m_pDataOut = pDataOut;
+  m_pDataIn = pDataIn;
+  m_streamId = 0;
+  m_result = OK;
+  m_httpResponseCode = 0;
+  m_endSent = false;
+  m_responseStarted = false;
+  m_lengthSet = false;
+  m_writtenLen = 0;
+  return m_pConnection->start(this);
+}
@@ -0,0 +1,125 @@
+/* HTTP2Request.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP2REQUEST_H_
+#define HTTP2REQUEST_H_
+
+#include "../IHTTPData.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+class HTTP2Connection;
+
+/** Request sent as a stream of an HTTP2Connection
+ * Requests are started on the connection, and all run at the same time when the connection's run() is called.
+ */
+class HTTP2Request
+{
+public:
+  /** Instantiate a request
+   * @param pConnection Connection carrying the request
+   */
+  HTTP2Request(HTTP2Connection* pConnection);
+
+  ///Cancel the request if it is still pending
+  ~HTTP2Request();
+
+  /** Start a GET request
+   * @param path Path (and query) on the host of the connection, must remain valid until completion
+   * @param pDataIn Pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @return 0 if the request was started, NET error otherwise
+   */
+  int get(const char* path, IHTTPDataIn* pDataIn);
+
+  /** Start a POST request
+   * @param path Path (and query) on the host of the connection, must remain valid until completion
+   * @param dataOut IHTTPDataOut instance that contains the data that will be posted, must remain valid until completion
+   * @param pDataIn Pointer to an IHTTPDataIn instance that will collect the data returned by the request, can be NULL
+   * @return 0 if the request was started, NET error otherwise
+   */
+  int post(const char* path, IHTTPDataOut& dataOut, IHTTPDataIn* pDataIn);
+
+  /** Set headers to send with the next requests, e.g. credentials
+   * Headers sent again on the same connection only cost a byte each.
+   * @param headers Names and values, one after the other: {name1, value1, name2, value2...}; the names must be in lowercase; the array must remain valid until completion
+   * @param count Number of headers (half the number of strings)
+   */
+  void setHeaders(const char* const* headers, size_t count);
+
+  /** Cancel the request if it is still pending, its result is then NET_ABORT
+   */
+  void abort();
+
+  /** Whether the request was started and did not complete yet
+   */
+  bool isPending();
+
+  /** Get the result of the request
+   * @return 0 on success, NET error on failure, NET_PROCESSING while the request is pending
+   */
+  int getResult();
+
+  /** Get the HTTP response code of the request
+   */
+  int getHTTPResponseCode();
+
+private:
+  friend class HTTP2Connection;
+
+  HTTP2Request(const HTTP2Request&); //Not copyable, the connection keeps a pointer to it
+  HTTP2Request& operator=(const HTTP2Request&);
+
+  enum STATE
+  {
+    STATE_IDLE,
+    STATE_QUEUED, //Waiting for the connection to allow another stream
+    STATE_OPEN, //Headers sent
+    STATE_DONE
+  };
+
+  int start(const char* meth, const char* path, IHTTPDataOut* pDataOut, IHTTPDataIn* pDataIn);
+
+  HTTP2Connection* m_pConnection;
+  HTTP2Request* m_pNext; //Next pending request of the connection
+  const char* m_meth;
+  const char* m_path;
+  const char* const* m_headers;
+  size_t m_headersCount;
+  IHTTPDataOut* m_pDataOut;
+  IHTTPDataIn* m_pDataIn;
+
+  STATE m_state;
+  uint32_t m_streamId;
+  int m_result;
+  int m_httpResponseCode;
+  bool m_endSent; //END_STREAM sent
+  bool m_responseStarted; //Final response headers received
+  bool m_lengthSet; //Content-Length received
+  size_t m_writtenLen; //Data sent
+  int32_t m_sendWindow; //Flow control window of the server for the stream
+  int32_t m_recvWindow; //Data the server may still send on the stream
+  uint32_t m_recvConsumed; //Data received since the last WINDOW_UPDATE
+};
+
+#endif /* HTTP2REQUEST_H_ */
@@ -0,0 +1,723 @@
+/* HTTPHpack.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPHpack.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPHpack.h"
+
+#include <string.h>
+
+#define HPACK_ENTRY_OVERHEAD 32
+#define HPACK_INT_MAX 0x0FFFFFFF //Larger integers are rejected, no header block comes close
+
+//Static table (RFC 7541 Appendix A), index 1 first
+static const struct
+{
+  const char* name;
+  const char* value;
+} s_staticTable[] = {
+  { ":authority", "" }, //1
+  { ":method", "GET" }, //2
+  { ":method", "POST" }, //3
+  { ":path", "/" }, //4
+  { ":path", "/index.html" }, //5
+  { ":scheme", "http" }, //6
+  { ":scheme", "https" }, //7
+  { ":status", "200" }, //8
+  { ":status", "204" }, //9
+  { ":status", "206" }, //10
+  { ":status", "304" }, //11
+  { ":status", "400" }, //12
+  { ":status", "404" }, //13
+  { ":status", "500" }, //14
+  { "accept-charset", "" }, //15
+  { "accept-encoding", "gzip, deflate" }, //16
+  { "accept-language", "" }, //17
+  { "accept-ranges", "" }, //18
+  { "accept", "" }, //19
+  { "access-control-allow-origin", "" }, //20
+  { "age", "" }, //21
+  { "allow", "" }, //22
+  { "authorization", "" }, //23
+  { "cache-control", "" }, //24
+  { "content-disposition", "" }, //25
+  { "content-encoding", "" }, //26
+  { "content-language", "" }, //27
+  { "content-length", "" }, //28
+  { "content-location", "" }, //29
+  { "content-range", "" }, //30
+  { "content-type", "" }, //31
+  { "cookie", "" }, //32
+  { "date", "" }, //33
+  { "etag", "" }, //34
+  { "expect", "" }, //35
+  { "expires", "" }, //36
+  { "from", "" }, //37
+  { "host", "" }, //38
+  { "if-match", "" }, //39
+  { "if-modified-since", "" }, //40
+  { "if-none-match", "" }, //41
+  { "if-range", "" }, //42
+  { "if-unmodified-since", "" }, //43
+  { "last-modified", "" }, //44
+  { "link", "" }, //45
+  { "location", "" }, //46
+  { "max-forwards", "" }, //47
+  { "proxy-authenticate", "" }, //48
+  { "proxy-authorization", "" }, //49
+  { "range", "" }, //50
+  { "referer", "" }, //51
+  { "refresh", "" }, //52
+  { "retry-after", "" }, //53
+  { "server", "" }, //54
+  { "set-cookie", "" }, //55
+  { "strict-transport-security", "" }, //56
+  { "transfer-encoding", "" }, //57
+  { "user-agent", "" }, //58
+  { "vary", "" }, //59
+  { "via", "" }, //60
+  { "www-authenticate", "" }, //61
+};
+#define HPACK_STATIC_COUNT (sizeof(s_staticTable) / sizeof(s_staticTable[0]))
+
+//Huffman code (RFC 7541 Appendix B), by symbol (256 is EOS)
+static const uint32_t s_huffmanCodes[257] = {
+  0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+  0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+  0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+  0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+  0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+  0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+  0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+  0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+  0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+  0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+  0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+  0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+  0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+  0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+  0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+  0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+  0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+  0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+  0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+  0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+  0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+  0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+  0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+  0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+  0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+  0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+  0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+  0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+  0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+  0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+  0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+  0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+  0x3fffffff
+};
+static const uint8_t s_huffmanLengths[257] = {
+  13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+  28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+  6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+  5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+  13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+  15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+  6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+  20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+  24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+  22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+  21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+  26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+  19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+  20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+  26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+  30
+};
+
+//The code is canonical: the codes of each length are consecutive, in the order of their symbols, which is enough to decode them
+static const uint16_t s_huffmanSymbols[257] = { //By length, then by symbol
+  48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37, 45, 46, 47, 51,
+  52, 53, 54, 55, 56, 57, 61, 65, 95, 98, 100, 102, 103, 104, 108, 109,
+  110, 112, 114, 117, 58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76,
+  77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 89, 106, 107, 113, 118,
+  119, 120, 121, 122, 38, 42, 44, 59, 88, 90, 33, 34, 40, 41, 63, 39,
+  43, 124, 35, 62, 0, 36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92,
+  195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177,
+  179, 209, 216, 217, 227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160,
+  163, 164, 169, 170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+  233, 1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157,
+  158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239, 9, 142,
+  144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+  200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203, 204, 211,
+  212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251, 252, 253, 254,
+  2, 3, 4, 5, 6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+  21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220, 249, 10, 13, 22,
+  256
+};
+static const uint32_t s_huffmanFirst[31] = { //First code of each length
+  0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x14, 0x5c,
+  0xf8, 0x1fc, 0x3f8, 0x7fa, 0xffa, 0x1ff8, 0x3ffc, 0x7ffc,
+  0xfffe, 0x1fffc, 0x3fff8, 0x7fff0, 0xfffe6, 0x1fffdc, 0x3fffd2, 0x7fffd8,
+  0xffffea, 0x1ffffec, 0x3ffffe0, 0x7ffffde, 0xfffffe2, 0x1ffffffe, 0x3ffffffc
+};
+static const uint16_t s_huffmanOffset[31] = { //Index in s_huffmanSymbols of the first code of each length
+  0, 0, 0, 0, 0, 0, 10, 36, 68, 74, 74, 79, 82, 84, 90, 92,
+  95, 95, 95, 95, 98, 106, 119, 145, 174, 186, 190, 205, 224, 253, 253
+};
+static const uint16_t s_huffmanCounts[31] = { //Number of codes of each length
+  0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3,
+  0, 0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 4
+};
+#define HUFFMAN_MIN_LEN 5
+#define HUFFMAN_MAX_LEN 30
+#define HUFFMAN_EOS 256
+
+static bool equals(const char* str, const char* data, size_t len) //Values may hold NULL chars
+{
+  return (strlen(str) == len) && !memcmp(str, data, len);
+}
+
+HTTPHpackTable::HTTPHpackTable() :
+m_first(0), m_count(0), m_size(0), m_maxSize(MIN(HTTP_HPACK_DEFAULT_TABLE_SIZE, HTTP_HPACK_TABLE_SIZE)), m_end(0)
+{
+
+}
+
+void HTTPHpackTable::setMaxSize(size_t maxSize)
+{
+  m_maxSize = MIN(maxSize, (size_t)HTTP_HPACK_TABLE_SIZE);
+  while(m_size > m_maxSize)
+  {
+    evict();
+  }
+}
+
+size_t HTTPHpackTable::getMaxSize() const
+{
+  return m_maxSize;
+}
+
+void HTTPHpackTable::add(const char* name, size_t nameLen, const char* value, size_t valueLen)
+{
+  size_t size = nameLen + valueLen + HPACK_ENTRY_OVERHEAD;
+  while( (m_count > 0) && (m_size + size > m_maxSize) )
+  {
+    evict();
+  }
+  if(size > m_maxSize) //Empties the table
+  {
+    return;
+  }
+
+  if(m_end + nameLen + valueLen > sizeof(m_data))
+  {
+    //Move the live entries back to the start: they take at most m_maxSize - size bytes, so the new one fits after them
+    size_t start = (m_count > 0) ? m_entries[m_first].pos : m_end;
+    memmove(m_data, m_data + start, m_end - start);
+    for(size_t i = 0; i < m_count; i++)
+    {
+      m_entries[(m_first + i) % (sizeof(m_entries) / sizeof(m_entries[0]))].pos -= start;
+    }
+    m_end -= start;
+  }
+
+  Entry& entry = m_entries[(m_first + m_count) % (sizeof(m_entries) / sizeof(m_entries[0]))];
+  entry.pos = m_end;
+  entry.nameLen = nameLen;
+  entry.valueLen = valueLen;
+  memcpy(m_data + m_end, name, nameLen);
+  memcpy(m_data + m_end + nameLen, value, valueLen);
+  m_end += nameLen + valueLen;
+  m_count++;
+  m_size += size;
+}
+
+bool HTTPHpackTable::get(size_t index, HTTPStringView* pName, HTTPStringView* pValue) const
+{
+  if(index >= m_count)
+  {
+    return false;
+  }
+  const Entry& entry = m_entries[(m_first + m_count - 1 - index) % (sizeof(m_entries) / sizeof(m_entries[0]))];
+  pName->ptr = m_data + entry.pos;
+  pName->len = entry.nameLen;
+  pValue->ptr = m_data + entry.pos + entry.nameLen;
+  pValue->len = entry.valueLen;
+  return true;
+}
+
+size_t HTTPHpackTable::getCount() const
+{
+  return m_count;
+}
+
+void HTTPHpackTable::evict() //Oldest entry
+{
+  const Entry& entry = m_entries[m_first];
+  m_size -= entry.nameLen + entry.valueLen + HPACK_ENTRY_OVERHEAD;
+  m_first = (m_first + 1) % (sizeof(m_entries) / sizeof(m_entries[0]));
+  m_count--;
+  if(m_count == 0)
+  {
+    m_end = 0;
+  }
+}
+
+HTTPHpackDecoder::HTTPHpackDecoder()
+{
+  m_table.setMaxSize(HTTP_HPACK_TABLE_SIZE); //Advertised with SETTINGS_HEADER_TABLE_SIZE before any header block is received
+}
+
+int HTTPHpackDecoder::decode(const char* block, size_t len, IHTTPHeaderVisitor* pVisitor)
+{
+  const uint8_t* in = (const uint8_t*)block;
+  const uint8_t* end = in + len;
+  bool headerSeen = false;
+  int ret;
+  while(in < end)
+  {
+    HTTPStringView name;
+    HTTPStringView value;
+    size_t scratchPos = 0;
+    size_t index;
+    uint8_t first = *in;
+    if(first & 0x80) //Indexed header
+    {
+      ret = decodeInt(&in, end, 7, &index);
+      if(ret == OK) ret = getEntry(index, &name, &value);
+      if(ret != OK) return ret;
+    }
+    else if( (first & 0xE0) == 0x20 ) //Dynamic table size update, only before the first header
+    {
+      ret = decodeInt(&in, end, 5, &index);
+      if(ret != OK) return ret;
+      if( headerSeen || (index > HTTP_HPACK_TABLE_SIZE) )
+      {
+        ERR("Invalid table size update to %d", (int)index);
+        return NET_PROTOCOL;
+      }
+      m_table.setMaxSize(index);
+      continue;
+    }
+    else //Literal, with incremental indexing (01), without indexing (0000) or never indexed (0001)
+    {
+      int prefixBits = ((first & 0xC0) == 0x40) ? 6 : 4;
+      ret = decodeInt(&in, end, prefixBits, &index);
+      if(ret != OK) return ret;
+      if(index != 0)
+      {
+        HTTPStringView unused;
+        ret = getEntry(index, &name, &unused);
+        if( (ret == OK) && (index > HPACK_STATIC_COUNT) )
+        {
+          //Adding the entry may evict or move the one the name comes from
+          if(name.len > sizeof(m_scratch))
+          {
+            return NET_TOOSMALL;
+          }
+          memcpy(m_scratch, name.ptr, name.len);
+          name.ptr = m_scratch;
+          scratchPos = name.len;
+        }
+      }
+      else
+      {
+        ret = decodeString(&in, end, &name, &scratchPos);
+      }
+      if(ret == OK) ret = decodeString(&in, end, &value, &scratchPos);
+      if(ret != OK) return ret;
+      if(prefixBits == 6)
+      {
+        m_table.add(name.ptr, name.len, value.ptr, value.len);
+      }
+    }
+    headerSeen = true;
+    if(pVisitor != NULL)
+    {
+      pVisitor->onHeader(name, value);
+    }
+  }
+  return OK;
+}
+
+/*static*/ int HTTPHpackDecoder::decodeHuffman(const char* in, size_t len, char* out, size_t maxLen, size_t* pOutLen)
+{
+  const uint8_t* p = (const uint8_t*)in;
+  const uint8_t* end = p + len;
+  uint64_t bits = 0;
+  int avail = 0; //Bits not decoded yet, at the bottom of bits
+  size_t outLen = 0;
+  while(true)
+  {
+    while( (avail <= 56) && (p < end) )
+    {
+      bits = (bits << 8) | *p++;
+      avail += 8;
+    }
+    if(avail == 0)
+    {
+      break;
+    }
+    //Try each length in turn, the shortest codes being the most frequent
+    int codeLen = HUFFMAN_MIN_LEN;
+    int sym = -1;
+    while( (codeLen <= HUFFMAN_MAX_LEN) && (codeLen <= avail) )
+    {
+      uint32_t code = (uint32_t)(bits >> (avail - codeLen)) & ((1UL << codeLen) - 1);
+      if(code - s_huffmanFirst[codeLen] < s_huffmanCounts[codeLen])
+      {
+        sym = s_huffmanSymbols[s_huffmanOffset[codeLen] + code - s_huffmanFirst[codeLen]];
+        break;
+      }
+      codeLen++;
+    }
+    if(sym < 0)
+    {
+      //Padding: fewer than 8 bits, all set (a prefix of EOS, which no code of that length can be)
+      if( (p == end) && (avail < 8) && ((bits & ((1U << avail) - 1)) == ((1U << avail) - 1)) )
+      {
+        break;
+      }
+      return NET_PROTOCOL;
+    }
+    if(sym == HUFFMAN_EOS)
+    {
+      return NET_PROTOCOL;
+    }
+    if(outLen >= maxLen)
+    {
+      return NET_TOOSMALL;
+    }
+    out[outLen++] = (char)sym;
+    avail -= codeLen;
+  }
+  *pOutLen = outLen;
+  return OK;
+}
+
+int HTTPHpackDecoder::decodeInt(const uint8_t** pIn, const uint8_t* end, int prefixBits, size_t* pValue)
+{
+  const uint8_t* in = *pIn;
+  size_t mask = (1 << prefixBits) - 1;
+  size_t value = *in++ & mask;
+  if(value == mask)
+  {
+    int shift = 0;
+    uint8_t b;
+    do
+    {
+      if( (in == end) || (shift > 21) )
+      {
+        ERR("Invalid integer");
+        return NET_PROTOCOL;
+      }
+      b = *in++;
+      value += (size_t)(b & 0x7F) << shift;
+      shift += 7;
+    } while(b & 0x80);
+    if(value > HPACK_INT_MAX)
+    {
+      ERR("Invalid integer");
+      return NET_PROTOCOL;
+    }
+  }
+  *pIn = in;
+  *pValue = value;
+  return OK;
+}
+
+int HTTPHpackDecoder::decodeString(const uint8_t** pIn, const uint8_t* end, HTTPStringView* pStr, size_t* pScratchPos)
+{
+  if(*pIn == end)
+  {
+    return NET_PROTOCOL;
+  }
+  bool huffman = (**pIn & 0x80) != 0;
+  size_t len;
+  int ret = decodeInt(pIn, end, 7, &len);
+  if(ret != OK)
+  {
+    return ret;
+  }
+  if(len > (size_t)(end - *pIn))
+  {
+    ERR("String longer than the header block");
+    return NET_PROTOCOL;
+  }
+  if(!huffman) //Used in place
+  {
+    pStr->ptr = (const char*)*pIn;
+    pStr->len = len;
+  }
+  else
+  {
+    size_t outLen;
+    ret = decodeHuffman((const char*)*pIn, len, m_scratch + *pScratchPos, sizeof(m_scratch) - *pScratchPos, &outLen);
+    if(ret != OK)
+    {
+      ERR("Could not decode Huffman string (%d)", ret);
+      return ret;
+    }
+    pStr->ptr = m_scratch + *pScratchPos;
+    pStr->len = outLen;
+    *pScratchPos += outLen;
+  }
+  *pIn += len;
+  return OK;
+}
+
+int HTTPHpackDecoder::getEntry(size_t index, HTTPStringView* pName, HTTPStringView* pValue)
+{
+  if( (index >= 1) && (index <= HPACK_STATIC_COUNT) )
+  {
+    pName->ptr = s_staticTable[index - 1].name;
+    pName->len = strlen(pName->ptr);
+    pValue->ptr = s_staticTable[index - 1].value;
+    pValue->len = strlen(pValue->ptr);
+    return OK;
+  }
+  if( (index > HPACK_STATIC_COUNT) && m_table.get(index - HPACK_STATIC_COUNT - 1, pName, pValue) )
+  {
+    return OK;
+  }
+  ERR("Invalid index %d", (int)index);
+  return NET_PROTOCOL;
+}
+
+HTTPHpackEncoder::HTTPHpackEncoder() :
+m_maxSize(MIN(HTTP_HPACK_DEFAULT_TABLE_SIZE, HTTP_HPACK_TABLE_SIZE)), m_minSize(m_maxSize), m_sizeChanged(m_maxSize != HTTP_HPACK_DEFAULT_TABLE_SIZE),
+m_buf(NULL), m_maxLen(0), m_len(0)
+{
+  m_table.setMaxSize(m_maxSize);
+}
+
+void HTTPHpackEncoder::setMaxSize(size_t maxSize)
+{
+  maxSize = MIN(maxSize, (size_t)HTTP_HPACK_TABLE_SIZE);
+  if(maxSize != m_maxSize)
+  {
+    m_sizeChanged = true;
+    m_minSize = MIN(m_minSize, maxSize);
+    m_maxSize = maxSize;
+    m_table.setMaxSize(maxSize);
+  }
+}
+
+int HTTPHpackEncoder::begin(char* buf, size_t maxLen)
+{
+  m_buf = buf;
+  m_maxLen = maxLen;
+  m_len = 0;
+  if(m_sizeChanged)
+  {
+    int ret = OK;
+    if(m_minSize < m_maxSize) //The decoder must evict what the smallest size did not allow
+    {
+      ret = encodeInt(m_minSize, 5, 0x20);
+    }
+    if(ret == OK) ret = encodeInt(m_maxSize, 5, 0x20);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    m_sizeChanged = false;
+    m_minSize = m_maxSize;
+  }
+  return OK;
+}
+
+int HTTPHpackEncoder::add(const char* name, size_t nameLen, const char* value, size_t valueLen, HTTPHpackIndexing indexing /*= HTTP_HPACK_INDEX*/)
+{
+  bool full;
+  size_t index = find(name, nameLen, value, valueLen, &full);
+  if(full && (indexing != HTTP_HPACK_NEVER_INDEX))
+  {
+    return encodeInt(index, 7, 0x80);
+  }
+
+  int ret;
+  if(indexing == HTTP_HPACK_INDEX)
+  {
+    ret = encodeInt(index, 6, 0x40);
+  }
+  else
+  {
+    ret = encodeInt(index, 4, (indexing == HTTP_HPACK_NEVER_INDEX) ? 0x10 : 0x00);
+  }
+  if( (ret == OK) && (index == 0) )
+  {
+    ret = encodeString(name, nameLen);
+  }
+  if(ret == OK) ret = encodeString(value, valueLen);
+  if(ret != OK)
+  {
+    return ret;
+  }
+  if(indexing == HTTP_HPACK_INDEX)
+  {
+    m_table.add(name, nameLen, value, valueLen);
+  }
+  return OK;
+}
+
+size_t HTTPHpackEncoder::getLength() const
+{
+  return m_len;
+}
+
+/*static*/ void HTTPHpackEncoder::encodeHuffman(const char* in, size_t len, char* out)
+{
+  uint64_t bits = 0;
+  int count = 0; //Bits pending in bits
+  for(size_t i = 0; i < len; i++)
+  {
+    uint8_t sym = (uint8_t)in[i];
+    bits = (bits << s_huffmanLengths[sym]) | s_huffmanCodes[sym];
+    count += s_huffmanLengths[sym];
+    while(count >= 8)
+    {
+      count -= 8;
+      *out++ = (char)(bits >> count);
+    }
+  }
+  if(count > 0) //Padded with the most significant bits of EOS
+  {
+    *out = (char)((bits << (8 - count)) | (0xFF >> count));
+  }
+}
+
+/*static*/ size_t HTTPHpackEncoder::getHuffmanLength(const char* in, size_t len)
+{
+  size_t bits = 0;
+  for(size_t i = 0; i < len; i++)
+  {
+    bits += s_huffmanLengths[(uint8_t)in[i]];
+  }
+  return (bits + 7) / 8;
+}
+
+int HTTPHpackEncoder::encodeInt(size_t value, int prefixBits, uint8_t flags)
+{
+  size_t mask = (1 << prefixBits) - 1;
+  if(m_len >= m_maxLen)
+  {
+    return NET_TOOSMALL;
+  }
+  if(value < mask)
+  {
+    m_buf[m_len++] = (char)(flags | value);
+    return OK;
+  }
+  m_buf[m_len++] = (char)(flags | mask);
+  value -= mask;
+  while(true)
+  {
+    if(m_len >= m_maxLen)
+    {
+      return NET_TOOSMALL;
+    }
+    if(value < 0x80)
+    {
+      m_buf[m_len++] = (char)value;
+      return OK;
+    }
+    m_buf[m_len++] = (char)(0x80 | (value & 0x7F));
+    value >>= 7;
+  }
+}
+
+int HTTPHpackEncoder::encodeString(const char* str, size_t len)
+{
+  size_t huffmanLen = getHuffmanLength(str, len);
+  bool huffman = (huffmanLen < len);
+  size_t encodedLen = huffman ? huffmanLen : len;
+  int ret = encodeInt(encodedLen, 7, huffman ? 0x80 : 0x00);
+  if(ret != OK)
+  {
+    return ret;
+  }
+  if(m_len + encodedLen > m_maxLen)
+  {
+    return NET_TOOSMALL;
+  }
+  if(huffman)
+  {
+    encodeHuffman(str, len, m_buf + m_len);
+  }
+  else
+  {
+    memcpy(m_buf + m_len, str, len);
+  }
+  m_len += encodedLen;
+  return OK;
+}
+
+size_t HTTPHpackEncoder::find(const char* name, size_t nameLen, const char* value, size_t valueLen, bool* pFull) //Best index, 0 if the name is unknown
+{
+  size_t nameIndex = 0;
+  *pFull = false;
+  for(size_t i = 0; i < HPACK_STATIC_COUNT; i++)
+  {
+    if( equals(s_staticTable[i].name, name, nameLen) )
+    {
+      if( equals(s_staticTable[i].value, value, valueLen) )
+      {
+        *pFull = true;
+        return i + 1;
+      }
+      if(nameIndex == 0)
+      {
+        nameIndex = i + 1;
+      }
+    }
+  }
+  for(size_t i = 0; i < m_table.getCount(); i++)
+  {
+    HTTPStringView entryName;
+    HTTPStringView entryValue;
+    m_table.get(i, &entryName, &entryValue);
+    if( (entryName.len == nameLen) && !memcmp(entryName.ptr, name, nameLen) )
+    {
+      if( (entryValue.len == valueLen) && !memcmp(entryValue.ptr, value, valueLen) )
+      {
+        *pFull = true;
+        return HPACK_STATIC_COUNT + 1 + i;
+      }
+      if(nameIndex == 0)
+      {
+        nameIndex = HPACK_STATIC_COUNT + 1 + i;
+      }
+    }
+  }
+  return nameIndex;
+}
@@ -0,0 +1,191 @@
+/* HTTPHpack.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPHPACK_H_
+#define HTTPHPACK_H_
+
+#include "../IHTTPHeaderVisitor.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef HTTP_HPACK_TABLE_SIZE
+#define HTTP_HPACK_TABLE_SIZE 1024 //Maximum size of each dynamic table, as counted by HPACK (32 bytes per entry on top of the name and value)
+#endif
+#ifndef HTTP_HPACK_STRING_MAX_LEN
+#define HTTP_HPACK_STRING_MAX_LEN 512 //Decoded Huffman strings of a header (name and value)
+#endif
+#define HTTP_HPACK_DEFAULT_TABLE_SIZE 4096 //Size of the dynamic tables until the decoder sets another one
+
+///How the encoder may store a header in the dynamic tables
+enum HTTPHpackIndexing
+{
+  HTTP_HPACK_INDEX, ///<Added to the tables, so that repeating it costs a single byte
+  HTTP_HPACK_NO_INDEX, ///<Not added, for values that change with each request
+  HTTP_HPACK_NEVER_INDEX ///<Not added by this encoder nor by any intermediary, for secrets
+};
+
+/** Dynamic table of HPACK (RFC 7541), holding at most HTTP_HPACK_TABLE_SIZE bytes
+ * Entries are appended to a linear buffer and evicted from its start; the live entries are moved back to the start of the buffer when
+ * the next one does not fit at its end, so that names and values are always contiguous.
+ */
+class HTTPHpackTable
+{
+public:
+  HTTPHpackTable();
+
+  /** Set the maximum size, evicting the oldest entries that no longer fit
+   * @param maxSize Maximum size, at most HTTP_HPACK_TABLE_SIZE
+   */
+  void setMaxSize(size_t maxSize);
+
+  size_t getMaxSize() const;
+
+  /** Add an entry, evicting the oldest entries to make room (or emptying the table if it is larger than the maximum size)
+   * The name and value must not point into the table.
+   */
+  void add(const char* name, size_t nameLen, const char* value, size_t valueLen);
+
+  /** Get an entry
+   * @param index 0 for the newest entry
+   * @param pName Pointer to the view on which the name will be stored
+   * @param pValue Pointer to the view on which the value will be stored
+   * @return true if the entry exists
+   */
+  bool get(size_t index, HTTPStringView* pName, HTTPStringView* pValue) const;
+
+  size_t getCount() const;
+
+private:
+  struct Entry
+  {
+    uint16_t pos; //Name, followed by the value, in m_data
+    uint16_t nameLen;
+    uint16_t valueLen;
+  };
+
+  void evict(); //Oldest entry
+
+  char m_data[HTTP_HPACK_TABLE_SIZE];
+  Entry m_entries[HTTP_HPACK_TABLE_SIZE / 32]; //Ring, oldest first
+  size_t m_first;
+  size_t m_count;
+  size_t m_size; //As counted by HPACK
+  size_t m_maxSize;
+  size_t m_end; //End of the newest entry in m_data
+};
+
+/** HPACK decoder (RFC 7541), for the header blocks received on a connection
+ * Its dynamic table is shared by all the blocks, so that every block must be decoded, in order, even when its headers are not needed.
+ */
+class HTTPHpackDecoder
+{
+public:
+  HTTPHpackDecoder();
+
+  /** Decode a complete header block
+   * @param block Header block
+   * @param len Length of the block
+   * @param pVisitor Visitor called for each header, with views that are only valid during the call
+   * @return 0 on success, NET_PROTOCOL if the block is invalid (a connection error), NET_TOOSMALL if a Huffman-encoded string is longer than HTTP_HPACK_STRING_MAX_LEN
+   */
+  int decode(const char* block, size_t len, IHTTPHeaderVisitor* pVisitor);
+
+  /** Huffman-decode a string
+   * @param in Encoded string
+   * @param len Length of the encoded string
+   * @param out Buffer receiving the decoded string
+   * @param maxLen Size of the buffer
+   * @param pOutLen Pointer to the variable on which the length of the decoded string will be stored
+   * @return 0 on success, NET_PROTOCOL if the string is invalid, NET_TOOSMALL if the buffer is too small
+   */
+  static int decodeHuffman(const char* in, size_t len, char* out, size_t maxLen, size_t* pOutLen);
+
+private:
+  int decodeInt(const uint8_t** pIn, const uint8_t* end, int prefixBits, size_t* pValue);
+  int decodeString(const uint8_t** pIn, const uint8_t* end, HTTPStringView* pStr, size_t* pScratchPos);
+  int getEntry(size_t index, HTTPStringView* pName, HTTPStringView* pValue);
+
+  HTTPHpackTable m_table;
+  char m_scratch[HTTP_HPACK_STRING_MAX_LEN];
+};
+
+/** HPACK encoder (RFC 7541), for the header blocks sent on a connection
+ * A header sent before with HTTP_HPACK_INDEX costs a single byte; others are sent with the index of their name when it is known, and their
+ * strings are Huffman-encoded when that is shorter.
+ */
+class HTTPHpackEncoder
+{
+public:
+  HTTPHpackEncoder();
+
+  /** Set the size of the dynamic table allowed by the decoder (SETTINGS_HEADER_TABLE_SIZE), the table is at most HTTP_HPACK_TABLE_SIZE
+   * The change is signaled at the start of the next header block.
+   */
+  void setMaxSize(size_t maxSize);
+
+  /** Start a header block
+   * @param buf Buffer receiving the block
+   * @param maxLen Size of the buffer
+   * @return 0 on success, NET_TOOSMALL if the buffer is too small
+   */
+  int begin(char* buf, size_t maxLen);
+
+  /** Add a header to the block
+   * @param name Header name, in lowercase
+   * @param nameLen Length of the name
+   * @param value Header value
+   * @param valueLen Length of the value
+   * @param indexing Whether the header may be added to the dynamic tables
+   * @return 0 on success, NET_TOOSMALL if the buffer is too small (the block is then unusable, as the tables may have changed)
+   */
+  int add(const char* name, size_t nameLen, const char* value, size_t valueLen, HTTPHpackIndexing indexing = HTTP_HPACK_INDEX);
+
+  ///Length of the block
+  size_t getLength() const;
+
+  /** Huffman-encode a string
+   * @param in String to encode
+   * @param len Length of the string
+   * @param out Buffer receiving the encoded string, at least getHuffmanLength() long
+   */
+  static void encodeHuffman(const char* in, size_t len, char* out);
+
+  ///Length of a string once Huffman-encoded
+  static size_t getHuffmanLength(const char* in, size_t len);
+
+private:
+  int encodeInt(size_t value, int prefixBits, uint8_t flags);
+  int encodeString(const char* str, size_t len);
+  size_t find(const char* name, size_t nameLen, const char* value, size_t valueLen, bool* pFull); //Best index, 0 if the name is unknown
+
+  HTTPHpackTable m_table;
+  size_t m_maxSize; //Table size to use
+  size_t m_minSize; //Smallest size since the last block, signaled first when the size was reduced then increased
+  bool m_sizeChanged;
+  char* m_buf;
+  size_t m_maxLen;
+  size_t m_len;
+};
+
+#endif /* HTTPHPACK_H_ */
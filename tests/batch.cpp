@@ -0,0 +1,383 @@
+/* batch.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** Aggregator checks (HTTPBatch) against the /collect endpoint of server.py (Linux host build only)
+ * Batches must be posted on their thresholds, swapped when a half is full, kept when the server is unavailable,
+ * dropped when it rejects them, and accepted on any 2xx code without closing the connection;
+ * records added by concurrent producers must all be posted once, in order, or counted as dropped.
+ *
+ * Build (host): compile with every library source file, with the framework headers (core/fwk.h) in the include path, and link with -lpthread
+ * Run: python3 server.py 8080 & ./batch http://127.0.0.1:8080
+ */
+
+#include "core/fwk.h"
+#include "HTTPClient.h"
+#include "HTTPBatch.h"
+#include "data/HTTPBuffer.h"
+#include "util/HTTPTime.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <pthread.h>
+#include <unistd.h>
+
+#define PRODUCERS 4
+#define RECORDS_PER_PRODUCER 20000
+
+static int s_fails = 0;
+static const char* s_base;
+static unsigned int s_key; //Each case posts to its own /collect key
+
+static void check(bool ok, int line, const char* what)
+{
+  if(!ok)
+  {
+    s_fails++;
+    printf("FAIL line %d: %s\n", line, what);
+  }
+}
+
+#define CHECK(x) check((x), __LINE__, #x)
+
+//Endpoint of a new /collect key, answering with a code such as 201, 204 or 400, or with 503 the first times
+static void newCollector(HTTPEndpoint* pEndpoint, char* key, const char* reply)
+{
+  snprintf(key, 16, "%u", s_key++);
+  char url[128];
+  snprintf(url, sizeof(url), "%s/collect/%s/%s", s_base, key, reply);
+  pEndpoint->setUrl(url);
+}
+
+//Requests received for a key, as "<content type>|<body>" separated by NULs; returns their count
+static int getCollected(const char* key, HTTPBuffer* pBuffer)
+{
+  HTTPClient client;
+  char url[128];
+  snprintf(url, sizeof(url), "%s/collected/%s", s_base, key);
+  pBuffer->clear();
+  if( (client.get(url, pBuffer) != OK) || (pBuffer->getLength() == 0) )
+  {
+    return 0;
+  }
+  int count = 1;
+  for(size_t i = 0; i < pBuffer->getLength(); i++)
+  {
+    if(pBuffer->getData()[i] == '\0')
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+//Request number n (from 0) of a collected buffer
+static bool isCollected(HTTPBuffer* pBuffer, int n, const char* expected)
+{
+  const char* data = pBuffer->getData();
+  const char* end = data + pBuffer->getLength();
+  for(; (n > 0) && (data < end); n--)
+  {
+    data += strnlen(data, end - data) + 1;
+  }
+  return (data < end) && (strnlen(data, end - data) == strlen(expected)) && !memcmp(data, expected, strlen(expected));
+}
+
+//Connections accepted by the server so far
+static int getConnections()
+{
+  HTTPClient client;
+  char url[128];
+  char buf[16];
+  snprintf(url, sizeof(url), "%s/conns", s_base);
+  if(client.get(url, buf, sizeof(buf)) != OK)
+  {
+    return -1;
+  }
+  return atoi(buf);
+}
+
+struct Producer
+{
+  HTTPBatch* pBatch;
+  int id;
+  int added;
+};
+
+static void* produce(void* arg)
+{
+  Producer* pProducer = (Producer*)arg;
+  char record[32];
+  for(int i = 0; i < RECORDS_PER_PRODUCER; i++)
+  {
+    snprintf(record, sizeof(record), "t%d-%d", pProducer->id, i);
+    if(pProducer->pBatch->add(record) == OK)
+    {
+      pProducer->added++;
+    }
+    if((i % 8) == 0)
+    {
+      usleep(100);
+    }
+  }
+  return NULL;
+}
+
+static volatile bool s_stop;
+
+static void* flush(void* arg)
+{
+  HTTPBatch* pBatch = (HTTPBatch*)arg;
+  while(!s_stop)
+  {
+    pBatch->poll();
+    usleep(200);
+  }
+  return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 2)
+  {
+    printf("Usage: %s <server.py URL>\n", argv[0]);
+    return 2;
+  }
+  s_base = argv[1];
+  s_key = HTTPTime::getMs() ^ ((unsigned int)getpid() << 16);
+  char key[16];
+  HTTPBuffer collected(1 << 22);
+
+  //Count threshold, then what was added since with flush()
+  {
+    HTTPClient client;
+    HTTPEndpoint endpoint;
+    newCollector(&endpoint, key, "0");
+    HTTPBatch batch(client, endpoint, 1024);
+    batch.setThresholds(1024, 3);
+    CHECK(batch.add("r0") == OK);
+    CHECK(batch.add("r1") == OK);
+    CHECK(batch.poll() == OK);
+    CHECK(batch.getPosted() == 0);
+    CHECK(batch.add("r2") == OK);
+    CHECK(batch.poll() == OK);
+    CHECK(batch.getPosted() == 1);
+    CHECK(batch.add("last") == OK);
+    CHECK(batch.flush() == OK);
+    CHECK(batch.flush() == OK);
+    CHECK(batch.getPosted() == 2);
+    CHECK(getCollected(key, &collected) == 2);
+    CHECK(isCollected(&collected, 0, "text/plain|r0\nr1\nr2"));
+    CHECK(isCollected(&collected, 1, "text/plain|last"));
+  }
+
+  //Any 2xx code means the batch was accepted: it is not posted again, and the connection is kept
+  {
+    HTTPClient client;
+    client.setKeepAlive(true);
+    const char* codes[] = { "201", "202", "204" };
+    for(size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++)
+    {
+      HTTPEndpoint endpoint;
+      newCollector(&endpoint, key, codes[i]);
+      HTTPBatch batch(client, endpoint, 256);
+      CHECK(batch.add("a") == OK);
+      CHECK(batch.flush() == OK); //Opens the connection, reused from then on
+      int connections = getConnections();
+      CHECK(batch.add("b") == OK);
+      CHECK(batch.flush() == OK);
+      CHECK(batch.add("c") == OK);
+      CHECK(batch.flush() == OK);
+      CHECK(client.getHTTPResponseCode() == atoi(codes[i]));
+      CHECK(batch.getPosted() == 3);
+      CHECK(getConnections() == connections + 1); //Only the one counting them
+      CHECK(getCollected(key, &collected) == 3);
+    }
+  }
+
+  //Both halves full: the producer swaps them once, then drops records until a half is posted
+  {
+    HTTPClient client;
+    HTTPEndpoint endpoint;
+    newCollector(&endpoint, key, "0");
+    char arena[40];
+    HTTPBatch batch(client, endpoint, arena, sizeof(arena));
+    CHECK(batch.add("0123456789012345678901") == NET_INVALID); //Cannot fit in a half
+    int added = 0;
+    int dropped = 0;
+    for(int i = 0; i < 12; i++)
+    {
+      int ret = batch.add("abcd");
+      if(ret == OK)
+      {
+        added++;
+      }
+      else if(ret == NET_FULL)
+      {
+        dropped++;
+      }
+    }
+    CHECK(added == 8);
+    CHECK(dropped == 4);
+    CHECK(batch.getDropped() == 4);
+    CHECK(batch.poll() == OK); //The sealed half
+    CHECK(batch.getPosted() == 1);
+    CHECK(batch.add("more") == OK); //Swapped again, as the active half is still full
+    CHECK(batch.flush() == OK);
+    CHECK(batch.getPosted() == 3);
+    CHECK(getCollected(key, &collected) == 3);
+    CHECK(isCollected(&collected, 0, "text/plain|abcd\nabcd\nabcd\nabcd"));
+    CHECK(isCollected(&collected, 1, "text/plain|abcd\nabcd\nabcd\nabcd"));
+    CHECK(isCollected(&collected, 2, "text/plain|more"));
+  }
+
+  //Unavailable twice: the batch is kept, posted again once the window expired, and the next records wait for it
+  {
+    HTTPClient client;
+    HTTPEndpoint endpoint;
+    newCollector(&endpoint, key, "2");
+    HTTPBatch batch(client, endpoint, 256);
+    batch.setThresholds(256, 2, 100);
+    CHECK(batch.add("a") == OK);
+    CHECK(batch.add("b") == OK);
+    CHECK(batch.poll() != OK);
+    CHECK(batch.add("c") == OK);
+    CHECK(batch.poll() == OK); //Not due yet
+    CHECK(batch.getPosted() == 0);
+    HTTPTime::sleep(150);
+    CHECK(batch.poll() != OK);
+    HTTPTime::sleep(150);
+    CHECK(batch.poll() == OK);
+    CHECK(batch.getPosted() == 1);
+    CHECK(batch.add("d") == OK);
+    CHECK(batch.poll() == OK);
+    CHECK(batch.getPosted() == 2);
+    CHECK(batch.getDropped() == 0);
+    CHECK(getCollected(key, &collected) == 2);
+    CHECK(isCollected(&collected, 0, "text/plain|a\nb"));
+    CHECK(isCollected(&collected, 1, "text/plain|c\nd"));
+  }
+
+  //Rejected: sending it again would not help, so it is dropped and the half is free again
+  {
+    HTTPClient client;
+    HTTPEndpoint endpoint;
+    newCollector(&endpoint, key, "400");
+    HTTPBatch batch(client, endpoint, 256);
+    batch.setThresholds(256, 3);
+    CHECK(batch.add("x") == OK);
+    CHECK(batch.add("y") == OK);
+    CHECK(batch.add("z") == OK);
+    CHECK(batch.poll() == NET_PROTOCOL);
+    CHECK(client.getHTTPResponseCode() == 400);
+    CHECK(batch.getDropped() == 3);
+    CHECK(batch.getPosted() == 0);
+    CHECK(batch.add("w") == OK);
+    CHECK(batch.flush() == NET_PROTOCOL);
+    CHECK(batch.getDropped() == 4);
+  }
+
+  //Concurrent producers, never blocked, while another thread posts: every record is posted once and in order, or counted as dropped
+  {
+    HTTPClient client;
+    client.setKeepAlive(true);
+    HTTPEndpoint endpoint;
+    newCollector(&endpoint, key, "0");
+    HTTPBatch batch(client, endpoint, 8192);
+    batch.setThresholds(3000, 0, 20);
+    Producer producers[PRODUCERS];
+    pthread_t threads[PRODUCERS];
+    pthread_t flusher;
+    s_stop = false;
+    pthread_create(&flusher, NULL, flush, &batch);
+    for(int i = 0; i < PRODUCERS; i++)
+    {
+      producers[i].pBatch = &batch;
+      producers[i].id = i;
+      producers[i].added = 0;
+      pthread_create(&threads[i], NULL, produce, &producers[i]);
+    }
+    int added = 0;
+    for(int i = 0; i < PRODUCERS; i++)
+    {
+      pthread_join(threads[i], NULL);
+      added += producers[i].added;
+    }
+    s_stop = true;
+    pthread_join(flusher, NULL);
+    CHECK(batch.flush() == OK);
+    CHECK(batch.flush() == OK); //The half swapped in while the first flush posted
+
+    int requests = getCollected(key, &collected);
+    int received = 0;
+    bool ordered = true;
+    int last[PRODUCERS];
+    for(int i = 0; i < PRODUCERS; i++)
+    {
+      last[i] = -1;
+    }
+    //Records are separated by new lines within a request, and requests by NULs
+    const char* data = collected.getData();
+    const char* end = data + collected.getLength();
+    while(data < end)
+    {
+      const char* body = (const char*)memchr(data, '|', end - data);
+      if(body == NULL)
+      {
+        break;
+      }
+      data = body + 1;
+      while( (data < end) && (*data != '\0') )
+      {
+        int id;
+        int n;
+        if( (sscanf(data, "t%d-%d", &id, &n) == 2) && (id >= 0) && (id < PRODUCERS) && (n > last[id]) )
+        {
+          last[id] = n;
+        }
+        else
+        {
+          ordered = false; //Duplicated, reordered or corrupted
+        }
+        received++;
+        while( (data < end) && (*data != '\n') && (*data != '\0') )
+        {
+          data++;
+        }
+        if( (data < end) && (*data == '\n') )
+        {
+          data++;
+        }
+      }
+      data++;
+    }
+    printf("%d records added by %d producers, %u dropped, %u batches posted\n", added, PRODUCERS, (unsigned int)batch.getDropped(), (unsigned int)batch.getPosted());
+    CHECK(ordered);
+    CHECK(received == added);
+    CHECK(added + (int)batch.getDropped() == PRODUCERS * RECORDS_PER_PRODUCER);
+    CHECK((int)batch.getPosted() == requests);
+  }
+
+  printf("fails=%d\n", s_fails);
+  return (s_fails != 0) ? 1 : 0;
+}
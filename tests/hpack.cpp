@@ -0,0 +1,371 @@
+/* hpack.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** HPACK checks (HTTPHpackDecoder, HTTPHpackEncoder, HTTPHpackTable) against the examples of RFC 7541 Appendix C
+ * No server is needed.
+ *
+ * Build (host): compile with every library source file, with the framework headers (core/fwk.h) in the include path
+ * Run: ./hpack
+ */
+
+#include "core/fwk.h"
+#include "http2/HTTPHpack.h"
+
+#include <cstdio>
+#include <cstring>
+
+static int s_fails = 0;
+
+static void check(bool ok, int line, const char* what)
+{
+  if(!ok)
+  {
+    s_fails++;
+    printf("FAIL line %d: %s\n", line, what);
+  }
+}
+
+#define CHECK(x) check((x), __LINE__, #x)
+
+//Headers of a block as "name: value\n" lines
+class HeaderList : public IHTTPHeaderVisitor
+{
+public:
+  HeaderList() : m_len(0)
+  {
+    m_str[0] = '\0';
+  }
+
+  const char* get()
+  {
+    return m_str;
+  }
+
+  void clear()
+  {
+    m_len = 0;
+    m_str[0] = '\0';
+  }
+
+protected:
+  virtual void onHeader(const HTTPStringView& name, const HTTPStringView& value)
+  {
+    m_len += snprintf(m_str + m_len, sizeof(m_str) - m_len, "%.*s: %.*s\n", (int)name.len, name.ptr, (int)value.len, value.ptr);
+    if(m_len >= sizeof(m_str))
+    {
+      m_len = sizeof(m_str) - 1;
+    }
+  }
+
+private:
+  char m_str[1024];
+  size_t m_len;
+};
+
+static size_t fromHex(const char* hex, char* out)
+{
+  size_t len = 0;
+  for(; hex[0] && hex[1]; hex += 2)
+  {
+    unsigned int byte;
+    sscanf(hex, "%2x", &byte);
+    out[len++] = (char)byte;
+  }
+  return len;
+}
+
+static bool decodes(HTTPHpackDecoder* pDecoder, const char* hex, const char* headers)
+{
+  char block[512];
+  size_t len = fromHex(hex, block);
+  HeaderList list;
+  int ret = pDecoder->decode(block, len, &list);
+  if( (ret != OK) || strcmp(list.get(), headers) )
+  {
+    printf("Decoded %s (%d):\n%s", hex, ret, list.get());
+    return false;
+  }
+  return true;
+}
+
+static int decodeResult(const char* hex)
+{
+  HTTPHpackDecoder decoder;
+  char block[512];
+  size_t len = fromHex(hex, block);
+  return decoder.decode(block, len, NULL);
+}
+
+//Encode name/value pairs, NULL-terminated, and compare with the expected block
+static bool encodes(HTTPHpackEncoder* pEncoder, const char* const* headers, const char* hex)
+{
+  char block[512];
+  char expected[512];
+  size_t expectedLen = fromHex(hex, expected);
+  if(pEncoder->begin(block, sizeof(block)) != OK)
+  {
+    return false;
+  }
+  for(; headers[0] != NULL; headers += 2)
+  {
+    if(pEncoder->add(headers[0], strlen(headers[0]), headers[1], strlen(headers[1])) != OK)
+    {
+      return false;
+    }
+  }
+  if( (pEncoder->getLength() != expectedLen) || memcmp(block, expected, expectedLen) )
+  {
+    printf("Encoded ");
+    for(size_t i = 0; i < pEncoder->getLength(); i++)
+    {
+      printf("%02x", (uint8_t)block[i]);
+    }
+    printf(", expected %s\n", hex);
+    return false;
+  }
+  return true;
+}
+
+static bool hasEntry(const HTTPHpackTable& table, size_t index, const char* name, const char* value)
+{
+  HTTPStringView n;
+  HTTPStringView v;
+  return table.get(index, &n, &v) && (n.len == strlen(name)) && !memcmp(n.ptr, name, n.len) && (v.len == strlen(value)) && !memcmp(v.ptr, value, v.len);
+}
+
+//Requests of C.3 and C.4
+static const char* s_request1[] = { ":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com", NULL };
+static const char* s_request2[] = { ":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com", "cache-control", "no-cache", NULL };
+static const char* s_request3[] = { ":method", "GET", ":scheme", "https", ":path", "/index.html", ":authority", "www.example.com", "custom-key", "custom-value", NULL };
+#define REQUEST1 ":method: GET\n:scheme: http\n:path: /\n:authority: www.example.com\n"
+#define REQUEST2 REQUEST1 "cache-control: no-cache\n"
+#define REQUEST3 ":method: GET\n:scheme: https\n:path: /index.html\n:authority: www.example.com\ncustom-key: custom-value\n"
+
+//Responses of C.5 and C.6, with a 256-byte table
+static const char* s_response1[] = { ":status", "302", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:21 GMT", "location", "https://www.example.com", NULL };
+static const char* s_response2[] = { ":status", "307", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:21 GMT", "location", "https://www.example.com", NULL };
+static const char* s_response3[] = { ":status", "200", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:22 GMT", "location", "https://www.example.com",
+                                     "content-encoding", "gzip", "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1", NULL };
+#define RESPONSE1 ":status: 302\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:21 GMT\nlocation: https://www.example.com\n"
+#define RESPONSE2 ":status: 307\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:21 GMT\nlocation: https://www.example.com\n"
+#define RESPONSE3 ":status: 200\ncache-control: private\ndate: Mon, 21 Oct 2013 20:13:22 GMT\nlocation: https://www.example.com\n" \
+                  "content-encoding: gzip\nset-cookie: foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1\n"
+#define TABLE_256 "3fe101" //Dynamic table size update to 256, in place of SETTINGS_HEADER_TABLE_SIZE
+#define TABLE_1024 "3fe107" //Sent first by the encoder, as its table is HTTP_HPACK_TABLE_SIZE rather than the 4096 bytes of the decoder
+
+int main()
+{
+  //C.2: single representations, each with an empty table
+  {
+    HTTPHpackDecoder decoder;
+    CHECK(decodes(&decoder, "400a637573746f6d2d6b65790d637573746f6d2d686561646572", "custom-key: custom-header\n"));
+    CHECK(decodes(&decoder, "be", "custom-key: custom-header\n")); //Indexed with incremental indexing
+  }
+  {
+    HTTPHpackDecoder decoder;
+    CHECK(decodes(&decoder, "040c2f73616d706c652f70617468", ":path: /sample/path\n"));
+    CHECK(decodeResult("be") == NET_PROTOCOL); //Without indexing: the dynamic table is still empty
+    CHECK(decodes(&decoder, "100870617373776f726406736563726574", "password: secret\n"));
+    CHECK(decodes(&decoder, "82", ":method: GET\n"));
+  }
+
+  //C.3: requests without Huffman coding, sharing the table
+  {
+    HTTPHpackDecoder decoder;
+    CHECK(decodes(&decoder, "828684410f7777772e6578616d706c652e636f6d", REQUEST1));
+    CHECK(decodes(&decoder, "828684be58086e6f2d6361636865", REQUEST2));
+    CHECK(decodes(&decoder, "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565", REQUEST3));
+  }
+
+  //C.4: the same requests with Huffman coding, which the encoder produces byte for byte after its table size
+  {
+    HTTPHpackDecoder decoder;
+    CHECK(decodes(&decoder, "828684418cf1e3c2e5f23a6ba0ab90f4ff", REQUEST1));
+    CHECK(decodes(&decoder, "828684be5886a8eb10649cbf", REQUEST2));
+    CHECK(decodes(&decoder, "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf", REQUEST3));
+    HTTPHpackEncoder encoder;
+    CHECK(encodes(&encoder, s_request1, TABLE_1024 "828684418cf1e3c2e5f23a6ba0ab90f4ff"));
+    CHECK(encodes(&encoder, s_request2, "828684be5886a8eb10649cbf"));
+    CHECK(encodes(&encoder, s_request3, "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"));
+  }
+
+  //C.5: responses without Huffman coding, evicting entries from a 256-byte table
+  {
+    HTTPHpackDecoder decoder;
+    CHECK(decodes(&decoder, TABLE_256 "4803333032580770726976617465611d4d6f6e2c203231204f637420323031332032303a31333a323120474d546e1768747470733a2f2f7777772e6578616d706c652e636f6d", RESPONSE1));
+    CHECK(decodes(&decoder, "4803333037c1c0bf", RESPONSE2));
+    CHECK(decodes(&decoder, "88c1611d4d6f6e2c203231204f637420323031332032303a31333a323220474d54c05a04677a69707738666f6f3d4153444a4b48514b425a584f5157454f50495541585157454f49553b206d61782d6167653d333630303b2076657273696f6e3d31", RESPONSE3));
+  }
+
+  //C.6: the same responses with Huffman coding; the encoder only uses it when shorter, so "307" is sent as in C.5
+  {
+    HTTPHpackDecoder decoder;
+    CHECK(decodes(&decoder, TABLE_256 "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3", RESPONSE1));
+    CHECK(decodes(&decoder, "4883640effc1c0bf", RESPONSE2));
+    CHECK(decodes(&decoder, "88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007", RESPONSE3));
+    HTTPHpackEncoder encoder;
+    encoder.setMaxSize(256);
+    CHECK(encodes(&encoder, s_response1, TABLE_256 "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3"));
+    CHECK(encodes(&encoder, s_response2, "4803333037c1c0bf"));
+    CHECK(encodes(&encoder, s_response3, "88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007"));
+  }
+
+  //Dynamic table: the states of C.5 after each response, then size changes
+  {
+    HTTPHpackTable table;
+    table.setMaxSize(256);
+    for(const char* const* h = s_response1; h[0] != NULL; h += 2)
+    {
+      table.add(h[0], strlen(h[0]), h[1], strlen(h[1]));
+    }
+    CHECK(table.getCount() == 4); //222 bytes
+    CHECK(hasEntry(table, 0, "location", "https://www.example.com"));
+    CHECK(hasEntry(table, 3, ":status", "302"));
+    table.add(":status", 7, "307", 3); //Evicts :status 302
+    CHECK(table.getCount() == 4);
+    CHECK(hasEntry(table, 0, ":status", "307"));
+    CHECK(hasEntry(table, 3, "cache-control", "private"));
+    table.add("date", 4, "Mon, 21 Oct 2013 20:13:22 GMT", 29);
+    table.add("content-encoding", 16, "gzip", 4);
+    table.add("set-cookie", 10, "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1", 56);
+    CHECK(table.getCount() == 3); //215 bytes
+    CHECK(hasEntry(table, 0, "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"));
+    CHECK(hasEntry(table, 1, "content-encoding", "gzip"));
+    CHECK(hasEntry(table, 2, "date", "Mon, 21 Oct 2013 20:13:22 GMT"));
+    CHECK(!table.get(3, NULL, NULL));
+
+    table.setMaxSize(100); //Keeps the newest entry only (98 bytes)
+    CHECK(table.getCount() == 1);
+    CHECK(hasEntry(table, 0, "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"));
+    table.add("content-encoding", 16, "gzip", 4);
+    table.add("a", 1, "b", 1);
+    CHECK(table.getCount() == 2); //52 + 34 bytes
+    CHECK(hasEntry(table, 1, "content-encoding", "gzip"));
+    table.setMaxSize(60);
+    CHECK(table.getCount() == 1);
+    CHECK(hasEntry(table, 0, "a", "b"));
+    char big[128];
+    memset(big, 'x', sizeof(big));
+    table.add("big", 3, big, sizeof(big)); //Larger than the table: empties it
+    CHECK(table.getCount() == 0);
+    table.setMaxSize(0);
+    table.add("a", 1, "b", 1);
+    CHECK(table.getCount() == 0);
+  }
+
+  //Table size updates: only at the start of a block and within the allowed size; a reduction then an increase are both signaled
+  {
+    HTTPHpackDecoder decoder;
+    CHECK(decodes(&decoder, "3fe10182", ":method: GET\n"));
+    CHECK(decodeResult("823fe101") == NET_PROTOCOL);
+    CHECK(decodeResult("3fe11f") == NET_PROTOCOL); //4096 + ..., above HTTP_HPACK_TABLE_SIZE
+    CHECK(decodeResult("20be") == NET_PROTOCOL); //Table emptied by the update
+
+    HTTPHpackEncoder encoder;
+    HTTPHpackDecoder peer;
+    const char* header[] = { "custom-key", "custom-value", NULL };
+    char block[64];
+    HeaderList list;
+    CHECK(encodes(&encoder, header, TABLE_1024 "408825a849e95ba97d7f8925a849e95bb8e8b4bf"));
+    CHECK(decodes(&peer, TABLE_1024 "408825a849e95ba97d7f8925a849e95bb8e8b4bf", "custom-key: custom-value\n"));
+    encoder.setMaxSize(0);
+    encoder.setMaxSize(100);
+    CHECK(encodes(&encoder, header, "203f45408825a849e95ba97d7f8925a849e95bb8e8b4bf")); //Emptied, then 100: the entry is added again
+    CHECK(decodes(&peer, "203f45408825a849e95ba97d7f8925a849e95bb8e8b4bf", "custom-key: custom-value\n"));
+    CHECK(encodes(&encoder, header, "be"));
+    CHECK(encoder.begin(block, 1) == OK);
+    CHECK(encoder.add("custom-key", 10, "other", 5) == NET_TOOSMALL);
+  }
+
+  //Representations chosen by the encoder
+  {
+    HTTPHpackEncoder encoder;
+    HTTPHpackDecoder decoder;
+    char block[256];
+    HeaderList list;
+    CHECK(encoder.begin(block, sizeof(block)) == OK);
+    size_t pos = encoder.getLength(); //After the table size
+    CHECK(encoder.add("authorization", 13, "secret", 6, HTTP_HPACK_NEVER_INDEX) == OK);
+    CHECK( ((uint8_t)block[pos] == 0x1f) && ((uint8_t)block[pos + 1] == 0x08) ); //Never indexed, name index 23 (15 + 8)
+    pos = encoder.getLength();
+    CHECK(encoder.add("content-length", 14, "5", 1, HTTP_HPACK_NO_INDEX) == OK);
+    CHECK( ((uint8_t)block[pos] & 0xF0) == 0x00 ); //Without indexing, name from the static table
+    CHECK(encoder.add("x-trace", 7, "abc", 3, HTTP_HPACK_INDEX) == OK);
+    CHECK(decoder.decode(block, encoder.getLength(), &list) == OK);
+    CHECK(!strcmp(list.get(), "authorization: secret\ncontent-length: 5\nx-trace: abc\n"));
+    //Only the indexed one is in the tables
+    CHECK(encoder.begin(block, sizeof(block)) == OK);
+    CHECK(encoder.add("x-trace", 7, "abc", 3) == OK);
+    CHECK(encoder.add("authorization", 13, "secret", 6) == OK);
+    CHECK( (uint8_t)block[0] == 0xbe );
+    CHECK( encoder.getLength() > 2 );
+  }
+
+  //Huffman coding
+  {
+    const char* str = "www.example.com";
+    char encoded[32];
+    char decoded[32];
+    size_t len;
+    CHECK(HTTPHpackEncoder::getHuffmanLength(str, strlen(str)) == 12);
+    HTTPHpackEncoder::encodeHuffman(str, strlen(str), encoded);
+    char expected[16];
+    CHECK(!memcmp(encoded, expected, fromHex("f1e3c2e5f23a6ba0ab90f4ff", expected)));
+    CHECK(HTTPHpackDecoder::decodeHuffman(encoded, 12, decoded, sizeof(decoded), &len) == OK);
+    CHECK( (len == strlen(str)) && !memcmp(decoded, str, len) );
+    CHECK(HTTPHpackDecoder::decodeHuffman(encoded, 12, decoded, 10, &len) == NET_TOOSMALL);
+
+    //Every byte value, including the ones with the longest codes
+    char all[256];
+    char allEncoded[1024];
+    char allDecoded[256];
+    for(int i = 0; i < 256; i++)
+    {
+      all[i] = (char)i;
+    }
+    size_t allLen = HTTPHpackEncoder::getHuffmanLength(all, sizeof(all));
+    CHECK(allLen <= sizeof(allEncoded));
+    HTTPHpackEncoder::encodeHuffman(all, sizeof(all), allEncoded);
+    CHECK(HTTPHpackDecoder::decodeHuffman(allEncoded, allLen, allDecoded, sizeof(allDecoded), &len) == OK);
+    CHECK( (len == sizeof(all)) && !memcmp(all, allDecoded, len) );
+
+    //Padding longer than 7 bits, padding that is not the start of EOS, and EOS itself are invalid (RFC 7541 section 5.2)
+    CHECK(HTTPHpackDecoder::decodeHuffman("\x1f\xff", 2, decoded, sizeof(decoded), &len) == NET_PROTOCOL); //'a' then 11 bits of padding
+    CHECK(HTTPHpackDecoder::decodeHuffman("\x18", 1, decoded, sizeof(decoded), &len) == NET_PROTOCOL); //'a' then 000
+    CHECK(HTTPHpackDecoder::decodeHuffman("\xff\xff\xff\xff", 4, decoded, sizeof(decoded), &len) == NET_PROTOCOL);
+    CHECK(HTTPHpackDecoder::decodeHuffman("\x1f", 1, decoded, sizeof(decoded), &len) == OK); //'a' then 111
+    CHECK( (len == 1) && (decoded[0] == 'a') );
+  }
+
+  //Malformed blocks
+  {
+    CHECK(decodeResult("80") == NET_PROTOCOL); //Index 0
+    CHECK(decodeResult("ff00") == NET_PROTOCOL); //Index 127, beyond both tables
+    CHECK(decodeResult("ff") == NET_PROTOCOL); //Truncated integer
+    CHECK(decodeResult("ffffffffffffffffffff01") == NET_PROTOCOL); //Integer overflow
+    CHECK(decodeResult("400a6375") == NET_PROTOCOL); //Truncated string
+  }
+
+  printf("fails=%d\n", s_fails);
+  return (s_fails != 0) ? 1 : 0;
+}
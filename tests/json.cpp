@@ -0,0 +1,131 @@
+/* json.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** Streaming JSON parser checks (HTTPJson), fed as HTTPClient would feed it
+ * No server is needed.
+ *
+ * Build (host): compile with every library source file, with the framework headers (core/fwk.h) in the include path
+ * Run: ./json
+ */
+
+#include "core/fwk.h"
+#include "data/HTTPJson.h"
+
+#include <cstdio>
+#include <cstring>
+
+static int s_fails = 0;
+
+class Collector : public IHTTPJsonHandler
+{
+public:
+  Collector() : m_count(0)
+  {
+    m_last[0] = '\0';
+  }
+
+  int m_count;
+  HTTP_JSON_TYPE m_type;
+  char m_last[HTTPJSON_VALUE_MAX_LEN];
+
+protected:
+  virtual void onValue(const char* path, HTTP_JSON_TYPE type, const char* value, size_t len, bool truncated)
+  {
+    m_count++;
+    m_type = type;
+    strcpy(m_last, value);
+  }
+};
+
+//Exposes the sink interface that HTTPClient uses
+class TestJson : public HTTPJson
+{
+public:
+  TestJson(IHTTPJsonHandler* pHandler) : HTTPJson(pHandler) { }
+
+  using HTTPJson::write;
+  using HTTPJson::setDataLen;
+};
+
+//Feed the document in pieces of fragmentLen bytes, with or without a Content-Length
+static void checkDocument(const char* doc, size_t fragmentLen, bool lengthSet, bool callFinish, int count, HTTP_JSON_TYPE type, const char* last)
+{
+  Collector collector;
+  TestJson json(&collector);
+  size_t len = strlen(doc);
+  if(lengthSet)
+  {
+    json.setDataLen(len);
+  }
+  int ret = OK;
+  for(size_t pos = 0; (pos < len) && (ret == OK); pos += fragmentLen)
+  {
+    ret = json.write(doc + pos, MIN(fragmentLen, len - pos));
+  }
+  if( (ret == OK) && callFinish )
+  {
+    ret = json.finish();
+  }
+  if( (ret != OK) || !json.isComplete() || (collector.m_count != count) || ((count > 0) && ((collector.m_type != type) || strcmp(collector.m_last, last))) )
+  {
+    s_fails++;
+    printf("FAIL '%s' (%u bytes, length %d, finish %d) -> ret=%d complete=%d count=%d last=%s\n", doc, (unsigned int)fragmentLen, lengthSet, callFinish,
+      ret, json.isComplete(), collector.m_count, collector.m_last);
+  }
+}
+
+static void checkInvalid(const char* doc)
+{
+  Collector collector;
+  TestJson json(&collector);
+  json.setDataLen(strlen(doc));
+  if( (json.write(doc, strlen(doc)) == OK) && json.isComplete() ) //An incomplete document is not an error, but is not complete either
+  {
+    s_fails++;
+    printf("FAIL '%s' accepted\n", doc);
+  }
+}
+
+int main()
+{
+  //Root scalars end with the data: delivered once Content-Length bytes are written, or by finish()
+  for(size_t fragmentLen = 1; fragmentLen <= 4; fragmentLen++)
+  {
+    checkDocument("42", fragmentLen, true, false, 1, HTTP_JSON_NUMBER, "42");
+    checkDocument("-1.5e3", fragmentLen, true, false, 1, HTTP_JSON_NUMBER, "-1.5e3");
+    checkDocument("true", fragmentLen, true, false, 1, HTTP_JSON_TRUE, "true");
+    checkDocument("null", fragmentLen, true, false, 1, HTTP_JSON_NULL, "null");
+    checkDocument("false", fragmentLen, false, true, 1, HTTP_JSON_FALSE, "false");
+    checkDocument("7", fragmentLen, false, true, 1, HTTP_JSON_NUMBER, "7");
+  }
+  checkDocument(" 42 ", 1, false, false, 1, HTTP_JSON_NUMBER, "42");
+  checkDocument("\"s\"", 1, true, true, 1, HTTP_JSON_STRING, "s");
+  checkDocument("{\"a\":[1,true]}", 3, true, true, 2, HTTP_JSON_TRUE, "true");
+  checkDocument("[]", 1, false, true, 0, HTTP_JSON_ARRAY, "");
+  checkInvalid("tru");
+  checkInvalid("01");
+  checkInvalid("[1");
+
+  printf("fails=%d\n", s_fails);
+  return (s_fails != 0) ? 1 : 0;
+}
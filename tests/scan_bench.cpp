@@ -0,0 +1,282 @@
+/* scan_bench.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** CRLF search and chunk size parsing benchmark (HTTPScan)
+ * Compares HTTPScan::findCRLF() with a byte-by-byte scan, a plain memchr() loop and, on x86, the SSE2 and AVX2 loops
+ * HTTPScan used before memchr() was found to be faster on long lines. Every implementation is first checked against
+ * the byte-by-byte scan on random data, then timed over 1 MB of header lines, small chunks and long lines.
+ *
+ * Build (host): g++ -O2 -I.. -I<framework headers> scan_bench.cpp -o scan_bench (util/HTTPScan.cpp is included, not linked)
+ * Run: ./scan_bench
+ */
+
+#include "util/HTTPScan.cpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_BENCH_X86
+#include <immintrin.h>
+#endif
+
+typedef size_t (*FindCRLFFn)(const char* buf, size_t len);
+
+static int s_fails = 0;
+static volatile size_t s_sink; //Keeps the results alive
+
+static double now()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static size_t findCRLFScalar(const char* buf, size_t len)
+{
+  for(size_t i = 0; i + 1 < len; i++)
+  {
+    if( (buf[i] == '\r') && (buf[i + 1] == '\n') )
+    {
+      return i;
+    }
+  }
+  return len;
+}
+
+static size_t findCRLFPlainMemchr(const char* buf, size_t len)
+{
+  const char* end = buf + len;
+  for(const char* p = buf; (p = (const char*) memchr(p, '\r', end - p)) != NULL; p++)
+  {
+    if( (p + 1 < end) && (p[1] == '\n') )
+    {
+      return p - buf;
+    }
+  }
+  return len;
+}
+
+#ifdef SCAN_BENCH_X86
+static inline bool matchCRLF(const char* buf, size_t pos, size_t len, uint64_t mask, size_t* pCrlfPos) //mask has a bit set for each CR in the block at pos
+{
+  while(mask != 0)
+  {
+    size_t cr = pos + __builtin_ctzll(mask);
+    if( (cr + 1 < len) && (buf[cr + 1] == '\n') )
+    {
+      *pCrlfPos = cr;
+      return true;
+    }
+    mask &= mask - 1;
+  }
+  return false;
+}
+
+__attribute__((target("sse2"))) static size_t findCRLFSSE2(const char* buf, size_t len)
+{
+  const __m128i cr = _mm_set1_epi8('\r');
+  size_t pos = 0;
+  size_t crlfPos;
+  for( ; pos + 16 <= len; pos += 16)
+  {
+    unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(buf + pos)), cr));
+    if( (mask != 0) && matchCRLF(buf, pos, len, mask, &crlfPos) )
+    {
+      return crlfPos;
+    }
+  }
+  return findCRLFTail(buf, pos, len);
+}
+
+__attribute__((target("avx2"))) static size_t findCRLFAVX2(const char* buf, size_t len)
+{
+  const __m256i cr = _mm256_set1_epi8('\r');
+  size_t pos = 0;
+  size_t crlfPos;
+  for( ; pos + 64 <= len; pos += 64)
+  {
+    uint64_t lo = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buf + pos)), cr));
+    uint64_t hi = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buf + pos + 32)), cr));
+    uint64_t mask = lo | (hi << 32);
+    if( (mask != 0) && matchCRLF(buf, pos, len, mask, &crlfPos) )
+    {
+      return crlfPos;
+    }
+  }
+  for( ; pos + 32 <= len; pos += 32)
+  {
+    uint64_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(buf + pos)), cr));
+    if( (mask != 0) && matchCRLF(buf, pos, len, mask, &crlfPos) )
+    {
+      return crlfPos;
+    }
+  }
+  return findCRLFTail(buf, pos, len);
+}
+#endif
+
+struct Implementation
+{
+  const char* name;
+  FindCRLFFn fn;
+};
+
+static Implementation s_impls[] =
+{
+  { "scalar", findCRLFScalar },
+  { "memchr", findCRLFPlainMemchr },
+#ifdef SCAN_BENCH_X86
+  { "sse2", findCRLFSSE2 },
+  { "avx2", findCRLFAVX2 },
+#endif
+  { "HTTPScan", HTTPScan::findCRLF }
+};
+static const size_t s_implCount = sizeof(s_impls) / sizeof(s_impls[0]);
+
+static void checkImplementations()
+{
+  static char buf[300];
+  srand(1);
+  for(int i = 0; i < 200000; i++)
+  {
+    size_t offset = rand() % 32; //Unaligned starts
+    size_t len = rand() % 200;
+    for(size_t j = 0; j < len; j++)
+    {
+      int r = rand() % 12;
+      buf[offset + j] = (r == 0) ? '\r' : ((r == 1) ? '\n' : 'x');
+    }
+    size_t expected = findCRLFScalar(buf + offset, len);
+    for(size_t k = 1; k < s_implCount; k++)
+    {
+      if(s_impls[k].fn(buf + offset, len) != expected)
+      {
+        s_fails++;
+        printf("FAIL %s on %u bytes\n", s_impls[k].name, (unsigned int)len);
+      }
+    }
+  }
+}
+
+static void bench(const char* name, const char* data, size_t len)
+{
+  const int reps = 50;
+  printf("%-22s", name);
+  for(size_t k = 0; k < s_implCount; k++)
+  {
+    double start = now();
+    for(int r = 0; r < reps; r++)
+    {
+      size_t pos = 0;
+      while(pos < len)
+      {
+        pos += s_impls[k].fn(data + pos, len - pos);
+        s_sink = pos;
+        pos += 2;
+      }
+    }
+    printf(" %8.2f", (double)len * reps / (now() - start) / 1e9);
+  }
+  printf(" GB/s\n");
+}
+
+int main()
+{
+  printf("findCRLF() uses %s\n", HTTPScan::getImplementation());
+  checkImplementations();
+
+  static char data[1 << 20];
+  size_t len;
+  printf("%-22s", "");
+  for(size_t k = 0; k < s_implCount; k++)
+  {
+    printf(" %8s", s_impls[k].name);
+  }
+  printf("\n");
+
+  len = 0;
+  while(len + 64 < sizeof(data))
+  {
+    len += sprintf(data + len, "X-Header-%05d: value %d\r\n", rand() % 100000, rand());
+  }
+  bench("header lines (~30 B)", data, len);
+
+  len = 0;
+  while(len + 64 < sizeof(data))
+  {
+    len += sprintf(data + len, "8\r\n12345678\r\n");
+  }
+  bench("8-byte chunks", data, len);
+
+  len = 0;
+  while(len + 300 < sizeof(data))
+  {
+    len += sprintf(data + len, "100\r\n");
+    memset(data + len, 'a', 256);
+    len += 256;
+    len += sprintf(data + len, "\r\n");
+  }
+  bench("256-byte chunks", data, len);
+
+  len = 0;
+  while(len + 2100 < sizeof(data))
+  {
+    memset(data + len, 'a', 2046);
+    len += 2046;
+    len += sprintf(data + len, "\r\n");
+  }
+  bench("2 KB lines", data, len);
+
+  //Chunk sizes, with an extension
+  const char* sizes[] = { "8", "1a", "100", "fff;ext=1", "3E8" };
+  const int count = 5000000;
+  size_t sum = 0;
+  double start = now();
+  for(int i = 0; i < count; i++)
+  {
+    unsigned int value;
+    sscanf(sizes[i % 5], "%x", &value);
+    sum += value;
+  }
+  double sscanfTime = now() - start;
+  start = now();
+  for(int i = 0; i < count; i++)
+  {
+    size_t value;
+    HTTPScan::parseHex(sizes[i % 5], &value);
+    sum -= value;
+  }
+  double parseHexTime = now() - start;
+  if(sum != 0)
+  {
+    s_fails++;
+    printf("FAIL parseHex and sscanf disagree\n");
+  }
+  printf("chunk size: sscanf %.1f ns, parseHex %.1f ns\n", sscanfTime / count * 1e9, parseHexTime / count * 1e9);
+
+  printf("fails=%d\n", s_fails);
+  return (s_fails != 0) ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+# Local stand-in HTTP server for the drivers in this directory
+# Usage: python3 server.py <port> [split]
+# "split" sends every response in random 1-5 byte writes, as a segmenting network would
+import socket, sys, threading, time, random
+BODY = b"".join(b"line %05d of the body\n" % i for i in range(400))
+def chunked(body, sizes):
+    out = b""; i = 0; k = 0
+    while i < len(body):
+        n = sizes[k % len(sizes)]; k += 1
+        part = body[i:i+n]; out += b"%x;ext=1\r\n" % len(part) + part + b"\r\n"; i += n
+    return out + b"0\r\nTrailer: x\r\n\r\n"
+conns = [0]
+counters = {}
+def count(key):
+    counters[key] = counters.get(key, 0) + 1
+    return counters[key]
+def handle(c, mode):
+    conns[0] += 1
+    data = b""
+    drop = False
+    while True:
+        while b"\r\n\r\n" not in data:
+            d = c.recv(4096)
+            if not d: c.close(); return
+            data += d
+        head, data = data.split(b"\r\n\r\n", 1)
+        cl = 0
+        for l in head.split(b"\r\n"):
+            if l.lower().startswith(b"content-length:"): cl = int(l.split(b":")[1])
+        expect = b"expect: 100-continue" in head.lower()
+        path = head.split(b" ")[1]
+        if drop: c.close(); return
+        if path.startswith(b"/dropnext"): drop = True
+        if path.startswith(b"/failclose/"):
+            _, _, key, n = path.split(b"/")[:4]
+            if count(b"fc" + key) <= int(n): c.close(); return
+        if expect and path.startswith(b"/reject"):
+            c.sendall(b"HTTP/1.1 413 Payload Too Large\r\nContent-Length: 8\r\nConnection: close\r\n\r\ntoo big!"); c.close(); return
+        if expect and path.startswith(b"/e417"):
+            c.sendall(b"HTTP/1.1 417 Expectation Failed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"); c.close(); return
+        if expect and path.startswith(b"/echo"):
+            c.sendall(b"HTTP/1.1 103 Early Hints\r\nLink: </x>\r\n\r\nHTTP/1.1 100 Continue\r\n\r\n")
+        while len(data) < cl: data += c.recv(4096)
+        rest, data = data[:cl], data[cl:]
+        if not respond(c, mode, head, rest): c.close(); return
+def respond(c, mode, head, rest):
+    meth = head.split(b" ")[0]
+    path = head.split(b" ")[1]
+    keep = True
+    if path.startswith(b"/conns"):
+        resp = b"HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n" % len(b"%d" % conns[0]) + b"%d" % conns[0]
+    elif path.startswith(b"/redir/"):
+        n = int(path[7:])
+        loc = b"/redir/%d" % (n - 1) if n > 1 else b"/plain"
+        resp = b"HTTP/1.1 302 Found\r\nLocation: %s\r\nContent-Length: 5\r\n\r\nmoved" % loc
+    elif path.startswith(b"/rabs"):
+        resp = b"HTTP/1.1 301 Moved\r\nLocation: http://127.0.0.1:%d/chunked\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nmoved\r\n0\r\n\r\n" % PORT
+    elif path.startswith(b"/rrel/"):
+        resp = b"HTTP/1.1 303 See Other\r\nLocation: ../close\r\nConnection: close\r\n\r\n"
+        keep = False
+    elif path.startswith(b"/r307"):
+        resp = b"HTTP/1.1 307 Temporary\r\nLocation: /echo?m=%s\r\nContent-Length: 0\r\n\r\n" % meth
+    elif path.startswith(b"/r302post"):
+        resp = b"HTTP/1.1 302 Found\r\nLocation: /echo?m=%s\r\nContent-Length: 0\r\n\r\n" % meth
+    elif path.startswith(b"/loop"):
+        resp = b"HTTP/1.1 302 Found\r\nLocation: /loop\r\nContent-Length: 0\r\n\r\n"
+    elif path.startswith(b"/chunked"):
+        resp = b"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nTransfer-Encoding: chunked\r\nX-Some-Very-Long-Header-Name: 1\r\n\r\n" + chunked(BODY, [1, 2, 3, 250, 7, 1000])
+    elif path.startswith(b"/cookie"): #Header and trailer longer than the client's line buffer
+        resp = b"HTTP/1.1 200 OK\r\nSet-Cookie: s=%s\r\nContent-Type: text/plain\r\nTransfer-Encoding: chunked\r\n\r\n" % (b"c" * 6000) + chunked(BODY, [700]).replace(b"Trailer: x", b"Trailer: " + b"t" * 6000)
+    elif path.startswith(b"/longtype"):
+        resp = b"HTTP/1.1 200 OK\r\nContent-Type: text/%s\r\nContent-Length: %d\r\n\r\n" % (b"p" * 6000, len(BODY)) + BODY
+    elif path.startswith(b"/close"):
+        resp = b"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n" + BODY
+        keep = False
+    elif path.startswith(b"/echo") or path.startswith(b"/e417") or path.startswith(b"/silent"):
+        rest = b"%s %s%s " % (meth, path, b" expect" if b"expect: 100-continue" in head.lower() else b"") + rest
+        resp = b"HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n" % len(rest) + rest
+    elif path.startswith(b"/json"):
+        js = b'{"items":[' + b",".join(b'{"id":%d,"name":"item %d"}' % (i, i) for i in range(200)) + b']}'
+        resp = b"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n" + chunked(js, [5, 300, 1, 77])
+    elif path.startswith(b"/fail503/"):
+        _, _, key, n = path.split(b"/")[:4]
+        k = count(b"f5" + key)
+        if k <= int(n): resp = b"HTTP/1.1 503 Service Unavailable\r\nRetry-After: 0\r\nContent-Length: 4\r\n\r\nbusy"
+        else: resp = b"HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n" % len(b"%d %s" % (k, rest)) + b"%d %s" % (k, rest)
+    elif path.startswith(b"/fail429/"):
+        _, _, key, n = path.split(b"/")[:4]
+        k = count(b"f4" + key)
+        if k <= int(n): resp = b"HTTP/1.1 429 Too Many Requests\r\nContent-Length: 4\r\n\r\nslow"
+        else: resp = b"HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n" % len(b"%d" % k) + b"%d" % k
+    elif path.startswith(b"/failclose/"):
+        resp = b"HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n" % len(rest) + rest
+    elif path.startswith(b"/big/"):
+        _, _, key, n = path.split(b"/")[:4]; n = int(n); sent = 0; piece = b"x" * 65536
+        c.sendall(b"HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n" % n)
+        try:
+            while sent < n:
+                k = min(65536, n - sent); c.sendall(piece[:k]); sent += k; counters[b"big" + key] = sent
+        except OSError: pass
+        return False
+    elif path.startswith(b"/bigsent/"):
+        body = b"%d" % counters.get(b"big" + path.split(b"/")[2], 0)
+        resp = b"HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n" % len(body) + body
+    elif path.startswith(b"/sse/"):
+        sse(c, mode, head, path); return False
+    elif path.startswith(b"/collect/"):
+        _, _, key, fails = path.split(b"/")[:4]
+        k = count(b"co" + key)
+        ct = [l.split(b":", 1)[1].strip() for l in head.split(b"\r\n") if l.lower().startswith(b"content-type:")]
+        if fails == b"400": resp = b"HTTP/1.1 400 Bad Request\r\nContent-Length: 3\r\n\r\nbad"
+        elif fails in (b"201", b"202", b"204"): #Accepted with another success code than 200
+            counters.setdefault(b"cb" + key, []).append((ct[0] if ct else b"") + b"|" + rest)
+            resp = b"HTTP/1.1 204 No Content\r\n\r\n" if fails == b"204" else b"HTTP/1.1 %s Accepted\r\nContent-Length: 2\r\n\r\nok" % fails
+        elif k <= int(fails): resp = b"HTTP/1.1 503 Service Unavailable\r\nContent-Length: 4\r\n\r\nbusy"
+        else:
+            counters.setdefault(b"cb" + key, []).append((ct[0] if ct else b"") + b"|" + rest)
+            resp = b"HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"
+    elif path.startswith(b"/collected/"):
+        body = b"\x00".join(counters.get(b"cb" + path.split(b"/")[2], []))
+        resp = b"HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n" % len(body) + body
+    elif path.startswith(b"/unavail"):
+        resp = b"HTTP/1.1 503 Service Unavailable\r\nretry-after: 120\r\nContent-Length: 4\r\n\r\nbusy"
+    else:
+        resp = b"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nETag: \"abc\"\r\nx-custom:  v 1 \t\r\ncontent-length: %d\r\n\r\n" % len(BODY) + BODY
+    if mode == "split":
+        i = 0
+        while i < len(resp):
+            n = random.randint(1, 5); c.sendall(resp[i:i+n]); i += n; time.sleep(0.0002)
+    else:
+        c.sendall(resp)
+    return keep
+def sse(c, mode, head, path):
+    def out(b):
+        if mode == "split":
+            i = 0
+            while i < len(b): n = random.randint(1, 5); c.sendall(b[i:i+n]); i += n; time.sleep(0.0002)
+        else: c.sendall(b)
+    def ch(b): out(b"%x\r\n" % len(b) + b + b"\r\n")
+    hdrs = {}
+    for l in head.split(b"\r\n")[1:]:
+        k, v = l.split(b":", 1); hdrs[k.strip().lower()] = v.strip()
+    last = hdrs.get(b"last-event-id")
+    if hdrs.get(b"accept") != b"text/event-stream" or hdrs.get(b"cache-control") != b"no-cache":
+        out(b"HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n"); return
+    scen = path.split(b"/")[3]
+    if scen == b"text":
+        out(b"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 5\r\n\r\nhello"); return
+    if scen == b"resume" and last == b"3":
+        out(b"HTTP/1.1 204 No Content\r\n\r\n"); return
+    out(b"HTTP/1.1 200 OK\r\nContent-Type: Text/Event-Stream; charset=utf-8\r\nTransfer-Encoding: chunked\r\n\r\n")
+    try:
+        if scen == b"resume":
+            if last is None:
+                ch(b"\xef\xbb\xbf: comment\r\nretry: 100\nevent: greet\ndata: hello\ndata:  world\nid: 1\n\n")
+                ch(b"data: line\r\rdata:x\r")
+                ch(b"\n\r\nid: 2\ndata\nretry: 12x\nunknown: field\n\n")
+            elif last == b"2":
+                ch(b"data: resumed\nid: 3\n\ndata: incomplete\nid: 99\n")
+            else:
+                ch(b"data: unexpected %s\n\n" % last)
+            out(b"0\r\n\r\n")
+        elif scen == b"slow":
+            ch(b"data: a\n\n"); time.sleep(1.2); ch(b"data: b\n\n"); ch(b"event: stop\ndata: done\n\n"); time.sleep(5)
+        elif scen == b"idle":
+            ch(b"id: k%d\ndata: last=%s\n\n" % (count(b"sse" + path.split(b"/")[2]), last or b"none")); time.sleep(5)
+        elif scen == b"big":
+            ch(b"data: " + b"y" * 600 + b"\n\n" + b"data: after\n\n"); out(b"0\r\n\r\n")
+        elif scen == b"many":
+            ch(b"retry: 0\n" + b"".join(b"data: %d\n\n" % i for i in range(1000))); out(b"0\r\n\r\n")
+    except OSError: pass
+
+s = socket.socket(); s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+PORT = int(sys.argv[1])
+s.bind(("127.0.0.1", PORT)); s.listen(64)
+mode = sys.argv[2] if len(sys.argv) > 2 else ""
+while True:
+    c, _ = s.accept()
+    threading.Thread(target=handle, args=(c, mode), daemon=True).start()
@@ -0,0 +1,206 @@
+/* spool.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** Persistent spool checks (HTTPSpool) against the /collect endpoint of server.py (Linux host build only)
+ * Records must survive reopening the spool, leave it once the server accepted them with any 2xx code (on the same connection),
+ * stay in it when the server is unavailable, and be dropped when the server rejects them.
+ *
+ * Build (host): compile with every library source file, with the framework headers (core/fwk.h) in the include path
+ * Run: python3 server.py 8080 & ./spool http://127.0.0.1:8080
+ */
+
+#include "core/fwk.h"
+#include "HTTPClient.h"
+#include "HTTPSpool.h"
+#include "data/HTTPBuffer.h"
+#include "util/HTTPTime.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+
+static int s_fails = 0;
+static const char* s_base;
+static unsigned int s_key; //Each case posts to its own /collect key
+
+static void check(bool ok, int line, const char* what)
+{
+  if(!ok)
+  {
+    s_fails++;
+    printf("FAIL line %d: %s\n", line, what);
+  }
+}
+
+#define CHECK(x) check((x), __LINE__, #x)
+
+//Endpoint of a new /collect key, answering with a code such as 201, 204 or 400, or with 503 the first times
+static void newCollector(HTTPEndpoint* pEndpoint, char* key, const char* reply)
+{
+  snprintf(key, 16, "%u", s_key++);
+  char url[128];
+  snprintf(url, sizeof(url), "%s/collect/%s/%s", s_base, key, reply);
+  pEndpoint->setUrl(url);
+}
+
+//Requests received for a key ("<content type>|<body>", separated by NULs), the first one copied to first
+static int getCollected(const char* key, char* first, size_t maxFirstLen)
+{
+  HTTPClient client;
+  HTTPBuffer buffer(1 << 16);
+  char url[128];
+  snprintf(url, sizeof(url), "%s/collected/%s", s_base, key);
+  if( (client.get(url, &buffer) != OK) || (buffer.getLength() == 0) )
+  {
+    return 0;
+  }
+  const char* data = buffer.getData();
+  size_t len = buffer.getLength();
+  snprintf(first, maxFirstLen, "%.*s", (int)strnlen(data, len), data);
+  int count = 1;
+  for(size_t i = 0; i < len; i++)
+  {
+    if(data[i] == '\0')
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+//Connections accepted by the server so far
+static int getConnections()
+{
+  HTTPClient client;
+  char url[128];
+  char buf[16];
+  snprintf(url, sizeof(url), "%s/conns", s_base);
+  if(client.get(url, buf, sizeof(buf)) != OK)
+  {
+    return -1;
+  }
+  return atoi(buf);
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 2)
+  {
+    printf("Usage: %s <server.py URL>\n", argv[0]);
+    return 2;
+  }
+  s_base = argv[1];
+  s_key = HTTPTime::getMs() ^ ((unsigned int)getpid() << 16);
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/spool_%d.spool", (int)getpid());
+  unlink(path);
+
+  HTTPClient client;
+  client.setKeepAlive(true);
+  char key[16];
+  char first[256];
+
+  //Records survive closing the spool, and are posted oldest first, one per request
+  {
+    HTTPSpool spool;
+    CHECK(spool.append("x", 1) == NET_CLOSED);
+    CHECK(spool.open(path, 4096) == OK);
+    CHECK(spool.append("one", 3) == OK);
+    CHECK(spool.append("two", 3) == OK);
+    CHECK(spool.append("three", 5) == OK);
+  }
+  {
+    HTTPSpool spool;
+    CHECK(spool.open(path, 0) == OK);
+    CHECK(spool.getCount() == 3);
+    HTTPEndpoint endpoint;
+    newCollector(&endpoint, key, "0");
+    CHECK(spool.drain(client, endpoint) == OK);
+    CHECK(spool.getCount() == 0);
+    CHECK( (getCollected(key, first, sizeof(first)) == 3) && !strcmp(first, "text/plain|one") );
+  }
+
+  HTTPSpool spool;
+  CHECK(spool.open(path, 0) == OK);
+
+  //Any 2xx code means the records were accepted: they leave the spool and are not posted again, and the connection is kept
+  int connections = getConnections();
+  const char* codes[] = { "201", "202", "204" };
+  for(size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++)
+  {
+    HTTPEndpoint endpoint;
+    newCollector(&endpoint, key, codes[i]);
+    CHECK(spool.append("a", 1) == OK);
+    CHECK(spool.append("b", 1) == OK);
+    int ret = spool.drain(client, endpoint);
+    CHECK(ret == OK);
+    CHECK(spool.getCount() == 0);
+    CHECK(spool.drain(client, endpoint) == OK);
+    CHECK(getCollected(key, first, sizeof(first)) == 2);
+    if(ret != OK)
+    {
+      printf("Code %s: drain() returned %d\n", codes[i], ret);
+      while(spool.getCount() > 0) //Leave the spool empty for the next cases
+      {
+        HTTPEndpoint accepting;
+        newCollector(&accepting, key, "0");
+        spool.drain(client, accepting);
+      }
+    }
+  }
+  CHECK(getConnections() == connections + 1 + 3); //Only the ones counting and reading them
+  CHECK(spool.getDropped() == 0);
+
+  //Unavailable once: the records are kept, then posted in one batch
+  {
+    HTTPEndpoint endpoint;
+    newCollector(&endpoint, key, "1");
+    CHECK(spool.append("c", 1) == OK);
+    CHECK(spool.append("d", 1) == OK);
+    CHECK(spool.drain(client, endpoint, 1024) != OK);
+    CHECK(spool.getCount() == 2);
+    CHECK(spool.drain(client, endpoint, 1024) == OK);
+    CHECK(spool.getCount() == 0);
+    CHECK( (getCollected(key, first, sizeof(first)) == 1) && !strcmp(first, "text/plain|c\nd") );
+  }
+
+  //Rejected: sending them again would not help, so they are dropped
+  {
+    HTTPEndpoint endpoint;
+    newCollector(&endpoint, key, "400");
+    for(int i = 0; i < 3; i++)
+    {
+      CHECK(spool.append("e", 1) == OK);
+    }
+    CHECK(spool.drain(client, endpoint, 1024) == OK);
+    CHECK(spool.getCount() == 0);
+    CHECK(spool.getDropped() == 3);
+  }
+
+  spool.close();
+  unlink(path);
+
+  printf("fails=%d\n", s_fails);
+  return (s_fails != 0) ? 1 : 0;
+}
@@ -0,0 +1,253 @@
+/* sse.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** Server-Sent Events checks (HTTPEventStream) against the /sse endpoints of server.py (Linux host build only)
+ * Run it against both servers: in split mode every response arrives in random 1-5 byte reads, cutting lines, CRLFs and the BOM.
+ * Fields ended by CR, LF and CRLF, reconnection with Last-Event-ID after the retry delay the server set, a 204 ending the stream,
+ * events delivered as they arrive, the idle timeout, responses that are not event streams, oversized events and a pausing listener.
+ *
+ * Build (host): compile with every library source file, with the framework headers (core/fwk.h) in the include path
+ * Run: python3 server.py 8080 & python3 server.py 8081 split & ./sse http://127.0.0.1:8080 && ./sse http://127.0.0.1:8081
+ */
+
+#include "core/fwk.h"
+#include "HTTPClient.h"
+#include "HTTPEventStream.h"
+#include "util/HTTPTime.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+
+#define MAX_EVENTS 8 //Kept for checking, the others are only counted
+
+static int s_fails = 0;
+static const char* s_base;
+static unsigned int s_key; //Each case uses its own stream key
+
+static void check(bool ok, int line, const char* what)
+{
+  if(!ok)
+  {
+    s_fails++;
+    printf("FAIL line %d: %s\n", line, what);
+  }
+}
+
+#define CHECK(x) check((x), __LINE__, #x)
+
+class Listener : public IHTTPEventListener
+{
+public:
+  Listener() : m_count(0), m_ordered(true), m_disconnections(0), m_maxDisconnections(100), m_pauseOn(-1), m_pauses(0), m_stopType(NULL), m_stopAfter(-1)
+  {
+
+  }
+
+  bool isEvent(int index, const char* type, const char* data, const char* id)
+  {
+    return (index < m_count) && (index < MAX_EVENTS) && !strcmp(m_types[index], type) && !strcmp(m_data[index], data) && !strcmp(m_ids[index], id);
+  }
+
+  int m_count;
+  char m_types[MAX_EVENTS][HTTP_EVENT_STREAM_TYPE_MAX_LEN];
+  char m_data[MAX_EVENTS][64];
+  char m_ids[MAX_EVENTS][HTTP_EVENT_STREAM_ID_MAX_LEN];
+  uint32_t m_times[MAX_EVENTS];
+  bool m_ordered; //Data of each event is its index
+  int m_results[4]; //Of the first disconnections
+  int m_disconnections;
+  int m_maxDisconnections;
+  int m_pauseOn; //Event paused three times
+  int m_pauses;
+  const char* m_stopType;
+  int m_stopAfter;
+
+protected:
+  virtual int onEvent(const char* type, const char* data, size_t len, const char* id)
+  {
+    CHECK(strlen(data) == len);
+    if( (m_count == m_pauseOn) && (m_pauses < 3) )
+    {
+      m_pauses++;
+      return HTTP_DATA_PAUSE;
+    }
+    if(m_count < MAX_EVENTS)
+    {
+      snprintf(m_types[m_count], sizeof(m_types[m_count]), "%s", type);
+      snprintf(m_data[m_count], sizeof(m_data[m_count]), "%s", data);
+      snprintf(m_ids[m_count], sizeof(m_ids[m_count]), "%s", id);
+      m_times[m_count] = HTTPTime::getMs();
+    }
+    if(atoi(data) != m_count)
+    {
+      m_ordered = false;
+    }
+    m_count++;
+    if( (m_stopType != NULL) && !strcmp(type, m_stopType) )
+    {
+      return HTTP_DATA_ENOUGH;
+    }
+    if(m_count == m_stopAfter)
+    {
+      return HTTP_DATA_ENOUGH;
+    }
+    return OK;
+  }
+
+  virtual bool onDisconnected(int result)
+  {
+    if(m_disconnections < 4)
+    {
+      m_results[m_disconnections] = result;
+    }
+    m_disconnections++;
+    return m_disconnections < m_maxDisconnections;
+  }
+};
+
+static void streamUrl(char* url, size_t maxLen, const char* scenario)
+{
+  snprintf(url, maxLen, "%s/sse/%u/%s", s_base, s_key++, scenario);
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 2)
+  {
+    printf("Usage: %s <server.py URL>\n", argv[0]);
+    return 2;
+  }
+  s_base = argv[1];
+  s_key = HTTPTime::getMs() ^ ((unsigned int)getpid() << 16);
+  char url[128];
+
+  //BOM, comment, fields ended by CRLF, LF and CR, multi-line data, unknown fields and an invalid retry;
+  //the server ends the response, the stream is resumed with Last-Event-ID after 100 ms, then the server ends it with a 204
+  {
+    HTTPClient client;
+    HTTPEventStream stream;
+    Listener listener;
+    streamUrl(url, sizeof(url), "resume");
+    uint32_t start = HTTPTime::getMs();
+    CHECK(stream.run(client, url, &listener) == OK);
+    uint32_t elapsed = HTTPTime::elapsed(start);
+    CHECK(listener.m_count == 5);
+    CHECK(listener.isEvent(0, "greet", "hello\n world", "1"));
+    CHECK(listener.isEvent(1, "message", "line", "1"));
+    CHECK(listener.isEvent(2, "message", "x", "1"));
+    CHECK(listener.isEvent(3, "message", "", "2"));
+    CHECK(listener.isEvent(4, "message", "resumed", "3")); //The incomplete event at the end of the response is dropped
+    CHECK( (listener.m_disconnections == 2) && (listener.m_results[0] == OK) && (listener.m_results[1] == OK) );
+    CHECK(stream.getRetry() == 100);
+    CHECK(!strcmp(stream.getLastEventId(), "3"));
+    printf("Resumed twice in %u ms\n", (unsigned int)elapsed);
+    CHECK( (elapsed >= 200) && (elapsed < 1500) );
+  }
+
+  //Silent for longer than the request timeout: the idle timeout applies instead, and events are passed on as they arrive
+  {
+    HTTPClient client;
+    HTTPEventStream stream;
+    Listener listener;
+    listener.m_stopType = "stop";
+    streamUrl(url, sizeof(url), "slow");
+    uint32_t start = HTTPTime::getMs();
+    CHECK(stream.run(client, url, &listener, HTTP_WAIT_FOREVER, 500) == OK);
+    uint32_t elapsed = HTTPTime::elapsed(start);
+    CHECK(listener.m_count == 3);
+    CHECK(listener.m_disconnections == 0);
+    CHECK( (elapsed >= 1200) && (elapsed < 2500) );
+    CHECK(listener.m_times[0] - start < 300);
+    CHECK(listener.m_times[1] - listener.m_times[0] >= 1150);
+    //The body timeout is reset for the next requests
+    char buf[64];
+    snprintf(url, sizeof(url), "%s/echo", s_base);
+    CHECK(client.get(url, buf, sizeof(buf)) == OK);
+  }
+
+  //Idle for longer than the idle timeout: reconnects with the last ID, until the listener gives up
+  {
+    HTTPClient client;
+    HTTPEventStream stream;
+    Listener listener;
+    listener.m_maxDisconnections = 2;
+    stream.setLastEventId("start");
+    streamUrl(url, sizeof(url), "idle");
+    uint32_t start = HTTPTime::getMs();
+    CHECK(stream.run(client, url, &listener, 300) == NET_CONN);
+    uint32_t elapsed = HTTPTime::elapsed(start);
+    CHECK(listener.m_count == 2);
+    CHECK(listener.isEvent(0, "message", "last=start", "k1"));
+    CHECK(listener.isEvent(1, "message", "last=k1", "k2"));
+    CHECK( (listener.m_disconnections == 2) && (listener.m_results[0] == NET_CONN) );
+    CHECK( (elapsed >= 600) && (elapsed < 5000) );
+  }
+
+  //Not an event stream, or no server
+  {
+    HTTPClient client;
+    HTTPEventStream stream;
+    Listener listener;
+    streamUrl(url, sizeof(url), "text");
+    CHECK(stream.run(client, url, &listener) == NET_PROTOCOL);
+    CHECK( (listener.m_disconnections == 0) && (listener.m_count == 0) );
+  }
+  {
+    HTTPClient client;
+    HTTPEventStream stream;
+    Listener listener;
+    listener.m_maxDisconnections = 1;
+    CHECK(stream.run(client, "http://127.0.0.1:9/events", &listener, 300, 300) != OK);
+    CHECK(listener.m_disconnections == 1);
+  }
+
+  //An event larger than HTTP_EVENT_STREAM_DATA_MAX_LEN is dropped, the next one is passed on
+  {
+    HTTPClient client;
+    HTTPEventStream stream;
+    Listener listener;
+    listener.m_stopAfter = 1;
+    streamUrl(url, sizeof(url), "big");
+    CHECK(stream.run(client, url, &listener) == OK);
+    CHECK( (listener.m_count == 1) && !strcmp(listener.m_data[0], "after") );
+  }
+
+  //A listener pausing on an event gets it again, and nothing is lost or reordered
+  {
+    HTTPClient client;
+    HTTPEventStream stream;
+    Listener listener;
+    listener.m_pauseOn = 3;
+    listener.m_stopAfter = 1000;
+    streamUrl(url, sizeof(url), "many");
+    CHECK(stream.run(client, url, &listener) == OK);
+    CHECK(listener.m_pauses == 3);
+    CHECK(listener.m_count == 1000);
+    CHECK(listener.m_ordered);
+  }
+
+  printf("fails=%d\n", s_fails);
+  return (s_fails != 0) ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+/* stress.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** Response parser stress and throughput benchmark
+ * Fetches the same 9.2 KB body with a Content-Length, chunked (with extensions and trailers), delimited by the connection close
+ * and after a header and a trailer longer than the line buffer, which are skipped,
+ * while HTTPImpairment splits the incoming data at fixed, random or single-byte boundaries, adds latency or caps the bandwidth.
+ * Every body is compared with the expected one, and the reads count and throughput are printed for each case.
+ *
+ * Build (host): compile with every library source file, with the framework headers (core/fwk.h) in the include path
+ * Define HTTP_CLIENT_LOG_LEVEL=0 to keep the library logs out of the figures
+ * Run: python3 server.py 8080 & ./stress http://127.0.0.1:8080
+ * Against "python3 server.py 8081 split" the server also splits its writes, which the impairment splits again
+ */
+
+#include "core/fwk.h"
+#include "HTTPClient.h"
+#include "transport/HTTPImpairedTransport.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define BODY_LEN (400 * 23)
+
+static const char* s_paths[] = { "/plain", "/chunked", "/close", "/cookie" };
+
+//Sizes chosen to split CRLFs, chunk headers and chunk tails at every offset
+static const size_t s_fragments[] = { 1, 2, 3, 5, 255, 1 };
+
+enum Mode
+{
+  MODE_CLEAN,
+  MODE_FRAGMENTS,
+  MODE_RANDOM,
+  MODE_DRIP,
+  MODE_LATENCY,
+  MODE_BANDWIDTH,
+  MODE_COUNT
+};
+
+static const char* s_modeNames[MODE_COUNT] = { "clean", "fragments", "random", "drip", "latency", "bandwidth" };
+
+static void setMode(HTTPImpairment* pImpairment, int mode, uint32_t seed)
+{
+  pImpairment->reset();
+  switch(mode)
+  {
+  case MODE_FRAGMENTS:
+    pImpairment->setFragments(s_fragments, sizeof(s_fragments) / sizeof(s_fragments[0]));
+    break;
+  case MODE_RANDOM:
+    pImpairment->setRandomFragments(7, seed);
+    break;
+  case MODE_DRIP:
+    pImpairment->setDrip(0); //One byte per read
+    break;
+  case MODE_LATENCY:
+    pImpairment->setLatency(50);
+    pImpairment->setRandomFragments(1400, seed); //Cellular-like segments
+    break;
+  case MODE_BANDWIDTH:
+    pImpairment->setBandwidth(64 * 1024);
+    break;
+  default:
+    break;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if(argc < 2)
+  {
+    printf("Usage: %s <server base URL>\n", argv[0]);
+    return 2;
+  }
+
+  static char expected[BODY_LEN + 1];
+  size_t len = 0;
+  for(int i = 0; i < 400; i++)
+  {
+    len += sprintf(expected + len, "line %05d of the body\n", i);
+  }
+
+  int fails = 0;
+  for(int mode = 0; mode < MODE_COUNT; mode++)
+  {
+    for(size_t p = 0; p < sizeof(s_paths) / sizeof(s_paths[0]); p++)
+    {
+      HTTPDefaultTransport net;
+      HTTPImpairment impairment;
+      HTTPImpairedTransport transport(&net, &impairment);
+      HTTPClient client(&transport);
+      setMode(&impairment, mode, 42 + p);
+
+      static char result[BODY_LEN + 64];
+      memset(result, 0, sizeof(result));
+      char url[128];
+      snprintf(url, sizeof(url), "%s%s", argv[1], s_paths[p]);
+      int ret = client.get(url, result, sizeof(result), 10000);
+      bool ok = (ret == OK) && !strcmp(result, expected);
+      if(!ok)
+      {
+        fails++;
+      }
+      printf("%-10s %-9s %s ret=%d reads=%u bytes=%u elapsed=%u ms throughput=%u B/s\n", s_modeNames[mode], s_paths[p], ok ? "ok  " : "FAIL", ret,
+          (unsigned int) impairment.getReadsCount(), (unsigned int) impairment.getBytesRead(), (unsigned int) impairment.getElapsed(), (unsigned int) impairment.getReadThroughput());
+    }
+  }
+
+  //A header that the client needs cannot be skipped
+  {
+    HTTPClient client;
+    static char result[BODY_LEN + 64];
+    char url[128];
+    snprintf(url, sizeof(url), "%s/longtype", argv[1]);
+    int ret = client.get(url, result, sizeof(result), 10000);
+    printf("%-10s %-9s %s ret=%d\n", "clean", "/longtype", (ret == NET_PROTOCOL) ? "ok  " : "FAIL", ret);
+    if(ret != NET_PROTOCOL)
+    {
+      fails++;
+    }
+  }
+
+  printf("fails=%d\n", fails);
+  return (fails != 0) ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+/* tls.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** TLS handshake and session resumption check
+ * Connects several times to each server with a session cache, and checks that the first handshake is a full one and
+ * that the following ones resume the cached session. Every handshake with the servers listed after --no-resume must be
+ * reported as a full one.
+ *
+ * Build (host): compile with every library source file and HTTP_CLIENT_TLS defined, link with mbedTLS 2.x
+ * (-lmbedtls -lmbedx509 -lmbedcrypto)
+ * Run, e.g. against OpenSSL:
+ *   openssl req -x509 -newkey rsa:2048 -nodes -keyout key.pem -out cert.pem -subj /CN=localhost
+ *   openssl s_server -www -accept 8443 -cert cert.pem -key key.pem -tls1_2 & #Session tickets
+ *   openssl s_server -www -accept 8444 -cert cert.pem -key key.pem -tls1_2 -no_ticket & #Session IDs
+ *   openssl s_server -www -accept 8445 -cert cert.pem -key key.pem -tls1_2 -no_ticket -no_cache & #No resumption
+ *   ./tls cert.pem https://localhost:8443/ https://localhost:8444/ --no-resume https://localhost:8445/
+ */
+
+#include "core/fwk.h"
+#include "HTTPClient.h"
+#include "data/HTTPBuffer.h"
+#include "transport/HTTPTLSTransport.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define CONNECTIONS_COUNT 4
+
+static int run(const char* caPem, const char* url, bool expectResumption)
+{
+  HTTPDefaultTransport net;
+  HTTPTLSSessionCache cache;
+  HTTPTLSTransport tls(&net, &cache);
+  if( tls.setCACert(caPem) != OK )
+  {
+    printf("Could not parse the CA certificate\n");
+    return 1;
+  }
+  HTTPClient client;
+  client.setTLSTransport(&tls);
+
+  int fails = 0;
+  for(int i = 0; i < CONNECTIONS_COUNT; i++)
+  {
+    HTTPBuffer buffer(16384);
+    int ret = client.get(url, &buffer, 5000); //Not kept alive, so every request goes through a handshake
+    bool expected = (i > 0) && expectResumption;
+    bool ok = (ret == OK) && (tls.isResumed() == expected);
+    if(!ok)
+    {
+      fails++;
+    }
+    printf("%s #%d: %s ret=%d %s, handshake %u ms\n", url, i, ok ? "ok  " : "FAIL", ret, tls.isResumed() ? "resumed" : "full", (unsigned int) tls.getHandshakeTime());
+  }
+  printf("%s: %u handshakes, %u resumed, %u ms in total\n", url, (unsigned int) tls.getHandshakesCount(), (unsigned int) tls.getResumedCount(),
+      (unsigned int) tls.getTotalHandshakeTime());
+
+  //Without the cached session, the next handshake is a full one again
+  cache.clear();
+  HTTPBuffer buffer(16384);
+  int ret = client.get(url, &buffer, 5000);
+  if( (ret != OK) || tls.isResumed() )
+  {
+    printf("%s: FAIL after clearing the cache, ret=%d %s\n", url, ret, tls.isResumed() ? "resumed" : "full");
+    fails++;
+  }
+  return fails;
+}
+
+int main(int argc, char** argv)
+{
+  if(argc < 3)
+  {
+    printf("Usage: %s <CA certificate file> <URL>... [--no-resume <URL>...]\n", argv[0]);
+    return 2;
+  }
+
+  static char caPem[16384];
+  FILE* f = fopen(argv[1], "r");
+  if(f == NULL)
+  {
+    printf("Could not open %s\n", argv[1]);
+    return 2;
+  }
+  caPem[fread(caPem, 1, sizeof(caPem) - 1, f)] = '\0';
+  fclose(f);
+
+  int fails = 0;
+  bool expectResumption = true;
+  for(int i = 2; i < argc; i++)
+  {
+    if( !strcmp(argv[i], "--no-resume") )
+    {
+      expectResumption = false;
+      continue;
+    }
+    fails += run(caPem, argv[i], expectResumption);
+  }
+  printf("fails=%d\n", fails);
+  return (fails != 0) ? 1 : 0;
+}
@@ -0,0 +1,310 @@
+/* uring.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** io_uring transport checks and benchmark (Linux host build only)
+ * Fetches the bodies of stress.cpp with HTTPClient over HTTPUringTransport, cleanly and with random fragments, then measures
+ * the requests per second of keep-alive GETs: sequential requests over the default transport and over io_uring, and many
+ * connections driven by a single thread, receiving into buffers of their own (startRead()) or reading the ring's registered
+ * buffers in place (startReadFixed()). Every response is compared with the expected one, and the io_uring_enter() calls per
+ * submitted operation are printed for the batched cases.
+ *
+ * Build (host): compile with every library source file, with the framework headers (core/fwk.h) in the include path
+ * Define HTTP_CLIENT_LOG_LEVEL=0 to keep the library logs out of the figures
+ * Run: python3 server.py 8080 & ./uring http://127.0.0.1:8080 127.0.0.1 8080
+ */
+
+#include "core/fwk.h"
+#include "HTTPClient.h"
+#include "transport/HTTPUringTransport.h"
+#include "transport/HTTPImpairedTransport.h"
+#include "util/HTTPTime.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#define BODY_LEN (400 * 23)
+#define CONNECTIONS 16
+#define REQUESTS 2000 //Per case
+#define RESPONSE_MAX_LEN (BODY_LEN + 512)
+
+static const char* s_paths[] = { "/plain", "/chunked", "/close", "/cookie" };
+static const char s_request[] = "GET /plain HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+
+static int s_fails = 0;
+static char s_body[BODY_LEN + 1];
+static char s_response[RESPONSE_MAX_LEN]; //Full response to s_request, headers included
+static size_t s_responseLen = 0;
+
+static void check(bool ok, int line, const char* what)
+{
+  if(!ok)
+  {
+    s_fails++;
+    printf("FAIL line %d: %s\n", line, what);
+  }
+}
+
+#define CHECK(x) check((x), __LINE__, #x)
+
+static void fetchResponse(const HTTPAddress& addr) //Raw response to s_request, as the batched cases expect it
+{
+  HTTPUringRing ring;
+  HTTPUringTransport transport(&ring);
+  CHECK(transport.connect(addr, 2000) == OK);
+  CHECK(transport.write(s_request, strlen(s_request), 2000) == OK);
+  while(s_responseLen < sizeof(s_response))
+  {
+    size_t len;
+    if(transport.read(s_response + s_responseLen, 1, sizeof(s_response) - s_responseLen, &len, 2000) != OK)
+    {
+      break;
+    }
+    s_responseLen += len;
+    const char* end = (const char*)memmem(s_response, s_responseLen, "\r\n\r\n", 4);
+    if( (end != NULL) && (s_responseLen == (size_t)(end + 4 - s_response) + BODY_LEN) )
+    {
+      break;
+    }
+  }
+  CHECK( (s_responseLen > BODY_LEN) && !memcmp(s_response + s_responseLen - BODY_LEN, s_body, BODY_LEN) );
+}
+
+static void benchSequential(const char* name, IHTTPTransport* pTransport, const char* url)
+{
+  HTTPClient client(pTransport);
+  static char result[BODY_LEN + 64];
+  int fails = 0;
+  uint32_t start = HTTPTime::getMs();
+  for(int i = 0; i < REQUESTS; i++)
+  {
+    result[0] = '\0';
+    if( (client.get(url, result, sizeof(result), 2000) != OK) || strcmp(result, s_body) )
+    {
+      fails++;
+    }
+  }
+  uint32_t elapsed = HTTPTime::elapsed(start);
+  printf("%-24s %u requests/s\n", name, (unsigned int)(REQUESTS * 1000ULL / MAX(elapsed, 1)));
+  CHECK(fails == 0);
+}
+
+struct Connection
+{
+  HTTPUringTransport* pTransport;
+  char buf[4096]; //Receive buffer when the registered one is not used
+  size_t sent;
+  size_t received; //Position in s_response
+  bool done;
+};
+
+static void benchBatched(const char* name, const HTTPAddress& addr, bool fixed)
+{
+  HTTPUringRing ring;
+  static Connection conns[CONNECTIONS];
+  for(int i = 0; i < CONNECTIONS; i++)
+  {
+    conns[i].pTransport = new HTTPUringTransport(&ring);
+    CHECK(conns[i].pTransport->connect(addr, 2000) == OK);
+    if(fixed)
+    {
+      CHECK(conns[i].pTransport->getReadBuffer() != NULL); //HTTP_URING_BUFFERS is larger than CONNECTIONS
+    }
+    conns[i].sent = 0;
+    conns[i].received = 0;
+    conns[i].done = false;
+    CHECK(conns[i].pTransport->startWrite(s_request, strlen(s_request)) == OK);
+  }
+
+  int started = CONNECTIONS;
+  int completed = 0;
+  int active = CONNECTIONS;
+  int fails = 0;
+  uint32_t enters = ring.getEnterCount();
+  uint32_t submitted = ring.getSubmittedCount();
+  uint32_t start = HTTPTime::getMs();
+  while(active > 0)
+  {
+    if(ring.flush(true) != OK)
+    {
+      fails++;
+      break;
+    }
+    for(int i = 0; i < CONNECTIONS; i++)
+    {
+      Connection& conn = conns[i];
+      if(conn.done || !conn.pTransport->isDone())
+      {
+        continue;
+      }
+      size_t len;
+      int ret = conn.pTransport->getResult(&len);
+      if(ret != OK)
+      {
+        fails++;
+        conn.done = true;
+        active--;
+        continue;
+      }
+      if(conn.sent < strlen(s_request)) //Send completed
+      {
+        conn.sent += len;
+        ret = (conn.sent < strlen(s_request)) ? conn.pTransport->startWrite(s_request + conn.sent, strlen(s_request) - conn.sent) : OK;
+      }
+      else //Receive completed, the data is checked where it was received
+      {
+        const char* data = fixed ? conn.pTransport->getReadBuffer() : conn.buf;
+        if( (conn.received + len > s_responseLen) || memcmp(data, s_response + conn.received, len) )
+        {
+          fails++;
+          conn.done = true;
+          active--;
+          continue;
+        }
+        conn.received += len;
+        if(conn.received == s_responseLen)
+        {
+          completed++;
+          conn.received = 0;
+          conn.sent = 0;
+          if(started == REQUESTS)
+          {
+            conn.done = true;
+            active--;
+            continue;
+          }
+          started++;
+          ret = conn.pTransport->startWrite(s_request, strlen(s_request));
+          if(ret == OK)
+          {
+            continue;
+          }
+        }
+      }
+      if( (ret == OK) && (conn.sent == strlen(s_request)) )
+      {
+        ret = fixed ? conn.pTransport->startReadFixed(s_responseLen - conn.received) : conn.pTransport->startRead(conn.buf, MIN(sizeof(conn.buf), s_responseLen - conn.received));
+      }
+      if(ret != OK)
+      {
+        fails++;
+        conn.done = true;
+        active--;
+      }
+    }
+  }
+  uint32_t elapsed = HTTPTime::elapsed(start);
+  enters = ring.getEnterCount() - enters;
+  submitted = ring.getSubmittedCount() - submitted;
+  printf("%-24s %u requests/s, %u io_uring_enter() calls for %u operations\n", name, (unsigned int)(completed * 1000ULL / MAX(elapsed, 1)),
+      (unsigned int)enters, (unsigned int)submitted);
+  CHECK(fails == 0);
+  CHECK(completed == REQUESTS);
+  for(int i = 0; i < CONNECTIONS; i++)
+  {
+    delete conns[i].pTransport;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if(argc < 4)
+  {
+    printf("Usage: %s <server base URL> <server address> <server port>\n", argv[0]);
+    return 2;
+  }
+
+  size_t len = 0;
+  for(int i = 0; i < 400; i++)
+  {
+    len += sprintf(s_body + len, "line %05d of the body\n", i);
+  }
+
+  //Response parsing over io_uring, with reads split anywhere
+  HTTPUringRing ring;
+  for(int mode = 0; mode < 2; mode++)
+  {
+    for(size_t p = 0; p < sizeof(s_paths) / sizeof(s_paths[0]); p++)
+    {
+      HTTPUringTransport net(&ring);
+      HTTPImpairment impairment;
+      if(mode == 1)
+      {
+        impairment.setRandomFragments(7, 42 + p);
+      }
+      HTTPImpairedTransport transport(&net, &impairment);
+      HTTPClient client(&transport);
+
+      static char result[BODY_LEN + 64];
+      memset(result, 0, sizeof(result));
+      char url[128];
+      snprintf(url, sizeof(url), "%s%s", argv[1], s_paths[p]);
+      int ret = client.get(url, result, sizeof(result), 10000);
+      bool ok = (ret == OK) && !strcmp(result, s_body);
+      printf("%-10s %-9s %s ret=%d reads=%u\n", (mode == 1) ? "random" : "clean", s_paths[p], ok ? "ok  " : "FAIL", ret, (unsigned int) impairment.getReadsCount());
+      CHECK(ok);
+    }
+  }
+
+  //Readiness and errors
+  {
+    HTTPUringTransport transport(&ring);
+    HTTPAddress addr;
+    CHECK(transport.resolve(argv[2], atoi(argv[3]), &addr) == OK);
+    CHECK(transport.connect(addr, 2000) == OK);
+    char buf[16];
+    size_t readLen;
+    uint32_t start = HTTPTime::getMs();
+    CHECK(transport.read(buf, 1, sizeof(buf), &readLen, 300) == NET_TIMEOUT); //The server waits for a request
+    CHECK(HTTPTime::elapsed(start) >= 250);
+    CHECK(transport.wait(HTTP_WRITABLE, 300) == OK);
+    CHECK(transport.getReadBuffer() != NULL);
+    addr.port = 9;
+    CHECK(transport.connect(addr, 500) != OK);
+    CHECK(!transport.isConnected());
+    CHECK(transport.startReadFixed(16) == NET_CLOSED);
+  }
+
+  HTTPAddress addr;
+  {
+    HTTPUringTransport transport(&ring);
+    CHECK(transport.resolve(argv[2], atoi(argv[3]), &addr) == OK);
+  }
+  fetchResponse(addr);
+
+  char url[128];
+  snprintf(url, sizeof(url), "%s/plain", argv[1]);
+  {
+    HTTPDefaultTransport transport;
+    benchSequential("sequential, default", &transport, url);
+  }
+  {
+    HTTPUringTransport transport(&ring);
+    benchSequential("sequential, io_uring", &transport, url);
+  }
+  benchBatched("batched, startRead", addr, false);
+  benchBatched("batched, startReadFixed", addr, true);
+
+  printf("fails=%d\n", s_fails);
+  return (s_fails != 0) ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+/* url.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** URL parsing and reference resolution checks (HTTPEndpoint, and HTTPUrl when built as C++14)
+ * No server is needed.
+ *
+ * Build (host): compile with every library source file, with the framework headers (core/fwk.h) in the include path
+ * Run: ./url
+ */
+
+#include "core/fwk.h"
+#include "HTTPEndpoint.h"
+
+#include <cstdio>
+#include <cstring>
+
+static int s_fails = 0;
+
+static void checkUrl(const char* url, bool valid, const char* host, uint16_t port, const char* path)
+{
+  HTTPEndpoint endpoint(url);
+  bool ok = (endpoint.isValid() == valid);
+  if(ok && valid)
+  {
+    ok = !strcmp(endpoint.getHost(), host) && (endpoint.getPort() == port) && !strcmp(endpoint.getPath(), path);
+  }
+  if(!ok)
+  {
+    s_fails++;
+    printf("FAIL %s -> valid=%d host=%s port=%d path=%s\n", url, endpoint.isValid(), endpoint.getHost(), endpoint.getPort(), endpoint.getPath());
+  }
+}
+
+static void checkReference(const char* base, const char* ref, const char* host, const char* path, bool sameOrigin)
+{
+  HTTPEndpoint endpoint(base);
+  bool same;
+  int ret = endpoint.resolveReference(ref, &same);
+  if( (ret != OK) || strcmp(endpoint.getHost(), host) || strcmp(endpoint.getPath(), path) || (same != sameOrigin) )
+  {
+    s_fails++;
+    printf("FAIL %s + %s -> ret=%d host=%s path=%s same=%d\n", base, ref, ret, endpoint.getHost(), endpoint.getPath(), same);
+  }
+}
+
+static void checkAuthority(const char* url, const char* authority)
+{
+  HTTPEndpoint endpoint(url);
+  if( !endpoint.isValid() || strcmp(endpoint.getAuthority(), authority) )
+  {
+    s_fails++;
+    printf("FAIL %s -> valid=%d authority=%s\n", url, endpoint.isValid(), endpoint.getAuthority());
+  }
+}
+
+#if __cplusplus >= 201402L
+constexpr HTTPUrl s_url6("http://[::1]:8080/p");
+static_assert(s_url6.getHostLen() == 3, "IPv6 host without brackets");
+static_assert(s_url6.getPort() == 8080, "IPv6 port");
+static_assert(s_url6.getPathLen() == 2, "IPv6 path");
+constexpr HTTPUrl s_url("http://127.0.0.1:81/chunked?x=1#frag");
+static_assert(s_url.isValid(), "valid");
+static_assert(s_url.getPort() == 81, "port");
+static_assert(s_url.getHostLen() == 9, "host");
+static_assert(s_url.getPathLen() == 12, "path");
+#endif
+
+int main()
+{
+  checkUrl("http://example.com/a/b?c=d#e", true, "example.com", 80, "/a/b?c=d");
+  checkUrl("https://example.com", true, "example.com", 443, "/");
+  checkUrl("HTTP://h:8080?q", true, "h", 8080, "/?q");
+  checkUrl("http://h:8080/p:q", true, "h", 8080, "/p:q");
+  checkUrl("http://h/p:q", true, "h", 80, "/p:q");
+  checkUrl("http://h:99999/", false, "", 0, "");
+  checkUrl("http://h:/", false, "", 0, "");
+  checkUrl("http://h:8x/", false, "", 0, "");
+  checkUrl("ftp://h/", false, "", 0, "");
+  checkUrl("http:///p", false, "", 0, "");
+  checkUrl("nourl", false, "", 0, "");
+  //IPv6 addresses: the colons in brackets are not the port separator, and the brackets are not part of the host
+  checkUrl("http://[::1]:8080/", true, "::1", 8080, "/");
+  checkUrl("https://[2001:db8::a]/p:q", true, "2001:db8::a", 443, "/p:q");
+  checkUrl("http://[::ffff:192.0.2.1]?q", true, "::ffff:192.0.2.1", 80, "/?q");
+  checkUrl("http://[::1/", false, "", 0, "");
+  checkUrl("http://[::1]x/", false, "", 0, "");
+  checkUrl("http://[::1]:/", false, "", 0, "");
+  checkUrl("http://[]/", false, "", 0, "");
+  checkUrl("http://[host]/", false, "", 0, "");
+  checkAuthority("http://[::1]:8080/", "[::1]:8080");
+  checkAuthority("http://[::1]/", "[::1]");
+  checkAuthority("https://[::1]:443/", "[::1]");
+  checkAuthority("http://h:81/", "h:81");
+  checkAuthority("http://h/", "h");
+
+  checkReference("http://h/a/b/c", "d", "h", "/a/b/d", true);
+  checkReference("http://h/a/b/c", "../d?x", "h", "/a/d?x", true);
+  checkReference("http://h/a/b/c", "./", "h", "/a/b/", true);
+  checkReference("http://h/a/b/c", "/z", "h", "/z", true);
+  checkReference("http://h/a/b/c", "//k/z", "k", "/z", false);
+  checkReference("http://h/a", "http://H:80/q", "H", "/q", true);
+  checkReference("http://h/a", "https://h/q", "h", "/q", false);
+  checkReference("http://h/a", "//[::1]:81/z", "::1", "/z", false);
+  checkReference("http://[::1]/a/b", "c", "::1", "/a/c", true);
+  {
+    HTTPEndpoint endpoint("http://h/a");
+    bool same;
+    if( endpoint.resolveReference("svn+ssh.x-1://h/q", &same) == OK ) //Absolute, but not a supported scheme
+    {
+      s_fails++;
+      printf("FAIL unsupported scheme accepted\n");
+    }
+  }
+  //Not absolute: "://" does not follow a scheme at the start of the reference
+  checkReference("http://h/a/b/c", "d?next=http://k/z", "h", "/a/b/d?next=http://k/z", true);
+  checkReference("http://h/a/b/c", "/login?next=https://k/", "h", "/login?next=https://k/", true);
+  checkReference("http://h/a/b/c", "1http://k/z", "h", "/a/b/1http://k/z", true);
+  //Query only: same path, query replaced (RFC 3986 section 5.2.2)
+  checkReference("http://h/a/b/c", "?q=1", "h", "/a/b/c?q=1", true);
+  checkReference("http://h/a/b/c?old=1", "?q=1#f", "h", "/a/b/c?q=1", true);
+  checkReference("http://h", "?q=1", "h", "/?q=1", true);
+  //Fragment only, or empty: same document
+  checkReference("http://h/a/b/c?x=1", "#f", "h", "/a/b/c?x=1", true);
+  checkReference("http://h/a/b/c?x=1", "", "h", "/a/b/c?x=1", true);
+  //Signed redirection targets of CDNs, well beyond 256 chars, fit unless HTTP_ENDPOINT_PATH_MAX_LEN is lowered
+  {
+    char signature[401];
+    memset(signature, 'A', sizeof(signature) - 1);
+    signature[sizeof(signature) - 1] = '\0';
+    char path[HTTP_ENDPOINT_PATH_MAX_LEN];
+    snprintf(path, sizeof(path), "/dl/firmware.bin?Expires=1767225600&Signature=%s&Key-Pair-Id=APKAEIBAERJR2EXAMPLE", signature);
+    char target[HTTP_ENDPOINT_PATH_MAX_LEN + 64];
+    snprintf(target, sizeof(target), "https://d111111abcdef8.cloudfront.net%s", path);
+    checkUrl(target, true, "d111111abcdef8.cloudfront.net", 443, path);
+    checkReference("http://h/firmware", target, "d111111abcdef8.cloudfront.net", path, false);
+    checkReference("http://h/firmware", path, "h", path, true);
+
+    char tooLong[HTTP_ENDPOINT_PATH_MAX_LEN + 64];
+    memset(tooLong, 'a', sizeof(tooLong) - 1);
+    tooLong[0] = '/';
+    tooLong[sizeof(tooLong) - 1] = '\0';
+    HTTPEndpoint endpoint("http://h/firmware");
+    bool same;
+    if( endpoint.resolveReference(tooLong, &same) != NET_TOOSMALL )
+    {
+      s_fails++;
+      printf("FAIL path longer than HTTP_ENDPOINT_PATH_MAX_LEN accepted\n");
+    }
+  }
+
+#if __cplusplus >= 201402L
+  HTTPEndpoint endpoint(s_url);
+  if( strcmp(endpoint.getPath(), "/chunked?x=1") )
+  {
+    s_fails++;
+    printf("FAIL HTTPUrl path %s\n", endpoint.getPath());
+  }
+  if( strcmp(HTTPEndpoint(s_url6).getAuthority(), "[::1]:8080") )
+  {
+    s_fails++;
+    printf("FAIL HTTPUrl IPv6 authority %s\n", HTTPEndpoint(s_url6).getAuthority());
+  }
+  HTTPUrl bogus("bogus");
+  HTTPUrl bogus6("http://[::1/");
+  if( bogus.isValid() || HTTPEndpoint(bogus).isValid() || bogus6.isValid() )
+  {
+    s_fails++;
+    printf("FAIL HTTPUrl accepted a bogus URL\n");
+  }
+#endif
+
+  printf("fails=%d\n", s_fails);
+  return (s_fails != 0) ? 1 : 0;
+}
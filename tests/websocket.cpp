@@ -0,0 +1,370 @@
+/* websocket.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/** WebSocket client checks (HTTPWebSocket, HTTPClient::openWebSocket()) against ws_server.py
+ * Covers echo through send() and the send buffer, fragmentation both ways, pings, closing handshakes, protocol errors,
+ * refused handshakes, the frame overhead, and the entropy source of the handshake and masking keys.
+ *
+ * Build (host): compile with every library source file, with the framework headers (core/fwk.h) in the include path
+ * Run: python3 ws_server.py 8765 & python3 server.py 8080 & ./websocket 127.0.0.1:8765 http://127.0.0.1:8080
+ * Against "python3 ws_server.py 8766 split" the server splits its frames into small writes
+ */
+
+#include "core/fwk.h"
+#include "HTTPClient.h"
+#include "HTTPWebSocket.h"
+#include "util/HTTPSHA1.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define MESSAGE_MAX_LEN 100000
+
+static int s_fails = 0;
+static const char* s_server; //host:port of ws_server.py
+static char s_message[MESSAGE_MAX_LEN + 1];
+static size_t s_messageLen;
+
+static void check(bool ok, int line, const char* what)
+{
+  if(!ok)
+  {
+    s_fails++;
+    printf("FAIL line %d: %s\n", line, what);
+  }
+}
+
+#define CHECK(x) check((x), __LINE__, #x)
+
+//Gather a whole message in s_message, NULL-terminated
+static int recvMessage(HTTPWebSocket& ws, HTTPWebSocketOpcode* pOpcode = NULL, int* pPieces = NULL)
+{
+  s_messageLen = 0;
+  s_message[0] = '\0';
+  int pieces = 0;
+  bool final = false;
+  int ret = OK;
+  while(!final)
+  {
+    const char* data;
+    size_t len;
+    ret = ws.recv(&data, &len, pOpcode, &final, 3000);
+    if(ret != OK)
+    {
+      break;
+    }
+    if(s_messageLen + len > MESSAGE_MAX_LEN)
+    {
+      ret = NET_TOOSMALL;
+      break;
+    }
+    memcpy(s_message + s_messageLen, data, len);
+    s_messageLen += len;
+    s_message[s_messageLen] = '\0';
+    pieces++;
+  }
+  if(pPieces != NULL)
+  {
+    *pPieces = pieces;
+  }
+  return ret;
+}
+
+static bool isMessage(HTTPWebSocket& ws, const char* expected)
+{
+  return (recvMessage(ws) == OK) && (s_messageLen == strlen(expected)) && !memcmp(s_message, expected, s_messageLen);
+}
+
+static int open(HTTPClient& client, HTTPWebSocket& ws, const char* path, const char* protocol = NULL, const char* scheme = "ws")
+{
+  char url[96];
+  snprintf(url, sizeof(url), "%s://%s%s", scheme, s_server, path);
+  return client.openWebSocket(url, &ws, protocol);
+}
+
+//Counts up from 0, so that the keys drawn from it are known
+class CountingSource : public IHTTPEntropySource
+{
+public:
+  CountingSource() : m_next(0), m_calls(0), m_fail(false) { }
+
+  uint8_t m_next;
+  int m_calls;
+  bool m_fail;
+
+protected:
+  virtual int getEntropy(uint8_t* buf, size_t len)
+  {
+    m_calls++;
+    if(m_fail)
+    {
+      return NET_UNKNOWN;
+    }
+    for(size_t i = 0; i < len; i++)
+    {
+      buf[i] = m_next++;
+    }
+    return OK;
+  }
+};
+
+static void checkEcho()
+{
+  HTTPClient client;
+  HTTPWebSocket ws;
+  CHECK(!ws.isOpen());
+  CHECK(ws.send("x", 1) == NET_INVALID);
+  CHECK(open(client, ws, "/echo") == OK);
+  CHECK(ws.isOpen());
+
+  HTTPWebSocketOpcode opcode;
+  CHECK(ws.send("hello", 5) == OK);
+  CHECK(isMessage(ws, "hello"));
+
+  size_t maxLen;
+  char* buf = ws.getSendBuffer(&maxLen);
+  CHECK(maxLen == HTTP_WEBSOCKET_BUFFER_SIZE);
+  memcpy(buf, "\x01\x02\x00\x03", 4);
+  CHECK(ws.sendBuffer(4, HTTP_WS_BINARY) == OK);
+  CHECK( (recvMessage(ws, &opcode) == OK) && (s_messageLen == 4) && !memcmp(s_message, "\x01\x02\x00\x03", 4) && (opcode == HTTP_WS_BINARY) );
+
+  //Fragmented by the caller
+  buf = ws.getSendBuffer(&maxLen);
+  memcpy(buf, "part1-", 6);
+  CHECK(ws.sendBuffer(6, HTTP_WS_TEXT, false) == OK);
+  buf = ws.getSendBuffer(&maxLen);
+  memcpy(buf, "part2", 5);
+  CHECK(ws.sendBuffer(5, HTTP_WS_CONTINUATION, true) == OK);
+  CHECK(isMessage(ws, "part1-part2"));
+
+  //Larger than the buffer: fragmented by send(), and the 3000-byte frame sent back is received in pieces
+  static char big[3000];
+  for(size_t i = 0; i < sizeof(big); i++)
+  {
+    big[i] = 'a' + i % 26;
+  }
+  int pieces;
+  CHECK(ws.send(big, sizeof(big)) == OK);
+  CHECK( (recvMessage(ws, &opcode, &pieces) == OK) && (s_messageLen == sizeof(big)) && !memcmp(s_message, big, sizeof(big)) && (pieces > 1) );
+  CHECK(recvMessage(ws) == NET_TIMEOUT); //Nothing more, and the connection stays open
+  CHECK(ws.isOpen());
+
+  CHECK(ws.send("big:100000", 10) == OK);
+  CHECK( (recvMessage(ws, &opcode) == OK) && (s_messageLen == 100000) && (opcode == HTTP_WS_BINARY) );
+  bool same = true;
+  for(size_t i = 0; i < s_messageLen; i++)
+  {
+    same = same && ((unsigned char)s_message[i] == i % 251);
+  }
+  CHECK(same);
+
+  //Fragmented by the server with a ping in the middle, answered while receiving
+  CHECK(ws.send("frag", 4) == OK);
+  CHECK( (recvMessage(ws, &opcode, &pieces) == OK) && !strcmp(s_message, "abcdefghi") && (pieces == 3) );
+  CHECK(ws.send("ping:xyz", 8) == OK);
+  CHECK(isMessage(ws, "pong-ok"));
+
+  //Pong of a ping from the client, consumed by recv()
+  CHECK(ws.ping("p", 1) == OK);
+  CHECK(ws.send("after", 5) == OK);
+  CHECK(isMessage(ws, "after"));
+
+  //Overhead: 6 bytes of header per small message ("stats" returns the bytes received by the server)
+  CHECK(ws.send("stats", 5) == OK);
+  CHECK(recvMessage(ws) == OK);
+  long before = atol(s_message);
+  for(int i = 0; i < 10; i++)
+  {
+    CHECK(ws.send("0123456789", 10) == OK);
+  }
+  for(int i = 0; i < 10; i++)
+  {
+    CHECK(isMessage(ws, "0123456789"));
+  }
+  CHECK(ws.send("stats", 5) == OK);
+  CHECK(recvMessage(ws) == OK);
+  long after = atol(s_message);
+  printf("10 messages of 10 bytes: %ld bytes on the wire\n", after - before - 11);
+  CHECK(after - before == 10 * 16 + 11);
+
+  CHECK(ws.close() == OK);
+  CHECK(!ws.isOpen());
+  CHECK(ws.getCloseStatus() == 1000);
+  CHECK(ws.send("x", 1) == NET_INVALID);
+}
+
+static void checkClosing()
+{
+  //Closed by the server
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CHECK(open(client, ws, "/echo") == OK);
+    CHECK(ws.send("close", 5) == OK);
+    CHECK(recvMessage(ws) == NET_CLOSED);
+    CHECK(ws.getCloseStatus() == 1001);
+    CHECK(!ws.isOpen());
+  }
+  //Masked frame from the server: protocol error
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CHECK(open(client, ws, "/echo") == OK);
+    CHECK(ws.send("badframe", 8) == OK);
+    CHECK(recvMessage(ws) == NET_PROTOCOL);
+    CHECK(!ws.isOpen());
+    CHECK(ws.getCloseStatus() == 1002);
+  }
+}
+
+static void checkHandshakes(const char* httpUrl)
+{
+  //Frame sent together with the 101
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CHECK(open(client, ws, "/early") == OK);
+    CHECK(isMessage(ws, "hello"));
+    CHECK(ws.send("e", 1) == OK);
+    CHECK(isMessage(ws, "e"));
+  }
+  //Subprotocol, accepted or not
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CHECK(open(client, ws, "/echo", "telemetry") == OK);
+    CHECK(ws.send("p", 1) == OK);
+    CHECK(isMessage(ws, "p"));
+  }
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CHECK(open(client, ws, "/noproto", "telemetry") != OK);
+    CHECK(!ws.isOpen());
+  }
+  //Refused
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CHECK(open(client, ws, "/refuse") == NET_PROTOCOL);
+    CHECK(client.getHTTPResponseCode() == 403);
+    CHECK(!ws.isOpen());
+  }
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CHECK(open(client, ws, "/badaccept") == NET_PROTOCOL);
+    CHECK(!ws.isOpen());
+  }
+  //http:// URL, then the same client is used for a plain request
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CHECK(open(client, ws, "/echo", NULL, "http") == OK);
+    CHECK(ws.send("h", 1) == OK);
+    CHECK(isMessage(ws, "h"));
+    char url[96];
+    char buf[64];
+    snprintf(url, sizeof(url), "%s/echo", httpUrl);
+    CHECK(client.get(url, buf, sizeof(buf)) == OK);
+    CHECK(!strcmp(buf, "GET /echo "));
+  }
+}
+
+static void checkEntropy()
+{
+  //The handshake key and the masking keys are drawn from the source: bytes 0 to 15, then 16 to 19 for the first frame
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CountingSource source;
+    ws.setEntropySource(&source);
+    CHECK(open(client, ws, "/echo") == OK);
+    CHECK(ws.send("key", 3) == OK);
+    CHECK(isMessage(ws, "AAECAwQFBgcICQoLDA0ODw=="));
+    CHECK(ws.send("mask", 4) == OK);
+    CHECK(isMessage(ws, "14151617")); //The "key" frame used bytes 16 to 19, this one 20 to 23
+    for(int i = 0; i < 20; i++)
+    {
+      CHECK(ws.send("e", 1) == OK);
+      CHECK(isMessage(ws, "e"));
+    }
+    CHECK(source.m_calls == 2); //22 frames and the handshake key: 104 bytes, drawn 64 at a time
+  }
+  //A failing source: the connection still works, with keys from the fallback generator
+  {
+    HTTPClient client;
+    HTTPWebSocket ws;
+    CountingSource source;
+    source.m_fail = true;
+    ws.setEntropySource(&source);
+    CHECK(open(client, ws, "/echo") == OK);
+    CHECK(ws.send("f", 1) == OK);
+    CHECK(isMessage(ws, "f"));
+    CHECK(source.m_calls >= 1);
+  }
+  //Default source: two connections do not share their keys
+  {
+    HTTPClient client;
+    HTTPWebSocket ws1;
+    HTTPWebSocket ws2;
+    char key1[HTTP_WEBSOCKET_KEY_LEN + 1];
+    CHECK(open(client, ws1, "/echo") == OK);
+    CHECK(ws1.send("key", 3) == OK);
+    CHECK(recvMessage(ws1) == OK);
+    snprintf(key1, sizeof(key1), "%s", s_message);
+    HTTPClient client2;
+    CHECK(open(client2, ws2, "/echo") == OK);
+    CHECK(ws2.send("key", 3) == OK);
+    CHECK(recvMessage(ws2) == OK);
+    CHECK( (strlen(key1) == HTTP_WEBSOCKET_KEY_LEN) && strcmp(key1, s_message) );
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 3)
+  {
+    printf("Usage: %s <WebSocket server host:port> <HTTP server URL>\n", argv[0]);
+    return 2;
+  }
+  s_server = argv[1];
+
+  //SHA-1 of "abc" (FIPS 180-2), which the Sec-WebSocket-Accept check relies on
+  {
+    HTTPSHA1 sha1;
+    uint8_t digest[HTTP_SHA1_DIGEST_LEN];
+    sha1.update("abc", 3);
+    sha1.finish(digest);
+    CHECK( (digest[0] == 0xa9) && (digest[1] == 0x99) && (digest[19] == 0x9d) );
+  }
+
+  checkEcho();
+  checkClosing();
+  checkHandshakes(argv[2]);
+  checkEntropy();
+
+  printf("fails=%d\n", s_fails);
+  return (s_fails != 0) ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+# Local WebSocket echo server for websocket.cpp
+# Usage: python3 ws_server.py <port> [split]
+# "split" sends every frame in random 1-7 byte writes. Besides echoing, some messages are commands:
+# ping:<data>, frag, big:<n>, close, stats, badframe, and key / mask, which return the handshake key and the last masking key
+import socket, sys, threading, time, random, hashlib, base64, struct
+GUID = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+def frame(op, payload, fin=True):
+    h = bytes([(0x80 if fin else 0) | op]); n = len(payload)
+    if n < 126: h += bytes([n])
+    elif n < 65536: h += bytes([126]) + struct.pack(">H", n)
+    else: h += bytes([127]) + struct.pack(">Q", n)
+    return h + payload
+class Conn:
+    def __init__(s, c, split): s.c = c; s.buf = b""; s.split = split; s.rx = 0; s.key = b""; s.mask = b""
+    def send(s, data):
+        if s.split:
+            i = 0
+            while i < len(data): n = random.randint(1, 7); s.c.sendall(data[i:i+n]); i += n; time.sleep(0.0001)
+        else: s.c.sendall(data)
+    def need(s, n):
+        while len(s.buf) < n:
+            d = s.c.recv(65536)
+            if not d: raise EOFError
+            s.buf += d; s.rx += len(d)
+        out, s.buf = s.buf[:n], s.buf[n:]; return out
+    def read_frame(s):
+        b0, b1 = s.need(2); n = b1 & 0x7f
+        if n == 126: n = struct.unpack(">H", s.need(2))[0]
+        elif n == 127: n = struct.unpack(">Q", s.need(8))[0]
+        if not (b1 & 0x80): return None
+        key = s.need(4); s.mask = key; p = bytearray(s.need(n))
+        for i in range(n): p[i] ^= key[i & 3]
+        return b0 & 0x80, b0 & 0x0f, bytes(p)
+def handle(c, split):
+    data = b""
+    while b"\r\n\r\n" not in data:
+        d = c.recv(4096)
+        if not d: c.close(); return
+        data += d
+    head, rest = data.split(b"\r\n\r\n", 1)
+    lines = head.split(b"\r\n"); path = lines[0].split(b" ")[1]
+    hdr = {}
+    for l in lines[1:]:
+        k, v = l.split(b":", 1); hdr[k.strip().lower()] = v.strip()
+    if path.startswith(b"/refuse"):
+        c.sendall(b"HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n\r\n"); c.close(); return
+    if hdr.get(b"upgrade", b"").lower() != b"websocket" or hdr.get(b"sec-websocket-version") != b"13":
+        c.sendall(b"HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n"); c.close(); return
+    acc = base64.b64encode(hashlib.sha1(hdr[b"sec-websocket-key"] + GUID).digest())
+    if path.startswith(b"/badaccept"): acc = b"x" + acc[1:]
+    resp = b"HTTP/1.1 101 Switching Protocols\r\nUpgrade: WebSocket\r\nConnection: keep-alive, Upgrade\r\nSec-WebSocket-Accept: " + acc + b"\r\n"
+    if b"sec-websocket-protocol" in hdr and not path.startswith(b"/noproto"): resp += b"Sec-WebSocket-Protocol: " + hdr[b"sec-websocket-protocol"].split(b",")[0].strip() + b"\r\n"
+    resp += b"\r\n"
+    if path.startswith(b"/early"): resp += frame(1, b"hello")
+    conn = Conn(c, split); conn.buf = rest; conn.key = hdr[b"sec-websocket-key"]
+    conn.send(resp)
+    msg = b""; pending_ping = None
+    try:
+        while True:
+            f = conn.read_frame()
+            if f is None: conn.send(frame(8, struct.pack(">H", 1002))); break
+            fin, op, p = f
+            if op == 9: conn.send(frame(10, p)); continue
+            if op == 10:
+                if pending_ping is not None: conn.send(frame(1, b"pong-ok" if p == pending_ping else b"pong-bad")); pending_ping = None
+                continue
+            if op == 8: conn.send(frame(8, p[:2])); break
+            if op in (1, 2): msg = p; mop = op
+            else: msg += p
+            if not fin: continue
+            if msg.startswith(b"ping:"): pending_ping = msg[5:]; conn.send(frame(9, pending_ping)); continue
+            if msg == b"frag": conn.send(frame(1, b"abc", False) + frame(9, b"in-between") + frame(0, b"def", False) + frame(0, b"ghi")); continue
+            if msg.startswith(b"big:"): n = int(msg[4:]); conn.send(frame(2, bytes(i % 251 for i in range(n)))); continue
+            if msg == b"close": conn.send(frame(8, struct.pack(">H", 1001) + b"bye")); conn.read_frame(); break
+            if msg == b"stats": conn.send(frame(1, b"%d" % conn.rx)); continue
+            if msg == b"key": conn.send(frame(1, conn.key)); continue
+            if msg == b"mask": conn.send(frame(1, conn.mask.hex().encode())); continue
+            if msg == b"badframe": conn.send(b"\x81\x85abcdhello"); continue
+            conn.send(frame(mop, msg))
+    except (EOFError, OSError): pass
+    c.close()
+PORT = int(sys.argv[1]); split = len(sys.argv) > 2
+s = socket.socket(); s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1); s.bind(("127.0.0.1", PORT)); s.listen(64)
+while True:
+    c, _ = s.accept(); threading.Thread(target=handle, args=(c, split), daemon=True).start()
@@ -0,0 +1,377 @@
+/* HTTPEpollTransport.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifdef __linux__ //Linux host build only
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPEpollTransport.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPEpollTransport.h"
+#include "HTTPLinuxNet.h"
+#include "../util/HTTPTime.h"
+
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstring>
+
+HTTPEpollTransport::HTTPEpollTransport() : m_epfd(-1), m_sock(-1), m_interest(0)
+{
+
+}
+
+HTTPEpollTransport::~HTTPEpollTransport()
+{
+  close();
+  if(m_epfd >= 0)
+  {
+    ::close(m_epfd);
+  }
+}
+
+/*virtual*/ int HTTPEpollTransport::resolve(const char* host, uint16_t port, HTTPAddress* pAddr)
+{
+  return HTTPLinuxNet::resolve(host, port, pAddr);
+}
+
+/*virtual*/ int HTTPEpollTransport::resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount)
+{
+  return HTTPLinuxNet::resolveAll(host, port, pAddrs, maxCount, pCount);
+}
+
+/*virtual*/ int HTTPEpollTransport::connect(const HTTPAddress& addr, uint32_t timeout)
+{
+  size_t index;
+  return connectAny(&addr, 1, timeout, &index);
+}
+
+/*virtual*/ int HTTPEpollTransport::connectAny(const HTTPAddress* pAddrs, size_t count, uint32_t timeout, size_t* pIndex)
+{
+  close();
+
+  if(m_epfd < 0) //Created on first use, so that an unused transport holds no file descriptor
+  {
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(m_epfd < 0)
+    {
+      ERR("Could not create epoll instance (errno %d)", errno);
+      return NET_OOM;
+    }
+  }
+
+  //Happy Eyeballs (RFC 8305): the next address is tried when the attempts in progress did not succeed within HTTP_CONNECT_ATTEMPT_DELAY ms,
+  //or as soon as they all failed, without cancelling them; the first connection established wins
+  int socks[HTTP_CONNECT_MAX_ATTEMPTS];
+  count = MIN(count, HTTP_CONNECT_MAX_ATTEMPTS);
+  size_t started = 0;
+  size_t pending = 0;
+  int ret = NET_CONN;
+  uint32_t start = HTTPTime::getMs();
+  uint32_t nextAttempt = 0; //Relative to start
+  while(true)
+  {
+    uint32_t elapsed = HTTPTime::elapsed(start);
+    if( (started < count) && ((elapsed >= nextAttempt) || (pending == 0)) )
+    {
+      ret = startAttempt(pAddrs[started], started, &socks[started]);
+      if(ret == OK)
+      {
+        pending++;
+      }
+      started++;
+      nextAttempt = elapsed + HTTP_CONNECT_ATTEMPT_DELAY;
+      continue;
+    }
+
+    if(pending == 0)
+    {
+      ERR("Could not connect");
+      return (ret == NET_OOM) ? NET_OOM : NET_CONN;
+    }
+    if( (timeout != HTTP_WAIT_FOREVER) && (elapsed >= timeout) )
+    {
+      closeAttempts(socks, started);
+      ERR("Could not connect (%d)", NET_TIMEOUT);
+      return NET_TIMEOUT;
+    }
+
+    int waitTime = (timeout != HTTP_WAIT_FOREVER) ? (int)(timeout - elapsed) : -1;
+    if( (started < count) && ((waitTime < 0) || (nextAttempt - elapsed < (uint32_t)waitTime)) )
+    {
+      waitTime = nextAttempt - elapsed;
+    }
+    struct epoll_event evs[HTTP_CONNECT_MAX_ATTEMPTS];
+    int n = epoll_wait(m_epfd, evs, HTTP_CONNECT_MAX_ATTEMPTS, waitTime);
+    if( (n < 0) && (errno != EINTR) )
+    {
+      ERR("epoll_wait failed (errno %d)", errno);
+      closeAttempts(socks, started);
+      return NET_CONN;
+    }
+    for(int e = 0; e < n; e++)
+    {
+      size_t i = evs[e].data.u32;
+      if(socks[i] < 0)
+      {
+        continue;
+      }
+      int err = 0;
+      socklen_t errLen = sizeof(err);
+      getsockopt(socks[i], SOL_SOCKET, SO_ERROR, &err, &errLen);
+      if(err == 0)
+      {
+        DBG("Connected to address %d of %d (handle %d)", i + 1, count, socks[i]);
+        m_sock = socks[i];
+        socks[i] = -1;
+        closeAttempts(socks, started);
+        m_interest = HTTP_WRITABLE;
+        *pIndex = i;
+        return OK;
+      }
+      WARN("Could not connect to address %d of %d (errno %d)", (int)(i + 1), (int)count, err);
+      ::close(socks[i]); //Also removes it from the epoll set
+      socks[i] = -1;
+      pending--;
+      nextAttempt = 0; //Try the next address right away
+    }
+  }
+}
+
+/*virtual*/ int HTTPEpollTransport::read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout)
+{
+  DBG("Trying to read between %d and %d bytes", minLen, maxLen);
+  size_t readLen = 0;
+  *pReadLen = 0;
+  while(readLen < minLen)
+  {
+    ssize_t ret = ::recv(m_sock, buf + readLen, maxLen - readLen, 0);
+    if( ret > 0 )
+    {
+      readLen += ret;
+      *pReadLen = readLen; //Bytes already read are reported even if a later call fails
+      continue;
+    }
+    else if( ret == 0 )
+    {
+      WARN("Connection was closed by server");
+      return NET_CLOSED; //Connection was closed by server
+    }
+    else if( errno == EINTR )
+    {
+      continue;
+    }
+    else if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+    {
+      int waitRet = wait(HTTP_READABLE, timeout);
+      if(waitRet != OK)
+      {
+        return waitRet;
+      }
+    }
+    else
+    {
+      ERR("Connection error (recv errno %d)", errno);
+      return NET_CONN;
+    }
+  }
+  DBG("Read %d bytes", readLen);
+  return OK;
+}
+
+/*virtual*/ int HTTPEpollTransport::write(const char* buf, size_t len, uint32_t timeout)
+{
+  DBG("Trying to write %d bytes", len);
+  size_t writtenLen = 0;
+  while(writtenLen < len)
+  {
+    ssize_t ret = ::send(m_sock, buf + writtenLen, len - writtenLen, MSG_NOSIGNAL);
+    if( ret > 0 )
+    {
+      writtenLen += ret;
+      continue;
+    }
+    else if( (ret < 0) && (errno == EINTR) )
+    {
+      continue;
+    }
+    else if( (ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)) )
+    {
+      int waitRet = wait(HTTP_WRITABLE, timeout);
+      if(waitRet != OK)
+      {
+        return waitRet;
+      }
+    }
+    else if( (ret < 0) && (errno == EPIPE) )
+    {
+      WARN("Connection was closed by server");
+      return NET_CLOSED; //Connection was closed by server
+    }
+    else
+    {
+      ERR("Connection error (send errno %d)", errno);
+      return NET_CONN;
+    }
+  }
+  DBG("Written %d bytes", writtenLen);
+  return OK;
+}
+
+/*virtual*/ int HTTPEpollTransport::wait(int events, uint32_t timeout)
+{
+  if(m_sock < 0)
+  {
+    return NET_CLOSED;
+  }
+
+  if(events != m_interest) //Only touch the registration when switching between reading and writing
+  {
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = ((events & HTTP_READABLE) ? (uint32_t)EPOLLIN : (uint32_t)0) | ((events & HTTP_WRITABLE) ? (uint32_t)EPOLLOUT : (uint32_t)0);
+    ev.data.fd = m_sock;
+    if( epoll_ctl(m_epfd, EPOLL_CTL_MOD, m_sock, &ev) < 0 )
+    {
+      ERR("Could not update socket registration (errno %d)", errno);
+      return NET_CONN;
+    }
+    m_interest = events;
+  }
+
+  uint32_t start = HTTPTime::getMs();
+  while(true)
+  {
+    int waitTime = -1;
+    if(timeout != HTTP_WAIT_FOREVER)
+    {
+      uint32_t elapsed = HTTPTime::elapsed(start);
+      waitTime = (elapsed < timeout) ? (timeout - elapsed) : 0; //Poll at least once, so that a zero timeout checks the current state
+    }
+
+    struct epoll_event ev;
+    int ret = epoll_wait(m_epfd, &ev, 1, waitTime);
+    if(ret > 0)
+    {
+      return OK; //Errors and hang-ups are reported as ready so that the next read or write returns the actual condition
+    }
+    else if( (ret == 0) && (waitTime >= 0) && (HTTPTime::elapsed(start) >= timeout) )
+    {
+      if(timeout != 0) //A zero timeout is a readiness probe, which is expected to time out
+      {
+        WARN("Timeout");
+      }
+      return NET_TIMEOUT; //Timeout
+    }
+    else if( (ret < 0) && (errno != EINTR) )
+    {
+      ERR("epoll_wait failed (errno %d)", errno);
+      return NET_CONN;
+    }
+  }
+}
+
+int HTTPEpollTransport::startAttempt(const HTTPAddress& addr, size_t index, int* pSock) //Start connecting a non-blocking socket, 0 if in progress
+{
+  *pSock = -1;
+  struct sockaddr_storage serverAddr;
+  socklen_t serverAddrLen = HTTPLinuxNet::toSockAddr(addr, &serverAddr);
+
+  DBG("Creating socket");
+  int sock = ::socket(HTTPLinuxNet::getDomain(addr), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(sock < 0)
+  {
+    ERR("Could not create socket (errno %d)", errno);
+    return NET_OOM;
+  }
+
+  //Requests are made of several small writes, do not let Nagle's algorithm hold them back waiting for ACKs
+  int one = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  struct epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLOUT;
+  ev.data.u32 = index;
+  if( epoll_ctl(m_epfd, EPOLL_CTL_ADD, sock, &ev) < 0 )
+  {
+    ERR("Could not register socket (errno %d)", errno);
+    ::close(sock);
+    return NET_OOM;
+  }
+
+  DBG("Connecting socket (handle %d)", sock);
+  if( (::connect(sock, (const struct sockaddr *)&serverAddr, serverAddrLen) < 0) && (errno != EINPROGRESS) )
+  {
+    WARN("Could not connect (errno %d)", errno);
+    ::close(sock);
+    return NET_CONN;
+  }
+  *pSock = sock; //Connected or in progress, either way epoll reports it writable
+  return OK;
+}
+
+void HTTPEpollTransport::closeAttempts(int* socks, size_t count)
+{
+  for(size_t i = 0; i < count; i++)
+  {
+    if(socks[i] >= 0)
+    {
+      ::close(socks[i]);
+      socks[i] = -1;
+    }
+  }
+}
+
+/*virtual*/ int HTTPEpollTransport::close()
+{
+  if(m_sock >= 0)
+  {
+    ::close(m_sock); //Also removes it from the epoll set
+    m_sock = -1;
+  }
+  m_interest = 0;
+  return OK;
+}
+
+/*virtual*/ bool HTTPEpollTransport::isConnected()
+{
+  return (m_sock >= 0);
+}
+
+int HTTPEpollTransport::getFd()
+{
+  return m_sock;
+}
+
+#endif
@@ -0,0 +1,78 @@
+/* HTTPEpollTransport.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPEPOLLTRANSPORT_H_
+#define HTTPEPOLLTRANSPORT_H_
+
+#include "../IHTTPTransport.h"
+
+#define HTTP_CONNECT_ATTEMPT_DELAY 250 //Time in ms given to a connection attempt before the next address is tried as well (RFC 8305)
+#define HTTP_CONNECT_MAX_ATTEMPTS 8 //Addresses tried by connectAny()
+
+/** Transport over native Linux sockets
+ * The socket is non-blocking: reads and writes are attempted directly and epoll is only used to wait for readiness
+ * once the kernel reports that the operation would block, so a transfer that keeps up with the network makes no extra syscalls.
+ */
+class HTTPEpollTransport : public IHTTPTransport
+{
+public:
+  ///Instantiate the transport
+  HTTPEpollTransport();
+  virtual ~HTTPEpollTransport();
+
+  //IHTTPTransport
+  virtual int resolve(const char* host, uint16_t port, HTTPAddress* pAddr);
+
+  virtual int resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount);
+
+  virtual int connect(const HTTPAddress& addr, uint32_t timeout);
+
+  /** Race connections to the addresses, starting a new attempt every HTTP_CONNECT_ATTEMPT_DELAY ms until one succeeds (Happy Eyeballs)
+   */
+  virtual int connectAny(const HTTPAddress* pAddrs, size_t count, uint32_t timeout, size_t* pIndex);
+
+  virtual int read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout);
+
+  virtual int write(const char* buf, size_t len, uint32_t timeout);
+
+  virtual int wait(int events, uint32_t timeout);
+
+  virtual int close();
+
+  virtual bool isConnected();
+
+  /** Get the underlying socket, e.g. to register it with an external event loop
+   * @return The socket's file descriptor, or -1 if not connected
+   */
+  int getFd();
+
+private:
+  int startAttempt(const HTTPAddress& addr, size_t index, int* pSock); //Start connecting a non-blocking socket, 0 if in progress
+  void closeAttempts(int* socks, size_t count);
+
+  int m_epfd;
+  int m_sock;
+  int m_interest; //Events the socket is currently registered for (HTTPTransportEvent flags)
+};
+
+#endif /* HTTPEPOLLTRANSPORT_H_ */
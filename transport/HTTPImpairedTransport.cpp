@@ -0,0 +1,114 @@
+/* HTTPImpairedTransport.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPImpairedTransport.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPImpairedTransport.h"
+
+HTTPImpairedTransport::HTTPImpairedTransport(IHTTPTransport* pTransport, HTTPImpairment* pImpairment) :
+m_pTransport(pTransport), m_pImpairment(pImpairment)
+{
+
+}
+
+/*virtual*/ int HTTPImpairedTransport::resolve(const char* host, uint16_t port, HTTPAddress* pAddr)
+{
+  return m_pTransport->resolve(host, port, pAddr);
+}
+
+/*virtual*/ int HTTPImpairedTransport::resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount)
+{
+  return m_pTransport->resolveAll(host, port, pAddrs, maxCount, pCount);
+}
+
+/*virtual*/ int HTTPImpairedTransport::connect(const HTTPAddress& addr, uint32_t timeout)
+{
+  return m_pTransport->connect(addr, timeout);
+}
+
+/*virtual*/ int HTTPImpairedTransport::connectAny(const HTTPAddress* pAddrs, size_t count, uint32_t timeout, size_t* pIndex)
+{
+  return m_pTransport->connectAny(pAddrs, count, timeout, pIndex);
+}
+
+/*virtual*/ int HTTPImpairedTransport::read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout)
+{
+  size_t readLen = 0;
+  *pReadLen = 0;
+  do //Deliver at most one fragment per underlying read
+  {
+    size_t fragmentLen;
+    int ret = m_pTransport->read(buf + readLen, 1, m_pImpairment->limitRead(maxLen - readLen), &fragmentLen, timeout);
+    if(fragmentLen > 0)
+    {
+      m_pImpairment->onRead(fragmentLen);
+      readLen += fragmentLen;
+      *pReadLen = readLen;
+    }
+    if(ret != OK)
+    {
+      return ret;
+    }
+  } while(readLen < minLen);
+  return OK;
+}
+
+/*virtual*/ int HTTPImpairedTransport::write(const char* buf, size_t len, uint32_t timeout)
+{
+  size_t writtenLen = 0;
+  while(writtenLen < len)
+  {
+    size_t writeLen = m_pImpairment->limitWrite(len - writtenLen);
+    int ret = m_pTransport->write(buf + writtenLen, writeLen, timeout);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    m_pImpairment->onWrite(writeLen);
+    writtenLen += writeLen;
+  }
+  return OK;
+}
+
+/*virtual*/ int HTTPImpairedTransport::wait(int events, uint32_t timeout)
+{
+  return m_pTransport->wait(events, timeout);
+}
+
+/*virtual*/ int HTTPImpairedTransport::close()
+{
+  return m_pTransport->close();
+}
+
+/*virtual*/ bool HTTPImpairedTransport::isConnected()
+{
+  return m_pTransport->isConnected();
+}
@@ -0,0 +1,73 @@
+/* HTTPImpairedTransport.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPIMPAIREDTRANSPORT_H_
+#define HTTPIMPAIREDTRANSPORT_H_
+
+#include "../IHTTPTransport.h"
+#include "../util/HTTPImpairment.h"
+
+/** Transport that runs another transport through an HTTPImpairment emulator
+ * Meant for parser stress tests and benchmarks, e.g.:
+ * @code
+ * HTTPEpollTransport net;
+ * HTTPImpairment impairment;
+ * impairment.setRandomFragments(7, 42);
+ * HTTPImpairedTransport transport(&net, &impairment);
+ * HTTPClient client(&transport);
+ * @endcode
+ */
+class HTTPImpairedTransport : public IHTTPTransport
+{
+public:
+  /** Instantiate the transport
+   * @param pTransport Transport that actually talks to the network
+   * @param pImpairment Impairment to apply, must remain valid as long as the transport is in use
+   */
+  HTTPImpairedTransport(IHTTPTransport* pTransport, HTTPImpairment* pImpairment);
+
+  //IHTTPTransport
+  virtual int resolve(const char* host, uint16_t port, HTTPAddress* pAddr);
+
+  virtual int resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount);
+
+  virtual int connect(const HTTPAddress& addr, uint32_t timeout);
+
+  virtual int connectAny(const HTTPAddress* pAddrs, size_t count, uint32_t timeout, size_t* pIndex);
+
+  virtual int read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout);
+
+  virtual int write(const char* buf, size_t len, uint32_t timeout);
+
+  virtual int wait(int events, uint32_t timeout);
+
+  virtual int close();
+
+  virtual bool isConnected();
+
+private:
+  IHTTPTransport* m_pTransport;
+  HTTPImpairment* m_pImpairment;
+};
+
+#endif /* HTTPIMPAIREDTRANSPORT_H_ */
@@ -0,0 +1,137 @@
+/* HTTPLinuxNet.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifdef __linux__ //Linux host build only
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPLinuxNet.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPLinuxNet.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+
+#include <cstring>
+
+/*static*/ int HTTPLinuxNet::resolve(const char* host, uint16_t port, HTTPAddress* pAddr)
+{
+  size_t count;
+  return resolveAll(host, port, pAddr, 1, &count);
+}
+
+/*static*/ int HTTPLinuxNet::resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount)
+{
+  DBG("Resolving DNS address or populate hard-coded IP address");
+  *pCount = 0;
+  struct addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC; //A and AAAA records
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_ADDRCONFIG; //Only families for which the host has an address
+  struct addrinfo* result;
+  int ret = getaddrinfo(host, NULL, &hints, &result);
+  if(ret != 0)
+  {
+    WARN("Could not resolve %s (%s)", host, gai_strerror(ret));
+    return NET_NOTFOUND;
+  }
+
+  //getaddrinfo() sorts the addresses by preference (RFC 6724); alternate between the two families from there (RFC 8305),
+  //so that a broken family only costs one connection attempt before the other one is tried
+  const struct addrinfo* pNext[2] = { result, result }; //Next address of the first family and of the other one
+  int firstFamily = result->ai_family;
+  for(int turn = 0; *pCount < maxCount; turn ^= 1)
+  {
+    const struct addrinfo* pInfo = pNext[turn];
+    while( (pInfo != NULL) && !(((pInfo->ai_family == firstFamily) == (turn == 0)) && ((pInfo->ai_family == AF_INET) || (pInfo->ai_family == AF_INET6))) )
+    {
+      pInfo = pInfo->ai_next;
+    }
+    if(pInfo == NULL)
+    {
+      if(pNext[turn ^ 1] == NULL)
+      {
+        break; //Both families exhausted
+      }
+      pNext[turn] = NULL;
+      continue;
+    }
+    pNext[turn] = pInfo->ai_next;
+
+    HTTPAddress* pAddr = &pAddrs[*pCount];
+    std::memset(pAddr, 0, sizeof(HTTPAddress));
+    if(pInfo->ai_family == AF_INET6)
+    {
+      pAddr->family = HTTP_ADDR_IPV6;
+      memcpy(pAddr->addr, &((struct sockaddr_in6*)pInfo->ai_addr)->sin6_addr, 16);
+    }
+    else
+    {
+      pAddr->family = HTTP_ADDR_IPV4;
+      memcpy(pAddr->addr, &((struct sockaddr_in*)pInfo->ai_addr)->sin_addr, 4);
+    }
+    pAddr->port = port;
+    (*pCount)++;
+  }
+  freeaddrinfo(result);
+  if(*pCount == 0)
+  {
+    WARN("No usable address for %s", host);
+    return NET_NOTFOUND;
+  }
+  DBG("Resolved %s to %d address(es)", host, *pCount);
+  return OK;
+}
+
+/*static*/ unsigned int HTTPLinuxNet::toSockAddr(const HTTPAddress& addr, struct sockaddr_storage* pSockAddr)
+{
+  std::memset(pSockAddr, 0, sizeof(struct sockaddr_storage));
+  if(addr.family == HTTP_ADDR_IPV6)
+  {
+    struct sockaddr_in6* pIn6 = (struct sockaddr_in6*)pSockAddr;
+    pIn6->sin6_family = AF_INET6;
+    pIn6->sin6_port = htons(addr.port);
+    memcpy(&pIn6->sin6_addr, addr.addr, 16);
+    return sizeof(struct sockaddr_in6);
+  }
+  struct sockaddr_in* pIn = (struct sockaddr_in*)pSockAddr;
+  pIn->sin_family = AF_INET;
+  pIn->sin_port = htons(addr.port);
+  memcpy(&pIn->sin_addr.s_addr, addr.addr, 4);
+  return sizeof(struct sockaddr_in);
+}
+
+/*static*/ int HTTPLinuxNet::getDomain(const HTTPAddress& addr)
+{
+  return (addr.family == HTTP_ADDR_IPV6) ? AF_INET6 : AF_INET;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/* HTTPLinuxNet.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPLINUXNET_H_
+#define HTTPLINUXNET_H_
+
+#include "../IHTTPTransport.h"
+
+struct sockaddr_storage;
+
+/** Helpers shared by the Linux transports
+*/
+class HTTPLinuxNet
+{
+public:
+  /** Resolve a host name (or parse a hard-coded IP address) with getaddrinfo()
+   * @param host Host name
+   * @param port Port to connect to
+   * @param pAddr Pointer to the structure on which the resolved address will be stored
+   * @return 0 on success, NET error on failure
+   */
+  static int resolve(const char* host, uint16_t port, HTTPAddress* pAddr);
+
+  /** Resolve a host name into its IPv4 and IPv6 addresses with getaddrinfo(), alternating between the two families
+   * @param host Host name
+   * @param port Port to connect to
+   * @param pAddrs Pointer to the array on which the resolved addresses will be stored
+   * @param maxCount Size of the array
+   * @param pCount Pointer to the variable on which the number of addresses will be stored
+   * @return 0 on success, NET error on failure
+   */
+  static int resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount);
+
+  /** Convert an address to a socket address
+   * @param addr Address to convert
+   * @param pSockAddr Pointer to the structure on which the socket address will be stored
+   * @return Length of the socket address
+   */
+  static unsigned int toSockAddr(const HTTPAddress& addr, struct sockaddr_storage* pSockAddr);
+
+  /** Get the socket domain to use for an address
+   */
+  static int getDomain(const HTTPAddress& addr);
+};
+
+#endif /* HTTPLINUXNET_H_ */
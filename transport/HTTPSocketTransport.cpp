@@ -0,0 +1,240 @@
+/* HTTPSocketTransport.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __linux__ //mbed target only
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPSocketTransport.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPSocketTransport.h"
+
+#include "api/socket.h"
+
+#include <cstring>
+
+HTTPSocketTransport::HTTPSocketTransport() : m_sock(-1)
+{
+
+}
+
+HTTPSocketTransport::~HTTPSocketTransport()
+{
+  close();
+}
+
+/*virtual*/ int HTTPSocketTransport::resolve(const char* host, uint16_t port, HTTPAddress* pAddr)
+{
+  size_t count;
+  return resolveAll(host, port, pAddr, 1, &count);
+}
+
+/*virtual*/ int HTTPSocketTransport::resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount)
+{
+  DBG("Resolving DNS address or populate hard-coded IP address");
+  *pCount = 0;
+  struct hostent *server = socket::gethostbyname(host); //IPv4 only, as is the network stack
+  if( (server == NULL) || (server->h_addr_list[0] == NULL) )
+  {
+    return NET_NOTFOUND; //Fail
+  }
+  //All the A records, which connectAny() tries one after the other
+  while( (*pCount < maxCount) && (server->h_addr_list[*pCount] != NULL) )
+  {
+    HTTPAddress* pAddr = &pAddrs[*pCount];
+    std::memset(pAddr, 0, sizeof(HTTPAddress));
+    pAddr->family = HTTP_ADDR_IPV4;
+    memcpy(pAddr->addr, server->h_addr_list[*pCount], MIN(server->h_length, 4));
+    pAddr->port = port;
+    (*pCount)++;
+  }
+  return OK;
+}
+
+/*virtual*/ int HTTPSocketTransport::connect(const HTTPAddress& addr, uint32_t timeout)
+{
+  close();
+
+  if(addr.family != HTTP_ADDR_IPV4)
+  {
+    WARN("Only IPv4 is supported");
+    return NET_INVALID;
+  }
+
+  //Now populate structure
+  struct sockaddr_in serverAddr;
+  std::memset(&serverAddr, 0, sizeof(struct sockaddr_in));
+  memcpy((char*)&serverAddr.sin_addr.s_addr, addr.addr, 4);
+  serverAddr.sin_family = AF_INET;
+  serverAddr.sin_port = htons(addr.port);
+
+  //Create socket
+  DBG("Creating socket");
+  m_sock = socket::socket(AF_INET, SOCK_STREAM, 0); //TCP socket
+  if (m_sock < 0)
+  {
+    ERR("Could not create socket");
+    return NET_OOM;
+  }
+  DBG("Handle is %d", m_sock);
+
+  //Connect it
+  DBG("Connecting socket to %s:%d", inet_ntoa(serverAddr.sin_addr), ntohs(serverAddr.sin_port));
+  int ret = socket::connect(m_sock, (const struct sockaddr *)&serverAddr, sizeof(serverAddr));
+  if (ret < 0)
+  {
+    close();
+    ERR("Could not connect");
+    return NET_CONN;
+  }
+
+  return OK;
+}
+
+/*virtual*/ int HTTPSocketTransport::read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout)
+{
+  DBG("Trying to read between %d and %d bytes", minLen, maxLen);
+  size_t readLen = 0;
+  *pReadLen = 0;
+  while(readLen < minLen)
+  {
+    //Wait for socket to be readable
+    int ret = wait(HTTP_READABLE, timeout);
+    if(ret != OK)
+    {
+      return ret;
+    }
+
+    ret = socket::recv(m_sock, buf + readLen, maxLen - readLen, 0);
+    if( ret > 0)
+    {
+      readLen += ret;
+      *pReadLen = readLen; //Bytes already read are reported even if a later call fails
+      continue;
+    }
+    else if( ret == 0 )
+    {
+      WARN("Connection was closed by server");
+      return NET_CLOSED; //Connection was closed by server
+    }
+    else
+    {
+      ERR("Connection error (recv returned %d)", ret);
+      return NET_CONN;
+    }
+  }
+  DBG("Read %d bytes", readLen);
+  return OK;
+}
+
+/*virtual*/ int HTTPSocketTransport::write(const char* buf, size_t len, uint32_t timeout)
+{
+  DBG("Trying to write %d bytes", len);
+  size_t writtenLen = 0;
+  while(writtenLen < len)
+  {
+    //Wait for socket to be writeable
+    int ret = wait(HTTP_WRITABLE, timeout);
+    if(ret != OK)
+    {
+      return ret;
+    }
+
+    ret = socket::send(m_sock, buf + writtenLen, len - writtenLen, 0);
+    if( ret > 0)
+    {
+      writtenLen += ret;
+      continue;
+    }
+    else if( ret == 0 )
+    {
+      WARN("Connection was closed by server");
+      return NET_CLOSED; //Connection was closed by server
+    }
+    else
+    {
+      ERR("Connection error (send returned %d)", ret);
+      return NET_CONN;
+    }
+  }
+  DBG("Written %d bytes", writtenLen);
+  return OK;
+}
+
+/*virtual*/ int HTTPSocketTransport::wait(int events, uint32_t timeout)
+{
+  if(m_sock < 0)
+  {
+    return NET_CLOSED;
+  }
+
+  //Creating FS sets
+  fd_set readSet;
+  fd_set writeSet;
+  FD_ZERO(&readSet);
+  FD_ZERO(&writeSet);
+  if(events & HTTP_READABLE)
+  {
+    FD_SET(m_sock, &readSet);
+  }
+  if(events & HTTP_WRITABLE)
+  {
+    FD_SET(m_sock, &writeSet);
+  }
+  struct timeval t_val;
+  t_val.tv_sec = timeout / 1000;
+  t_val.tv_usec = (timeout - (t_val.tv_sec * 1000)) * 1000;
+  int ret = socket::select(m_sock + 1, &readSet, &writeSet, NULL, &t_val); //Only this socket is in the sets
+  if(ret <= 0 || !(FD_ISSET(m_sock, &readSet) || FD_ISSET(m_sock, &writeSet)))
+  {
+    if(timeout != 0) //A zero timeout is a readiness probe, which is expected to time out
+    {
+      WARN("Timeout");
+    }
+    return NET_TIMEOUT; //Timeout
+  }
+  return OK;
+}
+
+/*virtual*/ int HTTPSocketTransport::close()
+{
+  if(m_sock >= 0)
+  {
+    socket::close(m_sock);
+    m_sock = -1;
+  }
+  return OK;
+}
+
+/*virtual*/ bool HTTPSocketTransport::isConnected()
+{
+  return (m_sock >= 0);
+}
+
+#endif
@@ -0,0 +1,59 @@
+/* HTTPSocketTransport.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPSOCKETTRANSPORT_H_
+#define HTTPSOCKETTRANSPORT_H_
+
+#include "../IHTTPTransport.h"
+
+/** Transport over the mbed networking stack (socket:: API)
+*/
+class HTTPSocketTransport : public IHTTPTransport
+{
+public:
+  ///Instantiate the transport
+  HTTPSocketTransport();
+  virtual ~HTTPSocketTransport();
+
+  //IHTTPTransport
+  virtual int resolve(const char* host, uint16_t port, HTTPAddress* pAddr);
+
+  virtual int resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount);
+
+  virtual int connect(const HTTPAddress& addr, uint32_t timeout);
+
+  virtual int read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout);
+
+  virtual int write(const char* buf, size_t len, uint32_t timeout);
+
+  virtual int wait(int events, uint32_t timeout);
+
+  virtual int close();
+
+  virtual bool isConnected();
+
+private:
+  int m_sock;
+};
+
+#endif /* HTTPSOCKETTRANSPORT_H_ */
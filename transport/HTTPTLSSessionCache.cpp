@@ -0,0 +1,144 @@
+/* HTTPTLSSessionCache.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifdef HTTP_CLIENT_TLS //Requires mbedTLS
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPTLSSessionCache.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPTLSSessionCache.h"
+
+#include <cstring>
+
+HTTPTLSSessionCache::HTTPTLSSessionCache() : m_useCounter(0)
+{
+  for(int i = 0; i < HTTP_TLS_SESSION_CACHE_SIZE; i++)
+  {
+    m_entries[i].valid = false;
+    mbedtls_ssl_session_init(&m_entries[i].session);
+  }
+}
+
+HTTPTLSSessionCache::~HTTPTLSSessionCache()
+{
+  clear();
+}
+
+const mbedtls_ssl_session* HTTPTLSSessionCache::find(const char* host, uint16_t port)
+{
+  int i = indexOf(host, port);
+  if(i < 0)
+  {
+    return NULL;
+  }
+  m_entries[i].lastUse = ++m_useCounter;
+  return &m_entries[i].session;
+}
+
+int HTTPTLSSessionCache::save(const char* host, uint16_t port, const mbedtls_ssl_context* pSsl)
+{
+  if( strlen(host) >= HTTP_TLS_HOST_MAX_LEN )
+  {
+    return NET_TOOSMALL;
+  }
+
+  int i = indexOf(host, port);
+  if(i < 0)
+  {
+    //Pick a free entry, or evict the least recently used one
+    i = 0;
+    for(int j = 0; j < HTTP_TLS_SESSION_CACHE_SIZE; j++)
+    {
+      if( !m_entries[j].valid )
+      {
+        i = j;
+        break;
+      }
+      if( m_entries[j].lastUse < m_entries[i].lastUse )
+      {
+        i = j;
+      }
+    }
+  }
+
+  Entry& entry = m_entries[i];
+  mbedtls_ssl_session_free(&entry.session); //Releases the previous ticket and peer certificate
+  mbedtls_ssl_session_init(&entry.session);
+  entry.valid = false;
+
+  int ret = mbedtls_ssl_get_session(pSsl, &entry.session);
+  if(ret != 0)
+  {
+    WARN("Could not save session (-0x%04X)", -ret);
+    return NET_OOM;
+  }
+
+  strcpy(entry.host, host);
+  entry.port = port;
+  entry.valid = true;
+  entry.lastUse = ++m_useCounter;
+  DBG("Saved session for %s:%d", host, port);
+  return OK;
+}
+
+void HTTPTLSSessionCache::remove(const char* host, uint16_t port)
+{
+  int i = indexOf(host, port);
+  if(i >= 0)
+  {
+    mbedtls_ssl_session_free(&m_entries[i].session);
+    mbedtls_ssl_session_init(&m_entries[i].session);
+    m_entries[i].valid = false;
+  }
+}
+
+void HTTPTLSSessionCache::clear()
+{
+  for(int i = 0; i < HTTP_TLS_SESSION_CACHE_SIZE; i++)
+  {
+    mbedtls_ssl_session_free(&m_entries[i].session);
+    mbedtls_ssl_session_init(&m_entries[i].session);
+    m_entries[i].valid = false;
+  }
+}
+
+int HTTPTLSSessionCache::indexOf(const char* host, uint16_t port)
+{
+  for(int i = 0; i < HTTP_TLS_SESSION_CACHE_SIZE; i++)
+  {
+    if( m_entries[i].valid && (m_entries[i].port == port) && !strcmp(m_entries[i].host, host) )
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+#endif
@@ -0,0 +1,87 @@
+/* HTTPTLSSessionCache.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPTLSSESSIONCACHE_H_
+#define HTTPTLSSESSIONCACHE_H_
+
+#include <stdint.h>
+
+#include "mbedtls/ssl.h"
+
+#define HTTP_TLS_SESSION_CACHE_SIZE 4 //Number of hosts whose session is kept
+#define HTTP_TLS_HOST_MAX_LEN 64 //Maximum length of a host name, including the NULL-terminating char
+
+/** Per-host cache of TLS sessions (session IDs and session tickets)
+ * Reconnecting to a host whose session is cached only costs an abbreviated handshake: no certificate exchange and no
+ * public key operations. When the cache is full, the least recently used host is evicted.
+ * A cache can be shared by several HTTPTLSTransport instances used from the same thread.
+ */
+class HTTPTLSSessionCache
+{
+public:
+  ///Instantiate an empty cache
+  HTTPTLSSessionCache();
+  ~HTTPTLSSessionCache();
+
+  /** Find the session for a host
+   * @param host Host name
+   * @param port Port
+   * @return Pointer to the session, valid until the next call to a non-const method, or NULL if none is cached
+   */
+  const mbedtls_ssl_session* find(const char* host, uint16_t port);
+
+  /** Save the session negotiated by a connection
+   * @param host Host name
+   * @param port Port
+   * @param pSsl Connection that has completed its handshake
+   * @return 0 on success, NET error on failure
+   */
+  int save(const char* host, uint16_t port, const mbedtls_ssl_context* pSsl);
+
+  /** Forget the session for a host, e.g. when the server has rejected it
+   * @param host Host name
+   * @param port Port
+   */
+  void remove(const char* host, uint16_t port);
+
+  /** Forget all sessions
+   */
+  void clear();
+
+private:
+  int indexOf(const char* host, uint16_t port);
+
+  struct Entry
+  {
+    char host[HTTP_TLS_HOST_MAX_LEN];
+    uint16_t port;
+    bool valid;
+    uint32_t lastUse;
+    mbedtls_ssl_session session;
+  };
+
+  Entry m_entries[HTTP_TLS_SESSION_CACHE_SIZE];
+  uint32_t m_useCounter;
+};
+
+#endif /* HTTPTLSSESSIONCACHE_H_ */
@@ -0,0 +1,419 @@
+/* HTTPTLSTransport.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifdef HTTP_CLIENT_TLS //Requires mbedTLS
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPTLSTransport.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPTLSTransport.h"
+#include "../util/HTTPTime.h"
+
+#include <cstring>
+
+static const char* s_pers = "HTTPClient";
+
+HTTPTLSTransport::HTTPTLSTransport(IHTTPTransport* pTransport, HTTPTLSSessionCache* pCache /*= NULL*/) :
+m_pTransport(pTransport), m_pCache(pCache), m_setup(false), m_connected(false), m_verify(true),
+m_resumed(false), m_timeout(HTTP_WAIT_FOREVER), m_lowerError(OK),
+m_handshakeTime(0), m_totalHandshakeTime(0), m_handshakesCount(0), m_resumedCount(0)
+{
+  m_host[0] = '\0';
+  mbedtls_entropy_init(&m_entropy);
+  mbedtls_ctr_drbg_init(&m_drbg);
+  mbedtls_ssl_config_init(&m_conf);
+  mbedtls_ssl_init(&m_ssl);
+  mbedtls_x509_crt_init(&m_caCert);
+}
+
+/*virtual*/ HTTPTLSTransport::~HTTPTLSTransport()
+{
+  close();
+  mbedtls_ssl_free(&m_ssl);
+  mbedtls_ssl_config_free(&m_conf);
+  mbedtls_ctr_drbg_free(&m_drbg);
+  mbedtls_entropy_free(&m_entropy);
+  mbedtls_x509_crt_free(&m_caCert);
+}
+
+int HTTPTLSTransport::setCACert(const char* pem)
+{
+  int ret = mbedtls_x509_crt_parse(&m_caCert, (const unsigned char*)pem, strlen(pem) + 1); //Length includes the NULL-terminating char for PEM
+  if(ret != 0)
+  {
+    ERR("Could not parse CA certificate (-0x%04X)", -ret);
+    return NET_INVALID;
+  }
+  if(m_setup)
+  {
+    mbedtls_ssl_conf_ca_chain(&m_conf, &m_caCert, NULL);
+  }
+  return OK;
+}
+
+void HTTPTLSTransport::setVerify(bool verify)
+{
+  m_verify = verify;
+  if(m_setup)
+  {
+    mbedtls_ssl_conf_authmode(&m_conf, m_verify ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_OPTIONAL);
+  }
+}
+
+void HTTPTLSTransport::setHostName(const char* host)
+{
+  strncpy(m_host, host, HTTP_TLS_HOST_MAX_LEN - 1);
+  m_host[HTTP_TLS_HOST_MAX_LEN - 1] = '\0';
+}
+
+bool HTTPTLSTransport::isResumed()
+{
+  return m_resumed;
+}
+
+uint32_t HTTPTLSTransport::getHandshakeTime()
+{
+  return m_handshakeTime;
+}
+
+uint32_t HTTPTLSTransport::getTotalHandshakeTime()
+{
+  return m_totalHandshakeTime;
+}
+
+uint32_t HTTPTLSTransport::getHandshakesCount()
+{
+  return m_handshakesCount;
+}
+
+uint32_t HTTPTLSTransport::getResumedCount()
+{
+  return m_resumedCount;
+}
+
+/*virtual*/ int HTTPTLSTransport::resolve(const char* host, uint16_t port, HTTPAddress* pAddr)
+{
+  return m_pTransport->resolve(host, port, pAddr);
+}
+
+/*virtual*/ int HTTPTLSTransport::resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount)
+{
+  return m_pTransport->resolveAll(host, port, pAddrs, maxCount, pCount);
+}
+
+/*virtual*/ int HTTPTLSTransport::connect(const HTTPAddress& addr, uint32_t timeout)
+{
+  size_t index;
+  return connectAny(&addr, 1, timeout, &index);
+}
+
+/*virtual*/ int HTTPTLSTransport::connectAny(const HTTPAddress* pAddrs, size_t count, uint32_t timeout, size_t* pIndex)
+{
+  int ret;
+  if(!m_setup)
+  {
+    ret = setup();
+    if(ret)
+    {
+      return ret;
+    }
+  }
+
+  if(m_connected)
+  {
+    close();
+  }
+
+  ret = m_pTransport->connectAny(pAddrs, count, timeout, pIndex);
+  if(ret)
+  {
+    return ret;
+  }
+  const HTTPAddress& addr = pAddrs[*pIndex];
+
+  m_timeout = timeout;
+  m_lowerError = OK;
+  m_resumed = false;
+
+  mbedtls_ssl_session_reset(&m_ssl);
+  ret = mbedtls_ssl_set_hostname(&m_ssl, m_host);
+  if(ret != 0)
+  {
+    m_pTransport->close();
+    return NET_OOM;
+  }
+
+  const mbedtls_ssl_session* pSession = (m_pCache != NULL) ? m_pCache->find(m_host, addr.port) : NULL;
+  if(pSession != NULL)
+  {
+    DBG("Offering cached session for %s", m_host);
+    mbedtls_ssl_set_session(&m_ssl, pSession); //Falls back to a full handshake if this fails
+  }
+
+  uint32_t start = HTTPTime::getMs();
+  do
+  {
+    ret = mbedtls_ssl_handshake(&m_ssl);
+  } while( (ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE) );
+
+  if(ret != 0)
+  {
+    ERR("Handshake with %s failed (-0x%04X)", m_host, -ret);
+    if(pSession != NULL)
+    {
+      m_pCache->remove(m_host, addr.port);
+    }
+    ret = toError(ret);
+    m_pTransport->close();
+    return ret;
+  }
+
+  m_handshakeTime = HTTPTime::elapsed(start);
+  m_totalHandshakeTime += m_handshakeTime;
+  m_handshakesCount++;
+
+  if(pSession != NULL)
+  {
+    m_resumed = isSameSession(pSession);
+    if(m_resumed)
+    {
+      m_resumedCount++;
+    }
+  }
+  DBG("Handshake with %s completed in %d ms (%s, %s)", m_host, m_handshakeTime, m_resumed ? "resumed" : "full",
+      mbedtls_ssl_get_ciphersuite(&m_ssl));
+
+  if(m_pCache != NULL)
+  {
+    m_pCache->save(m_host, addr.port, &m_ssl); //Also picks up a renewed ticket
+  }
+
+  m_connected = true;
+  return OK;
+}
+
+/*virtual*/ int HTTPTLSTransport::read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout)
+{
+  size_t readLen = 0;
+  *pReadLen = 0;
+  if(!m_connected)
+  {
+    return NET_CLOSED;
+  }
+  m_timeout = timeout;
+  while(readLen < minLen)
+  {
+    int ret = mbedtls_ssl_read(&m_ssl, (unsigned char*)buf + readLen, maxLen - readLen);
+    if(ret > 0)
+    {
+      readLen += ret;
+      *pReadLen = readLen;
+      continue;
+    }
+    if( (ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE) )
+    {
+      continue;
+    }
+    if( (ret == 0) || (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) )
+    {
+      DBG("Connection closed by server");
+      return NET_CLOSED;
+    }
+    return toError(ret);
+  }
+  return OK;
+}
+
+/*virtual*/ int HTTPTLSTransport::write(const char* buf, size_t len, uint32_t timeout)
+{
+  size_t writtenLen = 0;
+  if(!m_connected)
+  {
+    return NET_CLOSED;
+  }
+  m_timeout = timeout;
+  while(writtenLen < len)
+  {
+    int ret = mbedtls_ssl_write(&m_ssl, (const unsigned char*)buf + writtenLen, len - writtenLen);
+    if(ret > 0)
+    {
+      writtenLen += ret;
+      continue;
+    }
+    if( (ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE) )
+    {
+      continue;
+    }
+    return toError(ret);
+  }
+  return OK;
+}
+
+/*virtual*/ int HTTPTLSTransport::wait(int events, uint32_t timeout)
+{
+  if( (events & HTTP_READABLE) && (mbedtls_ssl_get_bytes_avail(&m_ssl) > 0) )
+  {
+    return OK; //Decrypted data is already buffered
+  }
+  return m_pTransport->wait(events, timeout);
+}
+
+/*virtual*/ int HTTPTLSTransport::close()
+{
+  if(m_connected)
+  {
+    m_timeout = 0;
+    mbedtls_ssl_close_notify(&m_ssl); //Best effort, the session remains resumable either way
+    m_connected = false;
+  }
+  return m_pTransport->close();
+}
+
+/*virtual*/ bool HTTPTLSTransport::isConnected()
+{
+  return m_connected && m_pTransport->isConnected();
+}
+
+int HTTPTLSTransport::setup()
+{
+  int ret = mbedtls_ctr_drbg_seed(&m_drbg, mbedtls_entropy_func, &m_entropy, (const unsigned char*)s_pers, strlen(s_pers));
+  if(ret != 0)
+  {
+    ERR("Could not seed RNG (-0x%04X)", -ret);
+    return NET_UNKNOWN;
+  }
+
+  ret = mbedtls_ssl_config_defaults(&m_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+  if(ret != 0)
+  {
+    ERR("Could not set up TLS configuration (-0x%04X)", -ret);
+    return NET_UNKNOWN;
+  }
+
+  mbedtls_ssl_conf_rng(&m_conf, mbedtls_ctr_drbg_random, &m_drbg);
+  mbedtls_ssl_conf_ca_chain(&m_conf, &m_caCert, NULL);
+  //With verification disabled, OPTIONAL still runs the verification (and the callback) but ignores its result
+  mbedtls_ssl_conf_authmode(&m_conf, m_verify ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_OPTIONAL);
+  mbedtls_ssl_conf_verify(&m_conf, &HTTPTLSTransport::verifyCb, this);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&m_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+  ret = mbedtls_ssl_setup(&m_ssl, &m_conf);
+  if(ret != 0)
+  {
+    ERR("Could not set up TLS context (-0x%04X)", -ret);
+    return NET_OOM;
+  }
+
+  mbedtls_ssl_set_bio(&m_ssl, this, &HTTPTLSTransport::sendCb, &HTTPTLSTransport::recvCb, NULL);
+  m_setup = true;
+  return OK;
+}
+
+int HTTPTLSTransport::toError(int ret)
+{
+  if(m_lowerError != OK) //The underlying transport failed, report its error
+  {
+    int lowerError = m_lowerError;
+    m_lowerError = OK;
+    return lowerError;
+  }
+  switch(ret)
+  {
+  case MBEDTLS_ERR_X509_CERT_VERIFY_FAILED:
+    ERR("Server certificate verification failed (flags 0x%08X)", (unsigned int)mbedtls_ssl_get_verify_result(&m_ssl));
+    return NET_AUTH;
+  case MBEDTLS_ERR_SSL_ALLOC_FAILED:
+    return NET_OOM;
+  case MBEDTLS_ERR_SSL_TIMEOUT:
+    return NET_TIMEOUT;
+  case MBEDTLS_ERR_SSL_CONN_EOF:
+    return NET_CLOSED;
+  default:
+    ERR("TLS error -0x%04X", -ret);
+    return NET_PROTOCOL;
+  }
+}
+
+/*static*/ int HTTPTLSTransport::sendCb(void* ctx, const unsigned char* buf, size_t len)
+{
+  HTTPTLSTransport* pTransport = (HTTPTLSTransport*) ctx;
+  int ret = pTransport->m_pTransport->write((const char*)buf, len, pTransport->m_timeout);
+  if(ret != OK)
+  {
+    pTransport->m_lowerError = ret;
+    return (ret == NET_TIMEOUT) ? MBEDTLS_ERR_SSL_TIMEOUT : MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+  }
+  return len;
+}
+
+/*static*/ int HTTPTLSTransport::recvCb(void* ctx, unsigned char* buf, size_t len)
+{
+  HTTPTLSTransport* pTransport = (HTTPTLSTransport*) ctx;
+  size_t readLen;
+  int ret = pTransport->m_pTransport->read((char*)buf, 1, len, &readLen, pTransport->m_timeout);
+  if(ret == OK)
+  {
+    return readLen;
+  }
+  if(ret == NET_CLOSED)
+  {
+    return 0; //EOF
+  }
+  pTransport->m_lowerError = ret;
+  return (ret == NET_TIMEOUT) ? MBEDTLS_ERR_SSL_TIMEOUT : MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+}
+
+bool HTTPTLSTransport::isSameSession(const mbedtls_ssl_session* pSession)
+{
+  //mbedTLS does not tell whether a handshake was abbreviated: a resumed session keeps the master secret of the one offered,
+  //while a full handshake derives a new one. The session ID cannot tell, the client draws a new one when it presents a ticket
+  mbedtls_ssl_session negotiated;
+  mbedtls_ssl_session_init(&negotiated);
+  bool same = false;
+  if( mbedtls_ssl_get_session(&m_ssl, &negotiated) == 0 )
+  {
+    same = (negotiated.ciphersuite == pSession->ciphersuite) && !memcmp(negotiated.master, pSession->master, sizeof(negotiated.master));
+  }
+  mbedtls_ssl_session_free(&negotiated);
+  return same;
+}
+
+/*static*/ int HTTPTLSTransport::verifyCb(void* /*ctx*/, mbedtls_x509_crt* /*crt*/, int depth, uint32_t* flags)
+{
+  if(*flags)
+  {
+    WARN("Certificate at depth %d does not verify (flags 0x%08X)", depth, (unsigned int)*flags);
+  }
+  return 0; //Keep the library's verdict
+}
+
+#endif
@@ -0,0 +1,151 @@
+/* HTTPTLSTransport.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPTLSTRANSPORT_H_
+#define HTTPTLSTRANSPORT_H_
+
+#include "../IHTTPTransport.h"
+#include "HTTPTLSSessionCache.h"
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+
+/** TLS transport running mbedTLS on top of another transport
+ * Only available when the library is built with HTTP_CLIENT_TLS defined. Sessions are saved in an optional
+ * HTTPTLSSessionCache so that reconnections to the same host use abbreviated handshakes, e.g.:
+ * @code
+ * HTTPEpollTransport net;
+ * HTTPTLSSessionCache cache;
+ * HTTPTLSTransport tls(&net, &cache);
+ * tls.setCACert(caPem);
+ * HTTPClient client(&net);
+ * client.setTLSTransport(&tls);
+ * @endcode
+ */
+class HTTPTLSTransport : public IHTTPTransport
+{
+public:
+  /** Instantiate the transport
+   * @param pTransport Transport that carries the TLS records
+   * @param pCache Session cache to use, or NULL to always perform full handshakes
+   */
+  HTTPTLSTransport(IHTTPTransport* pTransport, HTTPTLSSessionCache* pCache = NULL);
+  virtual ~HTTPTLSTransport();
+
+  /** Set the trusted CA certificate(s)
+   * @param pem NULL-terminated PEM string, may contain several certificates
+   * @return 0 on success, NET error on failure
+   */
+  int setCACert(const char* pem);
+
+  /** Enable or disable server certificate verification (enabled by default)
+   * Disabling it is only meant for tests against servers using a self-signed certificate
+   * @param verify true to abort the handshake when the server certificate cannot be verified
+   */
+  void setVerify(bool verify);
+
+  /** Set the name of the server for the next connection
+   * It is used for SNI, for hostname verification and as the session cache key
+   * @param host Host name, truncated to HTTP_TLS_HOST_MAX_LEN - 1 chars
+   */
+  void setHostName(const char* host);
+
+  /** Whether the last handshake resumed a cached session
+   * @return true if the last handshake was abbreviated
+   */
+  bool isResumed();
+
+  /** Duration of the last handshake, including the round trips
+   * @return duration in ms
+   */
+  uint32_t getHandshakeTime();
+
+  /** Cumulated duration of all handshakes
+   * @return duration in ms
+   */
+  uint32_t getTotalHandshakeTime();
+
+  /** Number of successful handshakes
+   * @return count
+   */
+  uint32_t getHandshakesCount();
+
+  /** Number of successful handshakes that resumed a cached session
+   * @return count
+   */
+  uint32_t getResumedCount();
+
+  //IHTTPTransport
+  virtual int resolve(const char* host, uint16_t port, HTTPAddress* pAddr);
+
+  virtual int resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount);
+
+  virtual int connect(const HTTPAddress& addr, uint32_t timeout);
+
+  virtual int connectAny(const HTTPAddress* pAddrs, size_t count, uint32_t timeout, size_t* pIndex);
+
+  virtual int read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout);
+
+  virtual int write(const char* buf, size_t len, uint32_t timeout);
+
+  virtual int wait(int events, uint32_t timeout);
+
+  virtual int close();
+
+  virtual bool isConnected();
+
+private:
+  int setup();
+  int toError(int ret);
+  bool isSameSession(const mbedtls_ssl_session* pSession);
+
+  static int sendCb(void* ctx, const unsigned char* buf, size_t len);
+  static int recvCb(void* ctx, unsigned char* buf, size_t len);
+  static int verifyCb(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags);
+
+  IHTTPTransport* m_pTransport;
+  HTTPTLSSessionCache* m_pCache;
+
+  mbedtls_entropy_context m_entropy;
+  mbedtls_ctr_drbg_context m_drbg;
+  mbedtls_ssl_config m_conf;
+  mbedtls_ssl_context m_ssl;
+  mbedtls_x509_crt m_caCert;
+
+  char m_host[HTTP_TLS_HOST_MAX_LEN];
+  bool m_setup;
+  bool m_connected;
+  bool m_verify;
+  bool m_resumed;
+  uint32_t m_timeout; //Timeout of the current operation, used by the BIO callbacks
+  int m_lowerError; //Last error returned by the underlying transport
+
+  uint32_t m_handshakeTime;
+  uint32_t m_totalHandshakeTime;
+  uint32_t m_handshakesCount;
+  uint32_t m_resumedCount;
+};
+
+#endif /* HTTPTLSTRANSPORT_H_ */
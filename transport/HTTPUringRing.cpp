@@ -0,0 +1,419 @@
+/* HTTPUringRing.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifdef __linux__ //Linux host build only
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPUringRing.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPUringRing.h"
+#include "../IHTTPTransport.h"
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include <cstring>
+
+//liburing is not required, the three system calls are used directly
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+  return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+  return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nrArgs)
+{
+  return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+HTTPUringRing::HTTPUringRing() : m_fd(-1), m_sqHead(NULL), m_sqTail(NULL), m_sqMask(NULL), m_sqArray(NULL),
+m_sqes((struct io_uring_sqe*)MAP_FAILED), m_sqEntries(0), m_sqLocalTail(0), m_toSubmit(0),
+m_cqHead(NULL), m_cqTail(NULL), m_cqMask(NULL), m_cqes(NULL),
+m_sqRingPtr(MAP_FAILED), m_sqRingSize(0), m_cqRingPtr(MAP_FAILED), m_cqRingSize(0), m_sqesSize(0), m_filesRegistered(false),
+m_buffers(NULL), m_buffersRegistered(false), m_buffersFree(0), m_enterCount(0), m_submittedCount(0)
+{
+
+}
+
+HTTPUringRing::~HTTPUringRing()
+{
+  teardown();
+  free(m_buffers);
+}
+
+struct io_uring_sqe* HTTPUringRing::getSqe(HTTPUringOp* pOp)
+{
+  if( (m_fd < 0) && (setup() != OK) )
+  {
+    return NULL;
+  }
+
+  if( m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries )
+  {
+    //Submission queue is full, hand what is queued to the kernel
+    if( flush(false) != OK )
+    {
+      return NULL;
+    }
+  }
+
+  unsigned index = m_sqLocalTail & *m_sqMask;
+  struct io_uring_sqe* sqe = &m_sqes[index];
+  std::memset(sqe, 0, sizeof(struct io_uring_sqe));
+  sqe->user_data = (uint64_t)(uintptr_t)pOp;
+  m_sqArray[index] = index;
+  m_sqLocalTail++;
+  m_toSubmit++;
+
+  if(pOp != NULL)
+  {
+    pOp->pending = true;
+    pOp->result = 0;
+  }
+  return sqe;
+}
+
+struct io_uring_sqe* HTTPUringRing::getSqe(HTTPUringOp* pOp, uint32_t timeout)
+{
+  if(timeout == HTTP_WAIT_FOREVER)
+  {
+    return getSqe(pOp);
+  }
+
+  //Make sure the operation and its timeout end up next to each other in the queue
+  if( (m_fd >= 0) && (m_sqLocalTail + 1 - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries) )
+  {
+    if( flush(false) != OK )
+    {
+      return NULL;
+    }
+  }
+
+  struct io_uring_sqe* sqe = getSqe(pOp);
+  if(sqe == NULL)
+  {
+    return NULL;
+  }
+  sqe->flags |= IOSQE_IO_LINK;
+
+  pOp->timeout.tv_sec = timeout / 1000;
+  pOp->timeout.tv_nsec = (timeout % 1000) * 1000000LL;
+  struct io_uring_sqe* timeoutSqe = getSqe(NULL); //Its completion (-ETIME or -ECANCELED) is not needed
+  timeoutSqe->opcode = IORING_OP_LINK_TIMEOUT;
+  timeoutSqe->fd = -1;
+  timeoutSqe->addr = (uint64_t)(uintptr_t)&pOp->timeout;
+  timeoutSqe->len = 1;
+
+  return sqe; //The caller fills the entry in after the timeout has been queued, which is fine as nothing is submitted yet
+}
+
+int HTTPUringRing::flush(bool wait)
+{
+  if(m_fd < 0)
+  {
+    return OK; //Nothing was ever queued
+  }
+
+  __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+
+  while(true)
+  {
+    m_enterCount++;
+    int ret = sys_io_uring_enter(m_fd, m_toSubmit, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+    if(ret < 0)
+    {
+      if(errno == EINTR)
+      {
+        continue;
+      }
+      if( (errno == EAGAIN) || (errno == EBUSY) )
+      {
+        reap(); //Completion queue is full, make room and retry
+        continue;
+      }
+      ERR("io_uring_enter failed (errno %d)", errno);
+      return NET_CONN;
+    }
+    m_submittedCount += ret;
+    m_toSubmit -= MIN((unsigned)ret, m_toSubmit);
+    if(m_toSubmit == 0)
+    {
+      break;
+    }
+    wait = false; //The remaining entries will be picked up by the next call
+  }
+
+  reap();
+  return OK;
+}
+
+int HTTPUringRing::waitFor(HTTPUringOp* pOp)
+{
+  while(pOp->pending)
+  {
+    int ret = flush(true);
+    if(ret != OK)
+    {
+      return ret;
+    }
+  }
+  return OK;
+}
+
+int HTTPUringRing::registerFile(int fd)
+{
+  if( !m_filesRegistered )
+  {
+    return -1;
+  }
+  for(int i = 0; i < HTTP_URING_MAX_FILES; i++)
+  {
+    if(m_files[i] == -1)
+    {
+      struct io_uring_files_update update;
+      std::memset(&update, 0, sizeof(update));
+      update.offset = i;
+      update.fds = (uint64_t)(uintptr_t)&fd;
+      if( sys_io_uring_register(m_fd, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1 )
+      {
+        WARN("Could not update the fixed file table (errno %d)", errno);
+        return -1;
+      }
+      m_files[i] = fd;
+      return i;
+    }
+  }
+  return -1; //Table is full, the caller falls back to using the descriptor
+}
+
+void HTTPUringRing::unregisterFile(int index)
+{
+  if( (index < 0) || (index >= HTTP_URING_MAX_FILES) )
+  {
+    return;
+  }
+  int fd = -1;
+  struct io_uring_files_update update;
+  std::memset(&update, 0, sizeof(update));
+  update.offset = index;
+  update.fds = (uint64_t)(uintptr_t)&fd;
+  sys_io_uring_register(m_fd, IORING_REGISTER_FILES_UPDATE, &update, 1);
+  m_files[index] = -1;
+}
+
+int HTTPUringRing::allocBuffer()
+{
+  if( (m_fd < 0) && (setup() != OK) )
+  {
+    return -1;
+  }
+  if( !m_buffersRegistered || (m_buffersFree == 0) )
+  {
+    return -1;
+  }
+  int index = __builtin_ctz(m_buffersFree);
+  m_buffersFree &= ~(1UL << index);
+  return index;
+}
+
+void HTTPUringRing::freeBuffer(int index)
+{
+  if( (index < 0) || (index >= HTTP_URING_BUFFERS) )
+  {
+    return;
+  }
+  m_buffersFree |= (1UL << index);
+}
+
+char* HTTPUringRing::getBuffer(int index)
+{
+  return m_buffers + (size_t)index * HTTP_URING_BUFFER_SIZE;
+}
+
+uint32_t HTTPUringRing::getEnterCount()
+{
+  return m_enterCount;
+}
+
+uint32_t HTTPUringRing::getSubmittedCount()
+{
+  return m_submittedCount;
+}
+
+int HTTPUringRing::setup()
+{
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  m_fd = sys_io_uring_setup(HTTP_URING_ENTRIES, &params);
+  if(m_fd < 0)
+  {
+    ERR("Could not set io_uring up (errno %d)", errno);
+    return NET_OOM;
+  }
+  m_sqEntries = params.sq_entries;
+
+  //Map the rings
+  m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if(params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    m_sqRingSize = MAX(m_sqRingSize, m_cqRingSize);
+    m_cqRingSize = m_sqRingSize;
+  }
+  m_sqRingPtr = mmap(NULL, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+  if(m_sqRingPtr == MAP_FAILED)
+  {
+    ERR("Could not map the submission queue (errno %d)", errno);
+    teardown();
+    return NET_OOM;
+  }
+  if(params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    m_cqRingPtr = m_sqRingPtr;
+  }
+  else
+  {
+    m_cqRingPtr = mmap(NULL, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+    if(m_cqRingPtr == MAP_FAILED)
+    {
+      ERR("Could not map the completion queue (errno %d)", errno);
+      teardown();
+      return NET_OOM;
+    }
+  }
+  m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  m_sqes = (struct io_uring_sqe*) mmap(NULL, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+  if(m_sqes == MAP_FAILED)
+  {
+    ERR("Could not map the submission entries (errno %d)", errno);
+    teardown();
+    return NET_OOM;
+  }
+
+  char* sq = (char*)m_sqRingPtr;
+  m_sqHead = (unsigned*)(sq + params.sq_off.head);
+  m_sqTail = (unsigned*)(sq + params.sq_off.tail);
+  m_sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+  m_sqArray = (unsigned*)(sq + params.sq_off.array);
+  m_sqLocalTail = *m_sqTail;
+
+  char* cq = (char*)m_cqRingPtr;
+  m_cqHead = (unsigned*)(cq + params.cq_off.head);
+  m_cqTail = (unsigned*)(cq + params.cq_off.tail);
+  m_cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+  m_cqes = cq + params.cq_off.cqes;
+
+  //Fixed file table, with all the slots empty; older kernels that refuse sparse tables just fall back to plain descriptors
+  for(int i = 0; i < HTTP_URING_MAX_FILES; i++)
+  {
+    m_files[i] = -1;
+  }
+  m_filesRegistered = (sys_io_uring_register(m_fd, IORING_REGISTER_FILES, m_files, HTTP_URING_MAX_FILES) == 0);
+  if( !m_filesRegistered )
+  {
+    WARN("Fixed files not available (errno %d)", errno);
+  }
+
+  //Registered buffers, pinned once instead of being mapped on every operation
+  if( posix_memalign((void**)&m_buffers, 4096, (size_t)HTTP_URING_BUFFERS * HTTP_URING_BUFFER_SIZE) == 0 )
+  {
+    struct iovec iov[HTTP_URING_BUFFERS];
+    for(int i = 0; i < HTTP_URING_BUFFERS; i++)
+    {
+      iov[i].iov_base = getBuffer(i);
+      iov[i].iov_len = HTTP_URING_BUFFER_SIZE;
+    }
+    m_buffersRegistered = (sys_io_uring_register(m_fd, IORING_REGISTER_BUFFERS, iov, HTTP_URING_BUFFERS) == 0);
+    if( !m_buffersRegistered )
+    {
+      WARN("Registered buffers not available (errno %d)", errno);
+    }
+    else
+    {
+      m_buffersFree = (HTTP_URING_BUFFERS >= 32) ? 0xFFFFFFFF : ((1UL << HTTP_URING_BUFFERS) - 1);
+    }
+  }
+
+  DBG("io_uring set up, %d entries", m_sqEntries);
+  return OK;
+}
+
+void HTTPUringRing::teardown() //Undo setup(), which is attempted again on the next getSqe() call
+{
+  if(m_fd >= 0)
+  {
+    ::close(m_fd); //Also unregisters files and buffers
+    m_fd = -1;
+  }
+  if(m_sqes != MAP_FAILED)
+  {
+    munmap(m_sqes, m_sqesSize);
+    m_sqes = (struct io_uring_sqe*)MAP_FAILED;
+  }
+  if( (m_cqRingPtr != MAP_FAILED) && (m_cqRingPtr != m_sqRingPtr) )
+  {
+    munmap(m_cqRingPtr, m_cqRingSize);
+  }
+  m_cqRingPtr = MAP_FAILED;
+  if(m_sqRingPtr != MAP_FAILED)
+  {
+    munmap(m_sqRingPtr, m_sqRingSize);
+    m_sqRingPtr = MAP_FAILED;
+  }
+}
+
+void HTTPUringRing::reap()
+{
+  unsigned head = *m_cqHead;
+  unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+  while(head != tail)
+  {
+    struct io_uring_cqe* cqe = &((struct io_uring_cqe*)m_cqes)[head & *m_cqMask];
+    HTTPUringOp* pOp = (HTTPUringOp*)(uintptr_t)cqe->user_data;
+    if(pOp != NULL)
+    {
+      pOp->result = cqe->res;
+      pOp->pending = false;
+    }
+    head++;
+  }
+  __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+}
+
+#endif
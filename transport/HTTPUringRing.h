@@ -0,0 +1,161 @@
+/* HTTPUringRing.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPURINGRING_H_
+#define HTTPURINGRING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/time_types.h>
+
+#define HTTP_URING_ENTRIES 64 //Submission queue size
+#define HTTP_URING_MAX_FILES 64 //Size of the registered (fixed) file table
+#define HTTP_URING_BUFFERS 32 //Number of registered buffers (at most 32)
+#define HTTP_URING_BUFFER_SIZE 2048 //Size of each registered buffer
+
+struct io_uring_sqe;
+
+///State of an operation submitted to a ring, owned by the submitter until it completes
+struct HTTPUringOp
+{
+  bool pending; ///<Submitted, completion not reaped yet
+  int result; ///<Completion result (bytes transferred or -errno)
+  struct __kernel_timespec timeout; ///<Storage for the linked timeout, read by the kernel on submission
+};
+
+/** io_uring instance shared by several HTTPUringTransport connections
+ * Operations queued by all the connections are submitted together by a single io_uring_enter() call,
+ * and their completions are dispatched back to the connections that queued them.
+ * The ring also owns a pool of registered buffers and a registered file table, so that the kernel does not need to
+ * map user memory or look file descriptors up on every operation.
+ * A ring must only be used by one thread.
+ */
+class HTTPUringRing
+{
+public:
+  /** Instantiate a ring
+   * The ring is set up on first use
+   */
+  HTTPUringRing();
+  ~HTTPUringRing();
+
+  /** Get a submission queue entry, the operation will be submitted on the next call to flush() or waitFor()
+   * @param pOp Operation to associate with the entry (NULL for an operation whose completion is ignored)
+   * @return Pointer to a zeroed entry, or NULL on failure
+   */
+  struct io_uring_sqe* getSqe(HTTPUringOp* pOp);
+
+  /** Get a submission queue entry for an operation, with a linked timeout
+   * @param pOp Operation to associate with the entry
+   * @param timeout Timeout in ms (HTTP_WAIT_FOREVER for none); the operation completes with -ECANCELED if it expires
+   * @return Pointer to a zeroed entry, or NULL on failure
+   */
+  struct io_uring_sqe* getSqe(HTTPUringOp* pOp, uint32_t timeout);
+
+  /** Submit all the queued operations and dispatch the completions that are available
+   * @param wait Block until at least one operation completes
+   * @return 0 on success, NET error on failure
+   */
+  int flush(bool wait);
+
+  /** Submit all the queued operations and dispatch completions until a given operation completes
+   * @param pOp Operation to wait for
+   * @return 0 on success, NET error on failure
+   */
+  int waitFor(HTTPUringOp* pOp);
+
+  /** Register a file descriptor in the fixed file table
+   * @param fd File descriptor
+   * @return Index in the table, or -1 if the table is full or not available
+   */
+  int registerFile(int fd);
+
+  /** Remove a file descriptor from the fixed file table
+   * @param index Index returned by registerFile()
+   */
+  void unregisterFile(int index);
+
+  /** Get a registered buffer
+   * @return Index of the buffer, or -1 if none is available
+   */
+  int allocBuffer();
+
+  /** Release a registered buffer
+   * @param index Index returned by allocBuffer()
+   */
+  void freeBuffer(int index);
+
+  /** Get the memory of a registered buffer
+   * @param index Index returned by allocBuffer()
+   */
+  char* getBuffer(int index);
+
+  /** Get number of io_uring_enter() calls made so far
+   */
+  uint32_t getEnterCount();
+
+  /** Get number of operations submitted so far
+   */
+  uint32_t getSubmittedCount();
+
+private:
+  int setup();
+  void teardown();
+  void reap();
+
+  int m_fd;
+
+  //Submission queue
+  unsigned* m_sqHead;
+  unsigned* m_sqTail;
+  unsigned* m_sqMask;
+  unsigned* m_sqArray;
+  struct io_uring_sqe* m_sqes;
+  unsigned m_sqEntries;
+  unsigned m_sqLocalTail; //Entries queued but not published to the kernel yet
+  unsigned m_toSubmit;
+
+  //Completion queue
+  unsigned* m_cqHead;
+  unsigned* m_cqTail;
+  unsigned* m_cqMask;
+  void* m_cqes;
+
+  void* m_sqRingPtr;
+  size_t m_sqRingSize;
+  void* m_cqRingPtr;
+  size_t m_cqRingSize;
+  size_t m_sqesSize;
+
+  bool m_filesRegistered;
+  int m_files[HTTP_URING_MAX_FILES];
+
+  char* m_buffers;
+  bool m_buffersRegistered;
+  uint32_t m_buffersFree; //Bitmap of available buffers
+
+  uint32_t m_enterCount;
+  uint32_t m_submittedCount;
+};
+
+#endif /* HTTPURINGRING_H_ */
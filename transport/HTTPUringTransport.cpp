@@ -0,0 +1,365 @@
+/* HTTPUringTransport.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifdef __linux__ //Linux host build only
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPUringTransport.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPUringTransport.h"
+#include "HTTPLinuxNet.h"
+
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <cstring>
+
+HTTPUringTransport::HTTPUringTransport(HTTPUringRing* pRing) : m_pRing(pRing), m_sock(-1), m_fileIndex(-1), m_bufIndex(-1), m_reading(false)
+{
+  std::memset(&m_op, 0, sizeof(m_op));
+}
+
+HTTPUringTransport::~HTTPUringTransport()
+{
+  close();
+}
+
+/*virtual*/ int HTTPUringTransport::resolve(const char* host, uint16_t port, HTTPAddress* pAddr)
+{
+  return HTTPLinuxNet::resolve(host, port, pAddr);
+}
+
+/*virtual*/ int HTTPUringTransport::resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount)
+{
+  return HTTPLinuxNet::resolveAll(host, port, pAddrs, maxCount, pCount);
+}
+
+/*virtual*/ int HTTPUringTransport::connect(const HTTPAddress& addr, uint32_t timeout)
+{
+  close();
+
+  socklen_t serverAddrLen = HTTPLinuxNet::toSockAddr(addr, &m_serverAddr);
+
+  DBG("Creating socket");
+  m_sock = ::socket(HTTPLinuxNet::getDomain(addr), SOCK_STREAM | SOCK_CLOEXEC, 0); //Blocking is fine, io_uring completes operations asynchronously
+  if(m_sock < 0)
+  {
+    ERR("Could not create socket (errno %d)", errno);
+    return NET_OOM;
+  }
+
+  //Requests are made of several small writes, do not let Nagle's algorithm hold them back waiting for ACKs
+  int one = 1;
+  setsockopt(m_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  //Both are optional, operations fall back to the plain descriptor and startReadFixed() to startRead()
+  m_fileIndex = m_pRing->registerFile(m_sock);
+  m_bufIndex = m_pRing->allocBuffer();
+  DBG("Handle is %d (fixed file %d, buffer %d)", m_sock, m_fileIndex, m_bufIndex);
+
+  struct io_uring_sqe* sqe = prepare(IORING_OP_CONNECT, timeout);
+  if(sqe == NULL)
+  {
+    close();
+    return NET_OOM;
+  }
+  sqe->addr = (uint64_t)(uintptr_t)&m_serverAddr;
+  sqe->off = serverAddrLen;
+
+  m_reading = false;
+  size_t len;
+  int ret = complete(&len);
+  if(ret != OK)
+  {
+    ERR("Could not connect (%d)", ret);
+    close();
+    return (ret == NET_TIMEOUT) ? NET_TIMEOUT : NET_CONN;
+  }
+  return OK;
+}
+
+/*virtual*/ int HTTPUringTransport::read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout)
+{
+  DBG("Trying to read between %d and %d bytes", minLen, maxLen);
+  size_t readLen = 0;
+  *pReadLen = 0;
+  while(readLen < minLen)
+  {
+    int ret = prepareRead(buf + readLen, maxLen - readLen, timeout);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    size_t len;
+    ret = complete(&len);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    readLen += len;
+    *pReadLen = readLen; //Bytes already read are reported even if a later call fails
+  }
+  DBG("Read %d bytes", readLen);
+  return OK;
+}
+
+/*virtual*/ int HTTPUringTransport::write(const char* buf, size_t len, uint32_t timeout)
+{
+  DBG("Trying to write %d bytes", len);
+  size_t writtenLen = 0;
+  while(writtenLen < len)
+  {
+    int ret = prepareWrite(buf + writtenLen, len - writtenLen, timeout);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    size_t trfLen;
+    ret = complete(&trfLen);
+    if(ret != OK)
+    {
+      return ret;
+    }
+    writtenLen += trfLen;
+  }
+  DBG("Written %d bytes", writtenLen);
+  return OK;
+}
+
+/*virtual*/ int HTTPUringTransport::wait(int events, uint32_t timeout)
+{
+  if(m_sock < 0)
+  {
+    return NET_CLOSED;
+  }
+  struct io_uring_sqe* sqe = prepare(IORING_OP_POLL_ADD, timeout);
+  if(sqe == NULL)
+  {
+    return NET_OOM;
+  }
+  sqe->poll32_events = ((events & HTTP_READABLE) ? POLLIN : 0) | ((events & HTTP_WRITABLE) ? POLLOUT : 0);
+
+  m_reading = false;
+  size_t len;
+  return complete(&len);
+}
+
+/*virtual*/ int HTTPUringTransport::close()
+{
+  if(m_op.pending) //Only possible if an operation started with startRead()/startWrite() is still in flight
+  {
+    struct io_uring_sqe* sqe = m_pRing->getSqe(NULL);
+    if(sqe != NULL)
+    {
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->addr = (uint64_t)(uintptr_t)&m_op;
+    }
+    m_pRing->waitFor(&m_op); //The kernel must be done with the buffers before they are released
+  }
+  if(m_fileIndex >= 0)
+  {
+    m_pRing->unregisterFile(m_fileIndex);
+    m_fileIndex = -1;
+  }
+  if(m_bufIndex >= 0)
+  {
+    m_pRing->freeBuffer(m_bufIndex);
+    m_bufIndex = -1;
+  }
+  if(m_sock >= 0)
+  {
+    ::close(m_sock);
+    m_sock = -1;
+  }
+  return OK;
+}
+
+/*virtual*/ bool HTTPUringTransport::isConnected()
+{
+  return (m_sock >= 0);
+}
+
+int HTTPUringTransport::startRead(char* buf, size_t maxLen)
+{
+  return prepareRead(buf, maxLen, HTTP_WAIT_FOREVER);
+}
+
+int HTTPUringTransport::startReadFixed(size_t maxLen)
+{
+  return prepareReadFixed(maxLen, HTTP_WAIT_FOREVER);
+}
+
+const char* HTTPUringTransport::getReadBuffer()
+{
+  return (m_bufIndex >= 0) ? m_pRing->getBuffer(m_bufIndex) : NULL;
+}
+
+int HTTPUringTransport::startWrite(const char* buf, size_t len)
+{
+  return prepareWrite(buf, len, HTTP_WAIT_FOREVER);
+}
+
+bool HTTPUringTransport::isDone()
+{
+  return !m_op.pending;
+}
+
+int HTTPUringTransport::getResult(size_t* pLen)
+{
+  *pLen = 0;
+  if(m_op.pending)
+  {
+    return NET_PROCESSING;
+  }
+  if(m_op.result < 0)
+  {
+    switch(-m_op.result)
+    {
+    case ECANCELED: //The linked timeout fired
+    case ETIME:
+      if( (m_op.timeout.tv_sec != 0) || (m_op.timeout.tv_nsec != 0) ) //A zero timeout is a readiness probe, which is expected to time out
+      {
+        WARN("Timeout");
+      }
+      return NET_TIMEOUT;
+    case EPIPE:
+    case ECONNRESET:
+      WARN("Connection was closed by server");
+      return NET_CLOSED;
+    default:
+      ERR("Connection error (errno %d)", -m_op.result);
+      return NET_CONN;
+    }
+  }
+  if( (m_op.result == 0) && m_reading )
+  {
+    WARN("Connection was closed by server");
+    return NET_CLOSED; //Connection was closed by server
+  }
+  *pLen = m_op.result;
+  return OK;
+}
+
+struct io_uring_sqe* HTTPUringTransport::prepare(uint8_t opcode, uint32_t timeout)
+{
+  struct io_uring_sqe* sqe = m_pRing->getSqe(&m_op, timeout);
+  if(sqe == NULL)
+  {
+    return NULL;
+  }
+  sqe->opcode = opcode;
+  if(m_fileIndex >= 0)
+  {
+    sqe->fd = m_fileIndex;
+    sqe->flags |= IOSQE_FIXED_FILE; //Keep the link flag set by the ring
+  }
+  else
+  {
+    sqe->fd = m_sock;
+  }
+  return sqe;
+}
+
+int HTTPUringTransport::prepareRead(char* buf, size_t maxLen, uint32_t timeout)
+{
+  if(m_sock < 0)
+  {
+    return NET_CLOSED;
+  }
+  //Received straight into the caller's buffer: going through a registered buffer would cost a copy on every read
+  struct io_uring_sqe* sqe = prepare(IORING_OP_RECV, timeout);
+  if(sqe == NULL)
+  {
+    return NET_OOM;
+  }
+  sqe->addr = (uint64_t)(uintptr_t)buf;
+  sqe->len = maxLen;
+  m_reading = true;
+  return OK;
+}
+
+int HTTPUringTransport::prepareReadFixed(size_t maxLen, uint32_t timeout)
+{
+  if(m_sock < 0)
+  {
+    return NET_CLOSED;
+  }
+  if(m_bufIndex < 0)
+  {
+    return NET_NOTFOUND;
+  }
+  struct io_uring_sqe* sqe = prepare(IORING_OP_READ_FIXED, timeout);
+  if(sqe == NULL)
+  {
+    return NET_OOM;
+  }
+  sqe->addr = (uint64_t)(uintptr_t)m_pRing->getBuffer(m_bufIndex);
+  sqe->len = MIN(maxLen, HTTP_URING_BUFFER_SIZE);
+  sqe->buf_index = m_bufIndex;
+  m_reading = true;
+  return OK;
+}
+
+int HTTPUringTransport::prepareWrite(const char* buf, size_t len, uint32_t timeout)
+{
+  if(m_sock < 0)
+  {
+    return NET_CLOSED;
+  }
+  //Sent straight from the caller's buffer: a registered buffer would require a copy, and write() on a socket could raise SIGPIPE
+  struct io_uring_sqe* sqe = prepare(IORING_OP_SEND, timeout);
+  if(sqe == NULL)
+  {
+    return NET_OOM;
+  }
+  sqe->addr = (uint64_t)(uintptr_t)buf;
+  sqe->len = len;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  m_reading = false;
+  return OK;
+}
+
+int HTTPUringTransport::complete(size_t* pLen)
+{
+  int ret = m_pRing->waitFor(&m_op);
+  if(ret != OK)
+  {
+    *pLen = 0;
+    return ret;
+  }
+  return getResult(pLen);
+}
+
+#endif
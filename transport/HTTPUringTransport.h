@@ -0,0 +1,118 @@
+/* HTTPUringTransport.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPURINGTRANSPORT_H_
+#define HTTPURINGTRANSPORT_H_
+
+#include "../IHTTPTransport.h"
+#include "HTTPUringRing.h"
+
+#include <sys/socket.h>
+
+/** Transport over native Linux sockets driven by io_uring
+ * Several transports share one HTTPUringRing, and all operations use its fixed file table when available.
+ * The blocking IHTTPTransport calls queue an operation and wait for its completion, submitting whatever other connections
+ * have queued in the same system call; data is received straight into the caller's buffer.
+ * startRead()/startWrite() queue an operation without waiting, so that a single thread can drive many connections:
+ * queue an operation on each of them, call HTTPUringRing::flush(true) and collect the results with isDone()/getResult().
+ * startReadFixed() receives into a registered buffer of the ring instead, which is read in place with getReadBuffer().
+ */
+class HTTPUringTransport : public IHTTPTransport
+{
+public:
+  /** Instantiate the transport
+   * @param pRing Ring to submit operations to, must remain valid as long as the transport is in use
+   */
+  HTTPUringTransport(HTTPUringRing* pRing);
+  virtual ~HTTPUringTransport();
+
+  //IHTTPTransport
+  virtual int resolve(const char* host, uint16_t port, HTTPAddress* pAddr);
+
+  virtual int resolveAll(const char* host, uint16_t port, HTTPAddress* pAddrs, size_t maxCount, size_t* pCount);
+
+  virtual int connect(const HTTPAddress& addr, uint32_t timeout);
+
+  virtual int read(char* buf, size_t minLen, size_t maxLen, size_t* pReadLen, uint32_t timeout);
+
+  virtual int write(const char* buf, size_t len, uint32_t timeout);
+
+  virtual int wait(int events, uint32_t timeout);
+
+  virtual int close();
+
+  virtual bool isConnected();
+
+  /** Queue a receive without waiting for it
+   * @param buf Pointer to the buffer on which to copy the data, must remain valid until the operation completes
+   * @param maxLen Length of the buffer
+   * @return 0 on success, NET error on failure
+   */
+  int startRead(char* buf, size_t maxLen);
+
+  /** Queue a receive into the registered buffer of the connection without waiting for it
+   * The data is not copied: once getResult() succeeds, it is read from getReadBuffer() until the next operation is queued.
+   * @param maxLen Maximum length to receive (at most HTTP_URING_BUFFER_SIZE bytes are received)
+   * @return 0 on success, NET_NOTFOUND if the connection has no registered buffer (use startRead() instead), NET error on failure
+   */
+  int startReadFixed(size_t maxLen);
+
+  /** Get the registered buffer that startReadFixed() receives into
+   * @return Pointer to the buffer, or NULL if the connection has none
+   */
+  const char* getReadBuffer();
+
+  /** Queue a send without waiting for it
+   * @param buf Pointer to the data to write, must remain valid until the operation completes
+   * @param len Length of the data (only part of it may be written)
+   * @return 0 on success, NET error on failure
+   */
+  int startWrite(const char* buf, size_t len);
+
+  /** Check whether the operation queued by startRead(), startReadFixed() or startWrite() has completed
+   */
+  bool isDone();
+
+  /** Get the result of the operation queued by startRead(), startReadFixed() or startWrite()
+   * @param pLen Pointer to the variable on which the number of bytes transferred will be stored
+   * @return 0 on success, NET error on failure
+   */
+  int getResult(size_t* pLen);
+
+private:
+  struct io_uring_sqe* prepare(uint8_t opcode, uint32_t timeout);
+  int prepareRead(char* buf, size_t maxLen, uint32_t timeout);
+  int prepareReadFixed(size_t maxLen, uint32_t timeout);
+  int prepareWrite(const char* buf, size_t len, uint32_t timeout);
+  int complete(size_t* pLen);
+
+  HTTPUringRing* m_pRing;
+  HTTPUringOp m_op;
+  int m_sock;
+  int m_fileIndex; //Index in the ring's fixed file table, -1 if not registered
+  int m_bufIndex; //Registered buffer used by startReadFixed(), -1 if none
+  bool m_reading; //The pending operation is a receive
+  struct sockaddr_storage m_serverAddr; //Read by the kernel while the connection is in progress
+};
+
+#endif /* HTTPURINGTRANSPORT_H_ */
@@ -0,0 +1,68 @@
+/* HTTPBase64.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "HTTPBase64.h"
+
+static const char s_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*static*/ size_t HTTPBase64::getEncodedLen(size_t len)
+{
+  return ((len + 2) / 3) * 4;
+}
+
+/*static*/ size_t HTTPBase64::encode(const char* data, size_t len, char* out, size_t maxOutLen)
+{
+  size_t outLen = getEncodedLen(len);
+  if(outLen + 1 > maxOutLen)
+  {
+    return 0;
+  }
+  const unsigned char* in = (const unsigned char*) data;
+  char* p = out;
+  while(len >= 3)
+  {
+    *p++ = s_alphabet[in[0] >> 2];
+    *p++ = s_alphabet[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+    *p++ = s_alphabet[((in[1] & 0x0F) << 2) | (in[2] >> 6)];
+    *p++ = s_alphabet[in[2] & 0x3F];
+    in += 3;
+    len -= 3;
+  }
+  if(len > 0) //1 or 2 bytes left, padded
+  {
+    *p++ = s_alphabet[in[0] >> 2];
+    if(len == 1)
+    {
+      *p++ = s_alphabet[(in[0] & 0x03) << 4];
+      *p++ = '=';
+    }
+    else
+    {
+      *p++ = s_alphabet[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+      *p++ = s_alphabet[(in[1] & 0x0F) << 2];
+    }
+    *p++ = '=';
+  }
+  *p = '\0';
+  return outLen;
+}
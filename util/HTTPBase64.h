@@ -0,0 +1,49 @@
+/* HTTPBase64.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPBASE64_H_
+#define HTTPBASE64_H_
+
+#include <stddef.h>
+
+/** Base64 encoding (RFC 4648, with padding)
+*/
+class HTTPBase64
+{
+public:
+  /** Length of the encoded form of some data, excluding the NULL-terminating char
+   * @param len Length of the data
+   */
+  static size_t getEncodedLen(size_t len);
+
+  /** Encode data
+   * @param data Data to encode
+   * @param len Length of the data
+   * @param out Buffer receiving the NULL-terminated encoded string
+   * @param maxOutLen Size of the buffer, at least getEncodedLen(len) + 1
+   * @return Length of the encoded string, or 0 if the buffer is too small
+   */
+  static size_t encode(const char* data, size_t len, char* out, size_t maxOutLen);
+};
+
+#endif /* HTTPBASE64_H_ */
@@ -0,0 +1,179 @@
+/* HTTPImpairment.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPImpairment.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPImpairment.h"
+#include "HTTPTime.h"
+
+HTTPImpairment::HTTPImpairment() : m_fragments(NULL), m_fragmentsCount(0), m_fragmentPos(0),
+m_randomMax(0), m_seed(0), m_random(0), m_latency(0), m_bandwidth(0), m_debtUs(0)
+{
+  reset();
+}
+
+void HTTPImpairment::setFragments(const size_t* sizes, size_t count)
+{
+  m_fragments = sizes;
+  m_fragmentsCount = count;
+  m_fragmentPos = 0;
+  m_randomMax = 0;
+}
+
+void HTTPImpairment::setRandomFragments(size_t maxSize, uint32_t seed)
+{
+  m_randomMax = maxSize;
+  m_seed = seed;
+  m_random = seed;
+  m_fragmentsCount = 0;
+}
+
+void HTTPImpairment::setLatency(uint32_t ms)
+{
+  m_latency = ms;
+}
+
+void HTTPImpairment::setBandwidth(uint32_t bytesPerSec)
+{
+  m_bandwidth = bytesPerSec;
+}
+
+void HTTPImpairment::setDrip(uint32_t intervalMs)
+{
+  static const size_t drip = 1;
+  setFragments(&drip, 1);
+  setLatency(intervalMs);
+}
+
+void HTTPImpairment::reset()
+{
+  m_fragmentPos = 0;
+  m_random = m_seed;
+  m_debtUs = 0;
+  m_bytesRead = 0;
+  m_bytesWritten = 0;
+  m_readsCount = 0;
+  m_writesCount = 0;
+  m_start = HTTPTime::getMs();
+}
+
+size_t HTTPImpairment::limitRead(size_t len)
+{
+  size_t fragmentLen = nextFragment(); //Not within MIN(), which would draw a second random size
+  return MIN(len, fragmentLen);
+}
+
+size_t HTTPImpairment::limitWrite(size_t len)
+{
+  return len; //Outgoing data is only paced, the server's parser is not what is being stressed
+}
+
+void HTTPImpairment::onRead(size_t len)
+{
+  m_bytesRead += len;
+  m_readsCount++;
+  if( m_fragmentsCount > 0 )
+  {
+    m_fragmentPos = (m_fragmentPos + 1) % m_fragmentsCount; //Only move on once the fragment has actually been delivered
+  }
+  pace(len);
+}
+
+void HTTPImpairment::onWrite(size_t len)
+{
+  m_bytesWritten += len;
+  m_writesCount++;
+  pace(len);
+}
+
+size_t HTTPImpairment::getBytesRead()
+{
+  return m_bytesRead;
+}
+
+size_t HTTPImpairment::getBytesWritten()
+{
+  return m_bytesWritten;
+}
+
+size_t HTTPImpairment::getReadsCount()
+{
+  return m_readsCount;
+}
+
+size_t HTTPImpairment::getWritesCount()
+{
+  return m_writesCount;
+}
+
+uint32_t HTTPImpairment::getElapsed()
+{
+  return HTTPTime::elapsed(m_start);
+}
+
+uint32_t HTTPImpairment::getReadThroughput()
+{
+  uint32_t elapsed = getElapsed();
+  if( elapsed == 0 )
+  {
+    elapsed = 1;
+  }
+  return (uint32_t)(((uint64_t)m_bytesRead * 1000) / elapsed);
+}
+
+size_t HTTPImpairment::nextFragment()
+{
+  if( m_fragmentsCount > 0 )
+  {
+    return m_fragments[m_fragmentPos];
+  }
+  else if( m_randomMax > 0 )
+  {
+    m_random = m_random * 1103515245 + 12345; //Same LCG as the C standard's example rand()
+    return 1 + ((m_random >> 16) % m_randomMax);
+  }
+  return (size_t)-1; //No limit
+}
+
+void HTTPImpairment::pace(size_t len)
+{
+  uint32_t delayUs = m_latency * 1000;
+  if( m_bandwidth != 0 )
+  {
+    delayUs += (uint32_t)(((uint64_t)len * 1000000) / m_bandwidth);
+  }
+  m_debtUs += delayUs;
+  if( m_debtUs >= 1000 ) //Accumulate sub-ms delays so that bandwidth caps stay accurate with small fragments
+  {
+    HTTPTime::sleep(m_debtUs / 1000);
+    m_debtUs %= 1000;
+  }
+}
@@ -0,0 +1,144 @@
+/* HTTPImpairment.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPIMPAIRMENT_H_
+#define HTTPIMPAIRMENT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Network impairment emulator
+ * Splits the byte stream exchanged by the HTTP client at configurable boundaries and adds latency and bandwidth caps,
+ * so that the parser can be stressed and benchmarked under the kind of segmentation seen on real (e.g. cellular) links.
+ * It also collects transfer statistics to measure the throughput achieved under these conditions.
+ */
+class HTTPImpairment
+{
+public:
+  /** Instantiate an impairment emulator that lets everything through unchanged
+   */
+  HTTPImpairment();
+
+  /** Split the incoming stream following a repeating pattern of fragment sizes
+   * The array must remain valid as long as the emulator is in use
+   * @param sizes Maximum number of bytes delivered by each successive read, cycled through; must not contain 0
+   * @param count Number of entries in the array (0 to disable)
+   */
+  void setFragments(const size_t* sizes, size_t count);
+
+  /** Split the incoming stream at pseudo-random boundaries (reproducible for a given seed)
+   * @param maxSize Maximum number of bytes delivered by each read, each fragment size is picked in [1, maxSize] (0 to disable)
+   * @param seed Seed for the pseudo-random generator
+   */
+  void setRandomFragments(size_t maxSize, uint32_t seed);
+
+  /** Delay each fragment delivered in either direction
+   * @param ms Latency in ms
+   */
+  void setLatency(uint32_t ms);
+
+  /** Cap the throughput in each direction
+   * @param bytesPerSec Bandwidth in bytes per second (0 for unlimited)
+   */
+  void setBandwidth(uint32_t bytesPerSec);
+
+  /** Drip feed: deliver the incoming stream one byte at a time
+   * @param intervalMs Delay between each byte in ms
+   */
+  void setDrip(uint32_t intervalMs);
+
+  /** Reset the transfer statistics and the fragmentation pattern
+   */
+  void reset();
+
+  /** Limit the length of the next read
+   * @param len Length requested by the client
+   * @return Length that may actually be read
+   */
+  size_t limitRead(size_t len);
+
+  /** Limit the length of the next write
+   * @param len Length requested by the client
+   * @return Length that may actually be written
+   */
+  size_t limitWrite(size_t len);
+
+  /** Account for bytes that have been read, sleeping as needed to emulate latency and bandwidth
+   * @param len Number of bytes read
+   */
+  void onRead(size_t len);
+
+  /** Account for bytes that have been written, sleeping as needed to emulate latency and bandwidth
+   * @param len Number of bytes written
+   */
+  void onWrite(size_t len);
+
+  /** Get number of bytes read since last reset
+   */
+  size_t getBytesRead();
+
+  /** Get number of bytes written since last reset
+   */
+  size_t getBytesWritten();
+
+  /** Get number of reads (i.e. fragments delivered) since last reset
+   */
+  size_t getReadsCount();
+
+  /** Get number of writes since last reset
+   */
+  size_t getWritesCount();
+
+  /** Get time elapsed since last reset in ms
+   */
+  uint32_t getElapsed();
+
+  /** Get the average incoming throughput since last reset
+   * @return Throughput in bytes per second
+   */
+  uint32_t getReadThroughput();
+
+private:
+  size_t nextFragment();
+  void pace(size_t len);
+
+  const size_t* m_fragments;
+  size_t m_fragmentsCount;
+  size_t m_fragmentPos;
+
+  size_t m_randomMax;
+  uint32_t m_seed;
+  uint32_t m_random;
+
+  uint32_t m_latency;
+  uint32_t m_bandwidth;
+  uint32_t m_debtUs; //Pacing delay not slept yet, in us
+
+  size_t m_bytesRead;
+  size_t m_bytesWritten;
+  size_t m_readsCount;
+  size_t m_writesCount;
+  uint32_t m_start;
+};
+
+#endif /* HTTPIMPAIRMENT_H_ */
@@ -0,0 +1,142 @@
+/* HTTPSHA1.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "HTTPSHA1.h"
+
+#include <string.h>
+
+static inline uint32_t rol(uint32_t x, int n)
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+HTTPSHA1::HTTPSHA1() : m_blockLen(0), m_totalLen(0)
+{
+  m_state[0] = 0x67452301;
+  m_state[1] = 0xEFCDAB89;
+  m_state[2] = 0x98BADCFE;
+  m_state[3] = 0x10325476;
+  m_state[4] = 0xC3D2E1F0;
+}
+
+void HTTPSHA1::update(const char* data, size_t len)
+{
+  m_totalLen += len;
+  while(len > 0)
+  {
+    size_t copyLen = sizeof(m_block) - m_blockLen;
+    if(copyLen > len)
+    {
+      copyLen = len;
+    }
+    memcpy(m_block + m_blockLen, data, copyLen);
+    m_blockLen += copyLen;
+    data += copyLen;
+    len -= copyLen;
+    if(m_blockLen == sizeof(m_block))
+    {
+      processBlock();
+    }
+  }
+}
+
+void HTTPSHA1::finish(uint8_t* digest)
+{
+  uint64_t bitLen = m_totalLen * 8;
+  //Padding: a 1 bit, zeros, then the message length in bits on 64 bits (big-endian) at the end of a block
+  m_block[m_blockLen++] = 0x80;
+  if(m_blockLen > sizeof(m_block) - 8)
+  {
+    memset(m_block + m_blockLen, 0, sizeof(m_block) - m_blockLen);
+    processBlock();
+  }
+  memset(m_block + m_blockLen, 0, sizeof(m_block) - 8 - m_blockLen);
+  for(int i = 0; i < 8; i++)
+  {
+    m_block[63 - i] = (uint8_t)(bitLen >> (8 * i));
+  }
+  processBlock();
+  for(int i = 0; i < 5; i++)
+  {
+    digest[4 * i] = (uint8_t)(m_state[i] >> 24);
+    digest[4 * i + 1] = (uint8_t)(m_state[i] >> 16);
+    digest[4 * i + 2] = (uint8_t)(m_state[i] >> 8);
+    digest[4 * i + 3] = (uint8_t)m_state[i];
+  }
+}
+
+void HTTPSHA1::processBlock()
+{
+  uint32_t w[80];
+  for(int i = 0; i < 16; i++)
+  {
+    w[i] = ((uint32_t)m_block[4 * i] << 24) | ((uint32_t)m_block[4 * i + 1] << 16) | ((uint32_t)m_block[4 * i + 2] << 8) | m_block[4 * i + 3];
+  }
+  for(int i = 16; i < 80; i++)
+  {
+    w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  }
+
+  uint32_t a = m_state[0];
+  uint32_t b = m_state[1];
+  uint32_t c = m_state[2];
+  uint32_t d = m_state[3];
+  uint32_t e = m_state[4];
+  for(int i = 0; i < 80; i++)
+  {
+    uint32_t f;
+    uint32_t k;
+    if(i < 20)
+    {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    }
+    else if(i < 40)
+    {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    }
+    else if(i < 60)
+    {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    }
+    else
+    {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+    uint32_t temp = rol(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = rol(b, 30);
+    b = a;
+    a = temp;
+  }
+  m_state[0] += a;
+  m_state[1] += b;
+  m_state[2] += c;
+  m_state[3] += d;
+  m_state[4] += e;
+  m_blockLen = 0;
+}
@@ -0,0 +1,60 @@
+/* HTTPSHA1.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPSHA1_H_
+#define HTTPSHA1_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HTTP_SHA1_DIGEST_LEN 20
+
+/** SHA-1 digest (FIPS 180-4), as needed by the WebSocket handshake
+ * SHA-1 is not collision-resistant anymore: do not use it for anything security-related
+ */
+class HTTPSHA1
+{
+public:
+  HTTPSHA1();
+
+  /** Add data to the digest
+   * @param data Data to add
+   * @param len Length of the data
+   */
+  void update(const char* data, size_t len);
+
+  /** Finish the digest, after which the instance must not be updated anymore
+   * @param digest Buffer receiving the HTTP_SHA1_DIGEST_LEN bytes of the digest
+   */
+  void finish(uint8_t* digest);
+
+private:
+  void processBlock();
+
+  uint32_t m_state[5];
+  uint8_t m_block[64];
+  size_t m_blockLen;
+  uint64_t m_totalLen;
+};
+
+#endif /* HTTPSHA1_H_ */
@@ -0,0 +1,147 @@
+/* HTTPScan.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "HTTPScan.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef MIN
+#define MIN(x,y) (((x)<(y))?(x):(y))
+#endif
+
+#if defined(__ARM_NEON)
+#define HTTP_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+#define HTTP_SCAN_MIN_VECTOR_LEN 8 //Bytes scanned one by one before the vector loop or memchr()
+
+static size_t findCRLFTail(const char* buf, size_t pos, size_t len) //Short data, or bytes left over by the vector loop
+{
+  for( ; pos + 1 < len; pos++)
+  {
+    if( (buf[pos] == '\r') && (buf[pos + 1] == '\n') )
+    {
+      return pos;
+    }
+  }
+  return len;
+}
+
+#ifdef HTTP_SCAN_NEON
+//Only looks for CRs, as almost all of them start a CRLF in HTTP
+static size_t findCRLFNEON(const char* buf, size_t len)
+{
+  const uint8x16_t cr = vdupq_n_u8('\r');
+  size_t pos = 0;
+  for( ; pos + 16 <= len; pos += 16)
+  {
+    uint8x16_t match = vceqq_u8(vld1q_u8((const uint8_t*)(buf + pos)), cr);
+    //No movemask on NEON: narrowing keeps 4 bits per byte, giving a 64-bit mask with 4 bits set for each CR
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0) & 0x1111111111111111ULL;
+    while(mask != 0)
+    {
+      size_t crPos = pos + (__builtin_ctzll(mask) >> 2);
+      if( (crPos + 1 < len) && (buf[crPos + 1] == '\n') )
+      {
+        return crPos;
+      }
+      mask &= mask - 1;
+    }
+  }
+  return findCRLFTail(buf, pos, len);
+}
+#define HTTP_SCAN_FIND_CRLF findCRLFNEON
+#define HTTP_SCAN_IMPLEMENTATION "neon"
+#else
+//The C library vectorizes memchr() for the CPU it runs on (e.g. AVX2 or EVEX in glibc on x86),
+//which beat hand-written SSE2 and AVX2 loops on all but the shortest lines
+static size_t findCRLFMemchr(const char* buf, size_t len)
+{
+  const char* end = buf + len;
+  const char* p = buf;
+  while( (p = (const char*) memchr(p, '\r', end - p)) != NULL )
+  {
+    if(p + 1 == end)
+    {
+      break;
+    }
+    if(p[1] == '\n')
+    {
+      return p - buf;
+    }
+    p++;
+  }
+  return len;
+}
+#define HTTP_SCAN_FIND_CRLF findCRLFMemchr
+#define HTTP_SCAN_IMPLEMENTATION "memchr"
+#endif
+
+/*static*/ size_t HTTPScan::findCRLF(const char* buf, size_t len)
+{
+  //Chunk sizes and chunk-terminating CRLFs are found in the first few bytes, before any vector setup or call pays off
+  size_t prefixLen = MIN(len, HTTP_SCAN_MIN_VECTOR_LEN);
+  size_t crlfPos = findCRLFTail(buf, 0, prefixLen);
+  if(crlfPos < prefixLen)
+  {
+    return crlfPos;
+  }
+  if(len == prefixLen)
+  {
+    return len;
+  }
+  return (prefixLen - 1) + HTTP_SCAN_FIND_CRLF(buf + prefixLen - 1, len - prefixLen + 1); //The last byte of the prefix may be a CR
+}
+
+/*static*/ size_t HTTPScan::parseHex(const char* str, size_t* pValue)
+{
+  const unsigned char* p = (const unsigned char*) str;
+  size_t value = 0;
+  size_t digits = 0;
+  while(true)
+  {
+    //Digit value without branching on the character class, 16 if not a hex digit
+    unsigned int dec = p[digits] - '0';
+    unsigned int alpha = (p[digits] | 0x20) - 'a';
+    unsigned int digit = (dec < 10) ? dec : ((alpha < 6) ? (alpha + 10) : 16);
+    if(digit == 16)
+    {
+      break;
+    }
+    if( (value >> (sizeof(size_t) * 8 - 4)) != 0 )
+    {
+      return 0; //Overflow
+    }
+    value = (value << 4) | digit;
+    digits++;
+  }
+  *pValue = value;
+  return digits;
+}
+
+/*static*/ const char* HTTPScan::getImplementation()
+{
+  return HTTP_SCAN_IMPLEMENTATION;
+}
@@ -0,0 +1,55 @@
+/* HTTPScan.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPSCAN_H_
+#define HTTPSCAN_H_
+
+#include <stddef.h>
+
+/** Delimiter search and number parsing for the response parser
+ * CRLF search is vectorized with NEON on ARM when built for it, and relies on memchr() elsewhere,
+ * which the C library already vectorizes on x86 (tests/scan_bench.cpp compares them)
+ */
+class HTTPScan
+{
+public:
+  /** Find the first CRLF
+   * @param buf Data to search
+   * @param len Length of the data
+   * @return Position of the CR, or len if there is no CRLF (a CR in the last byte may be the first half of one)
+   */
+  static size_t findCRLF(const char* buf, size_t len);
+
+  /** Parse a hexadecimal number, such as a chunk size, stopping at the first non-hex digit (chunk extension, CR...)
+   * @param str NULL-terminated string
+   * @param pValue Pointer to the variable on which the value will be stored
+   * @return Number of digits parsed, 0 if there is none or if the value does not fit in a size_t
+   */
+  static size_t parseHex(const char* str, size_t* pValue);
+
+  /** Name of the CRLF search implementation in use ("neon" or "memchr")
+   */
+  static const char* getImplementation();
+};
+
+#endif /* HTTPSCAN_H_ */
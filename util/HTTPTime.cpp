@@ -0,0 +1,84 @@
+/* HTTPTime.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "HTTPTime.h"
+
+#ifdef __linux__
+#include <time.h>
+#include <errno.h>
+#else
+#include "mbed.h"
+#include "rtos.h"
+
+//The us ticker wraps around every ~71 minutes, so it is extended to a ms counter that wraps around at 2^32
+static uint32_t s_lastUs = 0;
+static uint32_t s_remainderUs = 0;
+static uint32_t s_ms = 0;
+#endif
+
+/*static*/ uint32_t HTTPTime::getMs()
+{
+#ifdef __linux__
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#else
+  __disable_irq();
+  uint32_t nowUs = us_ticker_read();
+  s_remainderUs += nowUs - s_lastUs;
+  s_lastUs = nowUs;
+  s_ms += s_remainderUs / 1000;
+  s_remainderUs %= 1000;
+  uint32_t ms = s_ms;
+  __enable_irq();
+  return ms;
+#endif
+}
+
+/*static*/ uint32_t HTTPTime::getUs()
+{
+#ifdef __linux__
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+#else
+  return us_ticker_read();
+#endif
+}
+
+/*static*/ void HTTPTime::sleep(uint32_t ms)
+{
+#ifdef __linux__
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  while( (nanosleep(&ts, &ts) != 0) && (errno == EINTR) ); //Resume if interrupted by a signal
+#else
+  Thread::wait(ms);
+#endif
+}
+
+/*static*/ uint32_t HTTPTime::elapsed(uint32_t since)
+{
+  return getMs() - since; //Unsigned arithmetic handles the wraparound
+}
@@ -0,0 +1,56 @@
+/* HTTPTime.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPTIME_H_
+#define HTTPTIME_H_
+
+#include <stdint.h>
+
+/** Millisecond clock and sleep, on the mbed target and on the Linux host build
+*/
+class HTTPTime
+{
+public:
+  /** Get a monotonic timestamp
+   * @return Elapsed time in ms since an arbitrary origin (wraps around at 2^32)
+   * On the mbed target this must be called at least once every 70 minutes to keep track of the us ticker
+   */
+  static uint32_t getMs();
+
+  /** Get a monotonic timestamp with a finer resolution, for traces
+   * @return Elapsed time in us since an arbitrary origin (wraps around at 2^32, every ~71 minutes)
+   */
+  static uint32_t getUs();
+
+  /** Block the calling thread
+   * @param ms Time to wait in ms
+   */
+  static void sleep(uint32_t ms);
+
+  /** Time elapsed since a timestamp returned by getMs(), wraparound-safe
+   * @param since Timestamp returned by getMs()
+   */
+  static uint32_t elapsed(uint32_t since);
+};
+
+#endif /* HTTPTIME_H_ */
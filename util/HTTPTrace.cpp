@@ -0,0 +1,191 @@
+/* HTTPTrace.cpp */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTP_CLIENT_LOG_LEVEL
+#define HTTP_CLIENT_LOG_LEVEL 2 //Errors and warnings
+#endif
+#define __DEBUG__ HTTP_CLIENT_LOG_LEVEL
+#ifndef __MODULE__
+#define __MODULE__ "HTTPTrace.cpp"
+#endif
+
+#include "core/fwk.h"
+
+#include "HTTPTrace.h"
+#include "HTTPTime.h"
+
+#include <cstring>
+#include <cstdio>
+
+#define TRACE_MAGIC 0x43525448u //"HTRC"
+#define TRACE_VERSION 1
+
+struct HTTPTraceHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t entryLen;
+  uint32_t size; //Number of entries
+  uint32_t index; //Number of events recorded, the next one goes to index % size
+};
+
+struct HTTPTraceEntry
+{
+  uint32_t time; //us
+  uint16_t event;
+  uint16_t seq; //Low bits of the index of the event, written last
+  int32_t arg[2];
+};
+
+struct HTTPTraceEventInfo
+{
+  const char* name;
+  const char* arg[2];
+};
+
+static const HTTPTraceEventInfo s_events[] =
+{
+#define HTTP_TRACE_INFO(id, name, arg0, arg1) { name, { arg0, arg1 } },
+  HTTP_TRACE_EVENTS(HTTP_TRACE_INFO)
+#undef HTTP_TRACE_INFO
+};
+
+#ifdef HTTP_CLIENT_TRACE
+static HTTPTraceEntry s_ring[HTTP_TRACE_SIZE];
+static volatile uint32_t s_index = 0;
+#endif
+
+/*static*/ void HTTPTrace::record(HTTP_TRACE_EVENT event, int32_t arg0, int32_t arg1)
+{
+#ifdef HTTP_CLIENT_TRACE
+  uint32_t index = __sync_fetch_and_add(&s_index, 1);
+  HTTPTraceEntry* entry = &s_ring[index & (HTTP_TRACE_SIZE - 1)];
+  entry->time = HTTPTime::getUs();
+  entry->event = event;
+  entry->arg[0] = arg0;
+  entry->arg[1] = arg1;
+  __sync_synchronize(); //An entry is only valid once its sequence number matches
+  entry->seq = (uint16_t) index;
+#else
+  (void) event;
+  (void) arg0;
+  (void) arg1;
+#endif
+}
+
+/*static*/ size_t HTTPTrace::getDumpLen()
+{
+#ifdef HTTP_CLIENT_TRACE
+  return sizeof(HTTPTraceHeader) + sizeof(s_ring);
+#else
+  return 0;
+#endif
+}
+
+/*static*/ size_t HTTPTrace::dump(char* buf, size_t maxLen)
+{
+#ifdef HTTP_CLIENT_TRACE
+  if( maxLen < getDumpLen() )
+  {
+    return 0;
+  }
+  HTTPTraceHeader header;
+  header.magic = TRACE_MAGIC;
+  header.version = TRACE_VERSION;
+  header.entryLen = sizeof(HTTPTraceEntry);
+  header.size = HTTP_TRACE_SIZE;
+  header.index = __sync_fetch_and_add(&s_index, 0); //Full barrier, the entries are read after the index
+  memcpy(buf, &header, sizeof(header));
+  memcpy(buf + sizeof(header), s_ring, sizeof(s_ring));
+  return getDumpLen();
+#else
+  (void) buf;
+  (void) maxLen;
+  return 0;
+#endif
+}
+
+/*static*/ void HTTPTrace::clear()
+{
+#ifdef HTTP_CLIENT_TRACE
+  memset(s_ring, 0, sizeof(s_ring));
+  s_index = 0;
+#endif
+}
+
+/*static*/ int HTTPTrace::decode(const char* dump, size_t len, char* out, size_t maxOutLen)
+{
+  HTTPTraceHeader header;
+  if(len < sizeof(header))
+  {
+    return NET_INVALID;
+  }
+  if(maxOutLen == 0)
+  {
+    return NET_TOOSMALL;
+  }
+  memcpy(&header, dump, sizeof(header));
+  if( (header.magic != TRACE_MAGIC) || (header.version != TRACE_VERSION) || (header.entryLen != sizeof(HTTPTraceEntry)) ||
+      (header.size == 0) || (len < sizeof(header) + (size_t)header.size * sizeof(HTTPTraceEntry)) )
+  {
+    return NET_INVALID;
+  }
+
+  size_t outLen = 0;
+  out[0] = '\0';
+  uint32_t count = MIN(header.index, header.size);
+  uint32_t lastTime = 0;
+  bool first = true;
+  for(uint32_t index = header.index - count; index != header.index; index++)
+  {
+    HTTPTraceEntry entry;
+    memcpy(&entry, dump + sizeof(header) + (size_t)(index % header.size) * sizeof(entry), sizeof(entry));
+    if( entry.seq != (uint16_t) index )
+    {
+      continue; //Overwritten while the ring was dumped
+    }
+
+    uint32_t delta = first ? 0 : (entry.time - lastTime);
+    lastTime = entry.time;
+    first = false;
+
+    int lineLen;
+    if( entry.event < HTTP_TRACE_EVENT_COUNT )
+    {
+      const HTTPTraceEventInfo& info = s_events[entry.event];
+      lineLen = snprintf(out + outLen, maxOutLen - outLen, "%10u +%-8u %-8s %s=%d %s=%d\n", (unsigned int)entry.time, (unsigned int)delta,
+          info.name, info.arg[0], (int)entry.arg[0], info.arg[1], (int)entry.arg[1]);
+    }
+    else //Recorded by a newer build
+    {
+      lineLen = snprintf(out + outLen, maxOutLen - outLen, "%10u +%-8u event%u %d %d\n", (unsigned int)entry.time, (unsigned int)delta,
+          (unsigned int)entry.event, (int)entry.arg[0], (int)entry.arg[1]);
+    }
+    if( (lineLen < 0) || ((size_t)lineLen >= maxOutLen - outLen) )
+    {
+      return NET_TOOSMALL;
+    }
+    outLen += lineLen;
+  }
+  return OK;
+}
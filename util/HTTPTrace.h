@@ -0,0 +1,110 @@
+/* HTTPTrace.h */
+/*
+Copyright (C) 2012 ARM Limited.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HTTPTRACE_H_
+#define HTTPTRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef HTTP_TRACE_SIZE
+#define HTTP_TRACE_SIZE 256 //Number of events kept, a power of 2 (16 bytes each)
+#endif
+
+/** Traced events: identifier, name, and names of the two arguments
+ * Events are only ever added at the end, so that dumps of older builds can still be decoded
+ */
+#define HTTP_TRACE_EVENTS(X) \
+  X(REQUEST, "request", "method", "retry") \
+  X(CONNECT, "connect", "ret", "port") \
+  X(SEND, "send", "len", "ret") \
+  X(RECV, "recv", "len", "ret") \
+  X(STATUS, "status", "code", "minor") \
+  X(DONE, "done", "ret", "code")
+
+enum HTTP_TRACE_EVENT
+{
+#define HTTP_TRACE_ENUM(id, name, arg0, arg1) HTTP_TRACE_##id,
+  HTTP_TRACE_EVENTS(HTTP_TRACE_ENUM)
+#undef HTTP_TRACE_ENUM
+  HTTP_TRACE_EVENT_COUNT
+};
+
+/** Record an event in the trace ring
+ * Compiles to nothing unless the library is built with HTTP_CLIENT_TRACE defined
+ */
+#ifdef HTTP_CLIENT_TRACE
+#define HTTP_TRACE(id, arg0, arg1) HTTPTrace::record(HTTP_TRACE_##id, (int32_t)(arg0), (int32_t)(arg1))
+#else
+#define HTTP_TRACE(id, arg0, arg1)
+#endif
+
+/** Binary trace ring: events are recorded with a timestamp and two integers, without any formatting
+ * The ring is dumped as is on the device (sent to a server, read by a debugger...), and decoded offline on a host with the same byte order.
+ * @code
+ * //On the device, built with HTTP_CLIENT_TRACE
+ * char dump[HTTP_TRACE_SIZE * 16 + 16];
+ * size_t len = HTTPTrace::dump(dump, sizeof(dump));
+ *
+ * //On the host
+ * char text[HTTP_TRACE_SIZE * 64];
+ * if( HTTPTrace::decode(dump, len, text, sizeof(text)) == OK ) puts(text);
+ * @endcode
+ */
+class HTTPTrace
+{
+public:
+  /** Record an event, safe to call from several threads; use HTTP_TRACE() instead
+   * @param event Event
+   * @param arg0 First argument
+   * @param arg1 Second argument
+   */
+  static void record(HTTP_TRACE_EVENT event, int32_t arg0, int32_t arg1);
+
+  /** Length of a dump of the ring, 0 when tracing is not built in
+   */
+  static size_t getDumpLen();
+
+  /** Copy the ring, the oldest events are overwritten by events recorded meanwhile
+   * @param buf Buffer receiving the dump
+   * @param maxLen Size of the buffer, at least getDumpLen()
+   * @return Length of the dump, or 0 if the buffer is too small or tracing is not built in
+   */
+  static size_t dump(char* buf, size_t maxLen);
+
+  /** Forget the events recorded so far
+   */
+  static void clear();
+
+  /** Decode a dump into text, one event per line, oldest first, with the time elapsed since the previous event
+   * Does not need tracing to be built in
+   * @param dump Dump returned by dump()
+   * @param len Length of the dump
+   * @param out Buffer receiving the NULL-terminated text
+   * @param maxOutLen Size of the buffer, about 64 bytes per event
+   * @return 0 on success, NET_INVALID if this is not a dump, NET_TOOSMALL if the buffer is too small
+   */
+  static int decode(const char* dump, size_t len, char* out, size_t maxOutLen);
+};
+
+#endif /* HTTPTRACE_H_ */